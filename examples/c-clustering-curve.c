@@ -0,0 +1,138 @@
+/*
+  HMat-OSS (HMatrix library, open source software)
+
+  Copyright (C) 2014-2015 Airbus Group SAS
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+  http://github.com/jeromerobert/hmat-oss
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "hmat/hmat.h"
+#include "examples.h"
+
+/** Cluster trees of the Morton and Hilbert space-filling curves.
+
+    Usage: c-clustering-curve (write|compare) file
+
+    The points of a cylinder are clustered with hmat_create_clustering_morton
+    and hmat_create_clustering_hilbert. Each renumbering must be a permutation
+    and the leaves must not exceed the maximum leaf size. There are enough
+    points for the keys and the sort to be computed in parallel.
+
+    write: save the renumberings to file.
+
+    compare: the renumberings must be the ones of file. Run both with
+    different values of HMAT_NUM_THREADS, the trees must not depend on it.
+ */
+
+#define MAX_LEAF_SIZE 100
+
+/** Check a cluster and its sons, return the number of errors */
+static int checkCluster(hmat_cluster_tree_t * tree) {
+  hmat_cluster_info_t info;
+  size_t nodes = 1;
+  int i, errors = 0;
+  hmat_cluster_get_info(tree, &info);
+  if (info.nr_tree_nodes == 1 && info.size > MAX_LEAF_SIZE) {
+    fprintf(stderr, "Leaf of %d DoFs\n", info.size);
+    errors++;
+  }
+  for (i = 0; nodes < info.nr_tree_nodes; i++) {
+    hmat_cluster_tree_t * son = hmat_cluster_get_son(tree, i);
+    hmat_cluster_info_t sonInfo;
+    hmat_cluster_get_info(son, &sonInfo);
+    nodes += sonInfo.nr_tree_nodes;
+    errors += checkCluster(son);
+  }
+  return errors;
+}
+
+/** Build the tree of a curve, check it and copy its renumbering to indices */
+static int checkCurve(const char * name, hmat_clustering_algorithm_t * curve, double * points, int n, int * indices) {
+  hmat_clustering_algorithm_t * clustering = hmat_create_clustering_max_dof(curve, MAX_LEAF_SIZE);
+  hmat_cluster_tree_t * tree = hmat_create_cluster_tree(points, 3, n, clustering);
+  char * seen = (char *) calloc(n, 1);
+  int i, errors = 0;
+  memcpy(indices, hmat_cluster_get_indices(tree), n * sizeof(int));
+  for (i = 0; i < n; i++) {
+    if (indices[i] < 0 || indices[i] >= n || seen[indices[i]]) {
+      fprintf(stderr, "The renumbering is not a permutation\n");
+      errors++;
+      break;
+    }
+    seen[indices[i]] = 1;
+  }
+  free(seen);
+  errors += checkCluster(tree);
+  printf("%s: %d nodes, %d errors\n", name, hmat_tree_nodes_count(tree), errors);
+  hmat_delete_cluster_tree(tree);
+  hmat_delete_clustering(clustering);
+  hmat_delete_clustering(curve);
+  return errors != 0;
+}
+
+int main(int argc, char **argv) {
+  const int n = 200000;
+  hmat_interface_t hmat;
+  double * points;
+  int * indices;
+  FILE * f;
+  int rc = 0;
+
+  if (argc != 3 || (strcmp(argv[1], "write") != 0 && strcmp(argv[1], "compare") != 0)) {
+    fprintf(stderr, "Usage: %s (write|compare) file\n", argv[0]);
+    return 1;
+  }
+  hmat_init_default_interface(&hmat, HMAT_DOUBLE_PRECISION);
+  if (hmat.init() != 0) {
+    fprintf(stderr, "Unable to initialize HMat library\n");
+    return 1;
+  }
+  points = createCylinder(1., 1.75 * M_PI / sqrt((double)n), n);
+  /* The Morton then the Hilbert renumbering */
+  indices = (int *) malloc(2 * n * sizeof(int));
+  rc |= checkCurve("morton", hmat_create_clustering_morton(), points, n, indices);
+  rc |= checkCurve("hilbert", hmat_create_clustering_hilbert(), points, n, indices + n);
+
+  if (strcmp(argv[1], "write") == 0) {
+    f = fopen(argv[2], "wb");
+    if (f == NULL || fwrite(indices, sizeof(int), 2 * n, f) != (size_t) (2 * n))
+      rc = 1;
+  } else {
+    int * expected = (int *) malloc(2 * n * sizeof(int));
+    f = fopen(argv[2], "rb");
+    if (f == NULL || fread(expected, sizeof(int), 2 * n, f) != (size_t) (2 * n)) {
+      fprintf(stderr, "Cannot read %s\n", argv[2]);
+      rc = 1;
+    } else if (memcmp(indices, expected, 2 * n * sizeof(int)) != 0) {
+      fprintf(stderr, "The renumberings are not the ones of %s\n", argv[2]);
+      rc = 1;
+    }
+    free(expected);
+  }
+  if (f != NULL)
+    fclose(f);
+
+  free(indices);
+  free(points);
+  hmat.finalize();
+  printf("%s\n", rc ? "FAILED" : "OK");
+  return rc;
+}
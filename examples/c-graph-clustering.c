@@ -0,0 +1,183 @@
+/*
+  HMat-OSS (HMatrix library, open source software)
+
+  Copyright (C) 2014-2015 Airbus Group SAS
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+  http://github.com/jeromerobert/hmat-oss
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "hmat/hmat.h"
+
+/** Cluster trees built by hmat_create_cluster_tree_from_graph.
+
+    Usage: c-graph-clustering
+
+    The graph is the 5 points stencil of a square grid, then of two
+    disconnected grids. The renumbering must be a permutation, the leaves
+    must not exceed the maximum leaf size and the sides of a split must be
+    balanced: no child has more than 3/4 of the DoFs of its parent. A leaf
+    must not mix the DoFs of the two grids. The full leaves of the H-matrix
+    built on the disconnected graph must be those of each grid alone: the
+    DoFs of a grid must not look close to each other because they cannot be
+    reached from the other grid.
+ */
+
+#define MAX_LEAF_SIZE 50
+
+/** Graph of the DoFs of grids of nx[g] x nx[g] points, numbered grid by grid */
+typedef struct {
+  int size;
+  int * row_ptr, * col_ind;
+  /** grid of each DoF */
+  int * grid;
+} graph_t;
+
+static void createGraph(graph_t * g, const int * nx, int grids) {
+  int k, i, j, n = 0, first = 0;
+  g->size = 0;
+  for (k = 0; k < grids; k++)
+    g->size += nx[k] * nx[k];
+  g->row_ptr = (int *) malloc((g->size + 1) * sizeof(int));
+  g->col_ind = (int *) malloc(4 * g->size * sizeof(int));
+  g->grid = (int *) malloc(g->size * sizeof(int));
+  g->row_ptr[0] = 0;
+  for (k = 0; k < grids; k++) {
+    for (j = 0; j < nx[k]; j++) {
+      for (i = 0; i < nx[k]; i++) {
+        const int dof = first + j * nx[k] + i;
+        if (i > 0) g->col_ind[n++] = dof - 1;
+        if (i < nx[k] - 1) g->col_ind[n++] = dof + 1;
+        if (j > 0) g->col_ind[n++] = dof - nx[k];
+        if (j < nx[k] - 1) g->col_ind[n++] = dof + nx[k];
+        g->row_ptr[dof + 1] = n;
+        g->grid[dof] = k;
+      }
+    }
+    first += nx[k] * nx[k];
+  }
+}
+
+static void deleteGraph(graph_t * g) {
+  free(g->row_ptr);
+  free(g->col_ind);
+  free(g->grid);
+}
+
+/** Check a cluster and its sons, return the number of errors */
+static int checkCluster(hmat_cluster_tree_t * tree, const graph_t * g) {
+  const int * indices = hmat_cluster_get_indices(tree);
+  hmat_cluster_info_t info;
+  size_t nodes = 1;
+  int i, errors = 0;
+  hmat_cluster_get_info(tree, &info);
+  if (info.nr_tree_nodes == 1) {
+    if (info.size > MAX_LEAF_SIZE) {
+      fprintf(stderr, "Leaf of %d DoFs\n", info.size);
+      errors++;
+    }
+    for (i = info.offset; i < info.offset + info.size; i++) {
+      if (g->grid[indices[i]] != g->grid[indices[info.offset]]) {
+        fprintf(stderr, "Leaf at %d mixes the grids\n", info.offset);
+        return errors + 1;
+      }
+    }
+    return errors;
+  }
+  for (i = 0; nodes < info.nr_tree_nodes; i++) {
+    hmat_cluster_tree_t * son = hmat_cluster_get_son(tree, i);
+    hmat_cluster_info_t sonInfo;
+    hmat_cluster_get_info(son, &sonInfo);
+    if (4 * sonInfo.size > 3 * info.size) {
+      fprintf(stderr, "Son of %d DoFs of a cluster of %d DoFs\n", sonInfo.size, info.size);
+      errors++;
+    }
+    nodes += sonInfo.nr_tree_nodes;
+    errors += checkCluster(son, g);
+  }
+  return errors;
+}
+
+/** Number of full leaves of the H-matrix of the tree, or 0 on error */
+static size_t fullLeaves(hmat_interface_t * hmat, hmat_cluster_tree_t * tree) {
+  hmat_admissibility_t * admissibility = hmat_create_admissibility_standard(2.0);
+  hmat_matrix_t * matrix = hmat->create_empty_hmatrix_admissibility(tree, tree, 0, admissibility);
+  hmat_info_t info;
+  hmat_delete_admissibility(admissibility);
+  if (matrix == NULL || hmat->get_info(matrix, &info))
+    return 0;
+  hmat->destroy(matrix);
+  return info.full_count;
+}
+
+/** Build the tree of the grids, check it and return its number of full leaves */
+static int checkGraph(hmat_interface_t * hmat, const int * nx, int grids, size_t * full) {
+  graph_t g;
+  hmat_cluster_tree_t * tree;
+  const int * indices;
+  char * seen;
+  int i, errors = 0;
+  createGraph(&g, nx, grids);
+  tree = hmat_create_cluster_tree_from_graph(g.size, g.row_ptr, g.col_ind, MAX_LEAF_SIZE);
+  indices = hmat_cluster_get_indices(tree);
+  seen = (char *) calloc(g.size, 1);
+  for (i = 0; i < g.size; i++) {
+    if (indices[i] < 0 || indices[i] >= g.size || seen[indices[i]]) {
+      fprintf(stderr, "The renumbering is not a permutation\n");
+      errors++;
+      break;
+    }
+    seen[indices[i]] = 1;
+  }
+  free(seen);
+  errors += checkCluster(tree, &g);
+  *full = fullLeaves(hmat, tree);
+  printf("%d grids, %d DoFs: %d nodes, %lu full leaves, %d errors\n", grids, g.size,
+         hmat_tree_nodes_count(tree), (unsigned long) *full, errors);
+  hmat_delete_cluster_tree(tree);
+  deleteGraph(&g);
+  return errors != 0 || *full == 0;
+}
+
+int main(int argc, char **argv) {
+  const int nx[2] = { 40, 25 };
+  hmat_interface_t hmat;
+  size_t full[3];
+  int rc = 0;
+
+  if (argc != 1) {
+    fprintf(stderr, "Usage: %s\n", argv[0]);
+    return 1;
+  }
+  hmat_init_default_interface(&hmat, HMAT_DOUBLE_PRECISION);
+  if (hmat.init() != 0) {
+    fprintf(stderr, "Unable to initialize HMat library\n");
+    return 1;
+  }
+  rc |= checkGraph(&hmat, &nx[0], 1, &full[0]);
+  rc |= checkGraph(&hmat, &nx[1], 1, &full[1]);
+  rc |= checkGraph(&hmat, nx, 2, &full[2]);
+  if (full[2] != full[0] + full[1]) {
+    fprintf(stderr, "The disconnected grids have %lu full leaves instead of %lu\n",
+            (unsigned long) full[2], (unsigned long) (full[0] + full[1]));
+    rc = 1;
+  }
+  hmat.finalize();
+  printf("%s\n", rc ? "FAILED" : "OK");
+  return rc;
+}
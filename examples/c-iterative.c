@@ -0,0 +1,233 @@
+/*
+  HMat-OSS (HMatrix library, open source software)
+
+  Copyright (C) 2014-2015 Airbus Group SAS
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+  http://github.com/jeromerobert/hmat-oss
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "hmat/hmat.h"
+#include "examples.h"
+
+/** Iterative solves of a symmetric positive definite system with solve_iterative.
+
+    Usage: c-iterative
+
+    b = A x is computed for a known x, and A x' = b is solved with GMRES,
+    flexible GMRES, CG, BiCGStab and iterative refinement, preconditioned by
+    create_preconditioner with LLT. The relative error of x' must be small
+    and the number of iterations bounded.
+
+    The same system is solved with iterative refinement and GMRES
+    preconditioned by the single precision LLT factorization of
+    create_low_precision_preconditioner. They must reach the double precision
+    accuracy, far below the single precision epsilon, in a few iterations.
+
+    The error contract of solve_iterative is then checked: an unknown method
+    must return 1 and leave x unchanged, and a solve stopped by max_iterations
+    must return 2.
+ */
+
+#define TOLERANCE 1e-10
+/* Below the single precision epsilon */
+#define LOW_PRECISION_TOLERANCE 1e-12
+
+typedef struct {
+  double* points;
+  double l;
+} problem_data_t;
+
+static void interaction(void* data, int i, int j, void* result) {
+  problem_data_t* pdata = (problem_data_t*) data;
+  double r = distanceTo(&pdata->points[3*i], &pdata->points[3*j]);
+  *((double*)result) = exp(-fabs(r) / pdata->l) + (i == j ? 0.1 : 0.);
+}
+
+/** ||a - b|| / ||b|| */
+static double relativeDifference(const double * a, const double * b, int n) {
+  double diff = 0, norm = 0;
+  int i;
+  for (i = 0; i < n; i++) {
+    diff += (a[i] - b[i]) * (a[i] - b[i]);
+    norm += b[i] * b[i];
+  }
+  return sqrt(diff / norm);
+}
+
+/** Solve A x' = b with a method, return 0 if x' is close enough to x */
+static int checkMethod(hmat_interface_t * hmat, hmat_matrix_t * matrix, hmat_matrix_t * preconditioner,
+                       const char * name, hmat_iterative_t method, const double * b, const double * x, int n) {
+  double * y = (double *) malloc(n * sizeof(double));
+  hmat_iterative_context_t ctx;
+  double error = 0;
+  int rc;
+  hmat_iterative_context_init(&ctx);
+  ctx.method = method;
+  ctx.tolerance = TOLERANCE;
+  ctx.preconditioner = preconditioner;
+  rc = hmat->solve_iterative(matrix, &ctx, b, y, 1);
+  if (rc == 0)
+    error = relativeDifference(y, x, n);
+  printf("%s: rc=%d, %d iterations, residual %g, ||x - x'|| / ||x|| = %g\n",
+         name, rc, ctx.iterations, ctx.residual, error);
+  free(y);
+  return rc != 0 || !(ctx.residual <= TOLERANCE) || !(error < 1e-8) || ctx.iterations > 50;
+}
+
+/** Solve A x' = b with a single precision preconditioner, return 0 if x' has the double precision accuracy */
+static int checkLowPrecision(hmat_interface_t * hmat, hmat_matrix_t * matrix, hmat_matrix_t * preconditioner,
+                             const char * name, hmat_iterative_t method, const double * b, const double * x, int n) {
+  double * y = (double *) malloc(n * sizeof(double));
+  hmat_iterative_context_t ctx;
+  double error = 0;
+  int rc;
+  hmat_iterative_context_init(&ctx);
+  ctx.method = method;
+  ctx.tolerance = LOW_PRECISION_TOLERANCE;
+  ctx.preconditioner = preconditioner;
+  ctx.low_precision_preconditioner = 1;
+  rc = hmat->solve_iterative(matrix, &ctx, b, y, 1);
+  if (rc == 0)
+    error = relativeDifference(y, x, n);
+  printf("%s with a single precision preconditioner: rc=%d, %d iterations, residual %g, ||x - x'|| / ||x|| = %g\n",
+         name, rc, ctx.iterations, ctx.residual, error);
+  free(y);
+  return rc != 0 || !(ctx.residual <= LOW_PRECISION_TOLERANCE) || !(error < 1e-10) || ctx.iterations > 10;
+}
+
+/** Check the return codes of solve_iterative and that x is left unchanged on error */
+static int checkErrors(hmat_interface_t * hmat, hmat_matrix_t * matrix, const double * b, int n) {
+  double * y = (double *) malloc(n * sizeof(double));
+  double * initial = (double *) malloc(n * sizeof(double));
+  hmat_iterative_context_t ctx;
+  int i, rc, errors = 0;
+  for (i = 0; i < n; i++)
+    initial[i] = y[i] = sin(i);
+
+  hmat_iterative_context_init(&ctx);
+  ctx.method = (hmat_iterative_t) 42;
+  rc = hmat->solve_iterative(matrix, &ctx, b, y, 1);
+  printf("unknown method: rc=%d\n", rc);
+  if (rc != 1 || memcmp(y, initial, n * sizeof(double)) != 0) {
+    fprintf(stderr, "The failed solve must return 1 and leave x unchanged\n");
+    errors++;
+  }
+
+  hmat_iterative_context_init(&ctx);
+  ctx.tolerance = TOLERANCE;
+  ctx.max_iterations = 2;
+  rc = hmat->solve_iterative(matrix, &ctx, b, y, 1);
+  printf("max_iterations=2: rc=%d, %d iterations, residual %g\n", rc, ctx.iterations, ctx.residual);
+  if (rc != 2 || ctx.iterations != 2 || !(ctx.residual > TOLERANCE)) {
+    fprintf(stderr, "The solve which did not converge must return 2\n");
+    errors++;
+  }
+  free(y);
+  free(initial);
+  return errors;
+}
+
+int main(int argc, char **argv) {
+  const int n = 2000;
+  const char * names[] = { "gmres", "fgmres", "cg", "bicgstab", "refinement" };
+  const hmat_iterative_t methods[] = {
+    hmat_iterative_gmres, hmat_iterative_fgmres, hmat_iterative_cg,
+    hmat_iterative_bicgstab, hmat_iterative_refinement };
+  double one = 1, zero = 0;
+  hmat_interface_t hmat, sp;
+  hmat_clustering_algorithm_t * clustering;
+  hmat_cluster_tree_t * tree;
+  hmat_admissibility_t * admissibility;
+  hmat_assemble_context_t ctx;
+  hmat_factorization_context_t fctx;
+  hmat_matrix_t * matrix, * preconditioner;
+  problem_data_t data;
+  double * x, * b;
+  int i, rc = 0;
+
+  if (argc != 1) {
+    fprintf(stderr, "Usage: %s\n", argv[0]);
+    return 1;
+  }
+  hmat_init_default_interface(&hmat, HMAT_DOUBLE_PRECISION);
+  hmat_init_default_interface(&sp, HMAT_SIMPLE_PRECISION);
+  if (hmat.init() != 0 || sp.init() != 0) {
+    fprintf(stderr, "Unable to initialize HMat library\n");
+    return 1;
+  }
+  data.points = createCylinder(1., 1.75 * M_PI / sqrt((double)n), n);
+  data.l = correlationLength(data.points, n);
+  clustering = hmat_create_clustering_median();
+  tree = hmat_create_cluster_tree(data.points, 3, n, clustering);
+  hmat_delete_clustering(clustering);
+  admissibility = hmat_create_admissibility_standard(2.0);
+  matrix = hmat.create_empty_hmatrix_admissibility(tree, tree, 1, admissibility);
+  hmat_delete_admissibility(admissibility);
+  hmat.set_low_rank_epsilon(matrix, 1e-6);
+  hmat_assemble_context_init(&ctx);
+  ctx.compression = hmat_create_compression_aca_plus(1e-6);
+  ctx.user_context = &data;
+  ctx.simple_compute = interaction;
+  ctx.lower_symmetric = 1;
+  ctx.progress = NULL;
+  rc = hmat.assemble_generic(matrix, &ctx);
+  hmat_delete_compression(ctx.compression);
+
+  /* b = A x in the original numbering */
+  x = (double *) malloc(n * sizeof(double));
+  b = (double *) malloc(n * sizeof(double));
+  for (i = 0; i < n; i++)
+    x[i] = cos(i);
+  rc |= hmat.gemv('N', &one, matrix, x, &zero, b, 1);
+
+  hmat_factorization_context_init(&fctx);
+  fctx.factorization = hmat_factorization_llt;
+  fctx.progress = NULL;
+  preconditioner = rc ? NULL : hmat.create_preconditioner(matrix, 1e-2, &fctx);
+  if (preconditioner == NULL) {
+    rc = 1;
+  } else {
+    for (i = 0; i < 5; i++)
+      rc |= checkMethod(&hmat, matrix, preconditioner, names[i], methods[i], b, x, n);
+    hmat.destroy(preconditioner);
+    rc |= checkErrors(&hmat, matrix, b, n);
+  }
+
+  /* The single precision preconditioner belongs to the sp interface */
+  preconditioner = rc ? NULL : hmat.create_low_precision_preconditioner(matrix, &fctx);
+  if (preconditioner == NULL) {
+    rc = 1;
+  } else {
+    rc |= checkLowPrecision(&hmat, matrix, preconditioner, names[4], methods[4], b, x, n);
+    rc |= checkLowPrecision(&hmat, matrix, preconditioner, names[0], methods[0], b, x, n);
+    sp.destroy(preconditioner);
+  }
+
+  free(x);
+  free(b);
+  hmat.destroy(matrix);
+  hmat_delete_cluster_tree(tree);
+  sp.finalize();
+  hmat.finalize();
+  free(data.points);
+  printf("%s\n", rc ? "FAILED" : "OK");
+  return rc;
+}
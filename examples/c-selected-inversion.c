@@ -0,0 +1,199 @@
+/*
+  HMat-OSS (HMatrix library, open source software)
+
+  Copyright (C) 2014-2015 Airbus Group SAS
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+  http://github.com/jeromerobert/hmat-oss
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "hmat/hmat.h"
+#include "examples.h"
+
+/** Diagonal and diagonal blocks of the inverse of a LLt or LDLt factorized matrix.
+
+    Usage: c-selected-inversion
+
+    A small symmetric positive definite matrix is inverted densely. It is
+    factorized with LLt and LDLt, with small leaves so that the recursion on
+    the diagonal blocks has several levels, and the results of
+    inverse_diagonal and inverse_diagonal_blocks must be those of the dense
+    inverse.
+ */
+
+#define BLOCKS 2
+
+typedef struct {
+  double* points;
+  double l;
+} problem_data_t;
+
+static void interaction(void* data, int i, int j, void* result) {
+  problem_data_t* pdata = (problem_data_t*) data;
+  double r = distanceTo(&pdata->points[3*i], &pdata->points[3*j]);
+  *((double*)result) = exp(-fabs(r) / pdata->l) + (i == j ? 0.1 : 0.);
+}
+
+/** a <- a^-1, with a a n x n symmetric positive definite matrix, return 0 for success */
+static int denseInverse(double * a, int n) {
+  double * l = (double *) calloc((size_t) n * n, sizeof(double));
+  double * x = (double *) malloc(n * sizeof(double));
+  int i, j, k, rc = 0;
+  /* Cholesky, l being row major lower triangular */
+  for (j = 0; j < n && rc == 0; j++) {
+    for (i = j; i < n; i++) {
+      double s = a[i * n + j];
+      for (k = 0; k < j; k++)
+        s -= l[i * n + k] * l[j * n + k];
+      if (i == j) {
+        if (s <= 0) {
+          rc = 1;
+          break;
+        }
+        l[j * n + j] = sqrt(s);
+      } else {
+        l[i * n + j] = s / l[j * n + j];
+      }
+    }
+  }
+  /* Column j of the inverse is the solution of L L^T x = e_j */
+  for (j = 0; j < n && rc == 0; j++) {
+    for (i = 0; i < n; i++) {
+      double s = i == j ? 1 : 0;
+      for (k = 0; k < i; k++)
+        s -= l[i * n + k] * x[k];
+      x[i] = s / l[i * n + i];
+    }
+    for (i = n - 1; i >= 0; i--) {
+      double s = x[i];
+      for (k = i + 1; k < n; k++)
+        s -= l[k * n + i] * x[k];
+      x[i] = s / l[i * n + i];
+    }
+    for (i = 0; i < n; i++)
+      a[i * n + j] = x[i];
+  }
+  free(l);
+  free(x);
+  return rc;
+}
+
+/** Factorize with f, check the selected entries against the inverse, return 0 for success */
+static int checkFactorization(hmat_interface_t * hmat, hmat_cluster_tree_t * tree, problem_data_t * data,
+                              const char * name, hmat_factorization_t f, const double * inverse, int n) {
+  /* A block of consecutive rows and a scattered one */
+  const int sizes[BLOCKS] = { 10, 4 };
+  const int indices[] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 5, n / 3, n / 2, n - 1 };
+  hmat_admissibility_t * admissibility = hmat_create_admissibility_standard(2.0);
+  hmat_matrix_t * matrix = hmat->create_empty_hmatrix_admissibility(tree, tree, 1, admissibility);
+  hmat_assemble_context_t ctx;
+  hmat_factorization_context_t fctx;
+  double * diagonal = (double *) malloc(n * sizeof(double));
+  double * blocks = (double *) malloc((10 * 10 + 4 * 4) * sizeof(double));
+  double diagonalError = 0, blockError = 0;
+  const int * index = indices;
+  const double * block = blocks;
+  int b, i, j, rc;
+  hmat_delete_admissibility(admissibility);
+  hmat->set_low_rank_epsilon(matrix, 1e-10);
+  hmat_assemble_context_init(&ctx);
+  ctx.compression = hmat_create_compression_aca_plus(1e-10);
+  ctx.user_context = data;
+  ctx.simple_compute = interaction;
+  ctx.lower_symmetric = 1;
+  ctx.progress = NULL;
+  hmat_factorization_context_init(&fctx);
+  fctx.factorization = f;
+  fctx.progress = NULL;
+  rc = hmat->assemble_generic(matrix, &ctx) || hmat->factorize_generic(matrix, &fctx)
+    || hmat->inverse_diagonal(matrix, diagonal)
+    || hmat->inverse_diagonal_blocks(matrix, BLOCKS, sizes, indices, blocks);
+  hmat_delete_compression(ctx.compression);
+  hmat->destroy(matrix);
+
+  for (i = 0; rc == 0 && i < n; i++) {
+    const double e = fabs(diagonal[i] - inverse[i * n + i]) / fabs(inverse[i * n + i]);
+    if (e > diagonalError)
+      diagonalError = e;
+  }
+  for (b = 0; rc == 0 && b < BLOCKS; b++) {
+    for (j = 0; j < sizes[b]; j++) {
+      for (i = 0; i < sizes[b]; i++) {
+        const double expected = inverse[index[i] * n + index[j]];
+        const double e = fabs(block[i + j * sizes[b]] - expected) / fabs(inverse[index[i] * n + index[i]]);
+        if (e > blockError)
+          blockError = e;
+      }
+    }
+    index += sizes[b];
+    block += sizes[b] * sizes[b];
+  }
+  printf("%s: rc=%d, diagonal error %g, blocks error %g\n", name, rc, diagonalError, blockError);
+  free(diagonal);
+  free(blocks);
+  return rc != 0 || !(diagonalError < 1e-6) || !(blockError < 1e-6);
+}
+
+int main(int argc, char **argv) {
+  const int n = 600;
+  hmat_interface_t hmat;
+  hmat_clustering_algorithm_t * median, * clustering;
+  hmat_cluster_tree_t * tree;
+  problem_data_t data;
+  double * inverse;
+  int i, j, rc = 0;
+
+  if (argc != 1) {
+    fprintf(stderr, "Usage: %s\n", argv[0]);
+    return 1;
+  }
+  hmat_init_default_interface(&hmat, HMAT_DOUBLE_PRECISION);
+  if (hmat.init() != 0) {
+    fprintf(stderr, "Unable to initialize HMat library\n");
+    return 1;
+  }
+  data.points = createCylinder(1., 1.75 * M_PI / sqrt((double)n), n);
+  data.l = correlationLength(data.points, n);
+  median = hmat_create_clustering_median();
+  clustering = hmat_create_clustering_max_dof(median, 20);
+  tree = hmat_create_cluster_tree(data.points, 3, n, clustering);
+  hmat_delete_clustering(clustering);
+  hmat_delete_clustering(median);
+
+  /* The dense inverse, in the original numbering */
+  inverse = (double *) malloc((size_t) n * n * sizeof(double));
+  for (i = 0; i < n; i++)
+    for (j = 0; j < n; j++)
+      interaction(&data, i, j, &inverse[i * n + j]);
+  if (denseInverse(inverse, n)) {
+    fprintf(stderr, "The matrix is not positive definite\n");
+    rc = 1;
+  } else {
+    rc |= checkFactorization(&hmat, tree, &data, "llt", hmat_factorization_llt, inverse, n);
+    rc |= checkFactorization(&hmat, tree, &data, "ldlt", hmat_factorization_ldlt, inverse, n);
+  }
+
+  free(inverse);
+  hmat_delete_cluster_tree(tree);
+  hmat.finalize();
+  free(data.points);
+  printf("%s\n", rc ? "FAILED" : "OK");
+  return rc;
+}
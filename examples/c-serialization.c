@@ -0,0 +1,272 @@
+/*
+  HMat-OSS (HMatrix library, open source software)
+
+  Copyright (C) 2014-2015 Airbus Group SAS
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+  http://github.com/jeromerobert/hmat-oss
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "hmat/hmat.h"
+#include "examples.h"
+
+/** Round trip of a matrix through the serialization functions.
+
+    Usage: c-serialization (chunked|mapped)
+
+    chunked: write_data_chunked and read_data_chunked, then the same
+    stream with a flipped byte, with a corrupted header and truncated must
+    be rejected.
+
+    mapped: write_mapped and read_mapped, then the LU factorization of the
+    mapped matrix, which copies the blocks it modifies out of the file, and
+    a solve. The file must be left unchanged.
+ */
+
+typedef struct {
+  double* points;
+  double l;
+} problem_data_t;
+
+static void interaction(void* data, int i, int j, void* result) {
+  problem_data_t* pdata = (problem_data_t*) data;
+  double r = distanceTo(&pdata->points[3*i], &pdata->points[3*j]);
+  *((double*)result) = exp(-fabs(r) / pdata->l) + (i == j ? 0.1 : 0.);
+}
+
+/** A growing memory buffer, read back from pos up to size */
+typedef struct {
+  char * data;
+  size_t size, capacity, pos;
+} buffer_t;
+
+static void writeToBuffer(void * data, size_t n, void * user_data) {
+  buffer_t * b = (buffer_t *) user_data;
+  if (b->size + n > b->capacity) {
+    b->capacity = 2 * (b->size + n);
+    b->data = (char *) realloc(b->data, b->capacity);
+  }
+  memcpy(b->data + b->size, data, n);
+  b->size += n;
+}
+
+/** Read from the buffer, the bytes past its end are 0 as in a truncated stream */
+static void readFromBuffer(void * data, size_t n, void * user_data) {
+  buffer_t * b = (buffer_t *) user_data;
+  size_t available = b->pos < b->size ? b->size - b->pos : 0;
+  size_t k = n < available ? n : available;
+  memcpy(data, b->data + b->pos, k);
+  memset((char *) data + k, 0, n - k);
+  b->pos += n;
+}
+
+/** Relative difference of the products of 2 matrices by the same vector */
+static double productDifference(hmat_interface_t * hmat, hmat_matrix_t * a, hmat_matrix_t * b, int n) {
+  double one = 1, zero = 0, diff = 0, norm = 0;
+  double * x = (double *) malloc(n * sizeof(double));
+  double * ya = (double *) malloc(n * sizeof(double));
+  double * yb = (double *) malloc(n * sizeof(double));
+  int i;
+  for (i = 0; i < n; i++)
+    x[i] = cos(i);
+  hmat->gemm_dense('N', 'N', 'L', &one, a, x, &zero, ya, 1);
+  hmat->gemm_dense('N', 'N', 'L', &one, b, x, &zero, yb, 1);
+  for (i = 0; i < n; i++) {
+    diff += (ya[i] - yb[i]) * (ya[i] - yb[i]);
+    norm += ya[i] * ya[i];
+  }
+  free(x);
+  free(ya);
+  free(yb);
+  return sqrt(diff / norm);
+}
+
+/** Read the struct and data buffers, return the matrix or NULL if read_data_chunked failed */
+static hmat_matrix_t * readChunked(hmat_interface_t * hmat, buffer_t * structure, buffer_t * data) {
+  hmat_matrix_t * m;
+  structure->pos = 0;
+  data->pos = 0;
+  m = hmat->read_struct(readFromBuffer, structure);
+  if (hmat->read_data_chunked(m, readFromBuffer, data)) {
+    hmat->destroy(m);
+    return NULL;
+  }
+  return m;
+}
+
+static int testChunked(hmat_interface_t * hmat, hmat_matrix_t * matrix, int n) {
+  buffer_t structure = { NULL, 0, 0, 0 }, data = { NULL, 0, 0, 0 };
+  hmat_matrix_t * copy;
+  int compress, rc = 0;
+  hmat->write_struct(matrix, writeToBuffer, &structure);
+  for (compress = 0; compress < 2 && rc == 0; compress++) {
+    double diff;
+    size_t size;
+    data.size = 0;
+    if (hmat->write_data_chunked(matrix, writeToBuffer, &data, compress))
+      return 1;
+    copy = readChunked(hmat, &structure, &data);
+    if (copy == NULL)
+      return 1;
+    diff = productDifference(hmat, matrix, copy, n);
+    hmat->destroy(copy);
+    printf("compress=%d: %lu bytes, ||A x - A' x|| / ||A x|| = %g\n", compress, (unsigned long) data.size, diff);
+    if (diff != 0)
+      rc = 1;
+
+    /* A flipped byte in the middle of the blocks */
+    data.data[data.size / 2] ^= 0x10;
+    copy = readChunked(hmat, &structure, &data);
+    data.data[data.size / 2] ^= 0x10;
+    if (copy != NULL) {
+      fprintf(stderr, "The corrupted stream was read\n");
+      hmat->destroy(copy);
+      rc = 1;
+    }
+    /* A huge chunk size announced in the header, the most significant
+       byte of its last field, must be rejected before any allocation */
+    data.data[39] ^= 0x40;
+    copy = readChunked(hmat, &structure, &data);
+    data.data[39] ^= 0x40;
+    if (copy != NULL) {
+      fprintf(stderr, "The stream with a corrupted header was read\n");
+      hmat->destroy(copy);
+      rc = 1;
+    }
+    /* A truncated stream */
+    size = data.size;
+    data.size = size - size / 3;
+    copy = readChunked(hmat, &structure, &data);
+    data.size = size;
+    if (copy != NULL) {
+      fprintf(stderr, "The truncated stream was read\n");
+      hmat->destroy(copy);
+      rc = 1;
+    }
+  }
+  free(structure.data);
+  free(data.data);
+  return rc;
+}
+
+static int testMapped(hmat_interface_t * hmat, hmat_matrix_t * matrix, int n) {
+  const char * filename = "c-serialization.hmat";
+  double one = 1, zero = 0, diff = 0, norm = 0;
+  double * x, * b;
+  hmat_matrix_t * mapped;
+  hmat_factorization_context_t ctx;
+  int i, rc = 0;
+  if (hmat->write_mapped(matrix, filename))
+    return 1;
+  mapped = hmat->read_mapped(filename);
+  if (mapped == NULL)
+    return 1;
+  diff = productDifference(hmat, matrix, mapped, n);
+  printf("mapped: ||A x - A' x|| / ||A x|| = %g\n", diff);
+  if (diff != 0)
+    rc = 1;
+
+  /* Solve A x = b with the factorized mapped matrix, b from the original one */
+  x = (double *) malloc(n * sizeof(double));
+  b = (double *) malloc(n * sizeof(double));
+  for (i = 0; i < n; i++)
+    x[i] = cos(i);
+  hmat->gemm_dense('N', 'N', 'L', &one, matrix, x, &zero, b, 1);
+  hmat_factorization_context_init(&ctx);
+  ctx.factorization = hmat_factorization_lu;
+  if (hmat->factorize_generic(mapped, &ctx) || hmat->solve_dense(mapped, b, 1)) {
+    rc = 1;
+  } else {
+    diff = 0;
+    for (i = 0; i < n; i++) {
+      diff += (b[i] - x[i]) * (b[i] - x[i]);
+      norm += x[i] * x[i];
+    }
+    diff = sqrt(diff / norm);
+    printf("mapped LU: ||x - x'|| / ||x|| = %g\n", diff);
+    if (!(diff < 1e-2))
+      rc = 1;
+  }
+  free(x);
+  free(b);
+  hmat->destroy(mapped);
+
+  /* The factorization must not have modified the file */
+  mapped = hmat->read_mapped(filename);
+  if (mapped == NULL)
+    return 1;
+  diff = productDifference(hmat, matrix, mapped, n);
+  printf("mapped after LU: ||A x - A' x|| / ||A x|| = %g\n", diff);
+  if (diff != 0)
+    rc = 1;
+  hmat->destroy(mapped);
+  remove(filename);
+  return rc;
+}
+
+int main(int argc, char **argv) {
+  const int n = 2000;
+  hmat_interface_t hmat;
+  hmat_clustering_algorithm_t* clustering;
+  hmat_cluster_tree_t* cluster_tree;
+  hmat_admissibility_t * admissibility;
+  hmat_assemble_context_t ctx;
+  hmat_matrix_t * matrix;
+  problem_data_t problem_data;
+  int rc;
+
+  if (argc != 2 || (strcmp(argv[1], "chunked") != 0 && strcmp(argv[1], "mapped") != 0)) {
+    fprintf(stderr, "Usage: %s (chunked|mapped)\n", argv[0]);
+    return 1;
+  }
+
+  hmat_init_default_interface(&hmat, HMAT_DOUBLE_PRECISION);
+  if (0 != hmat.init()) {
+    fprintf(stderr, "Unable to initialize HMat library\n");
+    return 1;
+  }
+  problem_data.points = createCylinder(1., 1.75 * M_PI / sqrt((double)n), n);
+  problem_data.l = correlationLength(problem_data.points, n);
+
+  clustering = hmat_create_clustering_median();
+  cluster_tree = hmat_create_cluster_tree(problem_data.points, 3, n, clustering);
+  hmat_delete_clustering(clustering);
+  admissibility = hmat_create_admissibility_standard(2.0);
+  matrix = hmat.create_empty_hmatrix_admissibility(cluster_tree, cluster_tree, 0, admissibility);
+  hmat_delete_admissibility(admissibility);
+  hmat_assemble_context_init(&ctx);
+  ctx.compression = hmat_create_compression_aca_plus(1e-4);
+  ctx.user_context = &problem_data;
+  ctx.simple_compute = interaction;
+  hmat.assemble_generic(matrix, &ctx);
+  hmat_delete_compression(ctx.compression);
+
+  if (strcmp(argv[1], "chunked") == 0)
+    rc = testChunked(&hmat, matrix, n);
+  else
+    rc = testMapped(&hmat, matrix, n);
+
+  hmat.destroy(matrix);
+  hmat_delete_cluster_tree(cluster_tree);
+  hmat.finalize();
+  free(problem_data.points);
+  printf("%s\n", rc ? "FAILED" : "OK");
+  return rc;
+}
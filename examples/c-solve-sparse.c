@@ -0,0 +1,201 @@
+/*
+  HMat-OSS (HMatrix library, open source software)
+
+  Copyright (C) 2014-2015 Airbus Group SAS
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+  http://github.com/jeromerobert/hmat-oss
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "hmat/hmat.h"
+#include "examples.h"
+
+/** Sparse solves of solve_sparse against the full solve.
+
+    Usage: c-solve-sparse
+
+    The matrix is factorized with LU, LDLt and LLt. A right-hand side which
+    is zero outside of a few clusters and a scattered row is solved by
+    solve_sparse, giving the nonzero rows, the requested rows or both, and
+    by solve_systems. The solutions must be the same on the requested rows,
+    the triangular solves only skipping blocks which see zero inputs or
+    produce unneeded outputs. Without any nonzero row, the solution is 0.
+ */
+
+#define NRHS 2
+
+typedef struct {
+  double* points;
+  double l;
+} problem_data_t;
+
+static void interaction(void* data, int i, int j, void* result) {
+  problem_data_t* pdata = (problem_data_t*) data;
+  double r = distanceTo(&pdata->points[3*i], &pdata->points[3*j]);
+  *((double*)result) = exp(-fabs(r) / pdata->l) + (i == j ? 0.1 : 0.);
+}
+
+/** Rows of the original numbering, stored at internal positions which form a few ranges */
+typedef struct {
+  int count;
+  int * rows;
+} rows_t;
+
+/** Add the original rows of the internal rows [first, first + size) */
+static void addRange(rows_t * r, const int * indices, int first, int size) {
+  int i;
+  for (i = 0; i < size; i++)
+    r->rows[r->count++] = indices[first + i];
+}
+
+/**
+ * Solve with solve_sparse, nonzero and requested being NULL for all the rows,
+ * and compare the requested rows with the full solution x. Return 0 for success.
+ */
+static int checkSolve(hmat_interface_t * hmat, hmat_matrix_t * matrix, const char * name,
+                      const double * b, const double * x, int n,
+                      const rows_t * nonzero, const rows_t * requested) {
+  double * y = (double *) malloc(n * NRHS * sizeof(double));
+  double diff = 0, norm = 0;
+  int i, k, rc;
+  memcpy(y, b, n * NRHS * sizeof(double));
+  rc = hmat->solve_sparse(matrix, y, NRHS, nonzero ? nonzero->count : -1, nonzero ? nonzero->rows : NULL,
+                          requested ? requested->count : -1, requested ? requested->rows : NULL);
+  for (k = 0; rc == 0 && k < NRHS; k++) {
+    const int count = requested ? requested->count : n;
+    for (i = 0; i < count; i++) {
+      const int row = k * n + (requested ? requested->rows[i] : i);
+      diff += (y[row] - x[row]) * (y[row] - x[row]);
+      norm += x[row] * x[row];
+    }
+  }
+  diff = norm > 0 ? sqrt(diff / norm) : sqrt(diff);
+  printf("%s: rc=%d, sparse vs full solve: %g\n", name, rc, diff);
+  free(y);
+  return rc != 0 || !(diff < 1e-12);
+}
+
+/** Factorize with f and check the sparse solves, return 0 for success */
+static int checkFactorization(hmat_interface_t * hmat, hmat_cluster_tree_t * tree, problem_data_t * data,
+                              const char * name, hmat_factorization_t f, int n) {
+  const int * indices = hmat_cluster_get_indices(tree);
+  const int symmetric = f != hmat_factorization_lu;
+  hmat_admissibility_t * admissibility = hmat_create_admissibility_standard(2.0);
+  hmat_matrix_t * matrix = hmat->create_empty_hmatrix_admissibility(tree, tree, symmetric, admissibility);
+  hmat_assemble_context_t ctx;
+  hmat_factorization_context_t fctx;
+  rows_t nonzero, requested, none;
+  double * b = (double *) calloc(n * NRHS, sizeof(double));
+  double * x = (double *) malloc(n * NRHS * sizeof(double));
+  char label[64];
+  int i, k, rc;
+  hmat_delete_admissibility(admissibility);
+  hmat->set_low_rank_epsilon(matrix, 1e-6);
+  hmat_assemble_context_init(&ctx);
+  ctx.compression = hmat_create_compression_aca_plus(1e-6);
+  ctx.user_context = data;
+  ctx.simple_compute = interaction;
+  ctx.lower_symmetric = symmetric;
+  ctx.progress = NULL;
+  hmat_factorization_context_init(&fctx);
+  fctx.factorization = f;
+  fctx.progress = NULL;
+  rc = hmat->assemble_generic(matrix, &ctx) || hmat->factorize_generic(matrix, &fctx);
+  hmat_delete_compression(ctx.compression);
+
+  /* b is zero outside of two clusters in the middle and a row near the end */
+  nonzero.count = 0;
+  nonzero.rows = (int *) malloc(n * sizeof(int));
+  addRange(&nonzero, indices, n / 2, 40);
+  addRange(&nonzero, indices, 3 * n / 4, 10);
+  addRange(&nonzero, indices, n - 5, 1);
+  for (k = 0; k < NRHS; k++)
+    for (i = 0; i < nonzero.count; i++)
+      b[k * n + nonzero.rows[i]] = cos(i + k);
+  /* The requested rows are a range at the beginning and another one among the nonzero rows */
+  requested.count = 0;
+  requested.rows = (int *) malloc(n * sizeof(int));
+  addRange(&requested, indices, 100, 50);
+  addRange(&requested, indices, 3 * n / 4 - 5, 20);
+  none.count = 0;
+  none.rows = NULL;
+
+  memcpy(x, b, n * NRHS * sizeof(double));
+  rc = rc || hmat->solve_systems(matrix, x, NRHS);
+  if (rc == 0) {
+    snprintf(label, sizeof(label), "%s, nonzero rows", name);
+    rc |= checkSolve(hmat, matrix, label, b, x, n, &nonzero, NULL);
+    snprintf(label, sizeof(label), "%s, requested rows", name);
+    rc |= checkSolve(hmat, matrix, label, b, x, n, NULL, &requested);
+    snprintf(label, sizeof(label), "%s, nonzero and requested rows", name);
+    rc |= checkSolve(hmat, matrix, label, b, x, n, &nonzero, &requested);
+    /* Without any nonzero row, the right-hand side and the solution are 0 */
+    memset(x, 0, n * NRHS * sizeof(double));
+    snprintf(label, sizeof(label), "%s, no nonzero row", name);
+    rc |= checkSolve(hmat, matrix, label, x, x, n, &none, NULL);
+  } else {
+    fprintf(stderr, "%s failed\n", name);
+  }
+
+  hmat->destroy(matrix);
+  free(nonzero.rows);
+  free(requested.rows);
+  free(b);
+  free(x);
+  return rc;
+}
+
+int main(int argc, char **argv) {
+  const int n = 2000;
+  const char * names[] = { "lu", "ldlt", "llt" };
+  const hmat_factorization_t factorizations[] = {
+    hmat_factorization_lu, hmat_factorization_ldlt, hmat_factorization_llt };
+  hmat_interface_t hmat;
+  hmat_clustering_algorithm_t * median, * clustering;
+  hmat_cluster_tree_t * tree;
+  problem_data_t data;
+  int i, rc = 0;
+
+  if (argc != 1) {
+    fprintf(stderr, "Usage: %s\n", argv[0]);
+    return 1;
+  }
+  hmat_init_default_interface(&hmat, HMAT_DOUBLE_PRECISION);
+  if (hmat.init() != 0) {
+    fprintf(stderr, "Unable to initialize HMat library\n");
+    return 1;
+  }
+  data.points = createCylinder(1., 1.75 * M_PI / sqrt((double)n), n);
+  data.l = correlationLength(data.points, n);
+  median = hmat_create_clustering_median();
+  clustering = hmat_create_clustering_max_dof(median, 50);
+  tree = hmat_create_cluster_tree(data.points, 3, n, clustering);
+  hmat_delete_clustering(clustering);
+  hmat_delete_clustering(median);
+
+  for (i = 0; i < 3; i++)
+    rc |= checkFactorization(&hmat, tree, &data, names[i], factorizations[i], n);
+
+  hmat_delete_cluster_tree(tree);
+  hmat.finalize();
+  free(data.points);
+  printf("%s\n", rc ? "FAILED" : "OK");
+  return rc;
+}
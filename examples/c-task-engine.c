@@ -0,0 +1,242 @@
+/*
+  HMat-OSS (HMatrix library, open source software)
+
+  Copyright (C) 2014-2015 Airbus Group SAS
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+  http://github.com/jeromerobert/hmat-oss
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "hmat/hmat.h"
+#include "examples.h"
+
+/** Compare the task engine (hmat_init_task_interface) with the default one.
+
+    Usage: c-task-engine
+
+    The products of the same matrix assembled by both engines, transposed or
+    not, must be the same. It is also factorized with LU, LDLT, LLT and
+    HODLR by both engines, and the solutions of A x = b must be the same up
+    to the rounding errors. The blocks ask for the memory of their values before
+    being computed, and the budget of the parallel assembly
+    (hmat_settings_t.assemblyMemory) is much smaller than the total. Run it
+    with HMAT_NUM_THREADS > 1 to test the parallel algorithms.
+ */
+
+typedef struct {
+  double* points;
+  double l;
+} problem_data_t;
+
+static void interaction(void* data, int i, int j, void* result) {
+  problem_data_t* pdata = (problem_data_t*) data;
+  double r = distanceTo(&pdata->points[3*i], &pdata->points[3*j]);
+  *((double*)result) = exp(-fabs(r) / pdata->l) + (i == j ? 0.1 : 0.);
+}
+
+/** User data of a block */
+typedef struct {
+  int row_start, col_start;
+  int * row_hmat2client, * col_hmat2client;
+  problem_data_t * problem;
+} block_data_t;
+
+/**
+ * Prepare the assembly of a block, asking for the memory of its values as
+ * a kernel caching them would do, so that the assembly memory budget of the
+ * task engine is used.
+ */
+static void prepare(int row_start, int row_count, int col_start, int col_count,
+                    int *row_hmat2client, int *row_client2hmat, int *col_hmat2client, int *col_client2hmat,
+                    void *user_context, hmat_block_info_t * block_info) {
+  block_data_t * bdata;
+  (void) row_client2hmat; (void) col_client2hmat;
+  if (block_info->needed_memory == 0) {
+    block_info->needed_memory = (size_t) row_count * col_count * sizeof(double);
+    return;
+  }
+  bdata = (block_data_t *) malloc(sizeof(block_data_t));
+  bdata->row_start = row_start;
+  bdata->col_start = col_start;
+  bdata->row_hmat2client = row_hmat2client;
+  bdata->col_hmat2client = col_hmat2client;
+  bdata->problem = (problem_data_t *) user_context;
+  block_info->user_data = bdata;
+  block_info->release_user_data = free;
+}
+
+static void compute(void *data, int row_start, int row_count, int col_start, int col_count, void *values) {
+  block_data_t * bdata = (block_data_t *) data;
+  double * v = (double *) values;
+  int i, j;
+  for (j = 0; j < col_count; j++) {
+    const int col = bdata->col_hmat2client[bdata->col_start + col_start + j];
+    for (i = 0; i < row_count; i++)
+      interaction(bdata->problem, bdata->row_hmat2client[bdata->row_start + row_start + i], col, v++);
+  }
+}
+
+/** ||a - b|| / ||b|| */
+static double relativeDifference(const double * a, const double * b, int n) {
+  double diff = 0, norm = 0;
+  int i;
+  for (i = 0; i < n; i++) {
+    diff += (a[i] - b[i]) * (a[i] - b[i]);
+    norm += b[i] * b[i];
+  }
+  return sqrt(diff / norm);
+}
+
+static hmat_matrix_t * assemble(hmat_interface_t * hmat, hmat_cluster_tree_t * tree, problem_data_t * data,
+                                int symmetric, int hodlr) {
+  hmat_admissibility_t * admissibility = hodlr ? hmat_create_admissibility_hodlr()
+                                               : hmat_create_admissibility_standard(2.0);
+  hmat_matrix_t * matrix = hmat->create_empty_hmatrix_admissibility(tree, tree, symmetric, admissibility);
+  hmat_assemble_context_t ctx;
+  hmat_delete_admissibility(admissibility);
+  hmat->set_low_rank_epsilon(matrix, 1e-5);
+  hmat_assemble_context_init(&ctx);
+  ctx.compression = hmat_create_compression_aca_plus(1e-5);
+  ctx.user_context = data;
+  ctx.prepare = prepare;
+  ctx.block_compute = compute;
+  ctx.lower_symmetric = symmetric;
+  ctx.progress = NULL;
+  if (hmat->assemble_generic(matrix, &ctx)) {
+    hmat->destroy(matrix);
+    matrix = NULL;
+  }
+  hmat_delete_compression(ctx.compression);
+  return matrix;
+}
+
+/**
+ * Solve A x = b with the factorization f of the matrix assembled by an
+ * engine, b being in the internal numbering. Return 0 for success.
+ */
+static int factorizeAndSolve(hmat_interface_t * hmat, hmat_cluster_tree_t * tree, problem_data_t * data,
+                             hmat_factorization_t f, double * b) {
+  /* All the factorizations but LU use the lower part of the matrix */
+  const int symmetric = f != hmat_factorization_lu;
+  hmat_matrix_t * matrix = assemble(hmat, tree, data, symmetric, f == hmat_factorization_hodlr);
+  hmat_factorization_context_t ctx;
+  int rc;
+  if (matrix == NULL)
+    return 1;
+  hmat_factorization_context_init(&ctx);
+  ctx.factorization = f;
+  ctx.progress = NULL;
+  rc = hmat->factorize_generic(matrix, &ctx) || hmat->solve_dense(matrix, b, 1);
+  hmat->destroy(matrix);
+  return rc;
+}
+
+int main(int argc, char **argv) {
+  const int n = 2000;
+  const char * names[] = { "lu", "ldlt", "llt", "hodlr" };
+  const hmat_factorization_t factorizations[] = {
+    hmat_factorization_lu, hmat_factorization_ldlt, hmat_factorization_llt, hmat_factorization_hodlr };
+  double one = 1, zero = 0;
+  hmat_interface_t hmat, task;
+  hmat_settings_t settings;
+  hmat_clustering_algorithm_t * median, * clustering;
+  hmat_cluster_tree_t * tree;
+  hmat_matrix_t * matrix, * taskMatrix;
+  problem_data_t data;
+  double * x, * b, * xDefault, * xTask;
+  int i, rc = 0;
+
+  if (argc != 1) {
+    fprintf(stderr, "Usage: %s\n", argv[0]);
+    return 1;
+  }
+  hmat_get_parameters(&settings);
+  settings.assemblyMemory = 1 << 20;
+  hmat_set_parameters(&settings);
+  hmat_init_default_interface(&hmat, HMAT_DOUBLE_PRECISION);
+  hmat_init_task_interface(&task, HMAT_DOUBLE_PRECISION);
+  if (hmat.init() != 0 || task.init() != 0) {
+    fprintf(stderr, "Unable to initialize HMat library\n");
+    return 1;
+  }
+  data.points = createCylinder(1., 1.75 * M_PI / sqrt((double)n), n);
+  data.l = correlationLength(data.points, n);
+  median = hmat_create_clustering_median();
+  clustering = hmat_create_clustering_max_dof(median, 50);
+  tree = hmat_create_cluster_tree(data.points, 3, n, clustering);
+  hmat_delete_clustering(clustering);
+  hmat_delete_clustering(median);
+
+  /* b = A x in the internal numbering */
+  x = (double *) malloc(n * sizeof(double));
+  b = (double *) malloc(n * sizeof(double));
+  xDefault = (double *) malloc(n * sizeof(double));
+  xTask = (double *) malloc(n * sizeof(double));
+  for (i = 0; i < n; i++)
+    x[i] = cos(i);
+  matrix = assemble(&hmat, tree, &data, 0, 0);
+  hmat.gemm_dense('N', 'N', 'L', &one, matrix, x, &zero, b, 1);
+
+  /* Products by the matrix assembled by the task engine */
+  taskMatrix = assemble(&task, tree, &data, 0, 0);
+  for (i = 0; i < 2 && taskMatrix != NULL; i++) {
+    const char trans = i == 0 ? 'N' : 'T';
+    double diff;
+    hmat.gemm_dense(trans, 'N', 'L', &one, matrix, x, &zero, xDefault, 1);
+    task.gemm_dense(trans, 'N', 'L', &one, taskMatrix, x, &zero, xTask, 1);
+    diff = relativeDifference(xTask, xDefault, n);
+    printf("gemv %c: task vs default engine: %g\n", trans, diff);
+    if (!(diff < 1e-12))
+      rc = 1;
+  }
+  if (taskMatrix == NULL)
+    rc = 1;
+  else
+    task.destroy(taskMatrix);
+  hmat.destroy(matrix);
+
+  for (i = 0; i < 4; i++) {
+    double error, diff;
+    memcpy(xDefault, b, n * sizeof(double));
+    memcpy(xTask, b, n * sizeof(double));
+    if (factorizeAndSolve(&hmat, tree, &data, factorizations[i], xDefault)
+        || factorizeAndSolve(&task, tree, &data, factorizations[i], xTask)) {
+      fprintf(stderr, "%s failed\n", names[i]);
+      rc = 1;
+      continue;
+    }
+    error = relativeDifference(xTask, x, n);
+    diff = relativeDifference(xTask, xDefault, n);
+    printf("%s: ||x - x'|| / ||x|| = %g, task vs default engine: %g\n", names[i], error, diff);
+    if (!(error < 1e-3) || !(diff < 1e-10))
+      rc = 1;
+  }
+
+  free(x);
+  free(b);
+  free(xDefault);
+  free(xTask);
+  hmat_delete_cluster_tree(tree);
+  task.finalize();
+  hmat.finalize();
+  free(data.points);
+  printf("%s\n", rc ? "FAILED" : "OK");
+  return rc;
+}
@@ -0,0 +1,187 @@
+/*
+  HMat-OSS (HMatrix library, open source software)
+
+  Copyright (C) 2014-2015 Airbus Group SAS
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+  http://github.com/jeromerobert/hmat-oss
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "hmat/hmat.h"
+
+/** Conversion of the timeline traces of both versions by hmat_timeline_export.
+
+    Usage: c-timeline-version
+
+    The same records, block operations with 0 to 3 blocks and operations
+    with integer arguments, are written in the format of version 1 (no
+    header, no payload length) and of version 2. Both traces must be
+    converted with all their records. A version 1 trace whose last record
+    is partially written must be converted up to that record and reported
+    as damaged. The library does not need to be compiled with HMAT_TIMELINE.
+ */
+
+/* Timeline::Operation codes */
+enum { OP_GEMM = 0, OP_AXPY = 1, OP_SOLVE_UPPER = 2, OP_INIT = 13, OP_QR = 18, OP_BLASGEMM = 19 };
+/* "HMTL" and Timeline::TRACE_VERSION */
+#define TRACE_MAGIC 0x4c544d48
+#define TRACE_VERSION 2
+/* The last record is a GEMM with 3 blocks */
+#define RECORDS 203
+
+/** Write a record, with its payload length for the version 2 */
+static void writeRecord(FILE * f, int version, int op, const int * payload, int length, int64_t * t) {
+  int64_t timestamps[2];
+  timestamps[0] = *t;
+  timestamps[1] = *t + 1000 + 10 * length;
+  *t = timestamps[1] + 1;
+  fwrite(&op, sizeof(int), 1, f);
+  if (version > 1)
+    fwrite(&length, sizeof(int), 1, f);
+  fwrite(payload, sizeof(int), length, f);
+  fwrite(timestamps, sizeof(int64_t), 2, f);
+}
+
+/** Write the trace file of prefix, return the number of 3 blocks records */
+static int writeTrace(const char * prefix, int version) {
+  char name[256];
+  FILE * f;
+  int64_t t = 1000000;
+  int payload[12];
+  int i, k, threeBlocks = 0;
+  snprintf(name, sizeof(name), "%s00_00.bin", prefix);
+  f = fopen(name, "wb");
+  if (f == NULL)
+    return -1;
+  if (version > 1) {
+    const int header[2] = { TRACE_MAGIC, TRACE_VERSION };
+    fwrite(header, sizeof(header), 1, f);
+  }
+  writeRecord(f, version, OP_INIT, payload, 0, &t);
+  for (i = 1; i < RECORDS; i++) {
+    for (k = 0; k < 12; k++)
+      payload[k] = 10 * i + k;
+    switch (i % 6) {
+    case 0:
+      /* m, n, k, transA, transB */
+      writeRecord(f, version, OP_BLASGEMM, payload, 5, &t);
+      break;
+    case 1:
+      /* rows, cols, initialPivot */
+      writeRecord(f, version, OP_QR, payload, 3, &t);
+      break;
+    case 2:
+      writeRecord(f, version, OP_SOLVE_UPPER, payload, 4, &t);
+      break;
+    case 3:
+      writeRecord(f, version, OP_AXPY, payload, 8, &t);
+      break;
+    case 4:
+      writeRecord(f, version, OP_GEMM, payload, 12, &t);
+      threeBlocks++;
+      break;
+    default:
+      writeRecord(f, version, OP_AXPY, payload, 0, &t);
+      break;
+    }
+  }
+  fclose(f);
+  return threeBlocks;
+}
+
+/** Remove the last bytes of a file */
+static int cut(const char * filename, long bytes) {
+  FILE * f = fopen(filename, "rb");
+  char * data;
+  long size;
+  int rc;
+  if (f == NULL)
+    return 1;
+  fseek(f, 0, SEEK_END);
+  size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  data = (char *) malloc(size);
+  rc = fread(data, 1, size, f) != (size_t) size;
+  fclose(f);
+  f = rc ? NULL : fopen(filename, "wb");
+  if (f != NULL) {
+    rc = fwrite(data, 1, size - bytes, f) != (size_t) (size - bytes);
+    fclose(f);
+  } else {
+    rc = 1;
+  }
+  free(data);
+  return rc;
+}
+
+/** Number of occurrences of pattern in the file */
+static int count(const char * filename, const char * pattern) {
+  FILE * f = fopen(filename, "rb");
+  char * data, * p;
+  long size;
+  int n = 0;
+  if (f == NULL)
+    return -1;
+  fseek(f, 0, SEEK_END);
+  size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  data = (char *) calloc(size + 1, 1);
+  if (fread(data, 1, size, f) != (size_t) size)
+    n = -1;
+  fclose(f);
+  for (p = data; n >= 0 && (p = strstr(p, pattern)) != NULL; p++)
+    n++;
+  free(data);
+  return n;
+}
+
+/** Export the trace of prefix, check the return code and the number of events */
+static int check(const char * prefix, int expectedRc, int records, int threeBlocks) {
+  const char * output = "c-timeline-version.json";
+  char name[256];
+  int rc = hmat_timeline_export(prefix, output);
+  int events = count(output, "\"ph\":\"X\"");
+  int blocks = count(output, "\"block3\"");
+  printf("%s: rc=%d, %d events, %d with 3 blocks\n", prefix, rc, events, blocks);
+  snprintf(name, sizeof(name), "%s00_00.bin", prefix);
+  remove(name);
+  remove(output);
+  return rc != expectedRc || events != records || blocks != threeBlocks;
+}
+
+int main(int argc, char **argv) {
+  int threeBlocks, rc = 0;
+
+  if (argc != 1) {
+    fprintf(stderr, "Usage: %s\n", argv[0]);
+    return 1;
+  }
+  threeBlocks = writeTrace("c-timeline-v1-", 1);
+  rc |= threeBlocks < 0 || check("c-timeline-v1-", 0, RECORDS, threeBlocks);
+  rc |= writeTrace("c-timeline-v2-", 2) < 0 || check("c-timeline-v2-", 0, RECORDS, threeBlocks);
+
+  /* A version 1 trace of a killed run, cut in the middle of its last record */
+  if (writeTrace("c-timeline-cut-", 1) < 0 || cut("c-timeline-cut-00_00.bin", 10))
+    return 1;
+  rc |= check("c-timeline-cut-", 2, RECORDS - 1, threeBlocks - 1);
+
+  printf("%s\n", rc ? "FAILED" : "OK");
+  return rc;
+}
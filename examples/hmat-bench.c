@@ -0,0 +1,785 @@
+/*
+  HMat-OSS (HMatrix library, open source software)
+
+  Copyright (C) 2014-2015 Airbus Group SAS
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+  http://github.com/jeromerobert/hmat-oss
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <complex.h>
+#include "hmat/hmat.h"
+#include "examples.h"
+#include "common/chrono.h"
+
+/* Bound of the relative errors of the products and solves, in units of the
+   compression epsilon. The partial ACA of the large HODLR blocks is about 12
+   epsilon on the kriging kernels. */
+#define ERROR_FACTOR 100
+
+/** Benchmark of the main operations on synthetic kernels.
+
+    Usage: hmat-bench [--option=value ...]
+
+    --n=4000                   number of points
+    --geometry=cylinder        cylinder or sphere
+    --kernel=laplace           laplace, helmholtz, gaussian or matern
+    --nu=1.5                   smoothness of the Matern kernel: 0.5, 1.5 or 2.5
+    --nugget=1e-3              added to the diagonal of the kriging kernels
+    --arith=D                  S, D, C or Z (Z for helmholtz)
+    --epsilon=1e-4             compression accuracy
+    --eta=2                    standard admissibility parameter
+    --leaf=100                 maximum number of points of the cluster tree leaves
+    --compression=aca-plus     comma separated list of svd, aca-full, aca-partial,
+                               aca-plus, aca-random, aca-batch, rsvd
+    --factorization=lu,ldlt,llt,hodlrsym
+                               comma separated list of none, lu, ldlt, llt, hodlr, hodlrsym
+    --nrhs=16                  number of right-hand sides of the solve
+    --samples=64               rows of the exact product used for the assembly error
+    --repeat=5                 number of timed matrix-vector products
+    --estimate=50              rk leaves compressed by the dry-run estimate, 0 to disable it
+    --mixed-precision=0        1 to store the rk blocks of the gemv plan in single precision
+    --deferred-updates=0       1 to queue the low-rank updates during the factorizations
+    --engine=default           default or task, the multithreaded engine of
+                               hmat_init_task_interface using HMAT_NUM_THREADS
+    --output=FILE              JSON output, stdout by default
+
+    Each compression method assembles the matrix once for each needed
+    structure: LU uses the whole matrix and the other factorizations its
+    lower part, HODLR and HODLRSYM the HODLR admissibility. The factorizations
+    are done on copies of the assembled matrix, so their memory peaks
+    include it. The times are in seconds and the memory in bytes. Before the
+    assembly, the estimate_cost dry run predicts the assembly and each
+    factorization, to be compared with the measured values. The H2
+    conversion of convert_to_h2 is done last, after the factorizations, and
+    the products are also checked once the Rk blocks have been rebuilt from
+    the H2 bases.
+
+    The exit status is not 0 if a function fails or if an error exceeds its
+    bound: epsilon for the gemv plan, which is the same matrix, and 100
+    epsilon for the solves and for the products, compared with the exact
+    kernel or the H2 product with the H-matrix one.
+ */
+
+typedef struct {
+  int n;
+  const char * geometry;
+  const char * kernel;
+  double nu, nugget;
+  char arith;
+  double epsilon, eta;
+  int leaf;
+  const char * compressions;
+  const char * factorizations;
+  int nrhs, samples, repeat, estimate, mixedPrecision, deferredUpdates;
+  const char * engine;
+  const char * output;
+} bench_config_t;
+
+typedef struct {
+  const bench_config_t * config;
+  hmat_value_t type;
+  double * points;
+  /** Distance between two neighboring points */
+  double step;
+  /** Correlation length of the kriging kernels */
+  double l;
+  /** Wave number of the helmholtz kernel */
+  double k;
+} bench_t;
+
+/** Points on the unit sphere, with a Fibonacci lattice */
+static double * createSphere(int n) {
+  double * result = (double*) malloc(3 * n * sizeof(double));
+  const double golden = M_PI * (3. - sqrt(5.));
+  int i;
+  for (i = 0; i < n; i++) {
+    double z = 1 - (2 * i + 1.) / n;
+    double r = sqrt(1 - z * z);
+    result[3*i+0] = r * cos(golden * i);
+    result[3*i+1] = r * sin(golden * i);
+    result[3*i+2] = z;
+  }
+  return result;
+}
+
+static double complex kernel(const bench_t * b, int i, int j) {
+  double r = distanceTo(b->points + 3 * i, b->points + 3 * j);
+  const char * name = b->config->kernel;
+  if (!strcmp(name, "laplace") || !strcmp(name, "helmholtz")) {
+    /* The singular self interaction is replaced by the one at half a step */
+    if (i == j)
+      r = b->step / 2;
+    if (!strcmp(name, "laplace"))
+      return 1. / (4 * M_PI * r);
+    return cexp(I * b->k * r) / (4 * M_PI * r);
+  }
+  double v;
+  if (!strcmp(name, "gaussian")) {
+    v = exp(-(r * r) / (b->l * b->l));
+  } else {
+    const double nu = b->config->nu;
+    const double x = sqrt(2 * nu) * r / b->l;
+    if (nu == 0.5)
+      v = exp(-x);
+    else if (nu == 1.5)
+      v = (1 + x) * exp(-x);
+    else
+      v = (1 + x + x * x / 3) * exp(-x);
+  }
+  return i == j ? v + b->config->nugget : v;
+}
+
+/** The values are computed in double precision, also for the S and C arithmetics */
+static void interaction(void * data, int i, int j, void * result) {
+  const bench_t * b = (const bench_t *) data;
+  double complex v = kernel(b, i, j);
+  if (b->type == HMAT_SIMPLE_PRECISION || b->type == HMAT_DOUBLE_PRECISION)
+    *((double*) result) = creal(v);
+  else
+    *((double complex*) result) = v;
+}
+
+static size_t scalarSize(hmat_value_t type) {
+  switch (type) {
+  case HMAT_SIMPLE_PRECISION: return sizeof(float);
+  case HMAT_DOUBLE_PRECISION: return sizeof(double);
+  case HMAT_SIMPLE_COMPLEX: return sizeof(float complex);
+  default: return sizeof(double complex);
+  }
+}
+
+static double complex getScalar(hmat_value_t type, const void * a, size_t i) {
+  switch (type) {
+  case HMAT_SIMPLE_PRECISION: return ((const float*) a)[i];
+  case HMAT_DOUBLE_PRECISION: return ((const double*) a)[i];
+  case HMAT_SIMPLE_COMPLEX: return ((const float complex*) a)[i];
+  default: return ((const double complex*) a)[i];
+  }
+}
+
+static void setScalar(hmat_value_t type, void * a, size_t i, double complex v) {
+  switch (type) {
+  case HMAT_SIMPLE_PRECISION: ((float*) a)[i] = creal(v); break;
+  case HMAT_DOUBLE_PRECISION: ((double*) a)[i] = creal(v); break;
+  case HMAT_SIMPLE_COMPLEX: ((float complex*) a)[i] = v; break;
+  default: ((double complex*) a)[i] = v; break;
+  }
+}
+
+/**
+ * Write ,"relative_error":e, with null for NaN which is not valid JSON. Return
+ * 1 if e is not below bound, so that a numerical regression fails the run.
+ */
+static int writeError(FILE * out, const char * what, double e, double bound) {
+  if (isfinite(e))
+    fprintf(out, ",\"relative_error\":%g", e);
+  else
+    fprintf(out, ",\"relative_error\":null");
+  if (e <= bound)
+    return 0;
+  fprintf(stderr, "%s: relative error %g above %g\n", what, e, bound);
+  return 1;
+}
+
+/** ||a - b|| / ||b|| for arrays of size n */
+static double relativeError(hmat_value_t type, const void * a, const void * b, size_t n) {
+  double diff = 0, norm = 0;
+  size_t i;
+  for (i = 0; i < n; i++) {
+    double complex vb = getScalar(type, b, i);
+    double complex d = getScalar(type, a, i) - vb;
+    diff += creal(d * conj(d));
+    norm += creal(vb * conj(vb));
+  }
+  return norm > 0 ? sqrt(diff / norm) : sqrt(diff);
+}
+
+static hmat_compression_algorithm_t * createCompression(const char * name, double epsilon) {
+  if (!strcmp(name, "svd")) return hmat_create_compression_svd(epsilon);
+  if (!strcmp(name, "aca-full")) return hmat_create_compression_aca_full(epsilon);
+  if (!strcmp(name, "aca-partial")) return hmat_create_compression_aca_partial(epsilon);
+  if (!strcmp(name, "aca-plus")) return hmat_create_compression_aca_plus(epsilon);
+  if (!strcmp(name, "aca-random")) return hmat_create_compression_aca_random(epsilon);
+  if (!strcmp(name, "aca-batch")) return hmat_create_compression_aca_batch(epsilon, 8);
+  if (!strcmp(name, "rsvd")) return hmat_create_compression_rsvd(epsilon, 16, 1);
+  return NULL;
+}
+
+static int parseFactorization(const char * name, hmat_factorization_t * f) {
+  static const char * names[] = { "none", "lu", "ldlt", "llt", "hodlr", "hodlrsym" };
+  int i;
+  *f = hmat_factorization_none;
+  for (i = 0; i < 6; i++) {
+    if (!strcmp(name, names[i])) {
+      *f = (hmat_factorization_t) (i - 1);
+      return 0;
+    }
+  }
+  return 1;
+}
+
+/** The factorizations of the lower part of the matrix */
+static int isSymmetric(hmat_factorization_t f) {
+  return f != hmat_factorization_none && f != hmat_factorization_lu;
+}
+
+static int isHODLR(hmat_factorization_t f) {
+  return f == hmat_factorization_hodlr || f == hmat_factorization_hodlrsym;
+}
+
+static void writeMemory(FILE * out, const char * phase) {
+  hmat_memory_stats_t s;
+  if (hmat_get_memory_phase(phase, &s))
+    return;
+  fprintf(out, ",\"memory\":{\"peak_bytes\":%lld,\"bytes\":%lld,\"full_bytes\":%lld,\"rk_bytes\":%lld}",
+          s.peak[hmat_memory_total], s.current[hmat_memory_total],
+          s.current[hmat_memory_full], s.current[hmat_memory_rk]);
+}
+
+/** Copy list into buffer and return its next comma separated item, NULL at the end */
+static const char * nextItem(const char * list, int * pos, char * buffer, size_t size) {
+  size_t k = 0;
+  if (list[*pos] == '\0')
+    return NULL;
+  while (list[*pos] != '\0' && list[*pos] != ',') {
+    if (k + 1 < size)
+      buffer[k++] = list[*pos];
+    (*pos)++;
+  }
+  if (list[*pos] == ',')
+    (*pos)++;
+  buffer[k] = '\0';
+  return buffer;
+}
+
+/** Write the estimate of the assembly, or of a factorization if factorization is set */
+static void writeEstimate(FILE * out, const hmat_cost_estimate_t * e, double time, int factorization) {
+  if (time < 0) {
+    fprintf(out, ",\"estimate\":null");
+  } else if (factorization) {
+    fprintf(out, ",\"estimate\":{\"estimate_time\":%g,\"time\":%g,\"flops\":%g,\"bytes\":%.0f,"
+            "\"solve_flops\":%g}", time, e->factorization_time, e->factorization_flops,
+            e->factorized_bytes, e->solve_flops);
+  } else {
+    const hmat_info_t * info = &e->info;
+    fprintf(out, ",\"estimate\":{\"estimate_time\":%g,\"sampled_rk_blocks\":%d,\"time\":%g,"
+            "\"bytes\":%.0f,\"compressed_size\":%lu,\"mean_rank\":%g,\"max_rank\":%d}",
+            time, e->sampled_rk_blocks, e->assembly_time, e->assembled_bytes,
+            (unsigned long) info->compressed_size,
+            info->rk_count ? (double) info->rk_rank_sum / info->rk_count : 0., info->max_rk_rank);
+  }
+}
+
+typedef struct {
+  bench_t * bench;
+  hmat_interface_t * hmat;
+  hmat_cluster_tree_t * tree;
+  FILE * out;
+  /** x and A.x, in the internal numbering */
+  void * x, * ax;
+} run_t;
+
+/** Dry-run estimate of the factorization f on the empty matrix, return its time or -1 on error */
+static double estimate(run_t * run, hmat_matrix_t * matrix, hmat_assemble_context_t * ctx,
+                       hmat_factorization_t f, hmat_cost_estimate_t * e) {
+  Time start, end;
+  int rc;
+  ctx->factorization = f;
+  start = now();
+  rc = run->hmat->estimate_cost(matrix, ctx, run->bench->config->estimate, e);
+  end = now();
+  ctx->factorization = hmat_factorization_none;
+  return rc ? -1 : time_diff(start, end);
+}
+
+/**
+ * Factorize a copy of matrix, solve A.y = A.x and compare y with x. Return 0
+ * for success. e is the estimate of the factorization, which took
+ * estimateTime, NULL if it is disabled.
+ */
+static int factorizeAndSolve(run_t * run, hmat_matrix_t * matrix, hmat_factorization_t f, const char * name,
+                             const hmat_cost_estimate_t * e, double estimateTime) {
+  const bench_config_t * c = run->bench->config;
+  const size_t bytes = (size_t) c->n * c->nrhs * scalarSize(run->bench->type);
+  hmat_factorization_context_t ctx;
+  Time start, end;
+  int rc, inaccurate = 0;
+  fprintf(run->out, "{\"algorithm\":\"%s\"", name);
+  hmat_memory_begin_phase("factorization");
+  hmat_matrix_t * factor = run->hmat->copy(matrix);
+  hmat_factorization_context_init(&ctx);
+  ctx.factorization = f;
+  ctx.progress = NULL;
+  start = now();
+  rc = run->hmat->factorize_generic(factor, &ctx);
+  end = now();
+  hmat_memory_end_phase();
+  fprintf(run->out, ",\"time\":%g", time_diff(start, end));
+  writeMemory(run->out, "factorization");
+  if (e != NULL)
+    writeEstimate(run->out, e, estimateTime, 1);
+  if (rc == 0) {
+    void * y = malloc(bytes);
+    memcpy(y, run->ax, bytes);
+    hmat_memory_begin_phase("solve");
+    start = now();
+    rc = run->hmat->solve_dense(factor, y, c->nrhs);
+    end = now();
+    hmat_memory_end_phase();
+    fprintf(run->out, ",\"solve\":{\"nrhs\":%d,\"time\":%g", c->nrhs, time_diff(start, end));
+    if (rc == 0)
+      inaccurate = writeError(run->out, name, relativeError(run->bench->type, y, run->x, (size_t) c->n * c->nrhs),
+                              ERROR_FACTOR * c->epsilon);
+    writeMemory(run->out, "solve");
+    fprintf(run->out, "}");
+    free(y);
+  }
+  if (rc != 0)
+    fprintf(run->out, ",\"error\":%d", rc);
+  fprintf(run->out, "}");
+  run->hmat->destroy(factor);
+  return rc | inaccurate;
+}
+
+/**
+ * Assemble the matrix with a compression method, for the factorizations of a
+ * given structure, time the products and the factorizations.
+ */
+static int assembleAndFactorize(run_t * run, const char * compression, int symmetric, int hodlr,
+                                const char * factorizations) {
+  const bench_config_t * c = run->bench->config;
+  const hmat_value_t type = run->bench->type;
+  const size_t n = c->n;
+  hmat_admissibility_t * admissibility = hodlr ? hmat_create_admissibility_hodlr()
+                                               : hmat_create_admissibility_standard(c->eta);
+  hmat_matrix_t * matrix = run->hmat->create_empty_hmatrix_admissibility(run->tree, run->tree, symmetric, admissibility);
+  hmat_delete_admissibility(admissibility);
+  run->hmat->set_low_rank_epsilon(matrix, c->epsilon);
+  hmat_assemble_context_t ctx;
+  hmat_info_t info;
+  /* Indexed by hmat_factorization_t + 1 */
+  hmat_cost_estimate_t estimates[hmat_factorization_hodlrsym + 2];
+  double estimateTimes[hmat_factorization_hodlrsym + 2] = { 0 };
+  Time start, end;
+  double gemvTime = 0;
+  int rc, i, pos = 0;
+  char name[64];
+
+  fprintf(run->out, "{\"compression\":\"%s\",\"admissibility\":\"%s\",\"symmetric\":%s",
+          compression, hodlr ? "hodlr" : "standard", symmetric ? "true" : "false");
+  hmat_assemble_context_init(&ctx);
+  ctx.compression = createCompression(compression, c->epsilon);
+  ctx.user_context = run->bench;
+  ctx.simple_compute = interaction;
+  ctx.lower_symmetric = symmetric;
+  ctx.progress = NULL;
+  if (c->estimate > 0) {
+    estimateTimes[0] = estimate(run, matrix, &ctx, hmat_factorization_none, &estimates[0]);
+    while (nextItem(factorizations, &pos, name, sizeof(name))) {
+      hmat_factorization_t f;
+      parseFactorization(name, &f);
+      if (f != hmat_factorization_none && isSymmetric(f) == symmetric && isHODLR(f) == hodlr)
+        estimateTimes[f + 1] = estimate(run, matrix, &ctx, f, &estimates[f + 1]);
+    }
+    pos = 0;
+  }
+  hmat_memory_begin_phase("assembly");
+  start = now();
+  rc = run->hmat->assemble_generic(matrix, &ctx);
+  end = now();
+  hmat_memory_end_phase();
+  hmat_delete_compression(ctx.compression);
+  fprintf(run->out, ",\"assembly\":{\"time\":%g", time_diff(start, end));
+  writeMemory(run->out, "assembly");
+  if (c->estimate > 0)
+    writeEstimate(run->out, &estimates[0], estimateTimes[0], 0);
+  fprintf(run->out, "}");
+  if (rc != 0) {
+    fprintf(run->out, ",\"error\":%d}", rc);
+    run->hmat->destroy(matrix);
+    return rc;
+  }
+
+  run->hmat->get_info(matrix, &info);
+  fprintf(run->out, ",\"info\":{\"compressed_size\":%lu,\"uncompressed_size\":%lu,\"compression_ratio\":%g,"
+          "\"full_count\":%lu,\"rk_count\":%lu,\"mean_rank\":%g,\"max_rank\":%d}",
+          (unsigned long) info.compressed_size, (unsigned long) info.uncompressed_size,
+          (double) info.compressed_size / info.uncompressed_size,
+          (unsigned long) info.full_count, (unsigned long) info.rk_count,
+          info.rk_count ? (double) info.rk_rank_sum / info.rk_count : 0., info.max_rk_rank);
+
+  /* Products, and error of the first column of A.x on sampled rows */
+  const double complex one = 1, zero = 0;
+  void * alpha = malloc(scalarSize(type)), * beta = malloc(scalarSize(type));
+  void * y = malloc(n * scalarSize(type));
+  setScalar(type, alpha, 0, one);
+  setScalar(type, beta, 0, zero);
+  start = now();
+  run->hmat->gemm_dense('N', 'N', 'L', alpha, matrix, run->x, beta, run->ax, c->nrhs);
+  end = now();
+  const double gemmTime = time_diff(start, end);
+  for (i = 0; i < c->repeat; i++) {
+    start = now();
+    run->hmat->gemm_dense('N', 'N', 'L', alpha, matrix, run->x, beta, y, 1);
+    end = now();
+    gemvTime += time_diff(start, end);
+  }
+  run->hmat->vector_restore(y, run->tree, 0, NULL, 1);
+  void * x0 = malloc(n * scalarSize(type));
+  memcpy(x0, run->x, n * scalarSize(type));
+  run->hmat->vector_restore(x0, run->tree, 0, NULL, 1);
+  const int samples = c->samples < c->n ? c->samples : c->n;
+  void * exact = malloc(samples * scalarSize(type)), * approx = malloc(samples * scalarSize(type));
+  for (i = 0; i < samples; i++) {
+    const int row = (int) (((size_t) i * n) / samples);
+    double complex s = 0;
+    size_t j;
+    for (j = 0; j < n; j++)
+      s += kernel(run->bench, row, j) * getScalar(type, x0, j);
+    setScalar(type, exact, i, s);
+    setScalar(type, approx, i, getScalar(type, y, row));
+  }
+  fprintf(run->out, ",\"gemv\":{\"time\":%g,\"gemm_time\":%g,\"nrhs\":%d,\"sampled_rows\":%d",
+          c->repeat > 0 ? gemvTime / c->repeat : 0., gemmTime, c->nrhs, samples);
+  int errors = writeError(run->out, "gemv", relativeError(type, approx, exact, samples),
+                          ERROR_FACTOR * c->epsilon);
+  fprintf(run->out, "}");
+
+  /* Same products with the flat plan of prepare_gemv, the plan is dropped by the factorizations */
+  void * yPlan = malloc(n * scalarSize(type));
+  double planTime = 0;
+  hmat_memory_begin_phase("prepare_gemv");
+  start = now();
+  rc = run->hmat->prepare_gemv(matrix);
+  end = now();
+  hmat_memory_end_phase();
+  fprintf(run->out, ",\"gemv_plan\":{\"prepare_time\":%g", time_diff(start, end));
+  writeMemory(run->out, "prepare_gemv");
+  for (i = 0; rc == 0 && i < c->repeat; i++) {
+    start = now();
+    run->hmat->gemm_dense('N', 'N', 'L', alpha, matrix, run->x, beta, yPlan, 1);
+    end = now();
+    planTime += time_diff(start, end);
+  }
+  if (rc == 0 && c->repeat > 0) {
+    run->hmat->vector_restore(yPlan, run->tree, 0, NULL, 1);
+    fprintf(run->out, ",\"time\":%g", planTime / c->repeat);
+    /* The plan is the same matrix, only rounded with mixedPrecisionGemv */
+    errors |= writeError(run->out, "gemv_plan", relativeError(type, yPlan, y, n), c->epsilon);
+  }
+  if (rc == 0) {
+    /* Dropping the plan, here with set_low_rank_epsilon, must leave the matrix unchanged */
+    run->hmat->set_low_rank_epsilon(matrix, c->epsilon);
+    start = now();
+    run->hmat->gemm_dense('N', 'N', 'L', alpha, matrix, run->x, beta, yPlan, 1);
+    end = now();
+    run->hmat->vector_restore(yPlan, run->tree, 0, NULL, 1);
+    fprintf(run->out, ",\"dropped\":{\"time\":%g", time_diff(start, end));
+    errors |= writeError(run->out, "gemv after the plan", relativeError(type, yPlan, y, n), 0);
+    fprintf(run->out, "}");
+  }
+  fprintf(run->out, "}");
+  rc |= errors;
+
+  fprintf(run->out, ",\"factorizations\":[");
+  int first = 1;
+  while (nextItem(factorizations, &pos, name, sizeof(name))) {
+    hmat_factorization_t f;
+    parseFactorization(name, &f);
+    if (f == hmat_factorization_none || isSymmetric(f) != symmetric || isHODLR(f) != hodlr)
+      continue;
+    fprintf(run->out, "%s\n    ", first ? "" : ",");
+    first = 0;
+    rc |= factorizeAndSolve(run, matrix, f, name, c->estimate > 0 ? &estimates[f + 1] : NULL,
+                            estimateTimes[f + 1]);
+  }
+  fprintf(run->out, "]");
+
+  /*
+   * And with the H2 representation of convert_to_h2, which replaces the plan.
+   * It is done last because the copies of the factorizations would restore
+   * the Rk blocks from the H2 bases, with its approximation error.
+   */
+  hmat_memory_stats_t before;
+  int h2rc;
+  planTime = 0;
+  hmat_get_memory_stats(&before);
+  hmat_memory_begin_phase("convert_to_h2");
+  start = now();
+  h2rc = run->hmat->convert_to_h2(matrix, 0);
+  end = now();
+  hmat_memory_end_phase();
+  fprintf(run->out, ",\"h2\":{\"convert_time\":%g,\"bytes_before\":%lld", time_diff(start, end),
+          before.current[hmat_memory_total]);
+  writeMemory(run->out, "convert_to_h2");
+  for (i = 0; h2rc == 0 && i < c->repeat; i++) {
+    start = now();
+    run->hmat->gemm_dense('N', 'N', 'L', alpha, matrix, run->x, beta, yPlan, 1);
+    end = now();
+    planTime += time_diff(start, end);
+  }
+  if (h2rc == 0 && c->repeat > 0) {
+    run->hmat->vector_restore(yPlan, run->tree, 0, NULL, 1);
+    fprintf(run->out, ",\"time\":%g", planTime / c->repeat);
+    h2rc = writeError(run->out, "h2", relativeError(type, yPlan, y, n), ERROR_FACTOR * c->epsilon);
+  }
+  if (h2rc == 0) {
+    /* Dropping the H2 representation, here with copy(), rebuilds the Rk blocks from the bases */
+    run->hmat->destroy(run->hmat->copy(matrix));
+    start = now();
+    run->hmat->gemm_dense('N', 'N', 'L', alpha, matrix, run->x, beta, yPlan, 1);
+    end = now();
+    run->hmat->vector_restore(yPlan, run->tree, 0, NULL, 1);
+    fprintf(run->out, ",\"restored\":{\"time\":%g", time_diff(start, end));
+    h2rc = writeError(run->out, "h2 restored", relativeError(type, yPlan, y, n), ERROR_FACTOR * c->epsilon);
+    fprintf(run->out, "}");
+  }
+  fprintf(run->out, "}}");
+  rc |= h2rc;
+  free(yPlan);
+  free(exact);
+  free(approx);
+  free(x0);
+  free(y);
+  free(alpha);
+  free(beta);
+  run->hmat->destroy(matrix);
+  return rc;
+}
+
+static int parseArguments(int argc, char ** argv, bench_config_t * c) {
+  int i;
+  c->n = 4000;
+  c->geometry = "cylinder";
+  c->kernel = "laplace";
+  c->nu = 1.5;
+  c->nugget = 1e-3;
+  c->arith = 0;
+  c->epsilon = 1e-4;
+  c->eta = 2;
+  c->leaf = 100;
+  c->compressions = "aca-plus";
+  c->factorizations = "lu,ldlt,llt,hodlrsym";
+  c->nrhs = 16;
+  c->samples = 64;
+  c->repeat = 5;
+  c->estimate = 50;
+  c->mixedPrecision = 0;
+  c->deferredUpdates = 0;
+  c->engine = "default";
+  c->output = NULL;
+  for (i = 1; i < argc; i++) {
+    const char * a = argv[i];
+    const char * v = strchr(a, '=');
+    if (strncmp(a, "--", 2) || v == NULL)
+      return 1;
+    v++;
+#define HMAT_BENCH_OPTION(name) (strncmp(a + 2, name "=", strlen(name) + 1) == 0)
+    if (HMAT_BENCH_OPTION("n")) c->n = atoi(v);
+    else if (HMAT_BENCH_OPTION("geometry")) c->geometry = v;
+    else if (HMAT_BENCH_OPTION("kernel")) c->kernel = v;
+    else if (HMAT_BENCH_OPTION("nu")) c->nu = atof(v);
+    else if (HMAT_BENCH_OPTION("nugget")) c->nugget = atof(v);
+    else if (HMAT_BENCH_OPTION("arith")) c->arith = v[0];
+    else if (HMAT_BENCH_OPTION("epsilon")) c->epsilon = atof(v);
+    else if (HMAT_BENCH_OPTION("eta")) c->eta = atof(v);
+    else if (HMAT_BENCH_OPTION("leaf")) c->leaf = atoi(v);
+    else if (HMAT_BENCH_OPTION("compression")) c->compressions = v;
+    else if (HMAT_BENCH_OPTION("factorization")) c->factorizations = v;
+    else if (HMAT_BENCH_OPTION("nrhs")) c->nrhs = atoi(v);
+    else if (HMAT_BENCH_OPTION("samples")) c->samples = atoi(v);
+    else if (HMAT_BENCH_OPTION("repeat")) c->repeat = atoi(v);
+    else if (HMAT_BENCH_OPTION("estimate")) c->estimate = atoi(v);
+    else if (HMAT_BENCH_OPTION("mixed-precision")) c->mixedPrecision = atoi(v);
+    else if (HMAT_BENCH_OPTION("deferred-updates")) c->deferredUpdates = atoi(v);
+    else if (HMAT_BENCH_OPTION("engine")) c->engine = v;
+    else if (HMAT_BENCH_OPTION("output")) c->output = v;
+    else return 1;
+#undef HMAT_BENCH_OPTION
+  }
+  if (c->arith == 0)
+    c->arith = strcmp(c->kernel, "helmholtz") ? 'D' : 'Z';
+  if (c->n <= 0 || c->nrhs <= 0 || c->leaf <= 0 || !strchr("SDCZ", c->arith))
+    return 1;
+  if (strcmp(c->geometry, "cylinder") && strcmp(c->geometry, "sphere"))
+    return 1;
+  if (strcmp(c->kernel, "laplace") && strcmp(c->kernel, "helmholtz") &&
+      strcmp(c->kernel, "gaussian") && strcmp(c->kernel, "matern"))
+    return 1;
+  if (!strcmp(c->kernel, "matern") && c->nu != 0.5 && c->nu != 1.5 && c->nu != 2.5)
+    return 1;
+  if (!strcmp(c->kernel, "helmholtz") && (c->arith == 'S' || c->arith == 'D')) {
+    fprintf(stderr, "The helmholtz kernel requires the C or Z arithmetic\n");
+    return 1;
+  }
+  return 0;
+}
+
+static int checkLists(const bench_config_t * c) {
+  char name[64];
+  int pos = 0;
+  while (nextItem(c->compressions, &pos, name, sizeof(name))) {
+    hmat_compression_algorithm_t * algo = createCompression(name, c->epsilon);
+    if (algo == NULL) {
+      fprintf(stderr, "Unknown compression %s\n", name);
+      return 1;
+    }
+    hmat_delete_compression(algo);
+  }
+  pos = 0;
+  while (nextItem(c->factorizations, &pos, name, sizeof(name))) {
+    hmat_factorization_t f;
+    if (parseFactorization(name, &f)) {
+      fprintf(stderr, "Unknown factorization %s\n", name);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  bench_config_t config;
+  bench_t bench;
+  hmat_interface_t hmat;
+  run_t run;
+  Time start, end;
+  int rc = 0, i, pos = 0;
+  char name[64];
+
+  if (parseArguments(argc, argv, &config) || checkLists(&config)) {
+    fprintf(stderr, "Usage: %s [--n=4000] [--geometry=cylinder|sphere] "
+            "[--kernel=laplace|helmholtz|gaussian|matern] [--nu=1.5] [--nugget=1e-3] "
+            "[--arith=S|D|C|Z] [--epsilon=1e-4] [--eta=2] [--leaf=100] "
+            "[--compression=aca-plus,...] [--factorization=lu,ldlt,llt,hodlrsym] "
+            "[--nrhs=16] [--samples=64] [--repeat=5] [--estimate=50] [--mixed-precision=0] "
+            "[--deferred-updates=0] [--engine=default|task] [--output=file.json]\n", argv[0]);
+    return 1;
+  }
+  bench.config = &config;
+  switch (config.arith) {
+  case 'S': bench.type = HMAT_SIMPLE_PRECISION; break;
+  case 'D': bench.type = HMAT_DOUBLE_PRECISION; break;
+  case 'C': bench.type = HMAT_SIMPLE_COMPLEX; break;
+  default: bench.type = HMAT_DOUBLE_COMPLEX; break;
+  }
+  if (!strcmp(config.geometry, "sphere")) {
+    bench.step = sqrt(4 * M_PI / config.n);
+    bench.points = createSphere(config.n);
+  } else {
+    bench.step = 1.75 * M_PI / sqrt((double) config.n);
+    bench.points = createCylinder(1, bench.step, config.n);
+  }
+  bench.l = correlationLength(bench.points, config.n);
+  bench.k = 2 * M_PI / (10. * bench.step); /* 10 points per wavelength */
+
+  FILE * out = config.output ? fopen(config.output, "w") : stdout;
+  if (out == NULL) {
+    fprintf(stderr, "Cannot open %s\n", config.output);
+    return 1;
+  }
+  if (!strcmp(config.engine, "task"))
+    hmat_init_task_interface(&hmat, bench.type);
+  else
+    hmat_init_default_interface(&hmat, bench.type);
+  if (hmat.init() != 0) {
+    fprintf(stderr, "Unable to initialize HMat library\n");
+    return 1;
+  }
+  if (config.mixedPrecision || config.deferredUpdates) {
+    hmat_settings_t settings;
+    hmat_get_parameters(&settings);
+    settings.mixedPrecisionGemv = config.mixedPrecision != 0;
+    settings.deferredUpdates = config.deferredUpdates != 0;
+    hmat_set_parameters(&settings);
+  }
+
+  fprintf(out, "{\"version\":\"%s\",\n\"config\":{\"n\":%d,\"geometry\":\"%s\",\"kernel\":\"%s\","
+          "\"arith\":\"%c\",\"epsilon\":%g,\"eta\":%g,\"leaf\":%d,\"nrhs\":%d,\"mixed_precision\":%s,\"deferred_updates\":%s,\"engine\":\"%s\"",
+          hmat_get_version(), config.n, config.geometry, config.kernel, config.arith,
+          config.epsilon, config.eta, config.leaf, config.nrhs, config.mixedPrecision ? "true" : "false",
+          config.deferredUpdates ? "true" : "false", config.engine);
+  if (!strcmp(config.kernel, "matern"))
+    fprintf(out, ",\"nu\":%g", config.nu);
+  if (!strcmp(config.kernel, "gaussian") || !strcmp(config.kernel, "matern"))
+    fprintf(out, ",\"nugget\":%g,\"correlation_length\":%g", config.nugget, bench.l);
+  if (!strcmp(config.kernel, "helmholtz"))
+    fprintf(out, ",\"wave_number\":%g", bench.k);
+  fprintf(out, "},\n");
+
+  hmat_memory_begin_phase("cluster_tree");
+  start = now();
+  hmat_clustering_algorithm_t * median = hmat_create_clustering_median();
+  hmat_clustering_algorithm_t * clustering = hmat_create_clustering_max_dof(median, config.leaf);
+  hmat_cluster_tree_t * tree = hmat_create_cluster_tree(bench.points, 3, config.n, clustering);
+  end = now();
+  hmat_memory_end_phase();
+  hmat_delete_clustering(clustering);
+  hmat_delete_clustering(median);
+  fprintf(out, "\"cluster_tree\":{\"time\":%g,\"nodes\":%d", time_diff(start, end), hmat_tree_nodes_count(tree));
+  writeMemory(out, "cluster_tree");
+  fprintf(out, "},\n\"runs\":[");
+
+  /* Random x, in the internal numbering */
+  const size_t bytes = (size_t) config.n * config.nrhs * scalarSize(bench.type);
+  run.bench = &bench;
+  run.hmat = &hmat;
+  run.tree = tree;
+  run.out = out;
+  run.x = malloc(bytes);
+  run.ax = malloc(bytes);
+  srand(1);
+  for (i = 0; i < config.n * config.nrhs; i++)
+    setScalar(bench.type, run.x, i, 1 - 2. * rand() / RAND_MAX);
+  hmat.vector_reorder(run.x, tree, 0, NULL, config.nrhs);
+
+  int first = 1;
+  while (nextItem(config.compressions, &pos, name, sizeof(name))) {
+    /* One assembly for each structure used by the factorizations */
+    int structure;
+    for (structure = 0; structure < 4; structure++) {
+      const int symmetric = structure & 1, hodlr = structure >> 1;
+      int needed = 0, fpos = 0;
+      char fname[64];
+      while (nextItem(config.factorizations, &fpos, fname, sizeof(fname))) {
+        hmat_factorization_t f;
+        parseFactorization(fname, &f);
+        if (f == hmat_factorization_none ? structure == 0
+            : isSymmetric(f) == symmetric && isHODLR(f) == hodlr)
+          needed = 1;
+      }
+      if (!needed)
+        continue;
+      fprintf(out, "%s\n  ", first ? "" : ",");
+      first = 0;
+      rc |= assembleAndFactorize(&run, name, symmetric, hodlr, config.factorizations);
+    }
+  }
+  fprintf(out, "\n]}\n");
+
+  if (out != stdout)
+    fclose(out);
+  free(run.x);
+  free(run.ax);
+  hmat_delete_cluster_tree(tree);
+  hmat.finalize();
+  free(bench.points);
+  return rc;
+}
@@ -0,0 +1,40 @@
+/*
+  HMat-OSS (HMatrix library, open source software)
+
+  Copyright (C) 2014-2015 Airbus Group SAS
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+  http://github.com/jeromerobert/hmat-oss
+*/
+
+#include <stdio.h>
+#include "hmat/hmat.h"
+
+/** Convert the traces written by a run with HMAT_TIMELINE=prefix to a Chrome trace.
+
+    Usage: timeline-export prefix [output.json]
+ */
+int main(int argc, char **argv) {
+  const char * output = argc > 2 ? argv[2] : "timeline.json";
+  if (argc < 2) {
+    fprintf(stderr, "Usage: %s prefix [output.json]\n", argv[0]);
+    return 1;
+  }
+  if (hmat_timeline_export(argv[1], output))
+    return 1;
+  printf("Wrote %s, open it with chrome://tracing or https://ui.perfetto.dev\n", output);
+  return 0;
+}
@@ -82,6 +82,20 @@ typedef enum {
     hmat_factorization_hodlrsym
 } hmat_factorization_t;
 
+/** Krylov methods of solve_iterative */
+typedef enum {
+    /** Restarted GMRES, right preconditioned */
+    hmat_iterative_gmres,
+    /** Flexible GMRES, which stores the preconditioned Krylov basis */
+    hmat_iterative_fgmres,
+    /** Conjugate gradient, for symmetric positive definite matrices and preconditioners */
+    hmat_iterative_cg,
+    /** BiCGStab, right preconditioned */
+    hmat_iterative_bicgstab,
+    /** Iterative refinement, which stops when the residual no longer decreases */
+    hmat_iterative_refinement
+} hmat_iterative_t;
+
 typedef struct hmat_block_info_struct {
     hmat_block_t block_type;
     /**
@@ -119,6 +133,26 @@ typedef struct hmat_block_info_struct {
     size_t needed_memory;
     /** the number of strata in the block */
     int number_of_strata;
+    /*! \brief Optional function provided by the user in hmat_prepare_func_t to compute several rows at once
+
+      It is used by the ACA batch compression (see hmat_create_compression_aca_batch) instead of
+      one compute call per row, so that kernels can be evaluated on many rows with SIMD.
+      The count rows whose indices within this block are given by block_row_offsets must be
+      written to block, row k being stored contiguously from block + k * col_count, where
+      col_count is the number of columns of the block. A stratum of -1 means all strata.
+
+      Note: user prototype should be
+        void compute_rows(const hmat_block_info_t * block_info, int count,
+                          const int * block_row_offsets, int stratum, void * block);
+    */
+    void (*compute_rows)(const struct hmat_block_info_struct * block_info, int count,
+                         const int * block_row_offsets, int stratum, void * block);
+    /*! \brief Optional function provided by the user in hmat_prepare_func_t to compute several columns at once (equivalent to compute_rows)
+
+      Column k is stored contiguously from block + k * row_count.
+    */
+    void (*compute_cols)(const struct hmat_block_info_struct * block_info, int count,
+                         const int * block_col_offsets, int stratum, void * block);
 } hmat_block_info_t;
 
 /*! \brief Prepare block assembly.
@@ -193,6 +227,10 @@ HMAT_API hmat_clustering_algorithm_t* hmat_create_clustering_ntilesrecursive(int
 HMAT_API hmat_clustering_algorithm_t* hmat_create_clustering_geometric(void);
 /* Hybrid clustering */
 HMAT_API hmat_clustering_algorithm_t* hmat_create_clustering_hybrid(void);
+/* Clustering along a Morton (Z-order) curve, DOFs are sorted only once */
+HMAT_API hmat_clustering_algorithm_t* hmat_create_clustering_morton(void);
+/* Clustering along a Hilbert curve, DOFs are sorted only once */
+HMAT_API hmat_clustering_algorithm_t* hmat_create_clustering_hilbert(void);
 /* Create a new clustering algorithm by setting the maximum number of degrees of freedom in a leaf */
 HMAT_API hmat_clustering_algorithm_t* hmat_create_clustering_max_dof(const hmat_clustering_algorithm_t* algo, int max_dof);
 
@@ -225,6 +263,24 @@ HMAT_API void hmat_set_clustering_divider(hmat_clustering_algorithm_t* algo, int
 */
 HMAT_API hmat_cluster_tree_t * hmat_create_cluster_tree(double* coord, int dimension, int size, hmat_clustering_algorithm_t* algo);
 
+/*! \brief Create a ClusterTree from the adjacency graph of the DoFs.
+
+  The tree is built by nested dissection of the graph: each cluster is split
+  into two parts which are not connected to each other, and their separator.
+  The connected components are never split. The DoFs get as coordinates their
+  graph distances to 4 landmark DoFs of their component, so admissibility
+  conditions measure graph distances, and the components are far apart.
+
+  \param size number of DoFs
+  \param row_ptr array of size+1 offsets in col_ind
+  \param col_ind the neighbours of DoF i are col_ind[row_ptr[i]] to col_ind[row_ptr[i+1]-1].
+  The graph must be symmetric.
+  \param max_leaf_size maximum number of DoFs in a leaf, or 0 to use the
+  value of hmat_settings_t
+  \return an opaque pointer to a ClusterTree
+*/
+HMAT_API hmat_cluster_tree_t * hmat_create_cluster_tree_from_graph(int size, const int* row_ptr, const int* col_ind, int max_leaf_size);
+
 /* Opaque pointer */
 typedef struct hmat_cluster_tree_builder hmat_cluster_tree_builder_t;
 
@@ -293,6 +349,12 @@ typedef struct
 
   /* ! Number of tree nodes */
   size_t nr_tree_nodes;
+
+  /* ! Position of the first degree of freedom of the cluster in the renumbering */
+  int offset;
+
+  /* ! Number of degrees of freedom of the cluster */
+  int size;
 } hmat_cluster_info_t;
 
 HMAT_API int hmat_cluster_get_info(hmat_cluster_tree_t *tree, hmat_cluster_info_t* info);
@@ -372,6 +434,22 @@ HMAT_API hmat_compression_algorithm_t* hmat_create_compression_aca_full(double e
 HMAT_API hmat_compression_algorithm_t* hmat_create_compression_aca_partial(double epsilon);
 HMAT_API hmat_compression_algorithm_t* hmat_create_compression_aca_plus(double epsilon);
 HMAT_API hmat_compression_algorithm_t* hmat_create_compression_aca_random(double epsilon);
+/*
+ * ACA partial fetching batch_size rows, then the matching columns, per evaluation
+ * call. The rows of a batch are the batch_size largest entries of the last residual
+ * column. With batch_size=1 it behaves as hmat_create_compression_aca_partial.
+ * Blocks whose hmat_block_info_t provides compute_rows and compute_cols are
+ * evaluated with one call per batch.
+ */
+HMAT_API hmat_compression_algorithm_t* hmat_create_compression_aca_batch(double epsilon, int batch_size);
+/*
+ * Randomized SVD. The block is assembled, then its range is sketched with random
+ * matrices of block_size columns, each one refined with power_iterations power
+ * iterations, until the residual is below epsilon. The result is truncated with
+ * an SVD of the small factors. It is a BLAS3 alternative to the SVD for blocks
+ * where ACA picks bad pivots (16 and 1 are reasonable defaults).
+ */
+HMAT_API hmat_compression_algorithm_t* hmat_create_compression_rsvd(double epsilon, int block_size, int power_iterations);
 
 /* Delete a compression algorithm */
 HMAT_API void hmat_delete_compression(const hmat_compression_algorithm_t* algo);
@@ -412,8 +490,35 @@ typedef struct
   int largest_rk_mem_cols;
   /*! Rank of the largest Rk matrice with memory criteria */
   int largest_rk_mem_rank;
+  /*! Sum of the ranks of the rk leaves, their mean rank is rk_rank_sum / rk_count */
+  size_t rk_rank_sum;
+  /*! Largest rank of the rk leaves */
+  int max_rk_rank;
 } hmat_info_t;
 
+/** Estimate of the memory and of the cost of a HMatrix, see hmat_interface_t.estimate_cost */
+typedef struct
+{
+  /*! Information on the assembled matrix, the sizes and ranks of its rk leaves being estimated */
+  hmat_info_t info;
+  /*! Number of rk leaves compressed for the estimate */
+  int sampled_rk_blocks;
+  /*! Number of full leaves assembled for the estimate */
+  int sampled_full_blocks;
+  /*! Memory of the assembled matrix, in bytes */
+  double assembled_bytes;
+  /*! Sequential time of the assembly, in seconds */
+  double assembly_time;
+  /*! Memory of the factorized matrix, in bytes, including the pivots or the diagonal */
+  double factorized_bytes;
+  /*! Floating point operations of the factorization, counted in real arithmetic */
+  double factorization_flops;
+  /*! Sequential time of the factorization in seconds, 0 if it could not be measured */
+  double factorization_time;
+  /*! Floating point operations of the solve of one right-hand side, counted in real arithmetic */
+  double solve_flops;
+} hmat_cost_estimate_t;
+
 typedef struct hmat_matrix_struct hmat_matrix_t;
 
 /** Allow to implement a progress bar associated to assemble or factorize */
@@ -583,6 +688,32 @@ typedef struct {
 /** Init a hmat_factorization_context_t with default values */
 HMAT_API void hmat_factorization_context_init(hmat_factorization_context_t * context);
 
+typedef struct {
+    /** The Krylov method. The default is hmat_iterative_gmres. */
+    hmat_iterative_t method;
+    /** Stop when the residual norm is below tolerance times the norm of b. The default is 1e-6. */
+    double tolerance;
+    /** The maximum number of iterations for each right-hand side. The default is 1000. */
+    int max_iterations;
+    /** The dimension of the Krylov space before GMRES restarts. The default is 30. */
+    int restart;
+    /** A factorized approximation of the matrix, as returned by create_preconditioner,
+        or NULL for no preconditioning. The default is NULL. */
+    hmat_matrix_t * preconditioner;
+    /** The preconditioner is in single precision, as returned by
+        create_low_precision_preconditioner. The default is 0. */
+    int low_precision_preconditioner;
+    /** Use x as initial guess, else start from 0. The default is 0. */
+    int initial_guess;
+    /** Output: the largest number of iterations of the right-hand sides */
+    int iterations;
+    /** Output: the largest relative residual of the right-hand sides */
+    double residual;
+} hmat_iterative_context_t;
+
+/** Init a hmat_iterative_context_t with default values */
+HMAT_API void hmat_iterative_context_init(hmat_iterative_context_t * context);
+
 /** Context for the get_values and get_block function */
 struct hmat_get_values_context_t {
     /** The matrix from witch to get values */
@@ -831,7 +962,6 @@ typedef struct
 		       void* beta, void* vec_c, int nrhs);
     /*! @deprecated \brief C <- alpha * A * B + beta * C
 
-
       In this version, a, c: FullMatrix, b: HMatrix.
 
       \param trans_a
@@ -985,10 +1115,199 @@ typedef struct
      * reporting.
      */
     void (*set_progressbar)(hmat_matrix_t * matrix, hmat_progress_t * progress);
+
+    /* New members are appended below, so that the offsets of the members
+       above do not change within a HMAT_SO_VERSION. */
+    /*! \brief Prepare a matrix for repeated matrix-vector products
+
+      The leaves of the matrix are moved to a flat, contiguous
+      representation which is then used by gemm_scalar and gemm_dense
+      (with trans_b 'N' or 'T'). The memory of the matrix does not grow,
+      except while the leaves are moved. The flat representation is dropped
+      when the matrix is modified through this interface, and must be
+      prepared again.
+
+      \param hmatrix
+      \return 0 for success
+    */
+    int (*prepare_gemv)(hmat_matrix_t* hmatrix);
+    /*! \brief Write a matrix, structure and data, to a file which can be
+      loaded with read_mapped.
+      \return 0 for success
+    */
+    int (*write_mapped)(hmat_matrix_t* matrix, const char * filename);
+    /*! \brief Load a matrix written by write_mapped.
+
+      The file is mapped in memory and the blocks of the matrix point to it,
+      so pages are only read when they are used. Modifying the matrix does
+      not modify the file. The file is unmapped by destroy.
+      \return the matrix, NULL on error
+    */
+    hmat_matrix_t * (*read_mapped)(const char * filename);
+    /*! \brief Write the blocks of a matrix like write_data, in chunks
+      encoded in parallel. Each chunk has a checksum.
+      \param compress if non zero, chunks are compressed with a fast lossless
+      codec
+      \return 0 for success
+    */
+    int (*write_data_chunked)(hmat_matrix_t* matrix, hmat_iostream writefunc, void * user_data, int compress);
+    /*! \brief Read the blocks written by write_data_chunked into a matrix
+      created by read_struct. Chunks are decoded in parallel.
+      \return 0 for success, 1 if the data is truncated or corrupted
+    */
+    int (*read_data_chunked)(hmat_matrix_t* matrix, hmat_iostream readfunc, void * user_data);
+    /*! \brief Recompress a matrix with nested cluster bases (H2-matrix)
+      for repeated matrix-vector products
+
+      The admissible blocks are represented in orthonormal bases attached
+      to the nodes of the cluster trees, the basis of a cluster being
+      obtained from the bases of its children with small transfer matrices,
+      and each block is reduced to a small coupling matrix. The full blocks
+      are shared with the matrix, and the data of the admissible blocks is
+      freed as soon as their coupling matrix is built, so the memory does
+      not grow. The H2 representation is then used by gemm_scalar and
+      gemm_dense. It is dropped as the one of prepare_gemv, which it
+      replaces, by the functions modifying the matrix and by the functions
+      other than the products which read it, including copy and get_info.
+      The admissible blocks are then rebuilt from the bases, within epsilon
+      of the original ones, and get_info reports their sizes and ranks.
+
+      The conversion is lossy and cannot be undone: the original admissible
+      blocks are not kept, so once the H2 representation is dropped the
+      matrix and all its copies hold the rebuilt blocks, with the error of
+      the bases added to the one of the compression. Convert a copy to keep
+      the original matrix.
+
+      \param hmatrix
+      \param epsilon relative accuracy of the bases, 0 to use the low-rank
+      epsilon of the matrix
+      \return 0 for success
+    */
+    int (*convert_to_h2)(hmat_matrix_t* hmatrix, double epsilon);
+    /*! \brief Solve A x = b with a Krylov method.
+
+      The products by A use the matrix as is, or the copy built by
+      prepare_gemv or convert_to_h2. The preconditioner of the context
+      is applied with solve_systems.
+
+      \param hmatrix a square matrix
+      \param context the solver parameters, and the iteration count and residual on return
+      \param b the nrhs right-hand sides
+      \param x the nrhs solutions, and the initial guess if context->initial_guess is set.
+      It is left unchanged on error.
+      \param nrhs
+      \return 0 if all the right-hand sides converged, 1 on error, 2 if some of them did not
+      converge within max_iterations, x being then the last iterate
+    */
+    int (*solve_iterative)(hmat_matrix_t* hmatrix, hmat_iterative_context_t * context, const void* b,
+                           void* x, int nrhs);
+    /*! \brief Return a factorized copy of a matrix, recompressed at a larger epsilon,
+      to be used as preconditioner of solve_iterative.
+
+      \param hmatrix the matrix to approximate
+      \param epsilon the low-rank epsilon of the copy, such as 1e-2
+      \param context the factorization of the copy
+      \return the new matrix, or NULL in case of error
+    */
+    hmat_matrix_t* (*create_preconditioner)(hmat_matrix_t* hmatrix, double epsilon,
+                                            hmat_factorization_context_t * context);
+    /*! \brief Return a factorized single precision copy of a matrix, to be used as
+      preconditioner of solve_iterative with low_precision_preconditioner set.
+
+      With hmat_iterative_refinement or hmat_iterative_gmres, the solution then
+      has the double precision accuracy for the cost of a single precision
+      factorization. The copy shares the cluster trees of hmatrix, which must be
+      destroyed after it.
+
+      \param hmatrix the matrix to approximate
+      \param context the factorization of the copy
+      \return the new matrix, which belongs to the single precision interface
+      (HMAT_SIMPLE_PRECISION or HMAT_SIMPLE_COMPLEX) and must be destroyed with
+      it, or NULL in case of error
+    */
+    hmat_matrix_t* (*create_low_precision_preconditioner)(hmat_matrix_t* hmatrix,
+                                                          hmat_factorization_context_t * context);
+    /*! \brief Compute the diagonal of the inverse of a factorized matrix.
+
+      The matrix must be factorized with hmat_factorization_llt,
+      hmat_factorization_ldlt, hmat_factorization_hodlr or
+      hmat_factorization_hodlrsym. This costs a small multiple of the
+      factorization, instead of n solves.
+
+      \param hmatrix the factorized matrix
+      \param diagonal the n diagonal entries of the inverse, in the original numbering
+      \return 0 for success
+    */
+    int (*inverse_diagonal)(hmat_matrix_t* hmatrix, void* diagonal);
+    /*! \brief Compute diagonal blocks of the inverse of a factorized matrix.
+
+      The matrix must be factorized as for inverse_diagonal.
+
+      \param hmatrix the factorized matrix
+      \param nb_blocks the number of blocks
+      \param sizes the number of rows of each block
+      \param indices the rows (and columns) of the blocks, in the original numbering,
+      those of the first block, then those of the second one, ...
+      \param blocks the blocks of the inverse, each one stored in a column major
+      sizes[i] x sizes[i] array, one after the other
+      \return 0 for success
+    */
+    int (*inverse_diagonal_blocks)(hmat_matrix_t* hmatrix, int nb_blocks, const int* sizes,
+                                   const int* indices, void* blocks);
+    /*! \brief Solve A x = b, with x overwriting b, for a sparse b or when only
+      a few entries of x are needed.
+
+      b is zero outside of the rows nonzero_rows, and only the rows requested_rows
+      of x are computed, the other rows of b being unspecified on return. Rows are
+      given in the original numbering. The blocks of the factors which only see zero
+      inputs or only produce unneeded outputs are skipped, so the saving depends on
+      how localized these rows are in the cluster tree.
+
+      \param hmatrix a factorized matrix
+      \param b the nrhs right-hand sides, in the original numbering
+      \param nrhs
+      \param nb_nonzero the number of nonzero rows, or -1 if b is dense
+      \param nonzero_rows
+      \param nb_requested the number of requested rows, or -1 for the whole solution
+      \param requested_rows
+      \return 0 for success
+    */
+    int (*solve_sparse)(hmat_matrix_t* hmatrix, void* b, int nrhs, int nb_nonzero, const int* nonzero_rows,
+                        int nb_requested, const int* requested_rows);
+    /*! \brief Estimate the memory and the cost of the assembly and factorization
+
+      Only the block structure is used: a few rk leaves, spread over the range
+      of block sizes, are compressed with ctx->compression, and every other rk
+      leaf gets the rank of the sampled leaf of closest size. A few full leaves
+      are assembled to time the kernel and the dense factorization. The
+      factorization selected by ctx->factorization is then played on the block
+      structure, an rk block receiving an update of higher rank taking this
+      rank, which accounts for the fill-in.
+
+      \param hmatrix an empty HMatrix, as returned by create_empty_hmatrix_admissibility,
+      which is not modified
+      \param ctx the context which would be given to assemble_generic
+      \param nb_samples the number of rk leaves to compress, such as 50
+      \param estimate the result
+      \return 0 for success
+     */
+    int (*estimate_cost)(hmat_matrix_t *hmatrix, hmat_assemble_context_t * ctx, int nb_samples,
+                         hmat_cost_estimate_t * estimate);
 }  hmat_interface_t;
 
 HMAT_API void hmat_init_default_interface(hmat_interface_t * i, hmat_value_t type);
 
+/*! \brief Init an interface whose assembly and factorizations run in parallel
+
+  LU, LDLT and LLT factorizations are split into a graph of tasks executed on a
+  pool of threads. Leaves are assembled and compressed concurrently, so the
+  callbacks given to the assembly must be thread-safe. Other operations are the same as in the default interface.
+  The number of threads is read from the HMAT_NUM_THREADS environment variable
+  and defaults to the number of cores. The init() function of this interface
+  sets the worker index function (see hmat_set_worker_index_function).
+*/
+HMAT_API void hmat_init_task_interface(hmat_interface_t * i, hmat_value_t type);
+
 typedef struct
 {
   /*! \brief svd compression if max(rows->n, cols->n) < compressionMinLeafSize.*/
@@ -1011,6 +1330,24 @@ typedef struct
   int validationDump;
   /*! \brief Error threshold for the compression validation */
   double validationErrorThreshold;
+  /*! \brief Maximum memory in bytes requested at the same time through
+      hmat_block_info_t.needed_memory when blocks are assembled in parallel
+      (see hmat_init_task_interface). 0 means no limit. */
+  size_t assemblyMemory;
+  /*! \brief Store the Rk blocks of the gemv plan (see prepare_gemv) in single
+      precision when their low-rank epsilon allows it. Only used with double
+      and double complex matrices. The plan holds rounded copies, which halve
+      the bandwidth of the products, and the double precision data is kept
+      in the matrix, which is left unchanged when the plan is dropped. The
+      solves do not use the plan. */
+  int mixedPrecisionGemv;
+  /*! \brief During factorization, queue the low-rank updates that land on
+      each Rk block and merge them with a single recompression just before the
+      block is used by a triangular solve, instead of recompressing after each
+      update. Off by default: the merge costs one recompression of the sum
+      of the queued ranks, so it only pays when many small updates land on a
+      block of a much larger rank, and it was slower on the cylinder LU. */
+  int deferredUpdates;
 } hmat_settings_t;
 
 /*! \brief Get current settings
@@ -1043,6 +1380,109 @@ HMAT_API void hmat_get_build_date(const char**, const char**);
 */
 HMAT_API void hmat_tracing_dump(char *filename) ;
 
+/*! \brief Counters of a function instrumented with DECLARE_CONTEXT */
+typedef struct {
+    /*! Name of the function, including its template arguments */
+    const char * name;
+    /*! Number of calls */
+    long long calls;
+    /*! Time spent in the function and its callees in seconds, summed over the threads */
+    double time;
+    /*! Floating point operations of the function and its callees */
+    long long flops;
+} hmat_counter_t;
+
+/*!
+ \brief Enable or disable the per-function counters, which are enabled by default
+
+ Unlike the traces of hmat_tracing_dump, the counters do not need -DHAVE_CONTEXT.
+ They are flat: recursive calls only count the time of the outermost call.
+ Only the first 1024 instrumented functions (MAX_COUNTERS) have counters, a
+ warning is printed when a function is dropped.
+*/
+HMAT_API void hmat_set_counters_enabled(int enabled);
+
+/*!
+ \brief Get the per-function counters, sorted by decreasing time
+\param counters an array of size elements, filled with the most expensive functions
+\param size the size of counters
+\return the number of functions which have been called, which may be larger than size
+*/
+HMAT_API int hmat_get_counters(hmat_counter_t * counters, int size);
+
+/*! \brief Clear the per-function counters, outside of parallel regions */
+HMAT_API void hmat_reset_counters(void);
+
+/*! \brief Categories of the memory accounting */
+typedef enum {
+    /*! Arrays which do not belong to the other categories: work arrays, vectors, right-hand sides */
+    hmat_memory_temporary,
+    /*! Full blocks */
+    hmat_memory_full,
+    /*! Panels of the low-rank blocks */
+    hmat_memory_rk,
+    /*! Permutations and coordinates of the cluster trees */
+    hmat_memory_cluster_tree,
+    /*! Pivots and diagonals of the factorized full blocks */
+    hmat_memory_pivots,
+    /*! All the categories */
+    hmat_memory_total,
+    hmat_memory_categories
+} hmat_memory_category_t;
+
+/*! \brief Memory of each category in bytes */
+typedef struct {
+    long long current[hmat_memory_categories];
+    /*! Largest value of current, since the last reset or since the beginning of the phase */
+    long long peak[hmat_memory_categories];
+} hmat_memory_stats_t;
+
+/*!
+ \brief Get the memory used by the library, and its peaks since the last hmat_reset_memory_peaks
+
+ The accounting is always enabled and does not depend on HMAT_MEM_INSTR. It counts the
+ arrays of the matrices and of the cluster trees, not the allocator overhead.
+*/
+HMAT_API void hmat_get_memory_stats(hmat_memory_stats_t * stats);
+
+/*! \brief Set the peaks to the current values */
+HMAT_API void hmat_reset_memory_peaks(void);
+
+/*!
+ \brief Start a phase, such as "assembly", "factorization" or "solve", ending the previous one
+
+ The peaks of the phase can be read with hmat_get_memory_phase once it is ended.
+\param name the name of the phase, which is copied
+*/
+HMAT_API void hmat_memory_begin_phase(const char * name);
+
+/*! \brief End the current phase */
+HMAT_API void hmat_memory_end_phase(void);
+
+/*!
+ \brief Get the memory of the last ended phase with a given name
+\param name the name of the phase
+\param stats the memory at the end of the phase, and the peaks during the phase
+\return 0 for success, 1 if there is no such phase
+*/
+HMAT_API int hmat_get_memory_phase(const char * name, hmat_memory_stats_t * stats);
+
+/*!
+ \brief Convert the binary traces of a run to the Chrome trace JSON format
+
+ The library must be compiled with -DHMAT_TIMELINE=ON for the run to write the
+ traces <prefix><rank>_<worker>.bin, prefix being the value of the HMAT_TIMELINE
+ environment variable. The conversion itself is always available. The output has
+ one track per worker, and can be opened with chrome://tracing or ui.perfetto.dev.
+ The trace files now start with a header and record the length of each payload
+ (version 2). The traces of the previous releases (version 1) are still read.
+\param prefix the prefix of the trace files
+\param filename the name of the output json file
+\return 0 for success, 1 for an error, 2 if some trace files are truncated, corrupted
+or of another version: the records before the damage are converted
+*/
+HMAT_API int hmat_timeline_export(const char *prefix, const char *filename);
+
 /** \brief Set the function used to get the worker index.
 
     The function f() must return the worker Id (between 0 and nbWorkers-1) or -1 in a sequential section.
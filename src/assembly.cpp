@@ -194,6 +194,8 @@ void initBlockInfo(hmat_block_info_t * info) {
     info->user_data = NULL;
     info->needed_memory = 0;
     info->number_of_strata = 1;
+    info->compute_rows = NULL;
+    info->compute_cols = NULL;
 }
 
 template<typename T>
@@ -25,10 +25,17 @@
 #include "coordinates.hpp"
 #include "hmat_cpp_interface.hpp"
 #include "default_engine.hpp"
+#include "task_engine.hpp"
 #include "clustering.hpp"
+#include "graph_clustering.hpp"
 #include "admissibility.hpp"
 #include "c_wrapping.hpp"
 #include "common/my_assert.h"
+#include "common/memory_instrumentation.hpp"
+#include "common/timeline_export.hpp"
+
+#include <algorithm>
+#include <fstream>
 
 using namespace hmat;
 
@@ -53,6 +60,16 @@ hmat_clustering_algorithm_t * hmat_create_clustering_hybrid()
     return (hmat_clustering_algorithm_t*) new HybridBisectionAlgorithm();
 }
 
+hmat_clustering_algorithm_t * hmat_create_clustering_morton()
+{
+    return (hmat_clustering_algorithm_t*) new SpaceFillingCurveAlgorithm(SpaceFillingCurveAlgorithm::MORTON);
+}
+
+hmat_clustering_algorithm_t * hmat_create_clustering_hilbert()
+{
+    return (hmat_clustering_algorithm_t*) new SpaceFillingCurveAlgorithm(SpaceFillingCurveAlgorithm::HILBERT);
+}
+
 void hmat_delete_clustering(hmat_clustering_algorithm_t* algo)
 {
     delete (ClusteringAlgorithm*) algo;
@@ -115,6 +132,17 @@ hmat_cluster_tree_t * hmat_create_cluster_tree_generic(struct hmat_cluster_tree_
     return reinterpret_cast<hmat_cluster_tree_t *>(r);
 }
 
+hmat_cluster_tree_t * hmat_create_cluster_tree_from_graph(int size, const int* row_ptr, const int* col_ind, int max_leaf_size)
+{
+    std::shared_ptr<const DofGraph> graph(new DofGraph(size, row_ptr, col_ind));
+    std::unique_ptr<DofCoordinates> dofs(graph->landmarkCoordinates(4));
+    GraphNestedDissectionAlgorithm algo(graph);
+    if (max_leaf_size > 0)
+        algo.setMaxLeafSize(max_leaf_size);
+    ClusterTree * r = ClusterTreeBuilder(algo).build(*dofs);
+    return reinterpret_cast<hmat_cluster_tree_t *>(r);
+}
+
 hmat_cluster_tree_builder_t* hmat_create_cluster_tree_builder(const hmat_clustering_algorithm_t* algo)
 {
     ClusterTreeBuilder* result = new ClusterTreeBuilder(*static_cast<const ClusteringAlgorithm*>((void*) algo));
@@ -175,6 +203,8 @@ int hmat_cluster_get_info(hmat_cluster_tree_t *tree, hmat_cluster_info_t* info)
     info->spatial_dimension  = cl->data.coordinates()->dimension();
     info->dimension          = cl->data.coordinates()->numberOfDof();
     info->nr_tree_nodes      = cl->nodesCount();
+    info->offset             = cl->data.offset();
+    info->size               = cl->data.size();
     return 0;
 }
 
@@ -241,6 +271,18 @@ void hmat_init_default_interface(hmat_interface_t * i, hmat_value_t type)
     }
 }
 
+void hmat_init_task_interface(hmat_interface_t * i, hmat_value_t type)
+{
+    i->value_type = type;
+    switch (type) {
+    case HMAT_SIMPLE_PRECISION: createCInterface<S_t, TaskEngine>(i); break;
+    case HMAT_DOUBLE_PRECISION: createCInterface<D_t, TaskEngine>(i); break;
+    case HMAT_SIMPLE_COMPLEX: createCInterface<C_t, TaskEngine>(i); break;
+    case HMAT_DOUBLE_COMPLEX: createCInterface<Z_t, TaskEngine>(i); break;
+    default: HMAT_ASSERT(false);
+    }
+}
+
 void hmat_get_parameters(hmat_settings_t* settings)
 {
     HMatSettings& settingsCxx = HMatSettings::getInstance();
@@ -254,6 +296,9 @@ void hmat_get_parameters(hmat_settings_t* settings)
     settings->validationReRun = settingsCxx.validationReRun;
     settings->dumpTrace = settingsCxx.dumpTrace;
     settings->validationDump = settingsCxx.validationDump;
+    settings->assemblyMemory = settingsCxx.assemblyMemory;
+    settings->mixedPrecisionGemv = settingsCxx.mixedPrecisionGemv;
+    settings->deferredUpdates = settingsCxx.deferredUpdates;
 }
 
 int hmat_set_parameters(hmat_settings_t* settings)
@@ -271,6 +316,9 @@ int hmat_set_parameters(hmat_settings_t* settings)
     settingsCxx.validationReRun = settings->validationReRun;
     settingsCxx.dumpTrace = settings->dumpTrace;
     settingsCxx.validationDump = settings->validationDump;
+    settingsCxx.assemblyMemory = settings->assemblyMemory;
+    settingsCxx.mixedPrecisionGemv = settings->mixedPrecisionGemv;
+    settingsCxx.deferredUpdates = settings->deferredUpdates;
     settingsCxx.setParameters();
     return rc;
 }
@@ -309,6 +357,18 @@ void hmat_factorization_context_init(hmat_factorization_context_t *context) {
     context->progress = DefaultProgress::getInstance();
 }
 
+void hmat_iterative_context_init(hmat_iterative_context_t *context) {
+    context->method = hmat_iterative_gmres;
+    context->tolerance = 1e-6;
+    context->max_iterations = 1000;
+    context->restart = 30;
+    context->preconditioner = NULL;
+    context->low_precision_preconditioner = 0;
+    context->initial_guess = 0;
+    context->iterations = 0;
+    context->residual = 0;
+}
+
 void hmat_delete_procedure(hmat_procedure_t* proc) {
     switch (proc->value_type) {
     case HMAT_SIMPLE_PRECISION: delete static_cast<hmat::TreeProcedure<HMatrix<S_t> >*>(proc->internal); break;
@@ -351,6 +411,14 @@ hmat_compression_algorithm_t* hmat_create_compression_aca_random(double epsilon)
     return static_cast<hmat_compression_algorithm_t*>((void*) new hmat::CompressionAcaRandom(epsilon));
 }
 
+hmat_compression_algorithm_t* hmat_create_compression_aca_batch(double epsilon, int batch_size) {
+    return static_cast<hmat_compression_algorithm_t*>((void*) new hmat::CompressionAcaBatch(epsilon, batch_size));
+}
+
+hmat_compression_algorithm_t* hmat_create_compression_rsvd(double epsilon, int block_size, int power_iterations) {
+    return static_cast<hmat_compression_algorithm_t*>((void*) new hmat::CompressionRsvd(epsilon, block_size, power_iterations));
+}
+
 void hmat_delete_compression(const hmat_compression_algorithm_t* algo) {
     delete static_cast<hmat::CompressionAlgorithm*>((void*)algo);
 }
@@ -359,6 +427,69 @@ void hmat_tracing_dump(char *filename) {
   tracing_dump(filename);
 }
 
+void hmat_set_counters_enabled(int enabled) {
+  trace::Counters::enabled = enabled != 0;
+}
+
+int hmat_get_counters(hmat_counter_t * counters, int size) {
+  std::vector<hmat_counter_t> all;
+  for (int site = 0; site < trace::Counters::sites(); site++) {
+    const trace::Counters::Data d = trace::Counters::total(site);
+    if (d.calls == 0 || trace::Counters::name(site) == NULL)
+      continue;
+    hmat_counter_t c;
+    c.name = trace::Counters::name(site);
+    c.calls = d.calls;
+    c.time = d.time * 1e-9;
+    c.flops = d.flops;
+    all.push_back(c);
+  }
+  std::sort(all.begin(), all.end(), [](const hmat_counter_t & a, const hmat_counter_t & b) { return a.time > b.time; });
+  std::copy(all.begin(), all.begin() + std::min((int) all.size(), size), counters);
+  return all.size();
+}
+
+void hmat_reset_counters() {
+  trace::Counters::reset();
+}
+
+void hmat_get_memory_stats(hmat_memory_stats_t * stats) {
+  hmat::MemoryCounters::stats(*stats);
+}
+
+void hmat_reset_memory_peaks() {
+  hmat::MemoryCounters::resetPeaks();
+}
+
+void hmat_memory_begin_phase(const char * name) {
+  hmat::MemoryCounters::beginPhase(name);
+}
+
+void hmat_memory_end_phase() {
+  hmat::MemoryCounters::endPhase();
+}
+
+int hmat_get_memory_phase(const char * name, hmat_memory_stats_t * stats) {
+  return hmat::MemoryCounters::phase(name, *stats) ? 0 : 1;
+}
+
+int hmat_timeline_export(const char *prefix, const char *filename) {
+  std::ofstream out(filename);
+  if (!out) {
+    fprintf(stderr, "Cannot open %s\n", filename);
+    return 1;
+  }
+  int damaged;
+  long count = hmat::exportTimeline(prefix, out, damaged);
+  if (count < 0) {
+    fprintf(stderr, "No trace file %s00_00.bin\n", prefix);
+    return 1;
+  }
+  if (!out.good())
+    return 1;
+  return damaged ? 2 : 0;
+}
+
 hmat_progress_t * hmat_default_progress() {
     return DefaultProgress::getInstance();
 }
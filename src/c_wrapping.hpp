@@ -23,8 +23,10 @@
 #ifndef _C_WRAPPING_HPP
 #define _C_WRAPPING_HPP
 
+#include <algorithm>
 #include <string>
 #include <cstring>
+#include <memory>
 
 #include "common/context.hpp"
 #include "common/my_assert.h"
@@ -33,6 +35,8 @@
 #include "uncompressed_values.hpp"
 #include "serialization.hpp"
 #include "hmat_cpp_interface.hpp"
+#include "iterative_solver.hpp"
+#include "cost_estimator.hpp"
 #include "disable_threading.hpp"
 
 namespace
@@ -221,6 +225,7 @@ int axpy(void *a, hmat_matrix_t * x, hmat_matrix_t * y) {
   hmat::HMatInterface<T>* hmat_x = reinterpret_cast<hmat::HMatInterface<T>*>(x);
   hmat::HMatInterface<T>* hmat_y = reinterpret_cast<hmat::HMatInterface<T>*>(y);
   try {
+      hmat_y->invalidateGemvPlan();
       hmat_y->engine().hmat->axpy(*((T*)a), hmat_x->engine().hmat);
   } catch (const std::exception& e) {
       fprintf(stderr, "%s\n", e.what());
@@ -365,6 +370,32 @@ int gemm_dense(char trans_b, char trans_x, char side, const void* alpha, hmat_ma
   return 0;
 }
 
+template<typename T, template <typename> class E>
+int prepare_gemv(hmat_matrix_t* holder) {
+  DECLARE_CONTEXT;
+  hmat::HMatInterface<T>* hmat = (hmat::HMatInterface<T>*) holder;
+  try {
+      hmat->prepareGemv();
+  } catch (const std::exception& e) {
+      fprintf(stderr, "%s\n", e.what());
+      return 1;
+  }
+  return 0;
+}
+
+template<typename T, template <typename> class E>
+int convert_to_h2(hmat_matrix_t* holder, double epsilon) {
+  DECLARE_CONTEXT;
+  hmat::HMatInterface<T>* hmat = (hmat::HMatInterface<T>*) holder;
+  try {
+      hmat->convertToH2(epsilon);
+  } catch (const std::exception& e) {
+      fprintf(stderr, "%s\n", e.what());
+      return 1;
+  }
+  return 0;
+}
+
 template<typename T, template <typename> class E>
 int trsm( char side, char uplo, char transa, char diag, int m, int n,
 	  void *alpha, hmat_matrix_t *A, int is_b_hmat, void *B )
@@ -527,6 +558,169 @@ int solve_systems(hmat_matrix_t* holder, void* b, int nrhs) {
   return 0;
 }
 
+/**
+ * Convert rows in the original numbering into sorted and disjoint ranges of
+ * the internal numbering, internal[i] being the internal index of row i.
+ */
+void toInternalRanges(const std::vector<int>& internal, int offset, int nb, const int* rows,
+                      std::vector<hmat::IndexSet>& ranges) {
+  std::vector<int> sorted(nb);
+  for (int k = 0; k < nb; k++) {
+    HMAT_ASSERT_MSG(rows[k] >= 0 && rows[k] < (int) internal.size(), "Index %d out of range", rows[k]);
+    sorted[k] = internal[rows[k]];
+  }
+  std::sort(sorted.begin(), sorted.end());
+  for (int k = 0; k < nb;) {
+    int end = k + 1;
+    while (end < nb && sorted[end] <= sorted[end - 1] + 1)
+      end++;
+    ranges.push_back(hmat::IndexSet(offset + sorted[k], sorted[end - 1] - sorted[k] + 1));
+    k = end;
+  }
+}
+
+template<typename T, template <typename> class E>
+int solve_sparse(hmat_matrix_t* holder, void* b, int nrhs, int nb_nonzero, const int* nonzero_rows,
+                 int nb_requested, const int* requested_rows) {
+  DECLARE_CONTEXT;
+  hmat::HMatInterface<T>* hmat = (hmat::HMatInterface<T>*)holder;
+  try {
+      const int n = hmat->cols()->size();
+      // indices() gives the original index of each internal index
+      std::vector<int> internal(n);
+      for (int i = 0; i < n; i++)
+        internal[hmat->cols()->indices()[i]] = i;
+      std::vector<hmat::IndexSet> nonZero, requested;
+      if (nb_nonzero >= 0)
+        toInternalRanges(internal, hmat->cols()->offset(), nb_nonzero, nonzero_rows, nonZero);
+      if (nb_requested >= 0)
+        toInternalRanges(internal, hmat->cols()->offset(), nb_requested, requested_rows, requested);
+      hmat::ScalarArray<T> mb((T*) b, n, nrhs);
+      hmat::reorderVector<T>(&mb, hmat->cols()->indices(), 0);
+      hmat->solveSparse(mb, nb_nonzero >= 0 ? &nonZero : NULL, nb_requested >= 0 ? &requested : NULL);
+      hmat::restoreVectorOrder<T>(&mb, hmat->cols()->indices(), 0);
+  } catch (const std::exception& e) {
+      fprintf(stderr, "%s\n", e.what());
+      return 1;
+  }
+  return 0;
+}
+
+template<typename T, template <typename> class E>
+int solve_iterative(hmat_matrix_t* holder, hmat_iterative_context_t * ctx, const void* b, void* x, int nrhs) {
+  DECLARE_CONTEXT;
+  hmat::HMatInterface<T>* hmat = (hmat::HMatInterface<T>*)holder;
+  try {
+      typedef typename hmat::Types<T>::sp sp_t;
+      hmat::IterativeSolver<T> solver(*hmat, ctx->low_precision_preconditioner ?
+                                      NULL : (hmat::HMatInterface<T>*)ctx->preconditioner);
+      if (ctx->low_precision_preconditioner)
+        solver.lowPrecisionPreconditioner((hmat::HMatInterface<sp_t>*)ctx->preconditioner);
+      solver.method = hmat::IterativeMethod(ctx->method);
+      solver.tolerance = ctx->tolerance;
+      solver.maxIterations = ctx->max_iterations;
+      solver.restart = ctx->restart;
+      // b is const and x is only written on success, work on reordered copies
+      const hmat::ScalarArray<T> userB((T*) b, hmat->rows()->size(), nrhs);
+      hmat::ScalarArray<T> mb(hmat->rows()->size(), nrhs, false);
+      mb.copyMatrixAtOffset(&userB, 0, 0);
+      hmat::ScalarArray<T> userX((T*) x, hmat->cols()->size(), nrhs);
+      hmat::ScalarArray<T> mx(hmat->cols()->size(), nrhs, !ctx->initial_guess);
+      hmat::reorderVector<T>(&mb, hmat->rows()->indices(), 0);
+      if (ctx->initial_guess) {
+        mx.copyMatrixAtOffset(&userX, 0, 0);
+        hmat::reorderVector<T>(&mx, hmat->cols()->indices(), 0);
+      }
+      const bool converged = solver.solve(mb, mx);
+      hmat::restoreVectorOrder<T>(&mx, hmat->cols()->indices(), 0);
+      userX.copyMatrixAtOffset(&mx, 0, 0);
+      ctx->iterations = solver.iterations();
+      ctx->residual = solver.residual();
+      return converged ? 0 : 2;
+  } catch (const std::exception& e) {
+      fprintf(stderr, "%s\n", e.what());
+      return 1;
+  }
+}
+
+template<typename T, template <typename> class E>
+hmat_matrix_t* create_preconditioner(hmat_matrix_t* holder, double epsilon, hmat_factorization_context_t * ctx) {
+  DECLARE_CONTEXT;
+  try {
+      return (hmat_matrix_t*) hmat::IterativeSolver<T>::createPreconditioner(
+          *(hmat::HMatInterface<T>*)holder, epsilon,
+          hmat::convert_int_to_factorization(ctx->factorization), ctx->progress);
+  } catch (const std::exception& e) {
+      fprintf(stderr, "%s\n", e.what());
+      return NULL;
+  }
+}
+
+template<typename T, template <typename> class E>
+hmat_matrix_t* create_low_precision_preconditioner(hmat_matrix_t* holder, hmat_factorization_context_t * ctx) {
+  DECLARE_CONTEXT;
+  typedef typename hmat::Types<T>::sp sp_t;
+  try {
+      std::unique_ptr<hmat::IEngine<sp_t> > engine(new E<sp_t>());
+      return (hmat_matrix_t*) hmat::IterativeSolver<T>::createLowPrecisionPreconditioner(
+          *(hmat::HMatInterface<T>*)holder, std::move(engine),
+          hmat::convert_int_to_factorization(ctx->factorization), ctx->progress);
+  } catch (const std::exception& e) {
+      fprintf(stderr, "%s\n", e.what());
+      return NULL;
+  }
+}
+
+template<typename T, template <typename> class E>
+int inverse_diagonal(hmat_matrix_t* holder, void* diagonal) {
+  DECLARE_CONTEXT;
+  hmat::HMatInterface<T>* hmat = (hmat::HMatInterface<T>*)holder;
+  try {
+      hmat::ScalarArray<T> d((T*) diagonal, hmat->rows()->size(), 1);
+      hmat->inverseDiagonal(d);
+      hmat::restoreVectorOrder<T>(&d, hmat->rows()->indices(), 0);
+  } catch (const std::exception& e) {
+      fprintf(stderr, "%s\n", e.what());
+      return 1;
+  }
+  return 0;
+}
+
+template<typename T, template <typename> class E>
+int inverse_diagonal_blocks(hmat_matrix_t* holder, int nb_blocks, const int* sizes, const int* indices,
+                            void* blocks) {
+  DECLARE_CONTEXT;
+  hmat::HMatInterface<T>* hmat = (hmat::HMatInterface<T>*)holder;
+  try {
+      // indices() gives the original index of each internal index
+      const int n = hmat->rows()->size();
+      std::vector<int> internal(n);
+      for (int i = 0; i < n; i++)
+        internal[hmat->rows()->indices()[i]] = i;
+      std::vector<std::vector<int> > internalIndices(nb_blocks);
+      std::vector<hmat::ScalarArray<T> > arrays;
+      arrays.reserve(nb_blocks);
+      T* data = (T*) blocks;
+      for (int b = 0; b < nb_blocks; b++) {
+        for (int k = 0; k < sizes[b]; k++) {
+          HMAT_ASSERT_MSG(indices[k] >= 0 && indices[k] < n, "Index %d out of range", indices[k]);
+          internalIndices[b].push_back(internal[indices[k]]);
+        }
+        arrays.push_back(hmat::ScalarArray<T>(data, sizes[b], sizes[b]));
+        indices += sizes[b];
+        data += (size_t) sizes[b] * sizes[b];
+      }
+      std::vector<hmat::ScalarArray<T>*> results;
+      for (int b = 0; b < nb_blocks; b++)
+        results.push_back(&arrays[b]);
+      hmat->inverseBlocks(internalIndices, results);
+  } catch (const std::exception& e) {
+      fprintf(stderr, "%s\n", e.what());
+      return 1;
+  }
+  return 0;
+}
+
 template<typename T, template <typename> class E>
 int solve_dense(hmat_matrix_t* holder, void* b, int nrhs) {
   DECLARE_CONTEXT;
@@ -566,6 +760,36 @@ int hmat_get_info(hmat_matrix_t* holder, hmat_info_t* info) {
   return 0;
 }
 
+template<typename T, template <typename> class E>
+int estimate_cost(hmat_matrix_t* holder, hmat_assemble_context_t * ctx, int nb_samples,
+                  hmat_cost_estimate_t * estimate) {
+  DECLARE_CONTEXT;
+  hmat::HMatInterface<T>* hmat = (hmat::HMatInterface<T>*) holder;
+  try {
+      HMAT_ASSERT_MSG(ctx->compression, "No compression algorithm defined in hmat_assemble_context_t");
+      hmat::CompressionAlgorithm* compression = (hmat::CompressionAlgorithm*)ctx->compression;
+      hmat::Factorization algo = hmat::convert_int_to_factorization(ctx->factorization);
+      if(ctx->assembly != NULL) {
+          hmat::estimateCost(hmat->engine().hmat, *(hmat::Assembly<T> *)ctx->assembly, algo, nb_samples, *estimate);
+      } else if(ctx->block_compute != NULL || ctx->advanced_compute != NULL) {
+          HMAT_ASSERT(ctx->prepare != NULL);
+          hmat::BlockFunction<T> blockFunction(hmat->rows(), hmat->cols(),
+              ctx->user_context, ctx->prepare, ctx->block_compute, ctx->advanced_compute);
+          hmat::AssemblyFunction<T, hmat::BlockFunction> f(blockFunction, compression);
+          hmat::estimateCost(hmat->engine().hmat, f, algo, nb_samples, *estimate);
+      } else if(ctx->simple_compute != NULL) {
+          hmat::AssemblyFunction<T, hmat::SimpleFunction> f(
+              hmat::SimpleFunction<T>(ctx->simple_compute, ctx->user_context), compression);
+          hmat::estimateCost(hmat->engine().hmat, f, algo, nb_samples, *estimate);
+      } else
+        HMAT_ASSERT_MSG(0, "No valid assembly method in estimate_cost()");
+  } catch (const std::exception& e) {
+      fprintf(stderr, "%s\n", e.what());
+      return 1;
+  }
+  return 0;
+}
+
 template<typename T, template <typename> class E>
 int hmat_dump_info(hmat_matrix_t* holder, char* prefix) {
   DECLARE_CONTEXT;
@@ -602,6 +826,7 @@ int set_cluster_trees(hmat_matrix_t* holder, const hmat_cluster_tree_t * rows, c
   DECLARE_CONTEXT;
   hmat::HMatInterface<T>* hmat = (hmat::HMatInterface<T>*) holder;
   try {
+      hmat->invalidateGemvPlan();
       hmat->engine().hmat->setClusterTrees(
         reinterpret_cast<const hmat::ClusterTree*>(rows),
         reinterpret_cast<const hmat::ClusterTree*>(cols));
@@ -625,6 +850,8 @@ void set_low_rank_epsilon(hmat_matrix_t* holder, double epsilon)
 {
   DECLARE_CONTEXT;
   hmat::HMatInterface<T>* hmat = (hmat::HMatInterface<T>*) holder;
+  // The precision of the plan blocks and the H2 bases depend on epsilon
+  hmat->invalidateGemvPlan();
   hmat->engine().hmat->lowRankEpsilon(epsilon);
 }
 
@@ -794,6 +1021,7 @@ hmat_matrix_t * read_struct(hmat_iostream readfunc, void * user_data) {
 template <typename T, template <typename> class E>
 void read_data(hmat_matrix_t * matrix, hmat_iostream readfunc, void * user_data) {
     hmat::HMatInterface<T> * hmi = (hmat::HMatInterface<T> *) matrix;
+    hmi->invalidateGemvPlan();
     hmat::MatrixDataUnmarshaller<T>(readfunc, user_data).read(hmi->engine().hmat);
 }
 
@@ -810,6 +1038,62 @@ void write_data(hmat_matrix_t* matrix, hmat_iostream writefunc, void * user_data
     hmat::MatrixDataMarshaller<T>(writefunc, user_data).write(hmi->engine().hmat);
 }
 
+template <typename T, template <typename> class E>
+int write_data_chunked(hmat_matrix_t* matrix, hmat_iostream writefunc, void * user_data, int compress) {
+    DECLARE_CONTEXT;
+    hmat::HMatInterface<T> * hmi = (hmat::HMatInterface<T> *) matrix;
+    try {
+        hmat::ChunkedDataMarshaller<T>(writefunc, user_data, compress != 0).write(hmi->engine().hmat);
+    } catch (const std::exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
+
+template <typename T, template <typename> class E>
+int read_data_chunked(hmat_matrix_t* matrix, hmat_iostream readfunc, void * user_data) {
+    DECLARE_CONTEXT;
+    hmat::HMatInterface<T> * hmi = (hmat::HMatInterface<T> *) matrix;
+    try {
+        hmi->invalidateGemvPlan();
+        hmat::ChunkedDataUnmarshaller<T>(readfunc, user_data).read(hmi->engine().hmat);
+    } catch (const std::exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
+
+template <typename T, template <typename> class E>
+int write_mapped(hmat_matrix_t* matrix, const char * filename) {
+    DECLARE_CONTEXT;
+    hmat::HMatInterface<T> * hmi = (hmat::HMatInterface<T> *) matrix;
+    try {
+        hmat::MappedMatrixWriter<T>(filename).write(hmi->engine().hmat, hmi->factorization());
+    } catch (const std::exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
+
+template <typename T, template <typename> class E>
+hmat_matrix_t * read_mapped(const char * filename) {
+    DECLARE_CONTEXT;
+    try {
+        hmat::MappedMatrixReader<T> reader(&hmat::HMatSettings::getInstance(), filename);
+        hmat::HMatrix<T> * m = reader.read();
+        E<T>* engine = new E<T>();
+        hmat::HMatInterface<T> * r = new hmat::HMatInterface<T>(engine, m, reader.factorization());
+        r->mappedFile(reader.releaseFile());
+        return (hmat_matrix_t*) r;
+    } catch (const std::exception& e) {
+        fprintf(stderr, "%s\n", e.what());
+        return NULL;
+    }
+}
+
 template <typename T>
 void set_progressbar(hmat_matrix_t * matrix, hmat_progress_t * progress) {
     reinterpret_cast<hmat::HMatInterface<T> *>(matrix)->progress(progress);
@@ -842,10 +1126,12 @@ static void createCInterface(hmat_interface_t * i)
     i->scale = scale<T, E>;
     i->solve_mat = solve_mat<T, E>;
     i->solve_systems = solve_systems<T, E>;
+    i->solve_sparse = solve_sparse<T, E>;
     i->solve_dense = solve_dense<T, E>;
     i->transpose = transpose<T, E>;
     i->internal = NULL;
     i->get_info  = hmat_get_info<T, E>;
+    i->estimate_cost = estimate_cost<T, E>;
     i->dump_info = hmat_dump_info<T, E>;
     i->get_cluster_trees = get_cluster_trees<T, E>;
     i->set_cluster_trees = set_cluster_trees<T, E>;
@@ -863,12 +1149,23 @@ static void createCInterface(hmat_interface_t * i)
     i->write_struct = write_struct<T, E>;
     i->write_data = write_data<T, E>;
     i->read_data = read_data<T, E>;
+    i->write_data_chunked = write_data_chunked<T, E>;
+    i->read_data_chunked = read_data_chunked<T, E>;
+    i->write_mapped = write_mapped<T, E>;
+    i->read_mapped = read_mapped<T, E>;
     i->apply_on_leaf = apply_on_leaf<T, E>;
     i->axpy = axpy<T, E>;
     i->trsm = trsm<T, E>;
     i->truncate = truncate<T, E>;
     i->set_progressbar = set_progressbar<T>;
     i->gemm_dense = gemm_dense<T, E>;
+    i->prepare_gemv = prepare_gemv<T, E>;
+    i->convert_to_h2 = convert_to_h2<T, E>;
+    i->solve_iterative = solve_iterative<T, E>;
+    i->create_preconditioner = create_preconditioner<T, E>;
+    i->create_low_precision_preconditioner = create_low_precision_preconditioner<T, E>;
+    i->inverse_diagonal = inverse_diagonal<T, E>;
+    i->inverse_diagonal_blocks = inverse_diagonal_blocks<T, E>;
     i->vector_reorder = vector_reorder<T, E>;
     i->vector_restore = vector_restore<T, E>;
 }
@@ -60,6 +60,67 @@ namespace hmat {
     }
   }
 
+  template<typename T>
+  void ClusterAssemblyFunction<T>::getRows(int count, const int * indices,
+                                           ScalarArray<typename Types<T>::dp> &result) const {
+    getBatch(false, count, indices, result);
+  }
+
+  template<typename T>
+  void ClusterAssemblyFunction<T>::getCols(int count, const int * indices,
+                                           ScalarArray<typename Types<T>::dp> &result) const {
+    getBatch(true, count, indices, result);
+  }
+
+  template<typename T>
+  void ClusterAssemblyFunction<T>::getBatch(bool col, int count, const int * indices,
+                                            ScalarArray<typename Types<T>::dp> &result) const {
+    typedef typename Types<T>::dp dp_t;
+    assert(result.cols == count);
+    assert(result.rows == (col ? rows->size() : cols->size()));
+    void (*compute)(const hmat_block_info_t *, int, const int *, int, void *) =
+        col ? info.compute_cols : info.compute_rows;
+    char (*isNull)(const hmat_block_info_t *, int, int) =
+        col ? info.is_guaranteed_null_col : info.is_guaranteed_null_row;
+    if (compute == NULL) {
+      for (int k = 0; k < count; k++) {
+        Vector<dp_t> v(result, k);
+        if (col)
+          getCol(indices[k], v);
+        else
+          getRow(indices[k], v);
+      }
+      return;
+    }
+    // Positions in result of the vectors to compute
+    std::vector<int> positions;
+    std::vector<int> computed;
+    for (int k = 0; k < count; k++) {
+      if (HMatrix<T>::validateNullRowCol || !isNull || !isNull(&info, indices[k], stratum)) {
+        positions.push_back(k);
+        computed.push_back(indices[k]);
+      }
+    }
+    if (computed.empty())
+      return;
+    if (computed.size() == (size_t)count && result.lda == result.rows) {
+      compute(&info, count, indices, stratum, result.ptr());
+    } else {
+      ScalarArray<dp_t> tmp(result.rows, computed.size(), false);
+      compute(&info, computed.size(), computed.data(), stratum, tmp.ptr());
+      for (size_t k = 0; k < computed.size(); k++) {
+        const Vector<dp_t> v(tmp, k);
+        result.copyMatrixAtOffset(&v, 0, positions[k]);
+      }
+    }
+    if (HMatrix<T>::validateNullRowCol && isNull) {
+      for (int k = 0; k < count; k++) {
+        if (isNull(&info, indices[k], stratum))
+          assert(Vector<dp_t>(result, k).isZero());
+      }
+    }
+  }
+
   template<typename T>
   typename Types<T>::dp hmat::ClusterAssemblyFunction<T>::getElement(int rowIndex, int colIndex) const {
     if (!HMatrix<T>::validateNullRowCol) {
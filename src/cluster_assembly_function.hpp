@@ -31,6 +31,7 @@
 
 namespace hmat {
 
+  template<typename T> class ScalarArray;
 
   template<typename T>
   class ClusterAssemblyFunction {
@@ -53,12 +54,23 @@ namespace hmat {
 
     void getCol(int index, Vector<typename Types<T>::dp> &result) const;
 
+    /**
+     * Compute the rows of the given indices, row k being stored in column k of
+     * result. Use hmat_block_info_t::compute_rows when available. The
+     * guaranteed null rows are not written, result must be zeroed.
+     */
+    void getRows(int count, const int * indices, ScalarArray<typename Types<T>::dp> &result) const;
+
+    /** Compute the columns of the given indices, see getRows */
+    void getCols(int count, const int * indices, ScalarArray<typename Types<T>::dp> &result) const;
+
     typename Types<T>::dp getElement(int rowIndex, int colIndex) const;
 
 
     FullMatrix<typename Types<T>::dp> *assemble() const;
 
   private:
+    void getBatch(bool col, int count, const int * indices, ScalarArray<typename Types<T>::dp> &result) const;
     ClusterAssemblyFunction(ClusterAssemblyFunction &o) : f(o.f), rows(o.rows), cols(o.cols), allocationObserver_(o.allocationObserver_) {} // No copy
   };
 
@@ -30,12 +30,19 @@
 #include "coordinates.hpp"
 #include "common/my_assert.h"
 #include "common/context.hpp"
+#include "common/memory_instrumentation.hpp"
+#include "common/task_pool.hpp"
 
 #include <algorithm>
 #include <cstring>
+#include <limits>
+#include <vector>
 
 namespace hmat {
 
+/** Minimum number of DOFs handled by a single task when computing a bounding box */
+static const int parallelBoxChunk = 1 << 15;
+
 bool IndexSet::operator==(const IndexSet& o) const {
   // Attention ! On ne fait pas de verification sur les indices, pour
   // pouvoir parler d'egalite entre des noeuds ayant ete generes
@@ -89,16 +96,24 @@ DofData::DofData(const DofCoordinates& coordinates, int* group_index)
   {
     group_index_ = NULL;
   }
+  MemoryCounters::add(MemoryCounters::CLUSTER_TREE, memorySize());
 }
 
 DofData::~DofData()
 {
+  MemoryCounters::add(MemoryCounters::CLUSTER_TREE, -(ptrdiff_t)memorySize());
   delete[] perm_i2e_;
   delete[] perm_e2i_;
   delete[] group_index_;
   delete coordinates_;
 }
 
+size_t DofData::memorySize() const
+{
+  const size_t n = coordinates_->numberOfDof();
+  return (group_index_ ? 3 : 2) * n * sizeof(int)
+    + (size_t) coordinates_->numberOfPoints() * coordinates_->dimension() * sizeof(double);
+}
 
 DofData*
 DofData::copy() const
@@ -204,10 +219,34 @@ AxisAlignedBoundingBox::AxisAlignedBoundingBox(const ClusterData& data)
         bb_[i + dimension_] = bb_[i];
     }
 
-    for (unsigned i = 1; i < data.size(); ++i) {
-        int dof = myIndices[i];
-        for (unsigned pointId = 0; pointId < coords.spanSize(dof); pointId++)
-            coords.spanAABB(dof, bb_);
+    // min and max are exact so the reduction order does not change the box
+    const int n = data.size();
+    const int nChunks = std::min(TaskPool::instance().size(), n / parallelBoxChunk);
+    if (nChunks < 2) {
+        for (int i = 1; i < n; ++i)
+            coords.spanAABB(myIndices[i], bb_);
+        return;
+    }
+    std::vector<double> chunkBoxes(2 * dimension_ * nChunks);
+    TaskGraph g;
+    for (int c = 0; c < nChunks; c++) {
+        double * box = &chunkBoxes[2 * dimension_ * c];
+        const int begin = 1 + (int)(((long)(n - 1) * c) / nChunks);
+        const int end = 1 + (int)(((long)(n - 1) * (c + 1)) / nChunks);
+        g.submit([this, box, begin, end, myIndices, &coords]{
+            std::fill(box, box + dimension_, std::numeric_limits<double>::infinity());
+            std::fill(box + dimension_, box + 2 * dimension_, -std::numeric_limits<double>::infinity());
+            for (int i = begin; i < end; ++i)
+                coords.spanAABB(myIndices[i], box);
+        });
+    }
+    g.wait();
+    for (int c = 0; c < nChunks; c++) {
+        const double * box = &chunkBoxes[2 * dimension_ * c];
+        for (unsigned i = 0; i < dimension_; i++) {
+            bb_[i] = std::min(bb_[i], box[i]);
+            bb_[i + dimension_] = std::max(bb_[i + dimension_], box[i + dimension_]);
+        }
     }
 }
 
@@ -114,6 +114,8 @@ private:
   int *group_index_;
   /// Coordinates
   const DofCoordinates* coordinates_;
+  /// Bytes of the indices and coordinates arrays
+  size_t memorySize() const;
 };
 
 class ClusterData : public IndexSet {
@@ -196,7 +198,8 @@ class AxisAlignedBoundingBox
     double * bb_;
 public:
     explicit AxisAlignedBoundingBox(const ClusterData& node);
-    ~AxisAlignedBoundingBox();
+    /** Virtual so clustering algorithms can store more data in the node cache */
+    virtual ~AxisAlignedBoundingBox();
     double extends(int dim) const;
     int greatestDim() const;
     double diameter() const;
@@ -24,9 +24,14 @@
 #include "cluster_tree.hpp"
 #include "common/my_assert.h"
 #include "hmat_cpp_interface.hpp"
+#include "common/task_pool.hpp"
 
 #include <algorithm>
+#include <cmath>
 #include <cstring>
+#include <map>
+#include <memory>
+#include <stdint.h>
 
 namespace {
 
@@ -47,7 +52,7 @@ public:
     , dimension_(data.coordinates()->dimension())
     , axis_(axis)
   {}
-  bool operator() (int i, int j) {
+  bool operator() (int i, int j) const {
     if (group_index_ == NULL || group_index_[i] == group_index_[j])
       return coordinates_->spanCenter(i, axis_) < coordinates_->spanCenter(j, axis_);
     return group_index_[i] < group_index_[j];
@@ -63,13 +68,219 @@ public:
 	LargeSpanComparator(const hmat::DofCoordinates& coordinates,
         double threshold, int dimension)
         : coordinates_(coordinates), threshold_(threshold), dimension_(dimension){}
-    bool operator()(int i, int j) {
+    bool operator()(int i, int j) const {
         bool vi = coordinates_.spanDiameter(i, dimension_) > threshold_;
         bool vj = coordinates_.spanDiameter(j, dimension_) > threshold_;
         return vi < vj;
     }
 };
 
+/** Nodes with at least this number of DOFs have their subtrees built in parallel */
+const int parallelSubtreeSize = 1 << 12;
+/** Minimum number of indices sorted by a single task in parallelStableSort */
+const int parallelSortChunk = 1 << 15;
+
+/*! \brief Stable sort of n indices using the task pool.
+
+  Chunks are sorted concurrently with std::stable_sort then merged pairwise
+  with std::inplace_merge. Both are stable so the result is the same as a
+  sequential std::stable_sort.
+ */
+template<typename Comparator>
+void parallelStableSort(int * first, int n, const Comparator & comp)
+{
+  int nChunks = std::min(hmat::TaskPool::instance().size(), n / parallelSortChunk);
+  if (nChunks < 2) {
+    std::stable_sort(first, first + n, comp);
+    return;
+  }
+  std::vector<int> bounds(nChunks + 1);
+  for (int i = 0; i <= nChunks; i++)
+    bounds[i] = (int)(((long)n * i) / nChunks);
+  hmat::TaskGraph sorts;
+  for (int i = 0; i < nChunks; i++) {
+    int * begin = first + bounds[i];
+    int * end = first + bounds[i + 1];
+    sorts.submit([begin, end, &comp]{ std::stable_sort(begin, end, comp); });
+  }
+  sorts.wait();
+  for (int width = 1; width < nChunks; width *= 2) {
+    hmat::TaskGraph merges;
+    for (int i = 0; i + width < nChunks; i += 2 * width) {
+      int * begin = first + bounds[i];
+      int * middle = first + bounds[i + width];
+      int * end = first + bounds[std::min(i + 2 * width, nChunks)];
+      merges.submit([begin, middle, end, &comp]{ std::inplace_merge(begin, middle, end, comp); });
+    }
+    merges.wait();
+  }
+}
+
+/*! \brief Transform quantized coordinates into the transposed Hilbert index.
+
+  See J. Skilling, "Programming the Hilbert curve", AIP Conf. Proc. 707, 2004.
+ */
+void axesToTranspose(uint32_t * x, int bits, int dimension)
+{
+  const uint32_t m = 1u << (bits - 1);
+  // Inverse undo
+  for (uint32_t q = m; q > 1; q >>= 1) {
+    const uint32_t p = q - 1;
+    for (int i = 0; i < dimension; i++) {
+      if (x[i] & q) {
+        x[0] ^= p;
+      } else {
+        const uint32_t t = (x[0] ^ x[i]) & p;
+        x[0] ^= t;
+        x[i] ^= t;
+      }
+    }
+  }
+  // Gray encode
+  for (int i = 1; i < dimension; i++)
+    x[i] ^= x[i - 1];
+  uint32_t t = 0;
+  for (uint32_t q = m; q > 1; q >>= 1)
+    if (x[dimension - 1] & q)
+      t ^= q - 1;
+  for (int i = 0; i < dimension; i++)
+    x[i] ^= t;
+}
+
+/** Interleave the bits of x, from the most significant to the least significant ones */
+uint64_t interleaveBits(const uint32_t * x, int bits, int dimension)
+{
+  uint64_t key = 0;
+  for (int b = bits - 1; b >= 0; b--)
+    for (int i = 0; i < dimension; i++)
+      key = (key << 1) | ((x[i] >> b) & 1);
+  return key;
+}
+
+/*! \brief Bounding box of a node created by SpaceFillingCurveAlgorithm.
+
+  It also holds the curve keys of the DOFs, indexed like the coordinates,
+  which are shared by all the nodes below the one which was sorted.
+ */
+class CurveCell : public hmat::AxisAlignedBoundingBox {
+public:
+  typedef std::shared_ptr<const std::vector<uint64_t> > Keys;
+  CurveCell(const hmat::ClusterData& data, const Keys& keys)
+    : hmat::AxisAlignedBoundingBox(data), keys(keys) {}
+  const Keys keys;
+};
+
+/*! \brief Compare two DOF indices based on their curve keys then on their group
+ */
+class CurveKeyComparator {
+  const uint64_t * keys_;
+  const int * group_index_;
+public:
+  CurveKeyComparator(const uint64_t * keys, const int * group_index)
+    : keys_(keys), group_index_(group_index) {}
+  bool operator()(int i, int j) const {
+    if (group_index_ == NULL || keys_[i] != keys_[j])
+      return keys_[i] < keys_[j];
+    return group_index_[i] < group_index_[j];
+  }
+};
+
+/*! \brief Compute the curve keys of the DOFs of a node.
+
+  Centers are quantized in the bounding cube of box with the same number of
+  bits on each axis. DOFs of the same group get the smallest key of the group.
+ */
+CurveCell::Keys curveKeys(const hmat::ClusterData& data, const hmat::AxisAlignedBoundingBox& box, bool hilbert)
+{
+  const hmat::DofCoordinates& coords = *data.coordinates();
+  const int dimension = coords.dimension();
+  HMAT_ASSERT_MSG(dimension <= 64, "Space-filling curves support up to 64 dimensions");
+  const int bits = std::min(32, 64 / dimension);
+  double extent = 0;
+  for (int i = 0; i < dimension; i++)
+    extent = std::max(extent, box.extends(i));
+  const double maxCoord = std::ldexp(1., bits) - 1;
+  const double scale = extent > 0 ? std::ldexp(1., bits) / extent : 0;
+  const int* indices = data.indices() + data.offset();
+  const int n = data.size();
+  std::vector<uint64_t> * keys = new std::vector<uint64_t>(coords.numberOfDof());
+  uint64_t * k = &(*keys)[0];
+  auto computeKeys = [&](int begin, int end) {
+    uint32_t x[64];
+    for (int j = begin; j < end; j++) {
+      const int dof = indices[j];
+      for (int i = 0; i < dimension; i++)
+        x[i] = (uint32_t) std::min(maxCoord, std::max(0., (coords.spanCenter(dof, i) - box.bbMin()[i]) * scale));
+      if (hilbert)
+        axesToTranspose(x, bits, dimension);
+      k[dof] = interleaveBits(x, bits, dimension);
+    }
+  };
+  const int nChunks = std::min(hmat::TaskPool::instance().size(), n / parallelSortChunk);
+  if (nChunks < 2) {
+    computeKeys(0, n);
+  } else {
+    hmat::TaskGraph g;
+    for (int c = 0; c < nChunks; c++) {
+      const int begin = (int)(((long)n * c) / nChunks);
+      const int end = (int)(((long)n * (c + 1)) / nChunks);
+      g.submit([&computeKeys, begin, end]{ computeKeys(begin, end); });
+    }
+    g.wait();
+  }
+  const int* group_index = data.group_index();
+  if (group_index != NULL) {
+    std::map<int, uint64_t> groupKeys;
+    for (int j = 0; j < n; j++) {
+      const int dof = indices[j];
+      std::pair<std::map<int, uint64_t>::iterator, bool> it =
+        groupKeys.insert(std::make_pair(group_index[dof], k[dof]));
+      if (!it.second)
+        it.first->second = std::min(it.first->second, k[dof]);
+    }
+    for (int j = 0; j < n; j++)
+      k[indices[j]] = groupKeys[group_index[indices[j]]];
+  }
+  return CurveCell::Keys(keys);
+}
+
+/*! \brief Return where the range [begin, end) of indices, sorted by key, is cut.
+
+  This is where the highest bit which differs between the first and last keys
+  changes. A range with a single key is cut in the middle, moved to a group
+  boundary when there is one.
+ */
+int curveCut(const int * indices, int begin, int end, const uint64_t * keys, const int * group_index)
+{
+  const uint64_t first = keys[indices[begin]];
+  const uint64_t last = keys[indices[end - 1]];
+  if (first != last) {
+    int bit = 63;
+    while (((first ^ last) >> bit) == 0)
+      bit--;
+    const uint64_t boundary = (last >> bit) << bit;
+    const int * cut = std::lower_bound(indices + begin, indices + end, boundary,
+      [keys](int dof, uint64_t key) { return keys[dof] < key; });
+    return (int)(cut - indices);
+  }
+  int middle = begin + (end - begin) / 2;
+  if (group_index != NULL) {
+    const int group = group_index[indices[middle]];
+    int lower = middle;
+    int upper = middle;
+    while (lower > begin && group_index[indices[lower - 1]] == group)
+      --lower;
+    while (upper < end && group_index[indices[upper]] == group)
+      ++upper;
+    if (lower > begin && (upper == end || middle - lower <= upper - middle))
+      middle = lower;
+    else if (upper < end)
+      middle = upper;
+    // else all degrees of freedom belong to the same group, this is fine
+  }
+  return middle;
+}
+
 }
 
 namespace hmat {
@@ -79,7 +290,7 @@ AxisAlignClusteringAlgorithm::sortByDimension(ClusterTree& node, int dim)
 const
 {
   int* myIndices = node.data.indices() + node.data.offset();
-  std::stable_sort(myIndices, myIndices + node.data.size(), IndicesComparator(dim, node.data));
+  parallelStableSort(myIndices, node.data.size(), IndicesComparator(dim, node.data));
 }
 
 AxisAlignedBoundingBox*
@@ -421,7 +632,11 @@ ClusterTreeBuilder::build(const DofCoordinates& coordinates, int* group_index) c
   DofData* dofData = new DofData(coordinates, group_index);
   ClusterTree* rootNode = new ClusterTree(dofData);
 
-  divide_recursive(*rootNode, -1);
+  // Subtrees are built in parallel unless an algorithm must see the nodes in order
+  bool parallel = TaskPool::instance().size() > 1;
+  for (std::list<std::pair<int, ClusteringAlgorithm*> >::const_iterator it = algo_.begin(); it != algo_.end(); ++it)
+    parallel = parallel && it->second->concurrentPartitions();
+  divide_recursive(*rootNode, -1, parallel);
   clean_recursive(*rootNode);
   // Update reverse mapping
   int* indices_i2e = rootNode->data.indices();
@@ -478,7 +693,7 @@ ClusterTreeBuilder::addAlgorithm(int depth, const ClusteringAlgorithm& algo)
 }
 
 void
-ClusterTreeBuilder::divide_recursive(ClusterTree& current, int currentAxis) const
+ClusterTreeBuilder::divide_recursive(ClusterTree& current, int currentAxis, bool parallel) const
 {
   ClusteringAlgorithm* algo = getAlgorithm(current.depth);
   if (current.data.size() <= algo->getMaxLeafSize())
@@ -488,10 +703,60 @@ ClusterTreeBuilder::divide_recursive(ClusterTree& current, int currentAxis) cons
   std::vector<ClusterTree*> children;
   int childrenAxis = algo->partition(current, children, currentAxis);
   for (size_t i = 0; i < children.size(); ++i)
-  {
     current.insertChild(i, children[i]);
-    divide_recursive(*children[i], childrenAxis);
+  if (parallel && children.size() > 1 && current.data.size() >= parallelSubtreeSize)
+  {
+    // Children own disjoint ranges of the indices array
+    TaskGraph g;
+    for (size_t i = 1; i < children.size(); ++i)
+    {
+      ClusterTree* child = children[i];
+      g.submit([this, child, childrenAxis]{ divide_recursive(*child, childrenAxis, true); });
+    }
+    divide_recursive(*children[0], childrenAxis, true);
+    g.wait();
+  }
+  else
+  {
+    for (size_t i = 0; i < children.size(); ++i)
+      divide_recursive(*children[i], childrenAxis, parallel);
+  }
+}
+
+int
+SpaceFillingCurveAlgorithm::partition(ClusterTree& current, std::vector<ClusterTree*>& children,
+                                      int) const
+{
+  const int* indices = current.data.indices();
+  const int* group_index = current.data.group_index();
+  // Nodes which were not created by a curve algorithm are sorted once
+  AxisAlignedBoundingBox* bbox = getAxisAlignedBoundingbox(current);
+  CurveCell* cell = dynamic_cast<CurveCell*>(bbox);
+  CurveCell::Keys keys = cell ? cell->keys : curveKeys(current.data, *bbox, curve_ == HILBERT);
+  if (cell == NULL)
+    parallelStableSort(current.data.indices() + current.data.offset(), current.data.size(),
+                       CurveKeyComparator(&(*keys)[0], group_index));
+
+  // Cut the largest range until there are divider_ of them
+  std::vector<std::pair<int, int> > ranges(1, std::make_pair(current.data.offset(),
+                                                             current.data.offset() + current.data.size()));
+  while ((int)ranges.size() < divider_) {
+    size_t largest = 0;
+    for (size_t i = 1; i < ranges.size(); ++i)
+      if (ranges[i].second - ranges[i].first > ranges[largest].second - ranges[largest].first)
+        largest = i;
+    if (ranges[largest].second - ranges[largest].first < 2)
+      break;
+    const int cut = curveCut(indices, ranges[largest].first, ranges[largest].second, &(*keys)[0], group_index);
+    ranges.insert(ranges.begin() + largest + 1, std::make_pair(cut, ranges[largest].second));
+    ranges[largest].second = cut;
+  }
+  for (size_t i = 0; i < ranges.size(); ++i) {
+    ClusterTree* child = current.slice(ranges[i].first, ranges[i].second - ranges[i].first);
+    child->cache_ = new CurveCell(child->data, keys);
+    children.push_back(child);
   }
+  return -1; // the cuts are not along a single axis
 }
 
 SpanClusteringAlgorithm::SpanClusteringAlgorithm(
@@ -519,7 +784,7 @@ int SpanClusteringAlgorithm::partition(
     double threshold = aabb->extends(greatestDim) * ratio_;
     // move large span at the end of the indices array
     LargeSpanComparator comparator(coords, threshold, greatestDim);
-    std::stable_sort(indices, indices + n, comparator);
+    parallelStableSort(indices, n, comparator);
     // create the large span cluster
     int i = n - 1;
     while(i >= 0 && coords.spanDiameter(indices[i], greatestDim) > threshold)
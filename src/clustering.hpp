@@ -56,7 +56,7 @@ public:
   ClusterTree* build(const DofCoordinates& coordinates, int* group_index = NULL) const;
 
 private:
-  void divide_recursive(ClusterTree& current, int axis) const;
+  void divide_recursive(ClusterTree& current, int axis, bool parallel) const;
   void clean_recursive(ClusterTree& current) const;
   ClusteringAlgorithm* getAlgorithm(int depth) const;
 
@@ -91,6 +91,10 @@ public:
   /*! \brief Called by ClusterTreeBuilder::clean_recursive to free data which may be allocated by partition  */
   virtual void clean(ClusterTree&) const {}
 
+  /*! \brief Return false if partition depends on the order of the previous calls, so
+      ClusterTreeBuilder must split nodes one at a time */
+  virtual bool concurrentPartitions() const { return true; }
+
   int getMaxLeafSize() const;
   virtual void setMaxLeafSize(int maxLeafSize);
 
@@ -203,6 +207,7 @@ public:
     std::string str() const;
     ClusteringAlgorithm* clone() const;
     int partition(ClusterTree& current, std::vector<ClusterTree*>& children, int currentAxis) const;
+    bool concurrentPartitions() const { return algo_.concurrentPartitions(); }
 };
 
 class VoidClusteringAlgorithm : public ClusteringAlgorithm
@@ -217,6 +222,7 @@ public:
 
   int partition(ClusterTree& current, std::vector<ClusterTree*>& children, int currentAxis) const;
   void clean(ClusterTree& current) const;
+  bool concurrentPartitions() const { return algo_->concurrentPartitions(); }
 
 private:
   const ClusteringAlgorithm *algo_;
@@ -236,6 +242,8 @@ public:
   void clean(ClusterTree& current) const;
   void setMaxLeafSize(int maxLeafSize) { algo_->setMaxLeafSize(maxLeafSize); }
   void setDivider(int divider) const { algo_->setDivider(divider); }
+  /* The divider changes after each partition */
+  bool concurrentPartitions() const { return false; }
 
 private:
   ClusteringAlgorithm *algo_;
@@ -243,6 +251,31 @@ private:
   const int toDivider_;
 };
 
+/*! \brief Creating tree by cutting a space-filling curve.
+
+  A key is computed once for each DOF, by quantizing its center in the
+  bounding cube of the node which is split first, and the DOFs are sorted
+  by key. Each node is then split where the highest bit which differs
+  between its first and last keys changes, so a child holds the DOFs of one
+  cell of the curve. The keys are passed to the children through the node
+  cache, so nodes are cut by a binary search without being sorted again.
+  DOFs of the same group share the smallest key of the group.
+ */
+class SpaceFillingCurveAlgorithm : public AxisAlignClusteringAlgorithm
+{
+public:
+  enum Curve { MORTON, HILBERT };
+  explicit SpaceFillingCurveAlgorithm(Curve curve) : curve_(curve) {}
+
+  ClusteringAlgorithm* clone() const { return new SpaceFillingCurveAlgorithm(*this); }
+  std::string str() const { return curve_ == MORTON ? "MortonCurveAlgorithm" : "HilbertCurveAlgorithm"; }
+
+  int partition(ClusterTree& current, std::vector<ClusterTree*>& children, int currentAxis) const;
+
+private:
+  const Curve curve_;
+};
+
 class NTilesRecursiveAlgorithm : public AxisAlignClusteringAlgorithm
 {
 public:
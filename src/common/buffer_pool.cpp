@@ -0,0 +1,303 @@
+/*
+  HMat-OSS (HMatrix library, open source software)
+
+  Copyright (C) 2014-2015 Airbus Group SAS
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+  http://github.com/jeromerobert/hmat-oss
+*/
+
+#include "config.h"
+#include "common/buffer_pool.hpp"
+#include "common/my_assert.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#ifdef HAVE_JEMALLOC
+#define JEMALLOC_NO_DEMANGLE
+#include <jemalloc/jemalloc.h>
+#endif
+
+namespace {
+using namespace hmat;
+
+struct EnvVar {
+  /// Capacity of the shared cache in bytes
+  size_t poolSize;
+  EnvVar() {
+    const char * s = getenv("HMAT_POOL_SIZE");
+    poolSize = s == nullptr ? ((size_t)16 << 20) : strtoull(s, nullptr, 10);
+  }
+};
+static const EnvVar env;
+
+/// Smallest size class
+const size_t MIN_CLASS = 256;
+/// Number of size classes, the largest one being 64KB. The larger buffers,
+/// which are mostly leaf data, are allocated with their exact size.
+const int NB_CLASSES = 33;
+/// A buffer which is not pooled is shrunk when resizing it would waste more than 1/MAX_WASTE of it
+const size_t MAX_WASTE = 8;
+
+/// Stored in front of each buffer. Its size keeps the alignment of malloc.
+struct alignas(16) Header {
+  size_t capacity;
+  /// -1 for buffers which are not pooled
+  int sizeClass;
+};
+
+std::atomic<size_t> allocations(0);
+std::atomic<size_t> hits(0);
+std::atomic<size_t> cachedBytes(0);
+
+/**
+ * Return the size class of a request of n bytes, or -1 if it is too
+ * large to be pooled. The classes are 256, 320, 384, 448, 512, 640...
+ */
+int sizeClass(size_t n, size_t & capacity) {
+  if (n <= MIN_CLASS) {
+    capacity = MIN_CLASS;
+    return 0;
+  }
+  // b = floor(log2(n - 1))
+  int b = 0;
+  for (size_t v = (n - 1) >> 1; v != 0; v >>= 1)
+    b++;
+  const size_t step = (size_t)1 << (b - 2);
+  const size_t q = (n - 1) / step + 1;
+  const int k = (b - 8) * 4 + (int)q - 4;
+  if (k >= NB_CLASSES)
+    return -1;
+  capacity = q * step;
+  return k;
+}
+
+void * systemAlloc(size_t size, bool zeroinit) {
+#ifdef HAVE_JEMALLOC
+  return zeroinit ? je_calloc(size, 1) : je_malloc(size);
+#else
+  return zeroinit ? calloc(size, 1) : malloc(size);
+#endif
+}
+
+void * systemRealloc(void * p, size_t size) {
+#ifdef HAVE_JEMALLOC
+  return je_realloc(p, size);
+#else
+  return realloc(p, size);
+#endif
+}
+
+void systemFree(void * p) {
+#ifdef HAVE_JEMALLOC
+  je_free(p);
+#else
+  free(p);
+#endif
+}
+
+struct Cache {
+  std::vector<Header*> buffers[NB_CLASSES];
+  size_t bytes;
+  Cache(): bytes(0) {}
+
+  Header * pop(int k) {
+    if (buffers[k].empty())
+      return nullptr;
+    Header * h = buffers[k].back();
+    buffers[k].pop_back();
+    bytes -= h->capacity;
+    cachedBytes -= h->capacity;
+    return h;
+  }
+
+  bool push(Header * h, size_t limit) {
+    if (bytes + h->capacity > limit)
+      return false;
+    buffers[h->sizeClass].push_back(h);
+    bytes += h->capacity;
+    cachedBytes += h->capacity;
+    return true;
+  }
+
+  void clear() {
+    for (int k = 0; k < NB_CLASSES; k++) {
+      for (size_t i = 0; i < buffers[k].size(); i++)
+        systemFree(buffers[k][i]);
+      buffers[k].clear();
+    }
+    cachedBytes -= bytes;
+    bytes = 0;
+  }
+};
+
+/// Set when the shared cache is destroyed at exit, constant initialized
+bool sharedDestroyed = false;
+
+struct SharedCache {
+  std::mutex mutex;
+  Cache cache;
+  ~SharedCache() {
+    std::lock_guard<std::mutex> lock(mutex);
+    cache.clear();
+    sharedDestroyed = true;
+  }
+};
+
+SharedCache & shared() {
+  static SharedCache instance;
+  return instance;
+}
+
+/// Release a buffer to the shared cache or to the system
+void releaseShared(Header * h) {
+  if (!sharedDestroyed) {
+    SharedCache & s = shared();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    if (!sharedDestroyed && s.cache.push(h, env.poolSize))
+      return;
+  }
+  systemFree(h);
+}
+
+/// Set when the cache of the calling thread is destroyed, constant initialized
+thread_local bool threadCacheDestroyed = false;
+
+struct ThreadCache {
+  Cache cache;
+  ~ThreadCache() {
+    // Give the buffers to the other threads
+    for (int k = 0; k < NB_CLASSES; k++) {
+      for (size_t i = 0; i < cache.buffers[k].size(); i++) {
+        cachedBytes -= cache.buffers[k][i]->capacity;
+        releaseShared(cache.buffers[k][i]);
+      }
+      cache.buffers[k].clear();
+    }
+    cache.bytes = 0;
+    threadCacheDestroyed = true;
+  }
+};
+
+/// Return the cache of the calling thread, or NULL if it was already destroyed
+Cache * threadCache() {
+  if (threadCacheDestroyed)
+    return nullptr;
+  thread_local ThreadCache instance;
+  return &instance.cache;
+}
+
+}  // end anonymous namespace
+
+namespace hmat {
+
+void * BufferPool::allocate(size_t size, bool zeroinit) {
+  if (size == 0)
+    return nullptr;
+  allocations++;
+  size_t capacity = size;
+  const int k = env.poolSize > 0 ? sizeClass(size, capacity) : -1;
+  if (k >= 0) {
+    Cache * tc = threadCache();
+    Header * h = tc == nullptr ? nullptr : tc->pop(k);
+    if (h == nullptr && !sharedDestroyed) {
+      SharedCache & s = shared();
+      std::lock_guard<std::mutex> lock(s.mutex);
+      h = s.cache.pop(k);
+    }
+    if (h != nullptr) {
+      hits++;
+      if (zeroinit)
+        memset(h + 1, 0, size);
+      return h + 1;
+    }
+  }
+  Header * h = static_cast<Header*>(systemAlloc(sizeof(Header) + capacity, zeroinit));
+  if (h == nullptr)
+    return nullptr;
+  h->capacity = capacity;
+  h->sizeClass = k;
+  return h + 1;
+}
+
+void BufferPool::release(void * p) {
+  if (p == nullptr)
+    return;
+  Header * h = static_cast<Header*>(p) - 1;
+  if (h->sizeClass < 0) {
+    systemFree(h);
+    return;
+  }
+  Cache * tc = threadCache();
+  if (tc != nullptr && tc->push(h, env.poolSize / 16))
+    return;
+  releaseShared(h);
+}
+
+void * BufferPool::reallocate(void * p, size_t size) {
+  if (p == nullptr)
+    return allocate(size, false);
+  if (size == 0) {
+    release(p);
+    return nullptr;
+  }
+  Header * h = static_cast<Header*>(p) - 1;
+  size_t capacity = size;
+  const int k = env.poolSize > 0 ? sizeClass(size, capacity) : -1;
+  // Keep the buffer if it has the size class of the new size, or if it is
+  // not pooled and does not waste more than 1/MAX_WASTE of its capacity
+  if (k >= 0 ? k == h->sizeClass : (h->sizeClass < 0 && size <= h->capacity &&
+                                    h->capacity - size <= h->capacity / MAX_WASTE))
+    return p;
+  if (k < 0 && h->sizeClass < 0) {
+    Header * r = static_cast<Header*>(systemRealloc(h, sizeof(Header) + size));
+    if (r == nullptr)
+      return nullptr;
+    r->capacity = size;
+    return r + 1;
+  }
+  void * r = allocate(size, false);
+  if (r != nullptr) {
+    memcpy(r, p, size < h->capacity ? size : h->capacity);
+    release(p);
+  }
+  return r;
+}
+
+BufferPool::Stats BufferPool::stats() {
+  Stats s;
+  s.allocations = allocations;
+  s.hits = hits;
+  s.cachedBytes = cachedBytes;
+  return s;
+}
+
+void BufferPool::trim() {
+  Cache * tc = threadCache();
+  if (tc != nullptr)
+    tc->clear();
+  if (!sharedDestroyed) {
+    SharedCache & s = shared();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.cache.clear();
+  }
+}
+
+}  // end namespace hmat
@@ -0,0 +1,68 @@
+/*
+  HMat-OSS (HMatrix library, open source software)
+
+  Copyright (C) 2014-2015 Airbus Group SAS
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+  http://github.com/jeromerobert/hmat-oss
+*/
+
+/*! \file
+  \ingroup HMatrix
+  \brief Pooled allocation of ScalarArray buffers.
+*/
+#pragma once
+#include <stddef.h>
+
+namespace hmat {
+
+/*! \brief Size-class pool for the buffers of \a ScalarArray.
+
+  Requests up to 64KB are rounded up to a size class (4 classes per power
+  of 2). Freed buffers are kept in a cache owned by the calling thread and
+  reused by the next allocations of the same class, so temporaries created
+  and destroyed in a loop (such as the panels of Rk recompressions) do not
+  go through malloc. When the thread cache is full, buffers go to a cache
+  shared by all threads, and are returned to the system when it is full too.
+  Larger requests are not pooled and get their exact size, reallocate
+  shrinks them when they would waste more than 1/8 of their capacity.
+
+  The capacity of the shared cache is read from the HMAT_POOL_SIZE
+  environment variable in bytes (16MB by default, 0 disables the pool).
+  Each thread caches up to 1/16 of it.
+ */
+class BufferPool {
+public:
+  struct Stats {
+    /// Number of calls to allocate
+    size_t allocations;
+    /// Number of allocations served from a cache
+    size_t hits;
+    /// Bytes currently kept in the caches of all threads
+    size_t cachedBytes;
+  };
+  /** Allocate at least size bytes, aligned as with malloc */
+  static void * allocate(size_t size, bool zeroinit);
+  /** Release a buffer returned by allocate or reallocate, NULL is ignored */
+  static void release(void * p);
+  /** Change the size of a buffer, keeping its content as realloc */
+  static void * reallocate(void * p, size_t size);
+  static Stats stats();
+  /** Return the buffers cached by the calling thread and the shared cache to the system */
+  static void trim();
+};
+
+}  // end namespace hmat
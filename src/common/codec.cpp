@@ -0,0 +1,276 @@
+/*
+  HMat-OSS (HMatrix library, open source software)
+
+  Copyright (C) 2014-2015 Airbus Group SAS
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+  http://github.com/jeromerobert/hmat-oss
+*/
+
+#include "common/codec.hpp"
+
+#include <cstring>
+#include <vector>
+
+namespace {
+
+const size_t MIN_MATCH = 4;
+/// The last bytes are always literals, as in LZ4
+const size_t LAST_LITERALS = 5;
+/// No match starts in the last bytes, as in LZ4
+const size_t MATCH_START_LIMIT = 12;
+const size_t MAX_OFFSET = 65535;
+const int HASH_LOG = 16;
+
+inline uint32_t read32(const unsigned char * p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline uint64_t read64(const unsigned char * p) {
+  uint64_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline uint32_t hash4(uint32_t v) {
+  return (v * 2654435761U) >> (32 - HASH_LOG);
+}
+
+/** Write the bytes following a 15 nibble in a token */
+unsigned char * writeLength(unsigned char * op, size_t length) {
+  length -= 15;
+  while (length >= 255) {
+    *op++ = 255;
+    length -= 255;
+  }
+  *op++ = (unsigned char)length;
+  return op;
+}
+
+bool readLength(const unsigned char *& ip, const unsigned char * end, size_t & length) {
+  unsigned char b;
+  do {
+    if (ip >= end)
+      return false;
+    b = *ip++;
+    length += b;
+  } while (b == 255);
+  return true;
+}
+
+unsigned char * writeSequence(unsigned char * op, const unsigned char * literals,
+                              size_t literalLength, size_t offset, size_t matchLength) {
+  unsigned char * token = op++;
+  *token = (unsigned char)((literalLength >= 15 ? 15 : literalLength) << 4);
+  if (literalLength >= 15)
+    op = writeLength(op, literalLength);
+  memcpy(op, literals, literalLength);
+  op += literalLength;
+  if (matchLength == 0)
+    return op;
+  *op++ = (unsigned char)(offset & 0xff);
+  *op++ = (unsigned char)(offset >> 8);
+  matchLength -= MIN_MATCH;
+  *token |= (unsigned char)(matchLength >= 15 ? 15 : matchLength);
+  if (matchLength >= 15)
+    op = writeLength(op, matchLength);
+  return op;
+}
+
+/** Greedy LZ77 with a single entry hash table, output in the LZ4 block format */
+size_t lzCompress(const unsigned char * src, size_t n, unsigned char * dst) {
+  unsigned char * op = dst;
+  size_t anchor = 0;
+  if (n > MATCH_START_LIMIT) {
+    std::vector<size_t> table(1 << HASH_LOG, 0);
+    const size_t limit = n - MATCH_START_LIMIT;
+    const size_t matchLimit = n - LAST_LITERALS;
+    size_t ip = 0;
+    // Move faster in incompressible data
+    size_t misses = 1 << 6;
+    while (ip < limit) {
+      const uint32_t seq = read32(src + ip);
+      const uint32_t h = hash4(seq);
+      const size_t ref = table[h];
+      table[h] = ip;
+      if (ref < ip && ip - ref <= MAX_OFFSET && read32(src + ref) == seq) {
+        size_t length = MIN_MATCH;
+        while (ip + length + 8 <= matchLimit && read64(src + ip + length) == read64(src + ref + length))
+          length += 8;
+        while (ip + length < matchLimit && src[ip + length] == src[ref + length])
+          length++;
+        op = writeSequence(op, src + anchor, ip - anchor, ip - ref, length);
+        ip += length;
+        anchor = ip;
+        misses = 1 << 6;
+      } else {
+        ip += misses++ >> 6;
+      }
+    }
+  }
+  op = writeSequence(op, src + anchor, n - anchor, 0, 0);
+  return op - dst;
+}
+
+bool lzUncompress(const unsigned char * src, size_t n, unsigned char * dst, size_t dstSize) {
+  const unsigned char * ip = src;
+  const unsigned char * const end = src + n;
+  unsigned char * op = dst;
+  unsigned char * const oend = dst + dstSize;
+  while (ip < end) {
+    const unsigned token = *ip++;
+    size_t literalLength = token >> 4;
+    if (literalLength == 15 && !readLength(ip, end, literalLength))
+      return false;
+    if (literalLength > (size_t)(end - ip) || literalLength > (size_t)(oend - op))
+      return false;
+    memcpy(op, ip, literalLength);
+    op += literalLength;
+    ip += literalLength;
+    // The last sequence has no match
+    if (ip == end)
+      break;
+    if (end - ip < 2)
+      return false;
+    const size_t offset = ip[0] | ((size_t)ip[1] << 8);
+    ip += 2;
+    if (offset == 0 || offset > (size_t)(op - dst))
+      return false;
+    size_t matchLength = token & 15;
+    if (matchLength == 15 && !readLength(ip, end, matchLength))
+      return false;
+    matchLength += MIN_MATCH;
+    if (matchLength > (size_t)(oend - op))
+      return false;
+    const unsigned char * ref = op - offset;
+    if (offset >= matchLength) {
+      memcpy(op, ref, matchLength);
+    } else {
+      // Overlapping copy, the match repeats a pattern
+      for (size_t i = 0; i < matchLength; i++)
+        op[i] = ref[i];
+    }
+    op += matchLength;
+  }
+  return op == oend;
+}
+
+/** Group the bytes of the words by position, trailing bytes are kept as is */
+void shuffle(const char * src, size_t n, char * dst, int wordSize) {
+  const size_t words = n / wordSize;
+  for (size_t i = 0; i < words; i++)
+    for (int b = 0; b < wordSize; b++)
+      dst[b * words + i] = src[i * wordSize + b];
+  memcpy(dst + words * wordSize, src + words * wordSize, n - words * wordSize);
+}
+
+void unshuffle(const char * src, size_t n, char * dst, int wordSize) {
+  const size_t words = n / wordSize;
+  for (size_t i = 0; i < words; i++)
+    for (int b = 0; b < wordSize; b++)
+      dst[i * wordSize + b] = src[b * words + i];
+  memcpy(dst + words * wordSize, src + words * wordSize, n - words * wordSize);
+}
+
+const uint64_t PRIME1 = 11400714785074694791ULL;
+const uint64_t PRIME2 = 14029467366897019727ULL;
+const uint64_t PRIME3 = 1609587929392839161ULL;
+const uint64_t PRIME4 = 9650029242287828579ULL;
+const uint64_t PRIME5 = 2870177450012600261ULL;
+
+inline uint64_t rotl(uint64_t x, int r) {
+  return (x << r) | (x >> (64 - r));
+}
+
+inline uint64_t xxhRound(uint64_t acc, uint64_t input) {
+  acc += input * PRIME2;
+  return rotl(acc, 31) * PRIME1;
+}
+
+inline uint64_t xxhMerge(uint64_t acc, uint64_t v) {
+  acc ^= xxhRound(0, v);
+  return acc * PRIME1 + PRIME4;
+}
+
+}  // end anonymous namespace
+
+namespace hmat {
+
+size_t compressBound(size_t n) {
+  return n + n / 255 + 16;
+}
+
+size_t compressBlock(const char * src, size_t n, char * dst, int wordSize) {
+  std::vector<char> shuffled(n);
+  shuffle(src, n, shuffled.data(), wordSize);
+  size_t r = lzCompress(reinterpret_cast<const unsigned char *>(shuffled.data()), n,
+                        reinterpret_cast<unsigned char *>(dst));
+  return r < n ? r : 0;
+}
+
+bool uncompressBlock(const char * src, size_t n, char * dst, size_t dstSize, int wordSize) {
+  std::vector<char> shuffled(dstSize);
+  if (!lzUncompress(reinterpret_cast<const unsigned char *>(src), n,
+                    reinterpret_cast<unsigned char *>(shuffled.data()), dstSize))
+    return false;
+  unshuffle(shuffled.data(), dstSize, dst, wordSize);
+  return true;
+}
+
+uint64_t checksum64(const void * data, size_t n, uint64_t seed) {
+  const unsigned char * p = static_cast<const unsigned char *>(data);
+  const unsigned char * const end = p + n;
+  uint64_t h;
+  if (n >= 32) {
+    uint64_t v1 = seed + PRIME1 + PRIME2;
+    uint64_t v2 = seed + PRIME2;
+    uint64_t v3 = seed;
+    uint64_t v4 = seed - PRIME1;
+    do {
+      v1 = xxhRound(v1, read64(p));
+      v2 = xxhRound(v2, read64(p + 8));
+      v3 = xxhRound(v3, read64(p + 16));
+      v4 = xxhRound(v4, read64(p + 24));
+      p += 32;
+    } while (end - p >= 32);
+    h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+    h = xxhMerge(h, v1);
+    h = xxhMerge(h, v2);
+    h = xxhMerge(h, v3);
+    h = xxhMerge(h, v4);
+  } else {
+    h = seed + PRIME5;
+  }
+  h += n;
+  for (; end - p >= 8; p += 8)
+    h = rotl(h ^ xxhRound(0, read64(p)), 27) * PRIME1 + PRIME4;
+  if (end - p >= 4) {
+    h = rotl(h ^ (read32(p) * PRIME1), 23) * PRIME2 + PRIME3;
+    p += 4;
+  }
+  for (; p < end; p++)
+    h = rotl(h ^ (*p * PRIME5), 11) * PRIME1;
+  h ^= h >> 33;
+  h *= PRIME2;
+  h ^= h >> 29;
+  h *= PRIME3;
+  h ^= h >> 32;
+  return h;
+}
+
+}  // end namespace hmat
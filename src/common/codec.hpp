@@ -0,0 +1,58 @@
+/*
+  HMat-OSS (HMatrix library, open source software)
+
+  Copyright (C) 2014-2015 Airbus Group SAS
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+  http://github.com/jeromerobert/hmat-oss
+*/
+
+/*! \file
+  \ingroup HMatrix
+  \brief Lossless compression and checksums of serialized data.
+*/
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+namespace hmat {
+
+/** Size of the buffer needed by compressBlock for n input bytes */
+size_t compressBound(size_t n);
+
+/*! \brief Compress a buffer of scalars.
+
+  The bytes are first grouped by their position in the words of wordSize
+  bytes, so that the exponents of floating point values are contiguous, then
+  compressed with an LZ77 coder using the LZ4 block format.
+
+  \param dst a buffer of compressBound(n) bytes
+  \return the compressed size, 0 if it is not smaller than n
+ */
+size_t compressBlock(const char * src, size_t n, char * dst, int wordSize);
+
+/*! \brief Uncompress a buffer written by compressBlock.
+
+  \param n the size of the compressed data
+  \param dst a buffer of dstSize bytes, the uncompressed size
+  \return false if the data is corrupted
+ */
+bool uncompressBlock(const char * src, size_t n, char * dst, size_t dstSize, int wordSize);
+
+/** 64 bits XXH64 hash of a buffer */
+uint64_t checksum64(const void * data, size_t n, uint64_t seed = 0);
+
+}  // end namespace hmat
@@ -31,6 +31,7 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <algorithm>
 
 namespace trace {
 
@@ -52,6 +53,10 @@ namespace trace {
     nodeIndexFunction = nodeIndexFunc;
   }
 
+  int (*getNodeIndexFunction())() {
+    return nodeIndexFunction;
+  }
+
   bool Node::enabled = true;
   UM_NS::unordered_map<void*, Node*> Node::currentNodes[MAX_ROOTS];
   void* Node::enclosingContext[MAX_ROOTS] = {};
@@ -171,6 +176,58 @@ namespace trace {
     f << std::endl << "]" << std::endl;
   }
 
+  std::atomic<bool> Counters::enabled(true);
+  Counters::Data Counters::data_[MAX_ROOTS][MAX_COUNTERS];
+  int64_t Counters::flops_[MAX_ROOTS];
+  const char* Counters::names_[MAX_COUNTERS];
+  std::atomic<int> Counters::sites_(0);
+  std::atomic<int> Counters::droppedSites_(0);
+
+  int Counters::registerSite(const char* name) {
+    int site = sites_.fetch_add(1);
+    if (site >= MAX_COUNTERS) {
+      sites_ = MAX_COUNTERS;
+      if (droppedSites_.fetch_add(1) == 0)
+        fprintf(stderr, "[hmat] More than %d call sites, %s and the next ones have no counters. "
+                "Increase MAX_COUNTERS.\n", MAX_COUNTERS, name);
+      return -1;
+    }
+    names_[site] = name;
+    return site;
+  }
+
+  int Counters::sites() {
+    return std::min(sites_.load(), MAX_COUNTERS);
+  }
+
+  int Counters::droppedSites() {
+    return droppedSites_;
+  }
+
+  const char* Counters::name(int site) {
+    return names_[site];
+  }
+
+  Counters::Data Counters::total(int site) {
+    Data result = Data();
+    for (int i = 0; i < MAX_ROOTS; i++) {
+      result.calls += data_[i][site].calls;
+      result.time += data_[i][site].time;
+      result.flops += data_[i][site].flops;
+    }
+    return result;
+  }
+
+  void Counters::reset() {
+    for (int i = 0; i < MAX_ROOTS; i++) {
+      for (int site = 0; site < MAX_COUNTERS; site++) {
+        data_[i][site].calls = 0;
+        data_[i][site].time = 0;
+        data_[i][site].flops = 0;
+      }
+    }
+  }
+
   /** Find the current node, allocating one if necessary.
    */
   Node* Node::currentNode() {
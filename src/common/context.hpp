@@ -30,6 +30,7 @@
 #include "common/chrono.h"
 #include <vector>
 #include <fstream>
+#include <atomic>
 
 #if (__cplusplus > 201103L) || defined(HAVE_CPP11) || defined(_MSC_VER) || defined(_LIBCPP_VERSION)
   #include <unordered_map>
@@ -77,6 +78,8 @@ namespace trace {
         - between 1 and n_workers (included) in parallel regions
    */
   void setNodeIndexFunction(int (*nodeIndexFunc)());
+  /** Return the function set by setNodeIndexFunction(), NULL by default */
+  int (*getNodeIndexFunction())();
   int currentNodeIndex();
 
   class Node {
@@ -127,6 +130,91 @@ namespace trace {
     void jsonDump(std::ofstream& f) const;
     static Node* currentNode();
   };
+
+  // Maximum number of call sites with counters
+#ifndef MAX_COUNTERS
+  #define MAX_COUNTERS 1024
+#endif
+
+  /*! \brief Flat per-thread counters of the DECLARE_CONTEXT call sites.
+
+    Each call site gets a static slot in a preallocated table the first time
+    it runs, and each worker only writes its own row of the table, so the
+    hot path has neither lock nor lookup: two clock reads and a few
+    increments. This is cheap enough to be left on, unlike the trees of
+    Node which give the call graph with HAVE_CONTEXT.
+
+    Only the first MAX_COUNTERS call sites get a slot, a warning is printed
+    when another one is dropped.
+
+    Time and flops are inclusive: they contain the callees. A recursive
+    function only counts the time of its outermost call. Reading the
+    counters while workers run gives approximate values.
+   */
+  class Counters {
+  public:
+    struct Data {
+      int64_t calls;
+      int64_t time; // ns
+      int64_t flops;
+      /// Number of active calls, to count the time of recursive calls once
+      int depth;
+    };
+    /// Read without ordering by the call sites, so it may be toggled while workers run
+    static std::atomic<bool> enabled;
+    /** Return the slot of a call site, or -1 if the table is full.
+        name must exist until the end of the program. */
+    static int registerSite(const char* name);
+    /** Number of registered call sites */
+    static int sites();
+    /** Number of call sites which were dropped because the table is full */
+    static int droppedSites();
+    static const char* name(int site);
+    /** Sum of the counters of all the workers */
+    static Data total(int site);
+    /** Clear the counters, outside of parallel regions */
+    static void reset();
+    static void incrementFlops(int64_t flops) {
+      if (enabled.load(std::memory_order_relaxed))
+        flops_[currentNodeIndex()] += flops;
+    }
+  private:
+    friend class CounterScope;
+    static Data data_[MAX_ROOTS][MAX_COUNTERS];
+    /// Flops counted by each worker since the beginning
+    static int64_t flops_[MAX_ROOTS];
+    static const char* names_[MAX_COUNTERS];
+    static std::atomic<int> sites_;
+    static std::atomic<int> droppedSites_;
+  };
+
+  /*! \brief Update the Counters of a call site for the life time of the object */
+  class CounterScope {
+    int site_;
+    int index_;
+    int64_t flops_;
+    Time start_;
+  public:
+    explicit CounterScope(int site)
+      : site_(Counters::enabled.load(std::memory_order_relaxed) ? site : -1), index_(0), flops_(0), start_() {
+      if (site_ < 0)
+        return;
+      index_ = currentNodeIndex();
+      Counters::data_[index_][site_].depth++;
+      flops_ = Counters::flops_[index_];
+      start_ = now();
+    }
+    ~CounterScope() {
+      if (site_ < 0)
+        return;
+      Counters::Data & d = Counters::data_[index_][site_];
+      d.calls++;
+      if (--d.depth == 0) {
+        d.time += time_diff_in_nanos(start_, now());
+        d.flops += Counters::flops_[index_] - flops_;
+      }
+    }
+  };
 }
 
 
@@ -152,13 +240,13 @@ public:
 
 #define enter_context(x) trace::Node::enterContext(x)
 #define leave_context() trace::Node::leaveContext()
-#define increment_flops(x) trace::Node::incrementFlops(x)
+#define increment_flops(x) do { trace::Node::incrementFlops(x); trace::Counters::incrementFlops(x); } while(0)
 #define tracing_dump(x) trace::Node::jsonDumpMain(x)
 
 #else
 #define enter_context(x) do { hmat::ignore_unused_arg(x); } while(0)
 #define leave_context()  do {} while(0)
-#define increment_flops(x) do { hmat::ignore_unused_arg(x); } while(0)
+#define increment_flops(x) trace::Counters::incrementFlops(x)
 #define tracing_dump(x) do { hmat::ignore_unused_arg(x); } while(0)
 #define DISABLE_CONTEXT_IN_BLOCK do {} while (0)
 #endif
@@ -177,10 +265,15 @@ public:
 };
 
 #if defined(__GNUC__)
-#define DECLARE_CONTEXT Context __reserved_ctx(__PRETTY_FUNCTION__)
+#define CONTEXT_NAME __PRETTY_FUNCTION__
 #elif defined(_MSC_VER)
-#define DECLARE_CONTEXT Context __reserved_ctx(__FUNCTION__)
+#define CONTEXT_NAME __FUNCTION__
 #else
-#define DECLARE_CONTEXT Context __reserved_ctx(__func__)
+#define CONTEXT_NAME __func__
 #endif
 
+#define DECLARE_CONTEXT \
+  static const int __reserved_site = trace::Counters::registerSite(CONTEXT_NAME); \
+  trace::CounterScope __reserved_counter(__reserved_site); \
+  Context __reserved_ctx(CONTEXT_NAME)
+
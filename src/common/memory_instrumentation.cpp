@@ -26,6 +26,7 @@
 */
 #include "memory_instrumentation.hpp"
 #include "common/my_assert.h"
+#include "common/buffer_pool.hpp"
 #include <algorithm>
 
 #if defined(HAVE_JEMALLOC) && defined(__linux__)
@@ -73,6 +74,16 @@ static size_t get_res_mem(void *)
 }
 #endif
 
+static size_t get_pool_cached(void *)
+{
+    return BufferPool::stats().cachedBytes;
+}
+
+static size_t get_pool_hits(void *)
+{
+    return BufferPool::stats().hits;
+}
+
 MemoryInstrumenter::MemoryInstrumenter(): enabled_(false) {
     char * ws = getenv("HMAT_MEMINSTR_WS");
     write_sampling = ws ? atoi(ws) : 1;
@@ -110,6 +121,8 @@ MemoryInstrumenter::MemoryInstrumenter(): enabled_(false) {
     // addType("Total free space (fordblks)", false);
     addType("Top-most, releasable (keepcost)", false);
 #endif
+    addType("Buffer pool cache", false, get_pool_cached, NULL);
+    addType("Buffer pool hits", false, get_pool_hits, NULL);
 }
 
 void MemoryInstrumenter::setFile(const std::string & filename) {
@@ -251,4 +264,62 @@ void MemoryInstrumenter::disable() {
 size_t MemoryInstrumenter::nanoTime() {
     return time_diff_in_nanos(start_, now());
 }
+
+std::atomic<int64_t> MemoryCounters::current_[MemoryCounters::CATEGORIES];
+std::atomic<int64_t> MemoryCounters::peak_[MemoryCounters::CATEGORIES];
+std::atomic<int64_t> MemoryCounters::phasePeak_[MemoryCounters::CATEGORIES];
+std::mutex MemoryCounters::phaseMutex_;
+std::string MemoryCounters::currentPhase_;
+std::vector<std::pair<std::string, MemoryCounters::Stats> > MemoryCounters::phases_;
+
+void MemoryCounters::stats(Stats & s) {
+    for (int c = 0; c < CATEGORIES; c++) {
+        s.current[c] = current_[c].load();
+        s.peak[c] = peak_[c].load();
+    }
+}
+
+void MemoryCounters::resetPeaks() {
+    for (int c = 0; c < CATEGORIES; c++)
+        peak_[c] = current_[c].load();
+}
+
+void MemoryCounters::beginPhase(const std::string & name) {
+    endPhase();
+    std::lock_guard<std::mutex> lock(phaseMutex_);
+    for (int c = 0; c < CATEGORIES; c++)
+        phasePeak_[c] = current_[c].load();
+    currentPhase_ = name;
+}
+
+void MemoryCounters::endPhase() {
+    std::lock_guard<std::mutex> lock(phaseMutex_);
+    if (currentPhase_.empty())
+        return;
+    Stats s;
+    for (int c = 0; c < CATEGORIES; c++) {
+        s.current[c] = current_[c].load();
+        s.peak[c] = phasePeak_[c].load();
+    }
+    for (size_t i = 0; i < phases_.size(); i++) {
+        if (phases_[i].first == currentPhase_) {
+            phases_.erase(phases_.begin() + i);
+            break;
+        }
+    }
+    phases_.push_back(std::make_pair(currentPhase_, s));
+    currentPhase_.clear();
+}
+
+bool MemoryCounters::phase(const std::string & name, Stats & s) {
+    std::lock_guard<std::mutex> lock(phaseMutex_);
+    for (size_t i = 0; i < phases_.size(); i++) {
+        if (phases_[i].first == name) {
+            s = phases_[i].second;
+            return true;
+        }
+    }
+    return false;
+}
+
 }
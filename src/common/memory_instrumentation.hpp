@@ -30,6 +30,9 @@
 #include <stdio.h>
 #include <stddef.h>
 #include "common/chrono.h"
+#include "hmat/hmat.h"
+#include <atomic>
+#include <mutex>
 #ifndef HMAT_MEM_INSTR
 #include "common/context.hpp"
 #endif
@@ -106,5 +109,69 @@ public:
         return INSTANCE;
     }
 };
+
+/*! \brief Always enabled accounting of the memory, by category.
+
+  The owners of the arrays report their allocations with add(), and move()
+  them to another category when they take an array over, as RkMatrix does
+  with its panels. The counters are atomic, so the accounting can be left
+  on in parallel runs: the overhead is a few atomic operations per
+  allocation.
+
+  Phases give the peaks of a part of a run, such as the factorization. A
+  new phase ends the previous one.
+ */
+class MemoryCounters {
+public:
+    enum Category {
+        TEMPORARY = hmat_memory_temporary,
+        FULL = hmat_memory_full,
+        RK = hmat_memory_rk,
+        CLUSTER_TREE = hmat_memory_cluster_tree,
+        PIVOTS = hmat_memory_pivots,
+        TOTAL = hmat_memory_total,
+        CATEGORIES = hmat_memory_categories
+    };
+    typedef hmat_memory_stats_t Stats;
+
+    /** Account for bytes allocated in a category, or freed if bytes < 0 */
+    static void add(Category c, ptrdiff_t bytes) {
+        update(c, bytes);
+        update(TOTAL, bytes);
+    }
+    /** Move bytes from a category to another one */
+    static void move(Category from, Category to, ptrdiff_t bytes) {
+        if (from == to)
+            return;
+        update(to, bytes);
+        update(from, -bytes);
+    }
+    static void stats(Stats & s);
+    static void resetPeaks();
+    static void beginPhase(const std::string & name);
+    static void endPhase();
+    /** Return false if no phase named name has ended */
+    static bool phase(const std::string & name, Stats & s);
+
+private:
+    static std::atomic<int64_t> current_[CATEGORIES];
+    static std::atomic<int64_t> peak_[CATEGORIES];
+    static std::atomic<int64_t> phasePeak_[CATEGORIES];
+    static std::mutex phaseMutex_;
+    static std::string currentPhase_;
+    static std::vector<std::pair<std::string, Stats> > phases_;
+
+    static void updateMax(std::atomic<int64_t> & peak, int64_t value) {
+        int64_t p = peak.load(std::memory_order_relaxed);
+        while (value > p && !peak.compare_exchange_weak(p, value, std::memory_order_relaxed)) {}
+    }
+    static void update(Category c, ptrdiff_t bytes) {
+        const int64_t value = current_[c].fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        if (bytes > 0) {
+            updateMax(peak_[c], value);
+            updateMax(phasePeak_[c], value);
+        }
+    }
+};
 }
 
@@ -0,0 +1,239 @@
+/*
+  HMat-OSS (HMatrix library, open source software)
+
+  Copyright (C) 2014-2015 Airbus Group SAS
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+  http://github.com/jeromerobert/hmat-oss
+*/
+
+#include "config.h"
+#include "common/task_pool.hpp"
+#include "common/context.hpp"
+#include "common/my_assert.h"
+
+#include <cstdlib>
+
+namespace hmat {
+
+struct TaskPool::Task {
+  std::function<void()> function;
+  TaskGraph * graph;
+  /// Number of uncompleted dependencies, plus one until the task is submitted
+  std::atomic<int> pending;
+  std::mutex mutex;
+  bool done;
+  std::vector<Task*> successors;
+  Task(const std::function<void()> & f, TaskGraph * g): function(f), graph(g), pending(1), done(false) {}
+};
+
+namespace {
+thread_local int currentWorker = -1;
+
+int defaultPoolSize() {
+  const char * env = getenv("HMAT_NUM_THREADS");
+  int n = env == NULL ? (int)std::thread::hardware_concurrency() : atoi(env);
+  if(n < 1)
+    n = 1;
+  // trace::currentNodeIndex() must stay lower than MAX_ROOTS
+  if(n > MAX_ROOTS - 1)
+    n = MAX_ROOTS - 1;
+  return n;
+}
+}
+
+TaskPool::TaskPool(int size): queued_(0), stop_(false) {
+  // Give each worker its own row of the trace::Counters, the TaskEngine
+  // installs the same function but the pool is also used by the default one
+  if(trace::getNodeIndexFunction() == NULL)
+    trace::setNodeIndexFunction(&TaskPool::workerIndex);
+  for(int i = 0; i < size; i++)
+    queues_.push_back(std::unique_ptr<Queue>(new Queue()));
+  for(int i = 0; i < size - 1; i++)
+    threads_.push_back(std::thread(&TaskPool::workerLoop, this, i));
+}
+
+TaskPool::~TaskPool() {
+  {
+    std::lock_guard<std::mutex> lock(sleepMutex_);
+    stop_ = true;
+  }
+  sleepCond_.notify_all();
+  for(size_t i = 0; i < threads_.size(); i++)
+    threads_[i].join();
+}
+
+TaskPool & TaskPool::instance() {
+  static TaskPool instance(defaultPoolSize());
+  return instance;
+}
+
+int TaskPool::workerIndex() {
+  return currentWorker;
+}
+
+void TaskPool::notify(bool all) {
+  // Taking the lock ensures that a thread which checked its wake-up
+  // condition before the state change is already waiting.
+  { std::lock_guard<std::mutex> lock(sleepMutex_); }
+  if(all)
+    sleepCond_.notify_all();
+  else
+    sleepCond_.notify_one();
+}
+
+void TaskPool::push(Task * task) {
+  Queue & q = *queues_[currentWorker + 1];
+  {
+    std::lock_guard<std::mutex> lock(q.mutex);
+    q.tasks.push_back(task);
+  }
+  queued_++;
+  notify(false);
+}
+
+TaskPool::Task * TaskPool::pop() {
+  if(queued_ == 0)
+    return NULL;
+  int n = size();
+  int self = currentWorker + 1;
+  for(int i = 0; i < n; i++) {
+    Queue & q = *queues_[(self + i) % n];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if(!q.tasks.empty()) {
+      Task * t;
+      if(i == 0) {
+        // Own queue: LIFO for locality
+        t = q.tasks.back();
+        q.tasks.pop_back();
+      } else {
+        // Steal the oldest task, which is usually the largest one
+        t = q.tasks.front();
+        q.tasks.pop_front();
+      }
+      queued_--;
+      return t;
+    }
+  }
+  return NULL;
+}
+
+void TaskPool::run(Task * task) {
+  TaskGraph * graph = task->graph;
+  bool failed;
+  {
+    std::lock_guard<std::mutex> lock(graph->errorMutex_);
+    failed = (bool)graph->error_;
+  }
+  if(!failed) {
+    try {
+      task->function();
+    } catch(...) {
+      std::lock_guard<std::mutex> lock(graph->errorMutex_);
+      if(!graph->error_)
+        graph->error_ = std::current_exception();
+    }
+  }
+  graph->completed(task);
+}
+
+bool TaskPool::runPending() {
+  Task * t = pop();
+  if(t == NULL)
+    return false;
+  run(t);
+  return true;
+}
+
+void TaskPool::workerLoop(int index) {
+  currentWorker = index;
+  while(true) {
+    Task * t = pop();
+    if(t != NULL) {
+      run(t);
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(sleepMutex_);
+    sleepCond_.wait(lock, [this]{ return stop_ || queued_ > 0; });
+    if(stop_ && queued_ == 0)
+      return;
+  }
+}
+
+TaskGraph::TaskGraph(TaskPool & pool): pool_(pool), remaining_(0) {}
+
+TaskGraph::~TaskGraph() {
+  try {
+    wait();
+  } catch(...) {
+  }
+}
+
+TaskGraph::Task * TaskGraph::submit(const std::function<void()> & f, const std::vector<Task*> & deps) {
+  Task * t = new Task(f, this);
+  tasks_.push_back(std::unique_ptr<Task>(t));
+  remaining_++;
+  for(size_t i = 0; i < deps.size(); i++) {
+    Task * d = deps[i];
+    if(d == NULL)
+      continue;
+    HMAT_ASSERT(d->graph == this);
+    std::lock_guard<std::mutex> lock(d->mutex);
+    if(!d->done) {
+      t->pending++;
+      d->successors.push_back(t);
+    }
+  }
+  if(--t->pending == 0)
+    pool_.push(t);
+  return t;
+}
+
+void TaskGraph::completed(Task * task) {
+  std::vector<Task*> successors;
+  {
+    std::lock_guard<std::mutex> lock(task->mutex);
+    task->done = true;
+    successors.swap(task->successors);
+  }
+  for(size_t i = 0; i < successors.size(); i++) {
+    if(--successors[i]->pending == 0)
+      pool_.push(successors[i]);
+  }
+  // The graph may be destroyed as soon as remaining_ reaches 0
+  TaskPool & pool = pool_;
+  if(--remaining_ == 0)
+    pool.notify(true);
+}
+
+void TaskGraph::wait() {
+  while(remaining_ > 0) {
+    Task * t = pool_.pop();
+    if(t != NULL) {
+      pool_.run(t);
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(pool_.sleepMutex_);
+    pool_.sleepCond_.wait(lock, [this]{ return remaining_ == 0 || pool_.queued_ > 0; });
+  }
+  if(error_) {
+    std::exception_ptr e = error_;
+    error_ = std::exception_ptr();
+    std::rethrow_exception(e);
+  }
+}
+
+}  // end namespace hmat
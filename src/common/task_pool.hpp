@@ -0,0 +1,140 @@
+/*
+  HMat-OSS (HMatrix library, open source software)
+
+  Copyright (C) 2014-2015 Airbus Group SAS
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+  http://github.com/jeromerobert/hmat-oss
+*/
+
+/*! \file
+  \ingroup HMatrix
+  \brief Work-stealing thread pool and task graphs.
+*/
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace hmat {
+
+class TaskGraph;
+
+/*! \brief A pool of worker threads with one work-stealing queue per thread.
+
+  Workers pop tasks from the back of their own queue and steal from the front
+  of the other queues when it is empty. Threads which are not workers push to
+  a shared queue. A thread waiting for a \a TaskGraph executes pending tasks
+  instead of sleeping, so a task may itself build and wait for a nested graph.
+
+  The number of threads is read from the HMAT_NUM_THREADS environment variable
+  and defaults to std::thread::hardware_concurrency(). It includes the thread
+  which waits for the graphs, so a pool of size 1 has no worker and executes
+  tasks sequentially in submission order.
+
+  Unless hmat_set_worker_index_function was called first, the pool installs
+  \a workerIndex() as the worker index of the traces and counters, so that
+  each thread updates its own row.
+ */
+class TaskPool {
+  friend class TaskGraph;
+public:
+  struct Task;
+private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Task*> tasks;
+  };
+  /// queues_[0] is shared by non-worker threads, queues_[i+1] belongs to worker i
+  std::vector<std::unique_ptr<Queue> > queues_;
+  std::vector<std::thread> threads_;
+  std::atomic<int> queued_;
+  std::mutex sleepMutex_;
+  std::condition_variable sleepCond_;
+  bool stop_;
+
+  explicit TaskPool(int size);
+  ~TaskPool();
+  TaskPool(const TaskPool&);
+  void operator=(const TaskPool&);
+  void workerLoop(int index);
+  void push(Task * task);
+  Task * pop();
+  void run(Task * task);
+  void notify(bool all);
+public:
+  static TaskPool & instance();
+  /** Number of threads executing tasks, including the waiting thread */
+  int size() const { return (int)queues_.size(); }
+  /**
+   * Index of the calling thread in the pool, between 0 and size()-2 for
+   * workers and -1 for any other thread. This follows the convention of
+   * hmat_set_worker_index_function.
+   */
+  static int workerIndex();
+  /**
+   * Execute one pending task, if any. This lets a thread waiting for
+   * something else than a \a TaskGraph help instead of sleeping.
+   * @return false if there was no pending task
+   */
+  bool runPending();
+};
+
+/*! \brief A set of tasks with dependencies executed on a \a TaskPool.
+
+  Tasks are started as soon as all the tasks they depend on are completed.
+  Tasks must be submitted from a single thread. If a task throws, the
+  remaining tasks of the graph are skipped and \a wait() rethrows the first
+  exception.
+ */
+class TaskGraph {
+  friend class TaskPool;
+public:
+  typedef TaskPool::Task Task;
+private:
+  TaskPool & pool_;
+  std::vector<std::unique_ptr<Task> > tasks_;
+  std::atomic<int> remaining_;
+  std::mutex errorMutex_;
+  std::exception_ptr error_;
+  TaskGraph(const TaskGraph&);
+  void operator=(const TaskGraph&);
+  void completed(Task * task);
+public:
+  explicit TaskGraph(TaskPool & pool = TaskPool::instance());
+  /** Wait for all tasks, exceptions are dropped */
+  ~TaskGraph();
+  /**
+   * Add a task to the graph.
+   * @param f the function to run
+   * @param deps the tasks which must be completed before f is run. NULL
+   * entries are ignored.
+   * @return a handle to be used as a dependency of other tasks. It is valid
+   * until the graph is destroyed.
+   */
+  Task * submit(const std::function<void()> & f, const std::vector<Task*> & deps = std::vector<Task*>());
+  /** Execute pending tasks until all the tasks of this graph are completed */
+  void wait();
+};
+
+}  // end namespace hmat
@@ -1,5 +1,6 @@
 #include "timeline.hpp"
 #include "common/my_assert.h"
+#include <cstring>
 #include <iomanip>
 
 namespace hmat {
@@ -13,6 +14,9 @@ namespace hmat {
 Timeline::Task::~Task() {
     if(workerId_ >= 0) {
         timestamp();
+        // Number of integers of the payload, between op and the timestamps
+        const int length = (buffer_size - 2 * sizeof(int) - 2 * sizeof(int64_t)) / sizeof(int);
+        memcpy(buffer + sizeof(int), &length, sizeof(int));
         fwrite(buffer, buffer_size, 1, timeline_.files_[workerId_]);
     }
 }
@@ -31,6 +35,7 @@ bool Timeline::Task::init(int workerId, Operation op){
             workerId_=workerId;
         assert(workerId_ >= 0 && workerId_ < timeline_.files_.size());
         write(op);
+        write(0); // Payload length, set by ~Task()
         return true;
     } else {
         workerId_ = -1;
@@ -65,6 +70,8 @@ void Timeline::init(int numberOfWorker, int rank, bool onlyWorker) {
         ss << std::setw(2) << rank << "_" << std::setw(2) << i << ".bin";
         FILE * f = fopen(ss.str().c_str(), "wb");
         HMAT_ASSERT(f);
+        const int header[2] = { TRACE_MAGIC, TRACE_VERSION };
+        fwrite(header, sizeof(header), 1, f);
         files_.push_back(f);
     }
     enabled_ = true;
@@ -22,9 +22,15 @@ class Timeline {
                      PACK, UNPACK, INIT, PACK_COUNT, EXTRACT_RK, ASSEMBLE_RK,
                      MGS, QR, BLASGEMM, COPY_TRUNCATE, COARSEN, PRODUCTQ, SVD};
     std::bitset<SVD+1> opMask_;
+    /// First bytes of the trace files, followed by TRACE_VERSION
+    static const int TRACE_MAGIC = 0x4c544d48; // "HMTL"
+    /// Version 2 records the payload length: op, length, payload, 2 timestamps.
+    /// The files of version 1 have no header and their records no length,
+    /// the tools reading the raw files must handle both (see exportTimeline).
+    static const int TRACE_VERSION = 2;
     class Task {
 #ifdef HMAT_TIMELINE
-        char buffer[68]; // 68 bytes = 'op' (4 bytes) + payload (48 bytes max) + 2 timestamps (2x8 bytes)
+        char buffer[72]; // 72 bytes = 'op' and payload length (2x4 bytes) + payload (48 bytes max) + 2 timestamps (2x8 bytes)
         int buffer_size;
         Timeline & timeline_;
         int workerId_;
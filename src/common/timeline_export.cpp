@@ -0,0 +1,384 @@
+/*
+  HMat-OSS (HMatrix library, open source software)
+
+  Copyright (C) 2014-2015 Airbus Group SAS
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+  http://github.com/jeromerobert/hmat-oss
+*/
+
+#include "timeline_export.hpp"
+#include "timeline.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+namespace {
+
+using hmat::Timeline;
+
+const char * const operationNames[] = {
+  "gemm", "axpy", "solve_upper", "llt", "ldlt", "mdmt", "m_diag",
+  "solve_upper_left", "asm", "asm_sym", "solve_lower_left",
+  "pack", "unpack", "init", "pack_count", "extract_rk", "assemble_rk",
+  "mgs", "qr", "blasgemm", "copy_truncate", "coarsen", "productq", "svd"
+};
+static_assert(sizeof(operationNames) / sizeof(operationNames[0]) == Timeline::SVD + 1,
+              "operationNames must match Timeline::Operation");
+
+/** Names of the integer arguments of Timeline::Task, NULL for block operations */
+const char * const * integerArguments(int op) {
+  static const char * const init[] = { NULL };
+  static const char * const gemm[] = { "m", "n", "k", "transA", "transB", NULL };
+  static const char * const svd[] = { "rows", "cols", NULL };
+  static const char * const qr[] = { "rows", "cols", "initialPivot", NULL };
+  static const char * const productQ[] = { "k", "rows", "cols", NULL };
+  switch (op) {
+  case Timeline::INIT: return init;
+  case Timeline::BLASGEMM: return gemm;
+  case Timeline::SVD: return svd;
+  case Timeline::QR:
+  case Timeline::MGS: return qr;
+  case Timeline::PRODUCTQ: return productQ;
+  default: return NULL;
+  }
+}
+
+/** Floating point operations of a record, 0 if unknown */
+double flops(int op, const std::vector<int> & a) {
+  switch (op) {
+  case Timeline::BLASGEMM:
+    return 2. * a[0] * a[1] * a[2];
+  case Timeline::QR: {
+    const double m = std::max(a[0], a[1]), n = std::min(a[0], a[1]);
+    return 2. * m * n * n - 2. * n * n * n / 3.;
+  }
+  case Timeline::MGS:
+    return 2. * a[0] * a[1] * a[1];
+  case Timeline::PRODUCTQ:
+    return 4. * a[0] * a[1] * a[2];
+  default:
+    return 0;
+  }
+}
+
+struct Record {
+  int op;
+  std::vector<int> payload;
+  int64_t start, end;
+};
+
+class TraceReader {
+  const std::vector<char> & data_;
+
+  template<typename T> T read(size_t pos) const {
+    T v;
+    memcpy(&v, &data_[pos], sizeof(T));
+    return v;
+  }
+
+  /** Read the records of a version 2 file, which start after the header */
+  size_t parseRecords(std::vector<Record> & records) const {
+    // Up to 3 blocks of 4 integers
+    const int maxLength = 12;
+    size_t pos = 2 * sizeof(int);
+    int64_t lastEnd = 0;
+    while (pos + 2 * sizeof(int) <= data_.size()) {
+      Record r;
+      r.op = read<int>(pos);
+      const int length = read<int>(pos + sizeof(int));
+      const size_t end = pos + (2 + length) * sizeof(int) + 2 * sizeof(int64_t);
+      if (r.op < 0 || r.op > Timeline::SVD || length < 0 || length > maxLength || end > data_.size())
+        break;
+      if (integerArguments(r.op) == NULL && length % 4 != 0)
+        break;
+      r.payload.resize(length);
+      for (int k = 0; k < length; k++)
+        r.payload[k] = read<int>(pos + (2 + k) * sizeof(int));
+      r.start = read<int64_t>(end - 2 * sizeof(int64_t));
+      r.end = read<int64_t>(end - sizeof(int64_t));
+      // Records are written when tasks end, so the end timestamps of a worker never decrease
+      if (r.start < 0 || r.start > r.end || r.end < lastEnd)
+        break;
+      lastEnd = r.end;
+      records.push_back(r);
+      pos = end;
+    }
+    return pos;
+  }
+
+  // Version 1 files have no header and their records no payload length, so
+  // the number of blocks of the block operations must be guessed.
+
+  bool validOp(size_t pos) const {
+    if (pos + sizeof(int) > data_.size())
+      return false;
+    const int op = read<int>(pos);
+    return op >= 0 && op <= Timeline::SVD;
+  }
+  /** Payload sizes in bytes which may follow op in a version 1 record */
+  static std::vector<size_t> payloadSizes(int op) {
+    std::vector<size_t> sizes;
+    const char * const * args = integerArguments(op);
+    if (args) {
+      size_t n = 0;
+      while (args[n])
+        n++;
+      sizes.push_back(n * sizeof(int));
+    } else {
+      // Up to 3 blocks of 4 integers
+      for (size_t b = 0; b <= 3; b++)
+        sizes.push_back(b * 4 * sizeof(int));
+    }
+    return sizes;
+  }
+  /**
+   * End position of a version 1 record with a payload of size bytes at pos,
+   * or 0 if its timestamps are not consistent.
+   */
+  size_t fits(size_t pos, size_t size, int64_t lastEnd, int64_t & t1) const {
+    const size_t end = pos + sizeof(int) + size + 2 * sizeof(int64_t);
+    if (end > data_.size())
+      return 0;
+    const int64_t t0 = read<int64_t>(pos + sizeof(int) + size);
+    t1 = read<int64_t>(pos + sizeof(int) + size + sizeof(int64_t));
+    return t0 < 0 || t0 > t1 || t1 < lastEnd ? 0 : end;
+  }
+  Record record(size_t pos, size_t size) const {
+    Record r;
+    r.op = read<int>(pos);
+    pos += sizeof(int);
+    r.payload.resize(size / sizeof(int));
+    for (size_t k = 0; k < r.payload.size(); k++, pos += sizeof(int))
+      r.payload[k] = read<int>(pos);
+    r.start = read<int64_t>(pos);
+    r.end = read<int64_t>(pos + sizeof(int64_t));
+    return r;
+  }
+
+  /**
+   * Depth first search of the payload sizes of the version 1 block
+   * operations, so that the records cover the file, but at most slack bytes
+   * at its end. Return false if there is no such sequence of records.
+   */
+  bool search(std::vector<Record> & records, size_t & pos, size_t slack) const {
+    struct State {
+      size_t pos;
+      int64_t lastEnd;
+      size_t candidate;
+    };
+    // Smallest end timestamp of the previous record known to fail at a position
+    std::map<size_t, int64_t> failed;
+    std::vector<State> stack;
+    State root = { 0, 0, 0 };
+    stack.push_back(root);
+    while (!stack.empty() && stack.back().pos + slack < data_.size()) {
+      State & s = stack.back();
+      const std::vector<size_t> sizes = validOp(s.pos) ? payloadSizes(read<int>(s.pos)) : std::vector<size_t>();
+      State child = { 0, 0, 0 };
+      for (; s.candidate < sizes.size() && child.pos == 0; s.candidate++) {
+        child.pos = fits(s.pos, sizes[s.candidate], s.lastEnd, child.lastEnd);
+        std::map<size_t, int64_t>::const_iterator f = failed.find(child.pos);
+        if (child.pos != 0 && f != failed.end() && f->second <= child.lastEnd)
+          child.pos = 0;
+      }
+      if (child.pos != 0) {
+        stack.push_back(child);
+      } else {
+        std::map<size_t, int64_t>::iterator f = failed.find(s.pos);
+        if (f == failed.end() || s.lastEnd < f->second)
+          failed[s.pos] = s.lastEnd;
+        stack.pop_back();
+      }
+    }
+    if (stack.empty())
+      return false;
+    records.clear();
+    for (size_t i = 0; i + 1 < stack.size(); i++) {
+      const std::vector<size_t> sizes = payloadSizes(read<int>(stack[i].pos));
+      records.push_back(record(stack[i].pos, sizes[stack[i].candidate - 1]));
+    }
+    pos = stack.back().pos;
+    return true;
+  }
+
+  size_t parseVersion1(std::vector<Record> & records) const {
+    size_t pos = 0;
+    // A run which was killed may have written a part of its last record
+    const size_t maxRecordSize = sizeof(int) + 12 * sizeof(int) + 2 * sizeof(int64_t);
+    if (search(records, pos, 0) || search(records, pos, maxRecordSize - 1))
+      return pos;
+    // Corrupted data, read the records until the first inconsistent one
+    records.clear();
+    int64_t lastEnd = 0;
+    bool found = true;
+    while (found && validOp(pos)) {
+      const std::vector<size_t> sizes = payloadSizes(read<int>(pos));
+      found = false;
+      for (size_t i = 0; i < sizes.size() && !found; i++) {
+        int64_t t1;
+        const size_t end = fits(pos, sizes[i], lastEnd, t1);
+        if (end != 0) {
+          records.push_back(record(pos, sizes[i]));
+          pos = end;
+          lastEnd = t1;
+          found = true;
+        }
+      }
+    }
+    return pos;
+  }
+
+public:
+  explicit TraceReader(const std::vector<char> & data) : data_(data) {}
+
+  /**
+   * Version of the trace: Timeline::TRACE_VERSION, 1 for the files without
+   * header written before it, or 0 for an unknown version.
+   */
+  int version() const {
+    if (data_.size() < sizeof(int) || read<int>(0) != Timeline::TRACE_MAGIC)
+      return 1;
+    if (data_.size() >= 2 * sizeof(int) && read<int>(sizeof(int)) == Timeline::TRACE_VERSION)
+      return Timeline::TRACE_VERSION;
+    return 0;
+  }
+
+  /**
+   * Read the records of the file and return the number of bytes read, which
+   * is less than the file size if it is truncated or corrupted.
+   */
+  size_t parse(std::vector<Record> & records) const {
+    return version() == 1 ? parseVersion1(records) : parseRecords(records);
+  }
+};
+
+std::string traceFileName(const std::string & prefix, int rank, int worker) {
+  std::ostringstream ss;
+  ss << std::setfill('0') << prefix;
+  ss << std::setw(2) << rank << "_" << std::setw(2) << worker << ".bin";
+  return ss.str();
+}
+
+bool readFile(const std::string & name, std::vector<char> & data) {
+  FILE * f = fopen(name.c_str(), "rb");
+  if (f == NULL)
+    return false;
+  data.clear();
+  char buffer[1 << 16];
+  size_t n;
+  while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0)
+    data.insert(data.end(), buffer, buffer + n);
+  fclose(f);
+  return true;
+}
+
+void writeArguments(std::ostream & out, const Record & r) {
+  const char * const * names = integerArguments(r.op);
+  out << "\"args\":{";
+  if (names) {
+    size_t k = 0;
+    for (; names[k] && k < r.payload.size(); k++)
+      out << (k ? "," : "") << "\"" << names[k] << "\":" << r.payload[k];
+    const double f = names[k] ? 0 : flops(r.op, r.payload);
+    if (f > 0 && r.end > r.start)
+      out << (names[0] ? "," : "") << "\"gflops\":" << f / (r.end - r.start);
+  } else {
+    // Blocks are rows offset, rows size, cols offset, cols size
+    for (size_t b = 0; 4 * b < r.payload.size(); b++) {
+      const int * p = &r.payload[4 * b];
+      out << (b ? "," : "") << "\"block" << b + 1 << "\":\"" << p[1] << "x" << p[3]
+          << " at (" << p[0] << "," << p[2] << ")\"";
+    }
+  }
+  out << "}";
+}
+
+}  // end anonymous namespace
+
+namespace hmat {
+
+long exportTimeline(const std::string & prefix, std::ostream & out, int & damaged) {
+  // Load all the files first, timestamps are written relative to the earliest one
+  std::vector<std::vector<std::vector<Record> > > tracks;
+  int64_t origin = -1;
+  long count = 0;
+  damaged = 0;
+  std::vector<char> data;
+  for (int rank = 0; readFile(traceFileName(prefix, rank, 0), data); rank++) {
+    tracks.push_back(std::vector<std::vector<Record> >());
+    for (int worker = 0; worker == 0 || readFile(traceFileName(prefix, rank, worker), data); worker++) {
+      tracks.back().push_back(std::vector<Record>());
+      std::vector<Record> & records = tracks.back().back();
+      const TraceReader reader(data);
+      if (reader.version() == 0) {
+        fprintf(stderr, "HMat timeline: %s is not a trace of version 1 or %d\n",
+                traceFileName(prefix, rank, worker).c_str(), Timeline::TRACE_VERSION);
+        damaged++;
+        continue;
+      }
+      const size_t pos = reader.parse(records);
+      for (size_t i = 0; i < records.size(); i++) {
+        if (origin < 0 || records[i].start < origin)
+          origin = records[i].start;
+      }
+      count += records.size();
+      if (pos != data.size()) {
+        damaged++;
+        fprintf(stderr, "HMat timeline: %s is truncated or corrupted at byte %lu\n",
+                traceFileName(prefix, rank, worker).c_str(), (unsigned long) pos);
+      }
+    }
+  }
+  if (tracks.empty())
+    return -1;
+
+  out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+  bool first = true;
+  const std::streamsize precision = out.precision(3);
+  const std::ios_base::fmtflags flags = out.flags();
+  out << std::fixed;
+  for (size_t rank = 0; rank < tracks.size(); rank++) {
+    out << (first ? "" : ",\n") << "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":" << rank
+        << ",\"args\":{\"name\":\"rank " << rank << "\"}}";
+    first = false;
+    for (size_t worker = 0; worker < tracks[rank].size(); worker++) {
+      out << ",\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":" << rank << ",\"tid\":" << worker
+          << ",\"args\":{\"name\":\"worker " << worker << "\"}}";
+      const std::vector<Record> & records = tracks[rank][worker];
+      for (size_t i = 0; i < records.size(); i++) {
+        const Record & r = records[i];
+        // Chrome traces are in microseconds
+        out << ",\n{\"ph\":\"X\",\"cat\":\"hmat\",\"name\":\"" << operationNames[r.op]
+            << "\",\"pid\":" << rank << ",\"tid\":" << worker
+            << ",\"ts\":" << (r.start - origin) * 1e-3 << ",\"dur\":" << (r.end - r.start) * 1e-3 << ",";
+        writeArguments(out, r);
+        out << "}";
+      }
+    }
+  }
+  out << "\n]}\n";
+  out.precision(precision);
+  out.flags(flags);
+  return count;
+}
+
+}  // end namespace hmat
@@ -0,0 +1,62 @@
+/*
+  HMat-OSS (HMatrix library, open source software)
+
+  Copyright (C) 2014-2015 Airbus Group SAS
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+  http://github.com/jeromerobert/hmat-oss
+*/
+
+/*! \file
+  \ingroup HMatrix
+  \brief Conversion of the Timeline binary traces to the Chrome trace format.
+*/
+#pragma once
+#include <ostream>
+#include <string>
+
+namespace hmat {
+
+/*! \brief Convert the traces written by Timeline to Chrome trace JSON.
+
+  The traces of a run are the files <prefix><rank>_<worker>.bin, prefix
+  being the value of the HMAT_TIMELINE environment variable. They start
+  with Timeline::TRACE_MAGIC and Timeline::TRACE_VERSION, followed by the
+  records: the operation code, the number of integers of the payload, the
+  payload and the start and end timestamps. The traces of version 1,
+  written by the previous releases, have no header and no payload length:
+  the reader searches the number of blocks of each block operation which
+  reads the whole file with non-decreasing end timestamps.
+
+  Each process rank becomes a process and each worker file a thread of the
+  trace, the last one of a rank being the sequential section unless the
+  engine only traces workers. Every record is a complete event named after
+  its operation, with the block sizes as arguments, and the achieved
+  GFLOP/s of the BLAS and LAPACK operations (counted in real arithmetic).
+  The output can be opened with chrome://tracing or ui.perfetto.dev.
+
+  The records of a file are converted up to the first invalid one, which
+  ends a truncated or corrupted file.
+
+  \param prefix the prefix of the trace files
+  \param out the JSON output
+  \param damaged the number of files which are truncated, corrupted or of
+  an unknown trace version
+  \return the number of converted records, -1 if there is no trace file
+ */
+long exportTimeline(const std::string & prefix, std::ostream & out, int & damaged);
+
+}  // end namespace hmat
@@ -32,6 +32,8 @@
 #include <cfloat>
 #include <cstring>
 #include <limits>
+#include <algorithm>
+#include <random>
 #include "cluster_tree.hpp"
 #include "assembly.hpp"
 #include "rk_matrix.hpp"
@@ -354,6 +356,123 @@ template<typename T> RkMatrix<T>* acaFull(FullMatrix<T>* m, double compressionEp
   return new RkMatrix<T>(tmpA, rows, tmpB, cols);
 }
 
+template<typename T> static T randomValue(std::mt19937 & generator) {
+  std::uniform_real_distribution<double> distribution(-1, 1);
+  return T(distribution(generator));
+}
+
+template<> C_t randomValue<C_t>(std::mt19937 & generator) {
+  std::uniform_real_distribution<double> distribution(-1, 1);
+  const double re = distribution(generator);
+  const double im = distribution(generator);
+  return C_t(re, im);
+}
+
+template<> Z_t randomValue<Z_t>(std::mt19937 & generator) {
+  std::uniform_real_distribution<double> distribution(-1, 1);
+  const double re = distribution(generator);
+  const double im = distribution(generator);
+  return Z_t(re, im);
+}
+
+/** Replace the columns of y by an orthonormal basis of their span */
+template<typename T> static void orthonormalize(ScalarArray<T> & y) {
+  assert(y.lda == y.rows && y.rows >= y.cols);
+  ScalarArray<T> r(y.cols, y.cols, false);
+  y.qrDecomposition(&r);
+  ScalarArray<T> q(y.rows, y.cols);
+  for (int i = 0; i < y.cols; i++)
+    q.get(i, i) = 1;
+  y.productQ('L', 'N', &q);
+  y.copyMatrixAtOffset(&q, 0, 0);
+}
+
+template<typename T>
+void randomizedQB(ScalarArray<T> & m, ScalarArray<T>* & q, ScalarArray<T>* & b, double compressionEpsilon,
+                  int blockSize, int powerIterations) {
+  DECLARE_CONTEXT;
+  HMAT_ASSERT_MSG(blockSize > 0 && powerIterations >= 0,
+                  "Invalid randomized SVD parameters: block size %d, %d power iterations",
+                  blockSize, powerIterations);
+  const int maxK = min(m.rows, m.cols);
+  double residual = m.normSqr();
+  const double threshold = compressionEpsilon * compressionEpsilon * residual;
+  q = new ScalarArray<T>(m.rows, maxK);
+  b = new ScalarArray<T>(m.cols, maxK);
+  // Fixed seed, so that the result does not depend on the assembly order
+  std::mt19937 generator;
+  int k = 0;
+  while (k < maxK && residual > threshold) {
+    const int bs = min(blockSize, maxK - k);
+    ScalarArray<T> omega(m.cols, bs, false);
+    for (int j = 0; j < bs; j++)
+      for (int i = 0; i < m.cols; i++)
+        omega.get(i, j) = randomValue<T>(generator);
+    ScalarArray<T> y(m.rows, bs, false);
+    y.gemm('N', 'N', 1, &m, &omega, 0);
+    for (int i = 0; i < powerIterations; i++) {
+      orthonormalize(y);
+      omega.gemm('C', 'N', 1, &m, &y, 0);
+      orthonormalize(omega);
+      y.gemm('N', 'N', 1, &m, &omega, 0);
+    }
+    // m is deflated so y is orthogonal to q, up to rounding errors
+    if (k > 0) {
+      const ScalarArray<T> qk(*q, 0, m.rows, 0, k);
+      ScalarArray<T> c(k, bs, false);
+      c.gemm('C', 'N', 1, &qk, &y, 0);
+      y.gemm('N', 'N', -1, &qk, &c, 1);
+    }
+    orthonormalize(y);
+    ScalarArray<T> qi(*q, 0, m.rows, k, bs);
+    ScalarArray<T> bi(*b, 0, m.cols, k, bs);
+    qi.copyMatrixAtOffset(&y, 0, 0);
+    // bi = conj(m^H.qi) so that qi.bi^T = qi.qi^H.m
+    bi.gemm('C', 'N', 1, &m, &qi, 0);
+    bi.conjugate();
+    m.gemm('N', 'T', -1, &qi, &bi, 1);
+    k += bs;
+    residual = m.normSqr();
+  }
+  if (k == 0) {
+    delete q;
+    delete b;
+    q = nullptr;
+    b = nullptr;
+  } else {
+    q->resize(k);
+    b->resize(k);
+  }
+}
+
+template<typename T> RkMatrix<typename Types<T>::dp>*
+doCompressionRsvd(const ClusterAssemblyFunction<T>& block, double eps, int blockSize, int powerIterations) {
+  DECLARE_CONTEXT;
+  typedef typename Types<T>::dp dp_t;
+  FullMatrix<dp_t>* m = block.assemble();
+  ScalarArray<dp_t> *q, *b;
+  randomizedQB(m->data, q, b, eps, blockSize, powerIterations);
+  delete m;
+  return new RkMatrix<dp_t>(q, block.rows, b, block.cols);
+}
+
+RkMatrix<Types<S_t>::dp>*
+CompressionRsvd::compress(const ClusterAssemblyFunction<S_t>& block) const {
+    return doCompressionRsvd<S_t>(block, epsilon_, blockSize_, powerIterations_);
+}
+RkMatrix<Types<D_t>::dp>*
+CompressionRsvd::compress(const ClusterAssemblyFunction<D_t>& block) const {
+    return doCompressionRsvd<D_t>(block, epsilon_, blockSize_, powerIterations_);
+}
+RkMatrix<Types<C_t>::dp>*
+CompressionRsvd::compress(const ClusterAssemblyFunction<C_t>& block) const {
+    return doCompressionRsvd<C_t>(block, epsilon_, blockSize_, powerIterations_);
+}
+RkMatrix<Types<Z_t>::dp>*
+CompressionRsvd::compress(const ClusterAssemblyFunction<Z_t>& block) const {
+    return doCompressionRsvd<Z_t>(block, epsilon_, blockSize_, powerIterations_);
+}
+
 template<typename T> RkMatrix<typename Types<T>::dp>*
 doCompressionAcaFull(const ClusterAssemblyFunction<T>& block, double eps) {
   FullMatrix<typename Types<T>::dp> * m = block.assemble();
@@ -529,6 +648,156 @@ CompressionAcaPartial::compress(const ClusterAssemblyFunction<Z_t>& block) const
 }
 
 
+/**
+ * Return up to n free rows sorted by decreasing squared modulus in col,
+ * ties being broken by increasing index. If col is NULL, return the first
+ * free rows.
+ */
+template<typename T>
+static vector<int> selectRows(const Vector<T>* col, const vector<bool>& rowFree, int n) {
+  vector<int> candidates;
+  for (int i = 0; i < (int)rowFree.size(); i++)
+    if (rowFree[i])
+      candidates.push_back(i);
+  n = min(n, (int)candidates.size());
+  if (col != NULL) {
+    std::partial_sort(candidates.begin(), candidates.begin() + n, candidates.end(),
+      [col](int a, int b) {
+        const double na = squaredNorm<T>((*col)[a]);
+        const double nb = squaredNorm<T>((*col)[b]);
+        return na > nb || (na == nb && a < b);
+      });
+  }
+  candidates.resize(n);
+  return candidates;
+}
+
+template<typename T>
+RkMatrix<typename Types<T>::dp>*
+doCompressionAcaBatch(const ClusterAssemblyFunction<T>& block, double compressionEpsilon, int batchSize) {
+  typedef typename Types<T>::dp dp_t;
+  HMAT_ASSERT_MSG(batchSize > 0, "Invalid ACA batch size: %d", batchSize);
+
+  double estimateSquaredNorm = 0;
+  const int rowCount = block.rows->size();
+  const int colCount = block.cols->size();
+  const int maxK = min(rowCount, colCount);
+  vector<bool> rowFree(rowCount, true);
+  vector<bool> colFree(colCount, true);
+  vector<Vector<dp_t>*> aCols;
+  vector<Vector<dp_t>*> bCols;
+  // Same row count limit as ACA partial
+  int rowPivotCount = 0;
+  int k = 0;
+  bool converged = false;
+  vector<int> batch(rowCount > 0 ? 1 : 0, 0);
+
+  while (!batch.empty() && !converged && k < maxK) {
+    const int nr = batch.size();
+    rowPivotCount += nr;
+    // Rows of the batch and their residue
+    ScalarArray<dp_t> rowsRes(colCount, nr);
+    block.getRows(nr, batch.data(), rowsRes);
+    for (int r = 0; r < nr; r++) {
+      Vector<dp_t> row(rowsRes, r);
+      updateRow(row, batch[r], bCols, aCols, k);
+      rowFree[batch[r]] = false;
+    }
+
+    // Eliminate the rows against each other to find one column pivot per row
+    vector<Vector<dp_t>*> newB;
+    vector<int> pivotCols;
+    for (int r = 0; r < nr && k + (int)newB.size() < maxK; r++) {
+      Vector<dp_t> row(rowsRes, r);
+      for (size_t t = 0; t < newB.size(); t++)
+        row.axpy(-row[pivotCols[t]], newB[t]);
+      double maxNorm2 = 0.;
+      int J = 0;
+      for (int j = 0; j < colCount; j++) {
+        const double norm2 = squaredNorm<dp_t>(row[j]);
+        if (colFree[j] && norm2 > maxNorm2) {
+          maxNorm2 = norm2;
+          J = j;
+        }
+      }
+      if (maxNorm2 == 0.)
+        continue;
+      Vector<dp_t>* bCol = new Vector<dp_t>(colCount);
+      bCol->copyMatrixAtOffset(&row, 0, 0);
+      bCol->scale(1. / row[J]);
+      colFree[J] = false;
+      newB.push_back(bCol);
+      pivotCols.push_back(J);
+    }
+
+    if (!newB.empty()) {
+      // Columns of the pivots and their residue
+      const int nc = pivotCols.size();
+      // Zeroed as the guaranteed null columns are not written by getCols
+      ScalarArray<dp_t> colsRes(rowCount, nc);
+      block.getCols(nc, pivotCols.data(), colsRes);
+      int t = 0;
+      for (; t < nc && !converged; t++) {
+        Vector<dp_t>* aCol = new Vector<dp_t>(rowCount);
+        const Vector<dp_t> col(colsRes, t);
+        aCol->copyMatrixAtOffset(&col, 0, 0);
+        Vector<dp_t>* bCol = newB[t];
+        updateCol(*aCol, pivotCols[t], aCols, bCols, k);
+        aCols.push_back(aCol);
+        bCols.push_back(bCol);
+
+        // Same norm estimate and stopping criterion as ACA partial
+        double newEstimate = 0.0;
+        for (int l = 0; l < k; l++) {
+          newEstimate += hmat::real(Vector<dp_t>::dot(aCol, aCols[l]) * Vector<dp_t>::dot(bCol, bCols[l]));
+        }
+        estimateSquaredNorm += 2.0 * newEstimate;
+        const double ab_norm_2 = aCol->normSqr() * bCol->normSqr();
+        estimateSquaredNorm += ab_norm_2;
+        k++;
+        converged = ab_norm_2 < compressionEpsilon * compressionEpsilon * estimateSquaredNorm;
+      }
+      for (; t < nc; t++)
+        delete newB[t];
+    }
+    if (converged || rowPivotCount >= maxK)
+      break;
+    // The next batch starts with the row ACA partial would choose
+    batch = selectRows<dp_t>(newB.empty() ? NULL : aCols.back(), rowFree,
+                             min(batchSize, maxK - rowPivotCount));
+  }
+
+  if (k == 0)
+    return new RkMatrix<dp_t>(NULL, block.rows, NULL, block.cols);
+  ScalarArray<dp_t>* newA = new ScalarArray<dp_t>(rowCount, k);
+  ScalarArray<dp_t>* newB = new ScalarArray<dp_t>(colCount, k);
+  for (int i = 0; i < k; i++) {
+    newA->copyMatrixAtOffset(aCols[i], 0, i);
+    newB->copyMatrixAtOffset(bCols[i], 0, i);
+    delete aCols[i];
+    delete bCols[i];
+  }
+  return new RkMatrix<dp_t>(newA, block.rows, newB, block.cols);
+}
+
+RkMatrix<Types<S_t>::dp>*
+CompressionAcaBatch::compress(const ClusterAssemblyFunction<S_t>& block) const {
+    return doCompressionAcaBatch<S_t>(block, epsilon_, batchSize_);
+}
+RkMatrix<Types<D_t>::dp>*
+CompressionAcaBatch::compress(const ClusterAssemblyFunction<D_t>& block) const {
+    return doCompressionAcaBatch<D_t>(block, epsilon_, batchSize_);
+}
+RkMatrix<Types<C_t>::dp>*
+CompressionAcaBatch::compress(const ClusterAssemblyFunction<C_t>& block) const {
+    return doCompressionAcaBatch<C_t>(block, epsilon_, batchSize_);
+}
+RkMatrix<Types<Z_t>::dp>*
+CompressionAcaBatch::compress(const ClusterAssemblyFunction<Z_t>& block) const {
+    return doCompressionAcaBatch<Z_t>(block, epsilon_, batchSize_);
+}
+
+
 template<typename T>
 RkMatrix<typename Types<T>::dp>*
 doCompressionAcaPlus(const ClusterAssemblyFunction<T>& block, double compressionEpsilon, const CompressionAlgorithm* delegate) {
@@ -807,6 +1076,11 @@ template void acaFull(ScalarArray<D_t> &, ScalarArray<D_t>* &, ScalarArray<D_t>*
 template void acaFull(ScalarArray<C_t> &, ScalarArray<C_t>* &, ScalarArray<C_t>* &, double);
 template void acaFull(ScalarArray<Z_t> &, ScalarArray<Z_t>* &, ScalarArray<Z_t>* &, double);
 
+template void randomizedQB(ScalarArray<S_t> &, ScalarArray<S_t>* &, ScalarArray<S_t>* &, double, int, int);
+template void randomizedQB(ScalarArray<D_t> &, ScalarArray<D_t>* &, ScalarArray<D_t>* &, double, int, int);
+template void randomizedQB(ScalarArray<C_t> &, ScalarArray<C_t>* &, ScalarArray<C_t>* &, double, int, int);
+template void randomizedQB(ScalarArray<Z_t> &, ScalarArray<Z_t>* &, ScalarArray<Z_t>* &, double, int, int);
+
 template RkMatrix<Types<S_t>::dp>* compress<S_t>(const CompressionAlgorithm* method, const Function<S_t>& f, const ClusterData* rows, const ClusterData* cols, double epsilon, const AllocationObserver &);
 template RkMatrix<Types<D_t>::dp>* compress<D_t>(const CompressionAlgorithm* method, const Function<D_t>& f, const ClusterData* rows, const ClusterData* cols, double epsilon, const AllocationObserver &);
 template RkMatrix<Types<C_t>::dp>* compress<C_t>(const CompressionAlgorithm* method, const Function<C_t>& f, const ClusterData* rows, const ClusterData* cols, double epsilon, const AllocationObserver &);
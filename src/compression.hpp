@@ -41,7 +41,7 @@ template<typename T> class Function;
 class ClusterData;
 
 enum CompressionMethod {
-  Svd, AcaFull, AcaPartial, AcaPlus, NoCompression, AcaRandom
+  Svd, AcaFull, AcaPartial, AcaPlus, NoCompression, AcaRandom, AcaBatch, Rsvd
 };
 class IndexSet;
 
@@ -66,6 +66,21 @@ void acaFull(ScalarArray<T> & m, ScalarArray<T>* & u, ScalarArray<T>* & v, doubl
 template<typename T>
 RkMatrix<T>* acaFull(FullMatrix<T>* m, double eps);
 
+/** Randomized range finder, computing q orthonormal and b such that m ~= q.b^T.
+
+    The rank grows by steps of blockSize columns, each one sketched with a
+    random matrix and refined with powerIterations power iterations, until
+    |m - q.b^T| < eps |m| in Frobenius norm. The result is usually truncated
+    afterwards, which removes the extra columns of the last step.
+
+    \param m The matrix to compress. It is overwritten with m - q.b^T.
+    \param q set to NULL if m is null
+    \param b set to NULL if m is null
+*/
+template<typename T>
+void randomizedQB(ScalarArray<T> & m, ScalarArray<T>* & q, ScalarArray<T>* & b, double eps,
+                  int blockSize, int powerIterations);
+
 // Abstract class to compress a block into an RkMatrix.
 class CompressionAlgorithm
 {
@@ -113,6 +128,28 @@ public:
 };
 
 
+/**
+ * Randomized SVD: the block is assembled, compressed with randomizedQB then
+ * truncated. It only uses block products so it runs at BLAS3 speed, and
+ * unlike ACA it does not depend on the choice of pivots.
+ */
+class CompressionRsvd : public CompressionAlgorithm
+{
+public:
+    CompressionRsvd(double epsilon, int blockSize, int powerIterations)
+      : CompressionAlgorithm(epsilon), blockSize_(blockSize), powerIterations_(powerIterations) {}
+    CompressionRsvd* clone() const { return new CompressionRsvd(epsilon_, blockSize_, powerIterations_); }
+    RkMatrix<Types<S_t>::dp>* compress(const ClusterAssemblyFunction<S_t>& block) const;
+    RkMatrix<Types<D_t>::dp>* compress(const ClusterAssemblyFunction<D_t>& block) const;
+    RkMatrix<Types<C_t>::dp>* compress(const ClusterAssemblyFunction<C_t>& block) const;
+    RkMatrix<Types<Z_t>::dp>* compress(const ClusterAssemblyFunction<Z_t>& block) const;
+    bool isIncremental(const ClusterData&, const ClusterData&) const { return false; }
+private:
+    int blockSize_;
+    int powerIterations_;
+};
+
+
 class CompressionAcaPartial : public CompressionAlgorithm
 {
 public:
@@ -152,6 +189,29 @@ public:
 };
 
 
+/**
+ * ACA partial where the rows, then the columns, are fetched by batches.
+ *
+ * Each batch holds the pivot row that ACA partial would choose, followed by
+ * the rows with the next largest entries in the last residual column. The
+ * rows are eliminated against each other to find one column pivot per row,
+ * and these columns are fetched in a single call. With a batch size of 1,
+ * the pivots and the result are those of CompressionAcaPartial.
+ */
+class CompressionAcaBatch : public CompressionAlgorithm
+{
+public:
+    CompressionAcaBatch(double epsilon, int batchSize) : CompressionAlgorithm(epsilon), batchSize_(batchSize) {}
+    CompressionAcaBatch* clone() const { return new CompressionAcaBatch(epsilon_, batchSize_); }
+    RkMatrix<Types<S_t>::dp>* compress(const ClusterAssemblyFunction<S_t>& block) const;
+    RkMatrix<Types<D_t>::dp>* compress(const ClusterAssemblyFunction<D_t>& block) const;
+    RkMatrix<Types<C_t>::dp>* compress(const ClusterAssemblyFunction<C_t>& block) const;
+    RkMatrix<Types<Z_t>::dp>* compress(const ClusterAssemblyFunction<Z_t>& block) const;
+private:
+    int batchSize_;
+};
+
+
 template<typename T>
 RkMatrix<typename Types<T>::dp>*
 compress(const CompressionAlgorithm* compression, const Function<T>& f,
@@ -0,0 +1,583 @@
+/*
+  HMat-OSS (HMatrix library, open source software)
+
+  Copyright (C) 2014-2015 Airbus Group SAS
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+  http://github.com/jeromerobert/hmat-oss
+*/
+
+#include "cost_estimator.hpp"
+#include "h_matrix.hpp"
+#include "rk_matrix.hpp"
+#include "full_matrix.hpp"
+#include "assembly.hpp"
+#include "cluster_tree.hpp"
+#include "common/context.hpp"
+#include "common/chrono.h"
+#include "common/my_assert.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+/** A block of the simulated matrix, with only its sizes and its rank */
+struct Block {
+  /// Values of rank which are not the rank of an rk leaf
+  enum { FULL = -1, NODE = -2 };
+  int rows, cols, rank;
+  int nrChildRow, nrChildCol;
+  /// Children in column major order, NULL for the missing ones
+  std::vector<Block*> children;
+
+  Block(int r, int c, int k) : rows(r), cols(c), rank(k), nrChildRow(0), nrChildCol(0) {}
+  ~Block() {
+    for (size_t i = 0; i < children.size(); i++)
+      delete children[i];
+  }
+  bool isNode() const { return rank == NODE; }
+  bool isFull() const { return rank == FULL; }
+  bool isRk() const { return rank >= 0; }
+private:
+  Block(const Block&);
+  void operator=(const Block&);
+};
+
+/** Child (i, j) of b, or of b^T if trans */
+Block * child(const Block * b, bool trans, int i, int j) {
+  return trans ? b->children[j + i * b->nrChildRow] : b->children[i + j * b->nrChildRow];
+}
+int nrChildRow(const Block * b, bool trans) { return trans ? b->nrChildCol : b->nrChildRow; }
+int nrChildCol(const Block * b, bool trans) { return trans ? b->nrChildRow : b->nrChildCol; }
+
+/** Number of terms stored in b */
+double terms(const Block * b) {
+  if (b == NULL)
+    return 0;
+  if (b->isFull())
+    return double(b->rows) * b->cols;
+  if (b->isRk())
+    return double(b->rank) * (b->rows + b->cols);
+  double s = 0;
+  for (size_t i = 0; i < b->children.size(); i++)
+    s += terms(b->children[i]);
+  return s;
+}
+
+/** Flops of the product of b by a vector */
+double matVec(const Block * b) {
+  return 2 * terms(b);
+}
+
+/** Flops of the truncation of a m x n rk matrix of rank k */
+double truncation(double m, double n, double k) {
+  return 4 * (m + n) * k * k + 20 * k * k * k;
+}
+
+template<typename T>
+Block * build(const hmat::HMatrix<T> * h,
+              std::vector<std::pair<const hmat::HMatrix<T>*, Block*> > & rkLeaves,
+              std::vector<const hmat::HMatrix<T>*> & fullLeaves) {
+  if (h == NULL)
+    return NULL;
+  const int rows = h->rows()->size();
+  const int cols = h->cols()->size();
+  if (h->isLeaf()) {
+    Block * b = new Block(rows, cols, h->isRkMatrix() ? 0 : Block::FULL);
+    if (rows > 0 && cols > 0) {
+      if (b->isRk())
+        rkLeaves.push_back(std::make_pair(h, b));
+      else
+        fullLeaves.push_back(h);
+    }
+    return b;
+  }
+  Block * b = new Block(rows, cols, Block::NODE);
+  b->nrChildRow = h->nrChildRow();
+  b->nrChildCol = h->nrChildCol();
+  b->children.resize(h->nrChild());
+  for (int i = 0; i < h->nrChild(); i++)
+    b->children[i] = build(h->getChild(i), rkLeaves, fullLeaves);
+  return b;
+}
+
+/** Same as HMatrix::info() */
+void info(const Block * b, hmat_info_t & result) {
+  result.nr_block_clusters++;
+  const size_t r = b->rows, c = b->cols;
+  if (r == 0 || c == 0)
+    return;
+  if (b->isRk()) {
+    const size_t mem = b->rank * (r + c);
+    result.uncompressed_size += r * c;
+    result.compressed_size += mem;
+    if (r + c > (size_t) result.largest_rk_dim_cols + result.largest_rk_dim_rows) {
+      result.largest_rk_dim_cols = c;
+      result.largest_rk_dim_rows = r;
+    }
+    if (mem > ((size_t)result.largest_rk_mem_cols + result.largest_rk_mem_rows) * result.largest_rk_mem_rank) {
+      result.largest_rk_mem_cols = c;
+      result.largest_rk_mem_rows = r;
+      result.largest_rk_mem_rank = b->rank;
+    }
+    result.rk_count++;
+    result.rk_size += r * c;
+    result.rk_rank_sum += b->rank;
+    result.max_rk_rank = std::max(result.max_rk_rank, b->rank);
+  } else if (b->isFull()) {
+    result.uncompressed_size += r * c;
+    result.compressed_size += r * c;
+    result.full_count++;
+    result.full_size += r * c;
+  } else {
+    for (size_t i = 0; i < b->children.size(); i++)
+      if (b->children[i])
+        info(b->children[i], result);
+  }
+}
+
+/**
+ * Play the recursions of the HMatrix factorizations on the blocks, counting
+ * the flops and updating the ranks of the rk blocks.
+ */
+class Simulation {
+public:
+  double flops;
+  /// Terms of the factors which are not stored in the blocks
+  double extraTerms;
+  Simulation() : flops(0), extraTerms(0) {}
+
+  void lu(Block * x) {
+    if (!x->isNode() || x->nrChildRow != x->nrChildCol) {
+      flops += 2. / 3. * x->rows * x->rows * x->rows;
+      return;
+    }
+    const int n = x->nrChildRow;
+    for (int k = 0; k < n; k++) {
+      Block * xkk = child(x, false, k, k);
+      lu(xkk);
+      for (int j = k + 1; j < n; j++)
+        solveLower(child(x, false, k, j), xkk, false);
+      for (int i = k + 1; i < n; i++)
+        solveUpper(child(x, false, i, k), xkk, false);
+      for (int i = k + 1; i < n; i++)
+        for (int j = k + 1; j < n; j++)
+          gemm(child(x, false, i, j), child(x, false, i, k), false, child(x, false, k, j), false);
+    }
+  }
+
+  /** LLt or LDLt of the lower part of x */
+  void llt(Block * x) {
+    if (!x->isNode() || x->nrChildRow != x->nrChildCol) {
+      flops += 1. / 3. * x->rows * x->rows * x->rows;
+      return;
+    }
+    const int n = x->nrChildRow;
+    for (int k = 0; k < n; k++) {
+      Block * xkk = child(x, false, k, k);
+      llt(xkk);
+      for (int i = k + 1; i < n; i++)
+        solveUpper(child(x, false, i, k), xkk, true);
+      for (int i = k + 1; i < n; i++)
+        for (int j = k + 1; j <= i; j++)
+          gemm(child(x, false, i, j), child(x, false, i, k), false, child(x, false, j, k), true);
+    }
+  }
+
+  /**
+   * HODLR factorization of x, as in hodlr.cpp: the diagonal blocks are
+   * factorized recursively, and the off-diagonal rk block of rank k adds a
+   * Woodbury correction of size 2k (k for the symmetric one), without
+   * fill-in. The non symmetric one also stores a copy of the transpose of
+   * the rk block.
+   */
+  void hodlr(Block * x, bool sym) {
+    if (!x->isNode()) {
+      flops += 1. / 3. * x->rows * x->rows * x->rows;
+      return;
+    }
+    Block * x10 = child(x, false, 1, 0);
+    HMAT_ASSERT_MSG(x->nrChildRow == 2 && x->nrChildCol == 2 && x10 && x10->isRk(), "Not HODLR matrix");
+    HMAT_ASSERT_MSG(child(x, false, 0, 1) == NULL, "Not lowered stored matrix");
+    hodlr(child(x, false, 0, 0), sym);
+    hodlr(child(x, false, 1, 1), sym);
+    const double k = x10->rank, m = x10->rows, n = x10->cols;
+    if (sym) {
+      flops += k * (hodlrSolve(child(x, false, 0, 0), true) + hodlrSolve(child(x, false, 1, 1), true));
+      // QR of a, b^T.b and the k x k triangular products and decompositions
+      flops += 2 * m * k * k + 2 * n * k * k + 10 * k * k * k;
+      extraTerms += 2 * k * k;
+    } else {
+      flops += k * (hodlrSolve(child(x, false, 0, 0), false) + hodlrSolve(child(x, false, 1, 1), false));
+      flops += 4 * (m + n) * k * k + 2. / 3. * 8 * k * k * k;
+      extraTerms += k * (m + n) + 4 * k * k;
+    }
+  }
+
+  /** Flops of the solve of a vector with a HODLR factor, only L for sym */
+  double hodlrSolve(const Block * x, bool sym) const {
+    if (!x->isNode())
+      return double(x->rows) * x->rows * (sym ? 1 : 2);
+    const Block * x10 = child(x, false, 1, 0);
+    const double k = x10->rank;
+    double f = hodlrSolve(child(x, false, 0, 0), sym) + hodlrSolve(child(x, false, 1, 1), sym);
+    if (sym)
+      f += 2 * k * (x10->rows + x10->cols) + 2 * k * k;
+    else
+      f += 4 * k * (x10->rows + x10->cols) + 8 * k * k;
+    return f;
+  }
+
+private:
+  /** Flops of the solve of a vector with the lower or upper triangle of op(d) */
+  double triangle(const Block * d, bool trans, bool lower) const {
+    if (!d->isNode())
+      return double(d->rows) * d->rows;
+    double f = 0;
+    for (int i = 0; i < nrChildRow(d, trans); i++)
+      for (int j = 0; j < nrChildCol(d, trans); j++) {
+        const Block * c = child(d, trans, i, j);
+        if (c == NULL)
+          continue;
+        if (i == j)
+          f += triangle(c, trans, lower);
+        else if ((i > j) == lower)
+          f += matVec(c);
+      }
+    return f;
+  }
+
+  /** x <- L^-1.x, L being the lower triangle of op(d) */
+  void solveLower(Block * x, const Block * d, bool trans) {
+    if (x == NULL)
+      return;
+    if (x->isRk()) {
+      flops += x->rank * triangle(d, trans, true);
+      return;
+    }
+    const int n = x->nrChildRow;
+    if (x->isFull() || !d->isNode() || nrChildRow(d, trans) != n || nrChildCol(d, trans) != n) {
+      flops += x->cols * triangle(d, trans, true);
+      return;
+    }
+    for (int j = 0; j < x->nrChildCol; j++)
+      for (int k = 0; k < n; k++) {
+        Block * xkj = child(x, false, k, j);
+        if (xkj == NULL)
+          continue;
+        solveLower(xkj, child(d, trans, k, k), trans);
+        for (int i = k + 1; i < n; i++)
+          gemm(child(x, false, i, j), child(d, trans, i, k), trans, xkj, false);
+      }
+  }
+
+  /** x <- x.U^-1, U being the upper triangle of op(d) */
+  void solveUpper(Block * x, const Block * d, bool trans) {
+    if (x == NULL)
+      return;
+    if (x->isRk()) {
+      flops += x->rank * triangle(d, trans, false);
+      return;
+    }
+    const int n = x->nrChildCol;
+    if (x->isFull() || !d->isNode() || nrChildRow(d, trans) != n || nrChildCol(d, trans) != n) {
+      flops += x->rows * triangle(d, trans, false);
+      return;
+    }
+    for (int i = 0; i < x->nrChildRow; i++)
+      for (int k = 0; k < n; k++) {
+        Block * xik = child(x, false, i, k);
+        if (xik == NULL)
+          continue;
+        solveUpper(xik, child(d, trans, k, k), trans);
+        for (int j = k + 1; j < n; j++)
+          gemm(child(x, false, i, j), xik, false, child(d, trans, k, j), trans);
+      }
+  }
+
+  /** c <- c - op(a).op(b) */
+  void gemm(Block * c, const Block * a, bool transA, const Block * b, bool transB) {
+    if (c == NULL || a == NULL || b == NULL)
+      return;
+    const double m = c->rows, n = c->cols, p = transA ? a->rows : a->cols;
+    if (a->isRk() || b->isRk()) {
+      int k;
+      if (a->isRk() && b->isRk()) {
+        k = std::min(a->rank, b->rank);
+        flops += 2 * p * a->rank * b->rank + 2 * std::min(m, n) * a->rank * b->rank;
+      } else if (a->isRk()) {
+        k = a->rank;
+        flops += k * matVec(b);
+      } else {
+        k = b->rank;
+        flops += k * matVec(a);
+      }
+      if (k > 0)
+        addRk(c, k);
+    } else if (a->isFull() && b->isFull()) {
+      flops += 2 * m * p * n;
+      addFull(c);
+    } else if (a->isFull() || b->isFull()) {
+      flops += a->isFull() ? m * matVec(b) : n * matVec(a);
+      addFull(c);
+    } else if (c->isNode() && c->nrChildRow == nrChildRow(a, transA) && c->nrChildCol == nrChildCol(b, transB)
+               && nrChildCol(a, transA) == nrChildRow(b, transB)) {
+      for (int i = 0; i < c->nrChildRow; i++)
+        for (int j = 0; j < c->nrChildCol; j++)
+          for (int l = 0; l < nrChildCol(a, transA); l++)
+            gemm(child(c, false, i, j), child(a, transA, i, l), transA, child(b, transB, l, j), transB);
+    } else if (c->isRk()) {
+      // The product of two nodes is computed as an rk matrix of the rank of c
+      const int k = std::max(c->rank, 1);
+      flops += k * (matVec(a) + matVec(b)) + truncation(m, n, 2 * k);
+    } else {
+      flops += n * matVec(a);
+      addFull(c);
+    }
+  }
+
+  /** c <- c + an rk matrix of rank k */
+  void addRk(Block * c, int k) {
+    if (c == NULL)
+      return;
+    if (c->isFull()) {
+      flops += 2. * c->rows * c->cols * k;
+    } else if (c->isRk()) {
+      flops += truncation(c->rows, c->cols, c->rank + k);
+      c->rank = std::min(std::max(c->rank, k), std::min(c->rows, c->cols));
+    } else {
+      for (size_t i = 0; i < c->children.size(); i++)
+        addRk(c->children[i], k);
+    }
+  }
+
+  /** c <- c + a full matrix */
+  void addFull(Block * c) {
+    if (c == NULL)
+      return;
+    if (c->isFull()) {
+      flops += double(c->rows) * c->cols;
+    } else if (c->isRk()) {
+      // Compression of the sum, of the rank of c
+      flops += 4. * c->rows * c->cols * std::max(c->rank, 1);
+    } else {
+      for (size_t i = 0; i < c->children.size(); i++)
+        addFull(c->children[i]);
+    }
+  }
+};
+
+/** The rk leaves with more rows + cols than the root divided by this are not sampled */
+const int sampleDimDivisor = 8;
+
+int dim(const Block * b) {
+  return b->rows + b->cols;
+}
+
+/** Least squares fit of the rank as c.(rows + cols)^e, the growth of the rank with the block size */
+class RankFit {
+  double logC_, e_;
+public:
+  RankFit(const std::vector<double> & dims, const std::vector<int> & ranks) : logC_(0), e_(0) {
+    double n = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+    for (size_t i = 0; i < dims.size(); i++) {
+      if (ranks[i] <= 0)
+        continue;
+      const double x = log(dims[i]), y = log((double) ranks[i]);
+      n++;
+      sx += x;
+      sy += y;
+      sxx += x * x;
+      sxy += x * y;
+    }
+    const double d = n * sxx - sx * sx;
+    if (n > 0)
+      logC_ = sy / n;
+    if (n > 1 && d > 0) {
+      e_ = std::max(0., (n * sxy - sx * sy) / d);
+      logC_ = (sy - e_ * sx) / n;
+    }
+  }
+  int rank(double dim) const {
+    return (int) ceil(exp(logC_ + e_ * log(dim)));
+  }
+};
+
+template<typename T>
+struct BySize {
+  typedef std::pair<const hmat::HMatrix<T>*, Block*> Leaf;
+  bool operator()(const Leaf & a, const Leaf & b) const {
+    return a.second->rows + a.second->cols < b.second->rows + b.second->cols;
+  }
+};
+
+}  // end anonymous namespace
+
+namespace hmat {
+
+template<typename T>
+void estimateCost(HMatrix<T> * h, Assembly<T> & assembly, Factorization algo, int samples,
+                  hmat_cost_estimate_t & result) {
+  DECLARE_CONTEXT;
+  HMAT_ASSERT_MSG(samples > 0, "At least one rk leaf must be sampled");
+  memset(&result, 0, sizeof(result));
+  // Flops of a complex multiply-add counted in real arithmetic
+  const double flopFactor = Types<T>::IS_REAL::value ? 1 : 4;
+  std::vector<std::pair<const HMatrix<T>*, Block*> > rkLeaves;
+  std::vector<const HMatrix<T>*> fullLeaves;
+  Block * root = build(h, rkLeaves, fullLeaves);
+
+  // Compress samples evenly spread in the rk leaves sorted by size, up to
+  // maxSampleDim rows + cols so that the dry run stays much cheaper than the
+  // assembly, whose cost is dominated by the few largest blocks.
+  std::stable_sort(rkLeaves.begin(), rkLeaves.end(), BySize<T>());
+  const int nbRk = rkLeaves.size();
+  const int maxSampleDim = (root->rows + root->cols) / sampleDimDivisor;
+  int nbSampled = 0;
+  while (nbSampled < nbRk && (nbSampled == 0 || dim(rkLeaves[nbSampled].second) <= maxSampleDim))
+    nbSampled++;
+  const int nbRkSamples = std::min(samples, nbSampled);
+  std::vector<int> sampleRank(nbRkSamples);
+  std::vector<double> sampleTime(nbRkSamples), sampleDim(nbRkSamples);
+  for (int s = 0; s < nbRkSamples; s++) {
+    const HMatrix<T> * leaf = rkLeaves[((2 * (size_t)s + 1) * nbSampled) / (2 * nbRkSamples)].first;
+    FullMatrix<T> * full = NULL;
+    RkMatrix<T> * rk = NULL;
+    const Time start = now();
+    assembly.assemble(leaf->localSettings, *leaf->rowsTree(), *leaf->colsTree(), true, full, rk,
+                      leaf->lowRankEpsilon());
+    sampleTime[s] = time_diff(start, now());
+    sampleDim[s] = leaf->rows()->size() + leaf->cols()->size();
+    sampleRank[s] = full ? (int) Block::FULL : rk ? rk->rank() : 0;
+    delete full;
+    delete rk;
+  }
+  for (int p = 0; p < nbSampled; p++) {
+    Block * b = rkLeaves[p].second;
+    const int s = ((size_t)p * nbRkSamples) / nbSampled;
+    b->rank = sampleRank[s] == Block::FULL ? (int) Block::FULL : std::min(sampleRank[s], std::min(b->rows, b->cols));
+    result.assembly_time += sampleTime[s] * dim(b) / sampleDim[s];
+  }
+  // The rank of the larger leaves is extrapolated from the samples, and the
+  // time of the largest sample is scaled by (rows + cols) * rank^2, the cost
+  // of the orthogonalizations of ACA and of the recompression.
+  const RankFit fit(sampleDim, sampleRank);
+  const int last = nbRkSamples - 1;
+  for (int p = nbSampled; p < nbRk; p++) {
+    Block * b = rkLeaves[p].second;
+    if (sampleRank[last] == Block::FULL) {
+      b->rank = Block::FULL;
+      result.assembly_time += sampleTime[last] * dim(b) / sampleDim[last];
+    } else {
+      b->rank = std::min(std::max(fit.rank(dim(b)), sampleRank[last]), std::min(b->rows, b->cols));
+      const double ratio = double(std::max(b->rank, 1)) / std::max(sampleRank[last], 1);
+      result.assembly_time += sampleTime[last] * dim(b) / sampleDim[last] * ratio * ratio;
+    }
+  }
+  result.sampled_rk_blocks = nbRkSamples;
+
+  // Kernel time per entry and dense flop rate from the full leaves
+  const int nbFull = fullLeaves.size();
+  const int nbFullSamples = std::min(samples, nbFull);
+  double fullTime = 0, fullEntries = 0, fullSize = 0;
+  for (size_t i = 0; i < fullLeaves.size(); i++)
+    fullSize += double(fullLeaves[i]->rows()->size()) * fullLeaves[i]->cols()->size();
+  FullMatrix<T> * largest = NULL;
+  for (int s = 0; s < nbFullSamples; s++) {
+    const HMatrix<T> * leaf = fullLeaves[((2 * (size_t)s + 1) * nbFull) / (2 * nbFullSamples)];
+    FullMatrix<T> * full = NULL;
+    RkMatrix<T> * rk = NULL;
+    const Time start = now();
+    assembly.assemble(leaf->localSettings, *leaf->rowsTree(), *leaf->colsTree(), false, full, rk,
+                      leaf->lowRankEpsilon());
+    fullTime += time_diff(start, now());
+    fullEntries += double(leaf->rows()->size()) * leaf->cols()->size();
+    delete rk;
+    if (full && full->rows() == full->cols() && (largest == NULL || full->rows() > largest->rows())) {
+      delete largest;
+      largest = full;
+    } else {
+      delete full;
+    }
+  }
+  if (fullEntries > 0)
+    result.assembly_time += fullTime * fullSize / fullEntries;
+  result.sampled_full_blocks = nbFullSamples;
+  double flopRate = 0;
+  if (largest && algo != Factorization::NONE) {
+    const double n = largest->rows();
+    try {
+      // The first call of LAPACK may initialize it, it is not timed
+      FullMatrix<T> * warmUp = largest->copy();
+      warmUp->luDecomposition();
+      delete warmUp;
+      const Time start = now();
+      largest->luDecomposition();
+      const double t = time_diff(start, now());
+      if (t > 0)
+        flopRate = 2. / 3. * n * n * n * flopFactor / t;
+    } catch (const std::exception &) {
+      // A singular block, the time is unknown
+    }
+  }
+  delete largest;
+
+  info(root, result.info);
+  result.assembled_bytes = (double) result.info.compressed_size * sizeof(T);
+
+  if (algo != Factorization::NONE) {
+    Simulation simulation;
+    const double n = root->rows;
+    const bool hodlr = algo == Factorization::HODLR || algo == Factorization::HODLRSYM;
+    if (algo == Factorization::LU)
+      simulation.lu(root);
+    else if (hodlr)
+      simulation.hodlr(root, algo == Factorization::HODLRSYM);
+    else
+      simulation.llt(root);
+    const double factorTerms = terms(root) + simulation.extraTerms;
+    result.factorized_bytes = factorTerms * sizeof(T);
+    if (algo == Factorization::LU)
+      result.factorized_bytes += n * sizeof(int);
+    else if (algo == Factorization::LDLT)
+      result.factorized_bytes += n * sizeof(T);
+    result.factorization_flops = simulation.flops * flopFactor;
+    if (flopRate > 0)
+      result.factorization_time = result.factorization_flops / flopRate;
+    if (hodlr)
+      result.solve_flops = simulation.hodlrSolve(root, algo == Factorization::HODLRSYM)
+          * (algo == Factorization::HODLRSYM ? 2 : 1) * flopFactor;
+    else
+      // Each term of L and U is used once, each term of L twice for L.L^T
+      result.solve_flops = (algo == Factorization::LU ? 2 : 4) * terms(root) * flopFactor;
+  }
+  delete root;
+}
+
+// Explicit template instantiation
+template void estimateCost(HMatrix<S_t> * h, Assembly<S_t> & assembly, Factorization algo, int samples,
+                           hmat_cost_estimate_t & result);
+template void estimateCost(HMatrix<D_t> * h, Assembly<D_t> & assembly, Factorization algo, int samples,
+                           hmat_cost_estimate_t & result);
+template void estimateCost(HMatrix<C_t> * h, Assembly<C_t> & assembly, Factorization algo, int samples,
+                           hmat_cost_estimate_t & result);
+template void estimateCost(HMatrix<Z_t> * h, Assembly<Z_t> & assembly, Factorization algo, int samples,
+                           hmat_cost_estimate_t & result);
+
+}  // end namespace hmat
@@ -0,0 +1,74 @@
+/*
+  HMat-OSS (HMatrix library, open source software)
+
+  Copyright (C) 2014-2015 Airbus Group SAS
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+  http://github.com/jeromerobert/hmat-oss
+*/
+
+/*! \file
+  \ingroup HMatrix
+  \brief Estimate of the memory and of the cost of a HMatrix from its block structure.
+*/
+#ifndef _HMAT_COST_ESTIMATOR_HPP
+#define _HMAT_COST_ESTIMATOR_HPP
+
+#include "hmat/hmat.h"
+#include "scalar_array.hpp"
+
+namespace hmat {
+
+template<typename T> class HMatrix;
+template<typename T> class Assembly;
+
+/*! \brief Estimate the assembly and the factorization of an empty HMatrix.
+
+  The rk leaves are sorted by size and samples of them, evenly spread in
+  this order, are compressed with assembly. Each rk leaf gets the rank of
+  the sample of closest size, and the assembly time of this sample scaled
+  by rows + cols, as ACA and the SVD of the panels are linear in the block
+  dimension for a given rank. The leaves larger than an eighth of the
+  root, in rows + cols, are not sampled: their rank is extrapolated from
+  the samples as c.(rows + cols)^e, and their time from the largest
+  sample scaled by (rows + cols) * rank^2. A few full leaves are assembled to get the
+  kernel time per entry, and the LU decomposition of the largest one gives
+  the dense flop rate.
+
+  The factorization is then simulated on a copy of the block structure
+  holding only the sizes and the ranks, with the recursions of the
+  HMatrix factorizations. The product of an rk block of rank k and of any
+  block B costs k products of B by a vector, and its sum into an rk block
+  of rank kc costs the truncation of a rank kc + k matrix, whose rank is
+  then max(kc, k). Full products and decompositions have their BLAS and
+  LAPACK costs. The HODLR factorizations, which have no fill-in, follow
+  the Woodbury recursion of hodlr.cpp instead.
+
+  The sampled blocks are freed, h is left empty.
+
+  \param h an empty HMatrix
+  \param assembly the assembly which would be given to HMatrix::assemble()
+  \param algo the factorization to estimate, Factorization::NONE for only the assembly
+  \param samples the number of rk leaves to compress
+  \param result the estimate
+ */
+template<typename T>
+void estimateCost(HMatrix<T> * h, Assembly<T> & assembly, Factorization algo, int samples,
+                  hmat_cost_estimate_t & result);
+
+}  // end namespace hmat
+
+#endif
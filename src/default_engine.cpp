@@ -22,6 +22,7 @@
 
 #include "default_engine.hpp"
 #include "hmat_cpp_interface.hpp"
+#include "selected_inversion.hpp"
 #include "common/context.hpp"
 #include "common/my_assert.h"
 #include "hmat/hmat.h"
@@ -148,6 +149,27 @@ template<typename T> typename Types<T>::dp DefaultEngine<T>::logdet() const {
   }
 }
 
+template<typename T>
+void DefaultEngine<T>::inverseDiagonal(ScalarArray<T>& d, Factorization algo) const {
+  if(algo == Factorization::HODLR || algo == Factorization::HODLRSYM) {
+    this->hodlr.inverseDiagonal(this->hmat, d);
+  } else {
+    SelectedInversion<T>(this->hmat, algo).diagonal(d);
+  }
+}
+
+template<typename T>
+void DefaultEngine<T>::inverseBlocks(const std::vector<std::vector<int> >& indices,
+                                     std::vector<ScalarArray<T>*>& blocks, Factorization algo) const {
+  if(algo == Factorization::HODLR || algo == Factorization::HODLRSYM) {
+    this->hodlr.inverseBlocks(this->hmat, indices, blocks);
+  } else {
+    SelectedInversion<T> inversion(this->hmat, algo);
+    for(size_t i = 0; i < indices.size(); i++)
+      inversion.block(indices[i], *blocks[i]);
+  }
+}
+
 template<typename T> double DefaultEngine<T>::norm() const {
   return this->hmat->norm();
 }
@@ -220,6 +242,16 @@ void DefaultEngine<T>::solve(IEngine<T>& b, Factorization f) const {
     this->hmat->solve(b.hmat, f);
 }
 
+template<typename T>
+void DefaultEngine<T>::solveSparse(ScalarArray<T>& b, Factorization algo, const std::vector<IndexSet>* nonZeroRows,
+                                  const std::vector<IndexSet>* requestedRows) const {
+  if (algo == Factorization::HODLR || algo == Factorization::HODLRSYM)
+    // The HODLR solvers apply dense corrections at each level, there is nothing to prune
+    solve(b, algo);
+  else
+    this->hmat->solveSparse(&b, algo, nonZeroRows, requestedRows);
+}
+
 template<typename T>
 void DefaultEngine<T>::solveLower(ScalarArray<T>& b, Factorization algo, bool transpose) const {
   HMAT_ASSERT_MSG(algo != Factorization::HODLR, "solver lower not supported for non-symetric HODLR.");
@@ -33,6 +33,7 @@ namespace hmat {
 template<typename T> class DefaultEngine : public IEngine<T>
 {
   NullSettings settings;
+protected:
   HODLR<T> hodlr;
 public:
   ~DefaultEngine(){}
@@ -54,6 +55,8 @@ public:
   void solve(ScalarArray<T>& b, Factorization) const override;
   void solve(IEngine<T>& b, Factorization) const override ;
   void solveLower(ScalarArray<T>& b, Factorization t, bool transpose=false) const override;
+  void solveSparse(ScalarArray<T>& b, Factorization, const std::vector<IndexSet>* nonZeroRows,
+                   const std::vector<IndexSet>* requestedRows) const override;
   void copy(IEngine<T> & result, bool structOnly) const override;
   void transpose() override;
   void applyOnLeaf(const hmat::LeafProcedure<hmat::HMatrix<T> >&f) override;
@@ -62,6 +65,9 @@ public:
   void scale(T alpha) override;
   void info(hmat_info_t &i) const override;
   typename Types<T>::dp logdet() const override;
+  void inverseDiagonal(ScalarArray<T>& d, Factorization) const override;
+  void inverseBlocks(const std::vector<std::vector<int> >& indices, std::vector<ScalarArray<T>*>& blocks,
+                     Factorization) const override;
   double norm() const override;
 };
 
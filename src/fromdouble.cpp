@@ -21,6 +21,8 @@
 */
 
 #include "fromdouble.hpp"
+#include "h_matrix.hpp"
+#include "common/my_assert.h"
 #include <assert.h>
 
 namespace hmat {
@@ -99,4 +101,43 @@ template<typename T> RkMatrix<T>* fromDoubleRk(RkMatrix<typename Types<T>::dp>*
 template RkMatrix<S_t>* fromDoubleRk(RkMatrix<Types<S_t>::dp>* rk);
 template RkMatrix<C_t>* fromDoubleRk(RkMatrix<Types<C_t>::dp>* rk);
 
+template<typename T> HMatrix<T>* fromDoubleHMatrix(const HMatrix<typename Types<T>::dp>* h) {
+  HMAT_ASSERT_MSG(!h->isTriLower && !h->isTriUpper, "Factorized matrices cannot be converted");
+  HMatrix<T>* result = new HMatrix<T>(h->localSettings.global);
+  result->setClusterTrees(h->rowsTree(), h->colsTree());
+  result->lowRankEpsilon(h->lowRankEpsilon(), false);
+  result->isUpper = h->isUpper;
+  result->isLower = h->isLower;
+  result->keepSameRows = h->keepSameRows;
+  result->keepSameCols = h->keepSameCols;
+  result->approximateRank(h->approximateRank());
+  if (h->isLeaf()) {
+    if (h->isRkMatrix()) {
+      const RkMatrix<typename Types<T>::dp>* rk = h->rk();
+      // The panels are converted without deleting them
+      result->rk(rk == NULL ? NULL : new RkMatrix<T>(
+          fromDoubleScalarArray<T>(rk->a, false), rk->rows,
+          fromDoubleScalarArray<T>(rk->b, false), rk->cols));
+    } else if (h->isNull()) {
+      result->full(NULL);
+    } else {
+      const FullMatrix<typename Types<T>::dp>* f = h->full();
+      HMAT_ASSERT_MSG(f->pivots == NULL && f->diagonal == NULL, "Factorized matrices cannot be converted");
+      FullMatrix<T>* full = new FullMatrix<T>(f->rows_, f->cols_, false);
+      for (int j = 0; j < f->cols(); ++j)
+        for (int i = 0; i < f->rows(); ++i)
+          full->get(i, j) = T(f->get(i, j));
+      result->full(full);
+    }
+    return result;
+  }
+  for (int i = 0; i < h->nrChild(); i++)
+    result->insertChild(i, h->getChild(i) ? fromDoubleHMatrix<T>(h->getChild(i)) : NULL);
+  result->assembled();
+  return result;
+}
+
+template HMatrix<S_t>* fromDoubleHMatrix(const HMatrix<Types<S_t>::dp>* h);
+template HMatrix<C_t>* fromDoubleHMatrix(const HMatrix<Types<C_t>::dp>* h);
+
 }  // end namespace hmat
@@ -56,5 +56,14 @@ template<typename T> FullMatrix<T>* fromDoubleFull(FullMatrix<typename Types<T>:
     */
 template<typename T> RkMatrix<T>* fromDoubleRk(RkMatrix<typename Types<T>::dp>* rk);
 
+template<typename T> class HMatrix;
+
+  /** \brief Returns a conversion of the HMatrix 'h' in arithmetics 'T'
+
+    h is of type T::dp, it is not modified and must not be factorized. The
+    result has the same structure and shares the cluster trees of h.
+    */
+template<typename T> HMatrix<T>* fromDoubleHMatrix(const HMatrix<typename Types<T>::dp>* h);
+
 }  // end namespace hmat
 
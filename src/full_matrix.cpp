@@ -88,10 +88,12 @@ FullMatrix<T>::FullMatrix(const IndexSet*  _rows, const IndexSet*  _cols, bool z
     rows_(_rows), cols_(_cols), pivots(NULL), diagonal(NULL) {
   assert(rows_);
   assert(cols_);
+  data.memoryCategory(MemoryCounters::FULL);
 }
 
 template<typename T> FullMatrix<T>::~FullMatrix() {
   if (pivots) {
+    MemoryCounters::add(MemoryCounters::PIVOTS, -(ptrdiff_t)(data.rows * sizeof(int)));
     free(pivots);
   }
   if (diagonal) {
@@ -136,6 +138,7 @@ template<typename T> FullMatrix<T>* FullMatrix<T>::copy(FullMatrix<T>* result) c
   if (diagonal) {
     if(!result->diagonal)
       result->diagonal = new Vector<T>(rows());
+    result->diagonal->memoryCategory(MemoryCounters::PIVOTS);
     diagonal->copy(result->diagonal);
   }
 
@@ -186,6 +189,7 @@ void FullMatrix<T>::ldltDecomposition() {
   HMAT_ASSERT(rows() == cols());
   diagonal = new Vector<T>(rows());
   HMAT_ASSERT(diagonal);
+  diagonal->memoryCategory(MemoryCounters::PIVOTS);
   data.ldltDecomposition(*diagonal);
 
   triLower_ = true;
@@ -210,6 +214,7 @@ void FullMatrix<T>::luDecomposition() {
 
   pivots = (int*) calloc(rows(), sizeof(int));
   HMAT_ASSERT(pivots);
+  MemoryCounters::add(MemoryCounters::PIVOTS, rows() * sizeof(int));
   data.luDecomposition(pivots);
 }
 
@@ -0,0 +1,291 @@
+/*
+  HMat-OSS (HMatrix library, open source software)
+
+  Copyright (C) 2014-2015 Airbus Group SAS
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+  http://github.com/jeromerobert/hmat-oss
+*/
+
+#include "graph_clustering.hpp"
+#include "cluster_tree.hpp"
+#include "coordinates.hpp"
+#include "common/my_assert.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <unordered_map>
+
+namespace {
+
+/*! \brief Subgraph induced by the DOFs of a cluster, with local numbering
+ */
+struct Subgraph {
+  std::vector<int> xadj;
+  std::vector<int> adj;
+
+  int size() const { return (int)xadj.size() - 1; }
+  int degree(int v) const { return xadj[v + 1] - xadj[v]; }
+
+  /*! \brief Breadth-first search from root.
+      \param level level of each reached vertex, other vertices must be -1
+      \param order filled with the reached vertices in visit order
+      \return the number of levels
+   */
+  int levels(int root, std::vector<int>& level, std::vector<int>& order) const {
+    order.clear();
+    level[root] = 0;
+    order.push_back(root);
+    for (size_t head = 0; head < order.size(); ++head) {
+      const int v = order[head];
+      for (int k = xadj[v]; k < xadj[v + 1]; ++k) {
+        if (level[adj[k]] < 0) {
+          level[adj[k]] = level[v] + 1;
+          order.push_back(adj[k]);
+        }
+      }
+    }
+    return level[order.back()] + 1;
+  }
+};
+
+/*! \brief Assign each vertex of g to side 0, 1 or 2 (separator).
+
+  Both sides 0 and 1 are non empty when g has at least 2 vertices.
+ */
+void bisect(const Subgraph& g, std::vector<char>& side)
+{
+  const int n = g.size();
+  side.assign(n, 0);
+  std::vector<int> level(n, -1);
+  std::vector<int> order;
+
+  // Give each component of a disconnected graph to the smallest side
+  g.levels(0, level, order);
+  if ((int)order.size() < n) {
+    int sizes[2] = {(int)order.size(), 0};
+    for (int v = 1; v < n; ++v) {
+      if (level[v] >= 0)
+        continue;
+      g.levels(v, level, order);
+      const int s = sizes[1] < sizes[0] ? 1 : 0;
+      for (size_t i = 0; i < order.size(); ++i)
+        side[order[i]] = s;
+      sizes[s] += order.size();
+    }
+    return;
+  }
+
+  // Find a pseudo-peripheral vertex (George & Liu)
+  int height = level[order.back()] + 1;
+  std::vector<int> candidateLevel;
+  std::vector<int> candidateOrder;
+  for (int iter = 0; iter < 8; ++iter) {
+    int candidate = order.back();
+    for (int i = (int)order.size() - 1; i >= 0 && level[order[i]] == height - 1; --i)
+      if (g.degree(order[i]) <= g.degree(candidate))
+        candidate = order[i];
+    candidateLevel.assign(n, -1);
+    const int candidateHeight = g.levels(candidate, candidateLevel, candidateOrder);
+    if (candidateHeight <= height)
+      break;
+    height = candidateHeight;
+    level.swap(candidateLevel);
+    order.swap(candidateOrder);
+  }
+
+  if (height < 3) {
+    // No separating level, cut the visit order in two halves
+    for (int i = n / 2; i < n; ++i)
+      side[order[i]] = 1;
+    return;
+  }
+
+  // Choose the smallest level which leaves at least a quarter of the
+  // vertices on each side, or the most balanced one
+  std::vector<int> count(height, 0);
+  for (int v = 0; v < n; ++v)
+    count[level[v]]++;
+  int best = -1;
+  bool bestBalanced = false;
+  int bestImbalance = n;
+  int below = count[0];
+  for (int s = 1; s < height - 1; ++s) {
+    const int above = n - below - count[s];
+    const int imbalance = std::abs(above - below);
+    const bool balanced = 4 * std::min(below, above) >= n;
+    bool better;
+    if (best < 0 || balanced != bestBalanced)
+      better = best < 0 || balanced;
+    else if (balanced)
+      better = count[s] < count[best] || (count[s] == count[best] && imbalance < bestImbalance);
+    else
+      better = imbalance < bestImbalance;
+    if (better) {
+      best = s;
+      bestBalanced = balanced;
+      bestImbalance = imbalance;
+    }
+    below += count[s];
+  }
+
+  // Only the vertices of the level which touch the next one separate the sides
+  for (int v = 0; v < n; ++v) {
+    if (level[v] > best) {
+      side[v] = 1;
+    } else if (level[v] == best) {
+      for (int k = g.xadj[v]; k < g.xadj[v + 1]; ++k) {
+        if (level[g.adj[k]] > best) {
+          side[v] = 2;
+          break;
+        }
+      }
+    }
+  }
+}
+
+}
+
+namespace hmat {
+
+DofGraph::DofGraph(int size, const int* rowPtr, const int* colInd)
+  : rowPtr_(size + 1, 0)
+{
+  HMAT_ASSERT(size >= 0);
+  colInd_.reserve(rowPtr[size] - rowPtr[0]);
+  for (int i = 0; i < size; ++i) {
+    for (int k = rowPtr[i]; k < rowPtr[i + 1]; ++k) {
+      const int j = colInd[k - rowPtr[0]];
+      HMAT_ASSERT_MSG(j >= 0 && j < size, "Invalid neighbour %d of DOF %d", j, i);
+      if (j != i)
+        colInd_.push_back(j);
+    }
+    rowPtr_[i + 1] = colInd_.size();
+  }
+}
+
+int DofGraph::distances(int from, std::vector<int>& distance) const
+{
+  distance.assign(size(), -1);
+  std::vector<int> queue(1, from);
+  distance[from] = 0;
+  bfs(queue, distance);
+  return queue.back();
+}
+
+DofCoordinates* DofGraph::landmarkCoordinates(int dimension) const
+{
+  const int n = size();
+  std::vector<double> coord((size_t)n * dimension + 1);
+  std::vector<int> distance(n, -1);
+  std::vector<int> minDistance(n, -1);
+  std::vector<int> component;
+  // Components are 2n apart on each axis, farther than any graph distance
+  double origin = 0;
+  for (int first = 0; first < n; ++first) {
+    if (minDistance[first] >= 0)
+      continue;
+    // The landmarks of a component are taken inside it
+    component.assign(1, first);
+    distance[first] = 0;
+    bfs(component, distance);
+    int landmark = component.back();
+    for (size_t k = 0; k < component.size(); ++k)
+      minDistance[component[k]] = std::numeric_limits<int>::max();
+    for (int d = 0; d < dimension; ++d) {
+      for (size_t k = 0; k < component.size(); ++k)
+        distance[component[k]] = -1;
+      component.assign(1, landmark);
+      distance[landmark] = 0;
+      bfs(component, distance);
+      for (size_t k = 0; k < component.size(); ++k) {
+        const int i = component[k];
+        coord[(size_t)i * dimension + d] = origin + distance[i];
+        minDistance[i] = std::min(minDistance[i], distance[i]);
+      }
+      for (size_t k = 0; k < component.size(); ++k) {
+        if (minDistance[component[k]] > minDistance[landmark])
+          landmark = component[k];
+      }
+    }
+    origin += 2. * n;
+  }
+  return new DofCoordinates(&coord[0], dimension, n, true);
+}
+
+void DofGraph::bfs(std::vector<int>& queue, std::vector<int>& distance) const
+{
+  for (size_t head = 0; head < queue.size(); ++head) {
+    const int v = queue[head];
+    for (const int* it = neighboursBegin(v); it != neighboursEnd(v); ++it) {
+      if (distance[*it] < 0) {
+        distance[*it] = distance[v] + 1;
+        queue.push_back(*it);
+      }
+    }
+  }
+}
+
+int
+GraphNestedDissectionAlgorithm::partition(ClusterTree& current, std::vector<ClusterTree*>& children,
+                                          int) const
+{
+  const int offset = current.data.offset();
+  const int n = current.data.size();
+  int* indices = current.data.indices() + offset;
+
+  std::unordered_map<int, int> local;
+  local.reserve(n);
+  for (int i = 0; i < n; ++i)
+    local[indices[i]] = i;
+  Subgraph g;
+  g.xadj.resize(n + 1, 0);
+  for (int i = 0; i < n; ++i) {
+    for (const int* it = graph_->neighboursBegin(indices[i]); it != graph_->neighboursEnd(indices[i]); ++it) {
+      std::unordered_map<int, int>::const_iterator found = local.find(*it);
+      if (found != local.end())
+        g.adj.push_back(found->second);
+    }
+    g.xadj[i + 1] = g.adj.size();
+  }
+
+  std::vector<char> side;
+  bisect(g, side);
+
+  // Reorder the DOFs as side 0, side 1 then separator
+  std::vector<int> sorted;
+  sorted.reserve(n);
+  int sizes[3] = {0, 0, 0};
+  for (int s = 0; s < 3; ++s) {
+    for (int i = 0; i < n; ++i) {
+      if (side[i] == s) {
+        sorted.push_back(indices[i]);
+        sizes[s]++;
+      }
+    }
+  }
+  std::copy(sorted.begin(), sorted.end(), indices);
+  int start = offset;
+  for (int s = 0; s < 3; ++s) {
+    if (sizes[s] > 0)
+      children.push_back(current.slice(start, sizes[s]));
+    start += sizes[s];
+  }
+  return -1; // there is no partition axis
+}
+
+}  // end namespace hmat
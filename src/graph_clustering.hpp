@@ -0,0 +1,111 @@
+/*
+  HMat-OSS (HMatrix library, open source software)
+
+  Copyright (C) 2014-2015 Airbus Group SAS
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+  http://github.com/jeromerobert/hmat-oss
+*/
+
+/*! \file
+  \ingroup Clustering
+  \brief Algebraic clustering of the Dofs from their adjacency graph.
+*/
+#ifndef _HMAT_GRAPH_CLUSTERING_HPP
+#define _HMAT_GRAPH_CLUSTERING_HPP
+
+#include "clustering.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace hmat {
+
+class DofCoordinates;
+
+/*! \brief Adjacency graph of the DOFs in CSR format.
+
+  The graph must be symmetric, self loops are ignored.
+ */
+class DofGraph {
+public:
+  /*! \brief Copy a graph.
+
+      \param size number of DOFs
+      \param rowPtr array of size+1 offsets in colInd
+      \param colInd neighbours of DOF i are colInd[rowPtr[i]] to colInd[rowPtr[i+1]-1]
+   */
+  DofGraph(int size, const int* rowPtr, const int* colInd);
+
+  int size() const { return (int)rowPtr_.size() - 1; }
+  const int* neighboursBegin(int dof) const { return colInd_.data() + rowPtr_[dof]; }
+  const int* neighboursEnd(int dof) const { return colInd_.data() + rowPtr_[dof + 1]; }
+
+  /*! \brief Breadth-first search from a DOF.
+      \param distance filled with the graph distance to from, or -1 if not reachable
+      \return the last DOF reached
+   */
+  int distances(int from, std::vector<int>& distance) const;
+
+  /*! \brief Build coordinates from graph distances.
+
+    The coordinates of a DOF are its distances to dimension landmark DOFs,
+    each landmark being the DOF farthest from the previous ones. A
+    difference of coordinates is a lower bound of the graph distance, so
+    geometric admissibility conditions measure graph distances. Each
+    connected component has its own landmarks, and the components are
+    translated 2 size() apart, so that they are farther from each other than
+    any two connected DOFs.
+   */
+  DofCoordinates* landmarkCoordinates(int dimension) const;
+
+private:
+  /*! \brief Breadth-first search from the DOFs of queue, whose distance
+      is set. Only the reached DOFs are visited, they are appended to queue.
+   */
+  void bfs(std::vector<int>& queue, std::vector<int>& distance) const;
+
+  std::vector<int> rowPtr_;
+  std::vector<int> colInd_;
+};
+
+/*! \brief Creating tree by nested dissection of the DOF graph.
+
+  Disconnected clusters are split between their connected components.
+  Otherwise a level structure is built from a pseudo-peripheral DOF and the
+  smallest level which keeps both sides balanced becomes the separator.
+  Children are the two sides, which are not connected to each other, and
+  the separator, so that LU factors keep the sparsity of the domain blocks.
+  Clusters whose level structure is too shallow are split in two halves.
+ */
+class GraphNestedDissectionAlgorithm : public ClusteringAlgorithm
+{
+public:
+  explicit GraphNestedDissectionAlgorithm(const std::shared_ptr<const DofGraph>& graph)
+    : graph_(graph) {}
+
+  ClusteringAlgorithm* clone() const { return new GraphNestedDissectionAlgorithm(*this); }
+  std::string str() const { return "GraphNestedDissectionAlgorithm"; }
+
+  int partition(ClusterTree& current, std::vector<ClusterTree*>& children, int currentAxis) const;
+
+private:
+  std::shared_ptr<const DofGraph> graph_;
+};
+
+}  // end namespace hmat
+
+#endif  /* _HMAT_GRAPH_CLUSTERING_HPP */
@@ -0,0 +1,543 @@
+/*
+  HMat-OSS (HMatrix library, open source software)
+
+  Copyright (C) 2014-2015 Airbus Group SAS
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+  http://github.com/jeromerobert/hmat-oss
+*/
+
+#include "h2_matrix.hpp"
+#include "h_matrix.hpp"
+#include "rk_matrix.hpp"
+#include "full_matrix.hpp"
+#include "cluster_tree.hpp"
+#include "common/context.hpp"
+#include "common/my_assert.h"
+#include "common/memory_instrumentation.hpp"
+
+#include <algorithm>
+#include <map>
+
+namespace hmat {
+
+template<typename T>
+int H2Matrix<T>::createNodes(const ClusterTree * cluster, int rootOffset, std::vector<Basis> & tree) {
+  const int index = tree.size();
+  Basis b;
+  b.offset = cluster->data.offset() - rootOffset;
+  b.size = cluster->data.size();
+  b.rank = 0;
+  b.leaf = NULL;
+  b.transfer = NULL;
+  tree.push_back(b);
+  for (int i = 0; i < cluster->nrChild(); i++) {
+    if (cluster->getChild(i)) {
+      const int child = createNodes(cluster->getChild(i), rootOffset, tree);
+      tree[index].children.push_back(child);
+    }
+  }
+  return index;
+}
+
+template<typename T>
+int H2Matrix<T>::findNode(const std::vector<Basis> & tree, int offset, int size) {
+  int node = 0;
+  while (tree[node].offset != offset || tree[node].size != size) {
+    const std::vector<int> & children = tree[node].children;
+    size_t i = 0;
+    while (i < children.size() && !(tree[children[i]].offset <= offset &&
+           offset + size <= tree[children[i]].offset + tree[children[i]].size))
+      i++;
+    HMAT_ASSERT_MSG(i < children.size(), "Block [%d, %d] is not a cluster", offset, offset + size);
+    node = children[i];
+  }
+  return node;
+}
+
+template<typename T>
+void H2Matrix<T>::collect(const HMatrix<T> * h, char trans, const HMatrix<T> * root,
+                          std::vector<LowRank> & blocks,
+                          std::vector<const HMatrix<T> *> & nearBlocks) {
+  if (h->isVoid())
+    return;
+  if (h->isLeaf()) {
+    if (h->isNull() || (h->isRkMatrix() && (h->rk() == NULL || h->rank() == 0)))
+      return;
+    const bool mirror = trans != 'N';
+    const int rowsOffset = h->rows()->offset() - root->rows()->offset();
+    const int colsOffset = h->cols()->offset() - root->cols()->offset();
+    if (h->isRkMatrix()) {
+      // Rk block of op(root)
+      LowRank l;
+      l.rows = mirror ? findNode(rowBasis_, colsOffset, h->cols()->size())
+                      : findNode(rowBasis_, rowsOffset, h->rows()->size());
+      l.cols = mirror ? findNode(colBasis(), rowsOffset, h->rows()->size())
+                      : findNode(colBasis(), colsOffset, h->cols()->size());
+      l.a = mirror ? h->rk()->b : h->rk()->a;
+      l.b = mirror ? h->rk()->a : h->rk()->b;
+      l.block = h;
+      l.mirror = mirror;
+      blocks.push_back(l);
+    } else {
+      Near n;
+      n.rowsOffset = rowsOffset;
+      n.rowsSize = h->rows()->size();
+      n.colsOffset = colsOffset;
+      n.colsSize = h->cols()->size();
+      n.mirror = mirror;
+      n.data = NULL;
+      n.owner = false;
+      near_.push_back(n);
+      nearBlocks.push_back(h);
+    }
+    return;
+  }
+  // Same traversal as HMatrix::gemv
+  for (int i = 0, iend = (trans == 'N' ? h->nrChildRow() : h->nrChildCol()); i < iend; i++) {
+    for (int j = 0, jend = (trans == 'N' ? h->nrChildCol() : h->nrChildRow()); j < jend; j++) {
+      char t = trans;
+      const HMatrix<T> * child = h->getChildForGEMM(t, i, j);
+      if (child)
+        collect(child, t, root, blocks, nearBlocks);
+    }
+  }
+}
+
+namespace {
+/** Return a matrix with the same column space and singular values as a.b^T,
+    scaled to unit norm, or NULL if a.b^T is null */
+template<typename T>
+ScalarArray<T> * unitWeight(const ScalarArray<T> * a, const ScalarArray<T> * b) {
+  ScalarArray<T> * w;
+  if (b->rows <= b->cols) {
+    w = new ScalarArray<T>(a->rows, b->rows);
+    w->gemm('N', 'T', 1, a, b, 0);
+  } else {
+    // a.b^T = a.R^T.Q^T with b = Q.R
+    ScalarArray<T> * q = b->copy();
+    ScalarArray<T> r(b->cols, b->cols);
+    q->qrDecomposition(&r);
+    delete q;
+    w = new ScalarArray<T>(a->rows, b->cols);
+    w->gemm('N', 'T', 1, a, &r, 0);
+  }
+  const double norm = w->norm();
+  if (norm == 0) {
+    delete w;
+    return NULL;
+  }
+  w->scale(T(1 / norm));
+  return w;
+}
+
+/** Return the number of singular values above epsilon */
+template<typename T>
+int truncatedRank(const Vector<T> & sigma, double epsilon) {
+  int k = 0;
+  while (k < sigma.rows && sigma[k] > epsilon)
+    k++;
+  return k;
+}
+}
+
+template<typename T>
+void H2Matrix<T>::buildBasis(std::vector<Basis> & tree, int node, const ScalarArray<T> * inherited,
+                             const std::vector<BlockRow> & blockRows) {
+  const int size = tree[node].size;
+  const std::vector<int> children = tree[node].children;
+
+  // C = [inherited | weights of the blocks of this cluster], all the columns
+  // of C must be approximated by the basis of this cluster
+  std::vector<ScalarArray<T> *> weights;
+  int m = inherited ? inherited->cols : 0;
+  for (size_t i = 0; i < blockRows[node].size(); i++) {
+    ScalarArray<T> * w = unitWeight(blockRows[node][i].first, blockRows[node][i].second);
+    if (w) {
+      weights.push_back(w);
+      m += w->cols;
+    }
+  }
+  ScalarArray<T> * compressed = NULL;
+  if (m > 0 && size > 0) {
+    ScalarArray<T> c(size, m, false);
+    int col = 0;
+    if (inherited) {
+      c.copyMatrixAtOffset(inherited, 0, 0);
+      col = inherited->cols;
+    }
+    for (size_t i = 0; i < weights.size(); i++) {
+      c.copyMatrixAtOffset(weights[i], 0, col);
+      col += weights[i]->cols;
+    }
+    ScalarArray<T> * u = NULL, * v = NULL;
+    Vector<typename Types<T>::real> * sigma = NULL;
+    c.svdDecomposition(&u, &sigma, &v);
+    delete v;
+    const int k = truncatedRank(*sigma, epsilon_);
+    if (k > 0) {
+      u->resize(k);
+      sigma->rows = k;
+      if (children.empty()) {
+        u->memoryCategory(MemoryCounters::RK);
+        tree[node].leaf = u;
+        tree[node].rank = k;
+        u = NULL;
+      } else {
+        u->multiplyWithDiag(sigma);
+        compressed = u;
+        u = NULL;
+      }
+    }
+    delete u;
+    delete sigma;
+  }
+  for (size_t i = 0; i < weights.size(); i++)
+    delete weights[i];
+  if (children.empty())
+    return;
+
+  // The children bases approximate their part of the compressed C, which is
+  // then projected on them to compute the transfer matrices
+  std::vector<ScalarArray<T> *> projections(children.size(), (ScalarArray<T> *)NULL);
+  int stacked = 0;
+  for (size_t i = 0; i < children.size(); i++) {
+    const Basis & c = tree[children[i]];
+    if (compressed) {
+      ScalarArray<T> part(*compressed, c.offset - tree[node].offset, c.size, 0, compressed->cols);
+      buildBasis(tree, children[i], &part, blockRows);
+      if (tree[children[i]].rank > 0) {
+        projections[i] = project(tree, children[i], part);
+        stacked += tree[children[i]].rank;
+      }
+    } else {
+      buildBasis(tree, children[i], NULL, blockRows);
+    }
+  }
+  if (compressed && stacked > 0) {
+    ScalarArray<T> p(stacked, compressed->cols, false);
+    int row = 0;
+    for (size_t i = 0; i < children.size(); i++) {
+      if (projections[i]) {
+        p.copyMatrixAtOffset(projections[i], row, 0);
+        row += projections[i]->rows;
+      }
+    }
+    ScalarArray<T> * u = NULL, * v = NULL;
+    Vector<typename Types<T>::real> * sigma = NULL;
+    p.svdDecomposition(&u, &sigma, &v);
+    delete v;
+    const int k = truncatedRank(*sigma, epsilon_);
+    delete sigma;
+    if (k > 0) {
+      tree[node].rank = k;
+      row = 0;
+      for (size_t i = 0; i < children.size(); i++) {
+        if (projections[i]) {
+          const int kc = projections[i]->rows;
+          tree[children[i]].transfer = new ScalarArray<T>(kc, k, false);
+          tree[children[i]].transfer->memoryCategory(MemoryCounters::RK);
+          ScalarArray<T> q(*u, row, kc, 0, k);
+          tree[children[i]].transfer->copyMatrixAtOffset(&q, 0, 0);
+          row += kc;
+        }
+      }
+    }
+    delete u;
+  }
+  for (size_t i = 0; i < projections.size(); i++)
+    delete projections[i];
+  delete compressed;
+}
+
+template<typename T>
+ScalarArray<T> * H2Matrix<T>::project(const std::vector<Basis> & tree, int node, const ScalarArray<T> & x) {
+  // Return V^H.x, V being the basis of node
+  const Basis & b = tree[node];
+  ScalarArray<T> * result = new ScalarArray<T>(b.rank, x.cols);
+  if (b.leaf) {
+    result->gemm('C', 'N', 1, b.leaf, &x, 0);
+    return result;
+  }
+  for (size_t i = 0; i < b.children.size(); i++) {
+    const Basis & c = tree[b.children[i]];
+    if (c.transfer == NULL)
+      continue;
+    const ScalarArray<T> part(x, c.offset - b.offset, c.size, 0, x.cols);
+    ScalarArray<T> * p = project(tree, b.children[i], part);
+    result->gemm('C', 'N', 1, c.transfer, p, 1);
+    delete p;
+  }
+  return result;
+}
+
+template<typename T>
+ScalarArray<T> * H2Matrix<T>::expand(const std::vector<Basis> & tree, int node) {
+  // Return the explicit basis V of node
+  const Basis & b = tree[node];
+  if (b.leaf)
+    return b.leaf->copy();
+  ScalarArray<T> * result = new ScalarArray<T>(b.size, b.rank);
+  for (size_t i = 0; i < b.children.size(); i++) {
+    const Basis & c = tree[b.children[i]];
+    if (c.transfer == NULL)
+      continue;
+    ScalarArray<T> * v = expand(tree, b.children[i]);
+    ScalarArray<T> part(*result, c.offset - b.offset, c.size, 0, b.rank);
+    part.gemm('N', 'N', 1, v, c.transfer, 0);
+    delete v;
+  }
+  return result;
+}
+
+template<typename T>
+H2Matrix<T>::H2Matrix(HMatrix<T> * h, double epsilon)
+  : shared_(h->isLower || h->isUpper), rows_(h->rows()->size()), cols_(h->cols()->size()),
+    epsilon_(epsilon > 0 ? epsilon : h->lowRankEpsilon()) {
+  DECLARE_CONTEXT;
+  createNodes(h->rowsTree(), h->rows()->offset(), rowBasis_);
+  if (!shared_)
+    createNodes(h->colsTree(), h->cols()->offset(), colBasis_);
+  std::vector<LowRank> blocks;
+  std::vector<const HMatrix<T> *> nearBlocks;
+  collect(h, 'N', h, blocks, nearBlocks);
+
+  // Near field blocks are used in place, and accounted once for symmetric matrices
+  std::map<const HMatrix<T> *, ScalarArray<T> *> seen;
+  for (size_t i = 0; i < near_.size(); i++) {
+    near_[i].data = &nearBlocks[i]->full()->data;
+    near_[i].owner = seen.find(nearBlocks[i]) == seen.end();
+    seen[nearBlocks[i]] = near_[i].data;
+  }
+
+  // Cluster bases
+  std::vector<BlockRow> rowBlocks(rowBasis_.size());
+  std::vector<BlockRow> colBlocks(colBasis_.size());
+  for (size_t i = 0; i < blocks.size(); i++) {
+    const LowRank & l = blocks[i];
+    rowBlocks[l.rows].push_back(std::make_pair(l.a, l.b));
+    // The transposed copies of symmetric blocks are already in rowBlocks
+    if (!shared_)
+      colBlocks[l.cols].push_back(std::make_pair(l.b, l.a));
+  }
+  buildBasis(rowBasis_, 0, NULL, rowBlocks);
+  if (!shared_)
+    buildBasis(colBasis_, 0, NULL, colBlocks);
+
+  // Coupling matrices S = (V^H.a).(W^H.b)^T
+  std::map<const HMatrix<T> *, ScalarArray<T> *> computed;
+  for (size_t i = 0; i < blocks.size(); i++) {
+    const LowRank & l = blocks[i];
+    if (rowBasis_[l.rows].rank == 0 || colBasis()[l.cols].rank == 0) {
+      // The block is below epsilon, h is not const (see the constructor)
+      l.block->rk()->clear();
+      const_cast<HMatrix<T> *>(l.block)->rk(l.block->rk());
+      continue;
+    }
+    Coupling c;
+    c.rows = l.rows;
+    c.cols = l.cols;
+    c.block = NULL;
+    c.transposed = l.mirror;
+    typename std::map<const HMatrix<T> *, ScalarArray<T> *>::iterator it = computed.find(l.block);
+    if (it != computed.end()) {
+      // Transposed copy of a symmetric block
+      c.mirror = true;
+      c.s = it->second;
+      c.owner = false;
+    } else {
+      ScalarArray<T> * pa = project(rowBasis_, l.rows, *l.a);
+      ScalarArray<T> * pb = project(colBasis(), l.cols, *l.b);
+      c.mirror = false;
+      c.s = new ScalarArray<T>(pa->rows, pb->rows);
+      c.s->gemm('N', 'T', 1, pa, pb, 0);
+      c.s->memoryCategory(MemoryCounters::RK);
+      c.owner = true;
+      c.block = l.block;
+      computed[l.block] = c.s;
+      delete pa;
+      delete pb;
+      // The H2Matrix is now the only representation of the block, which
+      // keeps its rank as an evicted block
+      l.block->rk()->clear();
+    }
+    couplings_.push_back(c);
+  }
+}
+
+template<typename T>
+H2Matrix<T>::~H2Matrix() {
+  std::vector<Basis> * trees[2] = { &rowBasis_, &colBasis_ };
+  for (int t = 0; t < 2; t++) {
+    for (size_t i = 0; i < trees[t]->size(); i++) {
+      delete (*trees[t])[i].leaf;
+      delete (*trees[t])[i].transfer;
+    }
+  }
+  for (size_t i = 0; i < couplings_.size(); i++)
+    if (couplings_[i].owner)
+      delete couplings_[i].s;
+}
+
+template<typename T>
+void H2Matrix<T>::restoreLeaves() {
+  DECLARE_CONTEXT;
+  for (size_t i = 0; i < couplings_.size(); i++) {
+    const Coupling & c = couplings_[i];
+    if (c.block == NULL)
+      continue;
+    // V.S.W^T = (V.S).W^T, or W.S^T.V^T for a transposed block
+    ScalarArray<T> * v = expand(rowBasis_, c.rows);
+    ScalarArray<T> * w = expand(colBasis(), c.cols);
+    ScalarArray<T> * a = new ScalarArray<T>(c.transposed ? w->rows : v->rows,
+                                            c.transposed ? c.s->rows : c.s->cols, false);
+    a->gemm('N', c.transposed ? 'T' : 'N', 1, c.transposed ? w : v, c.s, 0);
+    ScalarArray<T> * b = c.transposed ? v : w;
+    delete (c.transposed ? w : v);
+    a->memoryCategory(MemoryCounters::RK);
+    b->memoryCategory(MemoryCounters::RK);
+    HMatrix<T> * block = const_cast<HMatrix<T> *>(c.block);
+    RkMatrix<T> * rk = block->rk();
+    assert(rk->a == NULL);
+    rk->a = a;
+    rk->b = b;
+    rk->truncate(block->lowRankEpsilon());
+    block->rk(rk);
+  }
+}
+
+template<typename T>
+size_t H2Matrix<T>::memorySize() const {
+  size_t result = 0;
+  const std::vector<Basis> * trees[2] = { &rowBasis_, &colBasis_ };
+  for (int t = 0; t < 2; t++) {
+    for (size_t i = 0; i < trees[t]->size(); i++) {
+      const Basis & b = (*trees[t])[i];
+      if (b.leaf)
+        result += b.leaf->memorySize();
+      if (b.transfer)
+        result += b.transfer->memorySize();
+    }
+  }
+  for (size_t i = 0; i < couplings_.size(); i++)
+    if (couplings_[i].owner)
+      result += couplings_[i].s->memorySize();
+  for (size_t i = 0; i < near_.size(); i++)
+    if (near_[i].owner)
+      result += near_[i].data->memorySize();
+  return result;
+}
+
+template<typename T>
+int H2Matrix<T>::maxRank() const {
+  int result = 0;
+  for (size_t i = 0; i < rowBasis_.size(); i++)
+    result = std::max(result, rowBasis_[i].rank);
+  for (size_t i = 0; i < colBasis_.size(); i++)
+    result = std::max(result, colBasis_[i].rank);
+  return result;
+}
+
+template<typename T>
+void H2Matrix<T>::forward(const std::vector<Basis> & tree, int node, const ScalarArray<T> & x,
+                          std::vector<ScalarArray<T> *> & xHat) {
+  // xHat <- V^T.x for node and its descendants
+  const Basis & b = tree[node];
+  if (b.rank > 0)
+    xHat[node] = new ScalarArray<T>(b.rank, x.cols);
+  if (b.leaf) {
+    const ScalarArray<T> part(x, b.offset, b.size, 0, x.cols);
+    xHat[node]->gemm('T', 'N', 1, b.leaf, &part, 0);
+    return;
+  }
+  for (size_t i = 0; i < b.children.size(); i++) {
+    const int c = b.children[i];
+    forward(tree, c, x, xHat);
+    if (tree[c].transfer)
+      xHat[node]->gemm('T', 'N', 1, tree[c].transfer, xHat[c], 1);
+  }
+}
+
+template<typename T>
+void H2Matrix<T>::backward(const std::vector<Basis> & tree, int node, T alpha,
+                           std::vector<ScalarArray<T> *> & yHat, ScalarArray<T> & y) {
+  // y <- y + alpha.V.yHat for node and its descendants
+  const Basis & b = tree[node];
+  if (b.leaf) {
+    ScalarArray<T> part(y, b.offset, b.size, 0, y.cols);
+    part.gemm('N', 'N', alpha, b.leaf, yHat[node], 1);
+    return;
+  }
+  for (size_t i = 0; i < b.children.size(); i++) {
+    const int c = b.children[i];
+    if (tree[c].transfer)
+      yHat[c]->gemm('N', 'N', 1, tree[c].transfer, yHat[node], 1);
+    backward(tree, c, alpha, yHat, y);
+  }
+}
+
+template<typename T>
+void H2Matrix<T>::gemv(char trans, T alpha, const ScalarArray<T> & x, T beta, ScalarArray<T> & y) const {
+  DECLARE_CONTEXT;
+  HMAT_ASSERT(trans == 'N' || trans == 'T');
+  assert(x.cols == y.cols);
+  assert((trans == 'N' ? rows_ : cols_) == y.rows);
+  assert((trans == 'N' ? cols_ : rows_) == x.rows);
+  if (rows_ == 0 || cols_ == 0)
+    return;
+  if (beta != T(1))
+    y.scale(beta);
+
+  const std::vector<Basis> & in = trans == 'N' ? colBasis() : rowBasis_;
+  const std::vector<Basis> & out = trans == 'N' ? rowBasis_ : colBasis();
+  std::vector<ScalarArray<T> *> xHat(in.size(), (ScalarArray<T> *)NULL);
+  std::vector<ScalarArray<T> *> yHat(out.size(), (ScalarArray<T> *)NULL);
+  forward(in, 0, x, xHat);
+  for (size_t i = 0; i < out.size(); i++)
+    if (out[i].rank > 0)
+      yHat[i] = new ScalarArray<T>(out[i].rank, x.cols);
+  for (size_t i = 0; i < couplings_.size(); i++) {
+    const Coupling & c = couplings_[i];
+    // yHat_t += S.xHat_s or yHat_s += S^T.xHat_t, S being transposed for mirrors
+    const char t = (trans == 'N') == c.mirror ? 'T' : 'N';
+    yHat[trans == 'N' ? c.rows : c.cols]->gemm(t, 'N', 1, c.s, xHat[trans == 'N' ? c.cols : c.rows], 1);
+  }
+  backward(out, 0, alpha, yHat, y);
+  for (size_t i = 0; i < xHat.size(); i++)
+    delete xHat[i];
+  for (size_t i = 0; i < yHat.size(); i++)
+    delete yHat[i];
+
+  for (size_t i = 0; i < near_.size(); i++) {
+    const Near & l = near_[i];
+    // The block is applied transposed in op(h) when trans and mirror differ
+    const char t = (trans == 'N') == l.mirror ? 'T' : 'N';
+    const bool transposed = t == 'T';
+    const ScalarArray<T> subX(x, transposed ? l.rowsOffset : l.colsOffset,
+                              transposed ? l.rowsSize : l.colsSize, 0, x.cols);
+    ScalarArray<T> subY(y, transposed ? l.colsOffset : l.rowsOffset,
+                        transposed ? l.colsSize : l.rowsSize, 0, y.cols);
+    subY.gemm(t, 'N', alpha, l.data, &subX, 1);
+  }
+}
+
+// Explicit template instantiation
+template class H2Matrix<S_t>;
+template class H2Matrix<D_t>;
+template class H2Matrix<C_t>;
+template class H2Matrix<Z_t>;
+
+}  // end namespace hmat
@@ -0,0 +1,167 @@
+/*
+  HMat-OSS (HMatrix library, open source software)
+
+  Copyright (C) 2014-2015 Airbus Group SAS
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+  http://github.com/jeromerobert/hmat-oss
+*/
+
+/*! \file
+  \ingroup HMatrix
+  \brief H2-matrix representation of an HMatrix, with nested cluster bases.
+*/
+#ifndef _H2_MATRIX_HPP
+#define _H2_MATRIX_HPP
+
+#include "scalar_array.hpp"
+#include <utility>
+#include <vector>
+
+namespace hmat {
+
+template<typename T> class HMatrix;
+class ClusterTree;
+
+/*! \brief Recompression of an HMatrix with nested cluster bases.
+
+  Each Rk block a.b^T of the HMatrix with rows t and cols s is replaced by
+  V_t.S.W_s^T, where V_t and W_s are orthonormal bases attached to the
+  nodes of the row and column cluster trees, and S is a small coupling
+  matrix. The bases are nested: only the leaves of the cluster trees store
+  an explicit basis, the basis of an inner node is the block diagonal of the
+  bases of its children times a small transfer matrix. The storage of the
+  bases is then linear in the matrix size instead of O(n.log(n)).
+
+  The bases are built from the Rk blocks of the whole block row (or column)
+  of each cluster, including the blocks of its ancestors, each block being
+  scaled to unit norm so that every block is approximated with the relative
+  accuracy epsilon at each level of the cluster tree.
+
+  The full blocks are used in place. The panels of each Rk block are freed
+  once its coupling matrix is built, so that the H2Matrix is the only
+  representation of these blocks until restoreLeaves() rebuilds them, with
+  the approximation error of the bases: the conversion is lossy. As
+  MatvecPlan, this is a snapshot which must be deleted before the HMatrix
+  is modified. The bases of lower or upper stored symmetric matrices are
+  shared by rows and cols.
+ */
+template<typename T> class H2Matrix {
+public:
+  /*! \brief Node of a cluster basis tree */
+  struct Basis {
+    /// Offset of the cluster relative to the matrix rows (or cols), and its size
+    int offset, size;
+    /// Number of columns of the basis
+    int rank;
+    /// Explicit basis (size x rank) of a leaf, NULL for inner nodes
+    ScalarArray<T> * leaf;
+    /// Transfer to the parent basis (rank x rank of the parent), NULL for the root
+    ScalarArray<T> * transfer;
+    std::vector<int> children;
+  };
+
+private:
+  struct Coupling {
+    /// Indices of the row and column basis nodes
+    int rows, cols;
+    /// The coupling matrix of a transposed copy of a symmetric block is transposed
+    bool mirror;
+    /// Coupling matrix, shared with the transposed copy of a symmetric block
+    ScalarArray<T> * s;
+    /// False for the copy which does not own s
+    bool owner;
+    /// Block of the HMatrix whose panels were freed, NULL for the copy which does not own s
+    const HMatrix<T> * block;
+    /// True if the block is the transpose of V.S.W^T
+    bool transposed;
+  };
+  struct Near {
+    int rowsOffset, rowsSize, colsOffset, colsSize;
+    /// True for the transposed copy of a block of a symmetric matrix
+    bool mirror;
+    /// Data of the full block of the HMatrix
+    ScalarArray<T> * data;
+    /// False for the transposed copy of a symmetric block
+    bool owner;
+  };
+  /// Rk block a.b^T of h, a transposed copy having a and b swapped
+  struct LowRank {
+    /// Indices of the row and column basis nodes
+    int rows, cols;
+    const ScalarArray<T> * a, * b;
+    const HMatrix<T> * block;
+    bool mirror;
+  };
+  /// Panels a and b of the Rk blocks of a block row
+  typedef std::vector<std::pair<const ScalarArray<T> *, const ScalarArray<T> *> > BlockRow;
+
+  std::vector<Basis> rowBasis_;
+  std::vector<Basis> colBasis_;
+  /// True if colBasis_ is empty and rowBasis_ is used for both
+  bool shared_;
+  std::vector<Coupling> couplings_;
+  std::vector<Near> near_;
+  int rows_, cols_;
+  double epsilon_;
+
+  void collect(const HMatrix<T> * h, char trans, const HMatrix<T> * root,
+               std::vector<LowRank> & blocks, std::vector<const HMatrix<T> *> & nearBlocks);
+  const std::vector<Basis> & colBasis() const { return shared_ ? rowBasis_ : colBasis_; }
+  static int createNodes(const ClusterTree * cluster, int rootOffset, std::vector<Basis> & tree);
+  static int findNode(const std::vector<Basis> & tree, int offset, int size);
+  void buildBasis(std::vector<Basis> & tree, int node, const ScalarArray<T> * inherited,
+                  const std::vector<BlockRow> & blockRows);
+  static ScalarArray<T> * project(const std::vector<Basis> & tree, int node, const ScalarArray<T> & x);
+  static ScalarArray<T> * expand(const std::vector<Basis> & tree, int node);
+  static void forward(const std::vector<Basis> & tree, int node, const ScalarArray<T> & x,
+                      std::vector<ScalarArray<T> *> & xHat);
+  static void backward(const std::vector<Basis> & tree, int node, T alpha,
+                       std::vector<ScalarArray<T> *> & yHat, ScalarArray<T> & y);
+  H2Matrix(const H2Matrix&);
+  void operator=(const H2Matrix&);
+public:
+  /**
+   * @param h the HMatrix to convert, which must not be factorized. The
+   * panels of its Rk blocks are freed.
+   * @param epsilon relative accuracy of the cluster bases, the default is
+   * the low-rank epsilon of h
+   */
+  explicit H2Matrix(HMatrix<T> * h, double epsilon = 0);
+  /** The Rk blocks of the HMatrix are not restored, see restoreLeaves() */
+  ~H2Matrix();
+  /**
+   * Give back their panels to the Rk blocks of the HMatrix, computed from
+   * the cluster bases and the coupling matrices and recompressed. The
+   * blocks are then within epsilon of the original ones. Must be called
+   * once, before the H2Matrix is deleted, unless the HMatrix is deleted.
+   */
+  void restoreLeaves();
+  /**
+   * y <- alpha.op(h).x + beta.y, with the same meaning as
+   * HMatrix::gemv(trans, alpha, &x, beta, &y, Side::LEFT).
+   * @param trans 'N' or 'T'
+   */
+  void gemv(char trans, T alpha, const ScalarArray<T> & x, T beta, ScalarArray<T> & y) const;
+  /** Size of the bases, coupling matrices and full blocks in bytes, the full blocks belonging to the HMatrix */
+  size_t memorySize() const;
+  /** Largest rank of the cluster bases */
+  int maxRank() const;
+};
+
+}  // end namespace hmat
+
+#endif
@@ -39,6 +39,7 @@
 #include "recursion.hpp"
 #include "common/context.hpp"
 #include "common/my_assert.h"
+#include "common/memory_instrumentation.hpp"
 #include "json.hpp"
 
 using namespace std;
@@ -55,6 +56,11 @@ template<typename T> bool HMatrix<T>::validationDump = false;
 template<typename T> double HMatrix<T>::validationErrorThreshold = 0;
 
 template<typename T> HMatrix<T>::~HMatrix() {
+  if (pendingUpdates_) {
+    for (RkMatrix<T>* update : *pendingUpdates_)
+      delete update;
+    delete pendingUpdates_;
+  }
   if (isRkMatrix() && rk_) {
     delete rk_;
     rk_ = NULL;
@@ -144,10 +150,10 @@ HMatrix<T>::HMatrix(const ClusterTree* _rows, const ClusterTree* _cols, const hm
                     int _depth, SymmetryFlag symFlag, AdmissibilityCondition * admissibilityCondition)
   : Tree<HMatrix<T> >(NULL, _depth), RecursionMatrix<T, HMatrix<T> >(),
     rows_(_rows), cols_(_cols), rk_(NULL),
-    rank_(UNINITIALIZED_BLOCK), approximateRank_(UNINITIALIZED_BLOCK),
+    rank_(UNINITIALIZED_BLOCK), approximateRank_(UNINITIALIZED_BLOCK), pendingUpdates_(NULL),
     isUpper(false), isLower(false),
     isTriUpper(false), isTriLower(false), keepSameRows(true), keepSameCols(true), temporary_(false),
-    ownRowsClusterTree_(false), ownColsClusterTree_(false), localSettings(settings, 1e-4)
+    ownRowsClusterTree_(false), ownColsClusterTree_(false), deferUpdates_(false), localSettings(settings, 1e-4)
 {
   if (isVoid())
     return;
@@ -217,10 +223,10 @@ bool HMatrix<T>::split(AdmissibilityCondition * admissibilityCondition, bool low
 template<typename T>
 HMatrix<T>::HMatrix(const hmat::MatrixSettings * settings) :
     Tree<HMatrix<T> >(NULL), RecursionMatrix<T, HMatrix<T> >(), rows_(NULL), cols_(NULL),
-    rk_(NULL), rank_(UNINITIALIZED_BLOCK), approximateRank_(UNINITIALIZED_BLOCK),
+    rk_(NULL), rank_(UNINITIALIZED_BLOCK), approximateRank_(UNINITIALIZED_BLOCK), pendingUpdates_(NULL),
     isUpper(false), isLower(false), isTriUpper(false), isTriLower(false),
     keepSameRows(true), keepSameCols(true), temporary_(false), ownRowsClusterTree_(false),
-    ownColsClusterTree_(false), localSettings(settings, -1.0)
+    ownColsClusterTree_(false), deferUpdates_(false), localSettings(settings, -1.0)
     {}
 
 template<typename T> HMatrix<T> * HMatrix<T>::internalCopy(bool temporary, bool withRowChild, bool withColChild) const {
@@ -469,6 +475,8 @@ template<typename T> void HMatrix<T>::info(hmat_info_t & result) {
             }
             result.rk_count++;
             result.rk_size += s;
+            result.rk_rank_sum += rank();
+            result.max_rk_rank = std::max(result.max_rk_rank, rank());
         } else {
             result.compressed_size += s;
             result.full_count ++;
@@ -613,6 +621,7 @@ void HMatrix<T>::scale(T alpha) {
   } else if(alpha == T(1)) {
     return;
   } else if (this->isLeaf()) {
+    flushUpdates();
     if (isNull()) {
       // nothing to do
     } else if (isRkMatrix()) {
@@ -921,7 +930,11 @@ void HMatrix<T>::axpy(T alpha, const RkMatrix<T>* b) {
     if (needResizing) {
       newRk = b->subset(rows(), cols());
     }
-    if (isRkMatrix()) {
+    if (isRkMatrix() && deferUpdates_) {
+      RkMatrix<T>* update = newRk->copy();
+      update->scale(alpha);
+      pushUpdate(update);
+    } else if (isRkMatrix()) {
       if(!rk())
           rk(new RkMatrix<T>(NULL, rows(), NULL, cols()));
       rk()->axpy(lowRankEpsilon(), alpha, newRk);
@@ -1438,6 +1451,12 @@ HMatrix<T>::leafGemm(char transA, char transB, T alpha, const HMatrix<T>* a, con
         assert(*cols() == (transB == 'N' ? *b->cols() : *b->rows()));
         if(rk() == NULL)
             rk(new RkMatrix<T>(NULL, rows(), NULL, cols()));
+        if(deferUpdates_) {
+            RkMatrix<T>* update = new RkMatrix<T>(NULL, rows(), NULL, cols());
+            update->gemmRk(lowRankEpsilon(), transA, transB, alpha, a, b);
+            pushUpdate(update);
+            return;
+        }
         rk()->gemmRk(lowRankEpsilon(), transA, transB, alpha, a, b);
         rank_ = rk()->rank();
         return;
@@ -1487,6 +1506,10 @@ void HMatrix<T>::gemm(char transA, char transB, T alpha, const HMatrix<T>* a, co
   if(isVoid() || a->isVoid())
       return;
 
+  // Queued updates must be scaled with the rest of the block
+  if(beta != T(1))
+      flushUpdates();
+
   // This and B are Rk matrices with the same panel 'b' -> the gemm is only applied on the panels 'a'
   if(isRkMatrix() && !isNull() && b->isRkMatrix() && !b->isNull() && rk()->b == b->rk()->b) {
     // Ca * CbT = beta * Ca * CbT + alpha * A * Ba * BbT
@@ -1812,6 +1835,7 @@ void HMatrix<T>::copyAndTranspose(const HMatrix<T>* o) {
           if (!full()->diagonal) {
             full()->diagonal = new Vector<T>(oF->rows());
             HMAT_ASSERT(full()->diagonal);
+            full()->diagonal->memoryCategory(MemoryCounters::PIVOTS);
           }
           oF->diagonal->copy(full()->diagonal);
         }
@@ -1931,12 +1955,75 @@ template<typename T> void HMatrix<T>::clear() {
     if(rk())
       delete rk();
     rk(NULL);
+    if(pendingUpdates_) {
+      for (RkMatrix<T>* update : *pendingUpdates_)
+        delete update;
+      delete pendingUpdates_;
+      pendingUpdates_ = NULL;
+    }
   } else if(isFullMatrix()) {
     delete full();
     full(NULL);
   }
 }
 
+template<typename T> void HMatrix<T>::deferUpdates(bool enable) {
+  if(!this->isLeaf()) {
+    for (int i = 0; i < this->nrChild(); i++) {
+      HMatrix<T>* child = this->getChild(i);
+      if (child)
+        child->deferUpdates(enable);
+    }
+  } else if(!enable) {
+    flushUpdates();
+  }
+  deferUpdates_ = enable;
+}
+
+template<typename T> void HMatrix<T>::pushUpdate(RkMatrix<T>* update) {
+  if(update->rank() == 0) {
+    delete update;
+    return;
+  }
+  if(!pendingUpdates_)
+    pendingUpdates_ = new std::vector<RkMatrix<T>*>();
+  pendingUpdates_->push_back(update);
+  // The cost of the merge grows with the square of the total rank: once the
+  // queued rank exceeds the rank of the block, merging one by one is cheaper.
+  // Past the block size formattedAddParts() would switch to a dense sum.
+  const int blockRank = rk() ? rk()->rank() : 0;
+  int pendingRank = 0;
+  for (const RkMatrix<T>* u : *pendingUpdates_)
+    pendingRank += u->rank();
+  if(pendingRank > std::max(blockRank, 8) || blockRank + pendingRank >= std::min(rows()->size(), cols()->size()))
+    flushUpdates();
+}
+
+template<typename T> void HMatrix<T>::flushUpdates() {
+  if(!deferUpdates_)
+    return;
+  if(!this->isLeaf()) {
+    for (int i = 0; i < this->nrChild(); i++) {
+      HMatrix<T>* child = this->getChild(i);
+      if (child)
+        child->flushUpdates();
+    }
+  } else if(pendingUpdates_) {
+    DECLARE_CONTEXT;
+    assert(isRkMatrix());
+    std::vector<RkMatrix<T>*> & updates = *pendingUpdates_;
+    if(!rk())
+      rk(new RkMatrix<T>(NULL, rows(), NULL, cols()));
+    std::vector<T> alpha(updates.size(), T(1));
+    rk()->formattedAddParts(lowRankEpsilon(), alpha.data(), updates.data(), updates.size());
+    rank_ = rk()->rank();
+    for (RkMatrix<T>* update : updates)
+      delete update;
+    delete pendingUpdates_;
+    pendingUpdates_ = NULL;
+  }
+}
+
 template<typename T>
 void HMatrix<T>::inverse() {
   DECLARE_CONTEXT;
@@ -2019,6 +2106,10 @@ template<typename T>
 void HMatrix<T>::solveLowerTriangularLeft(HMatrix<T>* b, Factorization algo, Diag diag, Uplo uplo, MainOp) const {
   DECLARE_CONTEXT;
   if (isVoid()) return;
+  // The recursion stops when one of the matrices is a leaf: b is then read
+  // directly, so its queued updates are merged first
+  if (this->isLeaf() || b->isLeaf())
+    b->flushUpdates();
   // At first, the recursion one (simple case)
   if (!this->isLeaf() && !b->isLeaf()) {
     this->recursiveSolveLowerTriangularLeft(b, algo, diag, uplo);
@@ -2047,8 +2138,25 @@ void HMatrix<T>::solveLowerTriangularLeft(HMatrix<T>* b, Factorization algo, Dia
   }
 }
 
+/** Return true if the sorted and disjoint ranges intersect set, NULL being all the rows */
+static bool intersects(const std::vector<IndexSet>* ranges, const IndexSet* set) {
+  if (ranges == NULL)
+    return true;
+  // First range ending after the beginning of set
+  std::vector<IndexSet>::const_iterator it = std::upper_bound(ranges->begin(), ranges->end(), set->offset(),
+    [](int offset, const IndexSet& r) { return offset < r.offset() + r.size(); });
+  return it != ranges->end() && it->offset() < set->offset() + set->size();
+}
+
 template<typename T>
 void HMatrix<T>::solveLowerTriangularLeft(ScalarArray<T>* b, Factorization algo, Diag diag, Uplo uplo) const {
+  solveLowerTriangularLeft(b, algo, diag, uplo, NULL, NULL);
+}
+
+template<typename T>
+void HMatrix<T>::solveLowerTriangularLeft(ScalarArray<T>* b, Factorization algo, Diag diag, Uplo uplo,
+                                          const std::vector<IndexSet>* nonZeroRows,
+                                          const std::vector<IndexSet>* requestedRows) const {
   DECLARE_CONTEXT;
   assert(*rows() == *cols());
   assert(cols()->size() == b->rows);
@@ -2065,21 +2173,44 @@ void HMatrix<T>::solveLowerTriangularLeft(ScalarArray<T>* b, Factorization algo,
     //  L11 * X1 = b1 (by recursive forward substitution)
     //  L21 * X1 + L22 * X2 = b2 (forward substitution of L22*X2=b2-L21*X1)
     //
-
+    const int n = nrChildRow();
+    // needed[i] is 2 if X_i is used by a later needed block, 1 if only
+    // some of its rows are requested, 0 if it is not computed
+    std::vector<char> needed(n, 0);
+    for (int i = n - 1; i >= 0; i--) {
+      for (int k = i + 1; k < n && needed[i] < 2; k++) {
+        if (needed[k] && (uplo == Uplo::LOWER ? get(k, i) : get(i, k)))
+          needed[i] = 2;
+      }
+      if (needed[i] == 0 && intersects(requestedRows, get(i, i)->cols()))
+        needed[i] = 1;
+    }
+    // nonZero[i] is 2 if b_i has been updated, 1 if it may only be nonzero
+    // on nonZeroRows, 0 if it is zero (and so is X_i)
+    std::vector<char> nonZero(n, 0);
     int offset(0);
     vector<ScalarArray<T> > sub;
-    for (int i=0 ; i<nrChildRow() ; i++) {
+    for (int i=0 ; i<n ; i++) {
       // Create sub[i] = a ScalarArray (without copy of data) for the rows in front of the i-th matrix block
       sub.push_back(ScalarArray<T>(*b, offset, get(i, i)->cols()->size(), 0, b->cols));
       offset += get(i, i)->cols()->size();
+      if (!needed[i])
+        continue;
+      if (intersects(nonZeroRows, get(i, i)->cols()))
+        nonZero[i] = 1;
       // Update sub[i] with the contribution of the solutions already computed sub[j] j<i
       for (int j=0 ; j<i ; j++) {
         const HMatrix<T>* u_ji = (uplo == Uplo::LOWER ? get(i, j) : get(j, i));
-        if (u_ji)
+        if (u_ji && nonZero[j]) {
           u_ji->gemv(uplo == Uplo::LOWER ? 'N' : 'T', -1, &sub[j], 1, &sub[i]);
+          nonZero[i] = 2;
+        }
       }
       // Solve the i-th diagonal system
-      get(i, i)->solveLowerTriangularLeft(&sub[i], algo, diag, uplo);
+      if (nonZero[i])
+        get(i, i)->solveLowerTriangularLeft(&sub[i], algo, diag, uplo,
+                                            nonZero[i] == 2 ? NULL : nonZeroRows,
+                                            needed[i] == 2 ? NULL : requestedRows);
     }
   }
 }
@@ -2093,6 +2224,10 @@ template<typename T>
 void HMatrix<T>::solveUpperTriangularRight(HMatrix<T>* b, Factorization algo, Diag diag, Uplo uplo) const {
   DECLARE_CONTEXT;
   if (rows()->size() == 0 || cols()->size() == 0) return;
+  // The recursion stops when one of the matrices is a leaf: b is then read
+  // directly, so its queued updates are merged first
+  if (this->isLeaf() || b->isLeaf())
+    b->flushUpdates();
   // The recursion one (simple case)
   if (!this->isLeaf() && !b->isLeaf()) {
     this->recursiveSolveUpperTriangularRight(b, algo, diag, uplo);
@@ -2176,6 +2311,10 @@ template<typename T>
 void HMatrix<T>::solveUpperTriangularLeft(HMatrix<T>* b, Factorization algo, Diag diag, Uplo uplo, MainOp) const {
   DECLARE_CONTEXT;
   if (rows()->size() == 0 || cols()->size() == 0) return;
+  // The recursion stops when one of the matrices is a leaf: b is then read
+  // directly, so its queued updates are merged first
+  if (this->isLeaf() || b->isLeaf())
+    b->flushUpdates();
   // At first, the recursion one (simple case)
   if (!this->isLeaf() && !b->isLeaf()) {
     this->recursiveSolveUpperTriangularLeft(b, algo, diag, uplo);
@@ -2206,6 +2345,13 @@ void HMatrix<T>::solveUpperTriangularLeft(HMatrix<T>* b, Factorization algo, Dia
 
 template<typename T>
 void HMatrix<T>::solveUpperTriangularLeft(ScalarArray<T>* b, Factorization algo, Diag diag, Uplo uplo) const {
+  solveUpperTriangularLeft(b, algo, diag, uplo, NULL, NULL);
+}
+
+template<typename T>
+void HMatrix<T>::solveUpperTriangularLeft(ScalarArray<T>* b, Factorization algo, Diag diag, Uplo uplo,
+                                          const std::vector<IndexSet>* nonZeroRows,
+                                          const std::vector<IndexSet>* requestedRows) const {
   DECLARE_CONTEXT;
   assert(*rows() == *cols());
   assert(rows()->size() == b->rows || uplo == Uplo::UPPER);
@@ -2222,23 +2368,43 @@ void HMatrix<T>::solveUpperTriangularLeft(ScalarArray<T>* b, Factorization algo,
     //  U22 * X2 = b12(by recursive backward substitution)
     //  U11 * X1 + U12 * X2 = b1 (backward substitution of U11*X1=b1-U12*X2)
     //
-
+    const int n = nrChildRow();
+    // Same pruning as in the forward substitution, in the reverse order
+    std::vector<char> needed(n, 0);
+    for (int i = 0; i < n; i++) {
+      for (int k = 0; k < i && needed[i] < 2; k++) {
+        if (needed[k] && (uplo == Uplo::LOWER ? get(i, k) : get(k, i)))
+          needed[i] = 2;
+      }
+      if (needed[i] == 0 && intersects(requestedRows, get(i, i)->cols()))
+        needed[i] = 1;
+    }
+    std::vector<char> nonZero(n, 0);
     int offset(0);
     vector<ScalarArray<T> > sub;
-    for (int i=0 ; i<nrChildRow() ; i++) {
+    for (int i=0 ; i<n ; i++) {
       // Create sub[i] = a ScalarArray (without copy of data) for the rows in front of the i-th matrix block
       sub.push_back(b->rowsSubset(offset, get(i, i)->cols()->size()));
       offset += get(i, i)->cols()->size();
     }
-    for (int i=nrChildRow()-1 ; i>=0 ; i--) {
-      // Solve the i-th diagonal system
-      get(i, i)->solveUpperTriangularLeft(&sub[i], algo, diag, uplo);
-      // Update sub[j] j<i with the contribution of the solutions just computed sub[i]
-      for (int j=0 ; j<i ; j++) {
-        const HMatrix<T>* u_ji = (uplo == Uplo::LOWER ? get(i, j) : get(j, i));
-        if (u_ji)
-          u_ji->gemv(uplo == Uplo::LOWER ? 'T' : 'N', -1, &sub[i], 1, &sub[j]);
+    for (int i=n-1 ; i>=0 ; i--) {
+      if (!needed[i])
+        continue;
+      if (intersects(nonZeroRows, get(i, i)->cols()))
+        nonZero[i] = 1;
+      // Update sub[i] with the contribution of the solutions already computed sub[j] j>i
+      for (int j=n-1 ; j>i ; j--) {
+        const HMatrix<T>* u_ij = (uplo == Uplo::LOWER ? get(j, i) : get(i, j));
+        if (u_ij && nonZero[j]) {
+          u_ij->gemv(uplo == Uplo::LOWER ? 'T' : 'N', -1, &sub[j], 1, &sub[i]);
+          nonZero[i] = 2;
+        }
       }
+      // Solve the i-th diagonal system
+      if (nonZero[i])
+        get(i, i)->solveUpperTriangularLeft(&sub[i], algo, diag, uplo,
+                                            nonZero[i] == 2 ? NULL : nonZeroRows,
+                                            needed[i] == 2 ? NULL : requestedRows);
     }
   }
 }
@@ -2721,6 +2887,38 @@ void HMatrix<T>::solveLlt(FullMatrix<T>* b) const {
   solveLlt(&b->data);
 }
 
+template<typename T>
+void HMatrix<T>::solveSparse(ScalarArray<T>* b, Factorization algo,
+                             const std::vector<IndexSet>* nonZeroRows,
+                             const std::vector<IndexSet>* requestedRows) const {
+  DECLARE_CONTEXT;
+  HMAT_ASSERT_MSG(algo == Factorization::LU || algo == Factorization::LDLT || algo == Factorization::LLT,
+                  "Unsupported factorization for a sparse solve");
+  const int end = rows()->offset() + rows()->size();
+  if (nonZeroRows != NULL && nonZeroRows->empty()) {
+    b->clear();
+    return;
+  }
+  // The backward substitution only needs the intermediate solution after
+  // the first requested row, and it is zero before the first nonzero row
+  std::vector<IndexSet> tail;
+  if (requestedRows != NULL) {
+    if (requestedRows->empty())
+      return;
+    tail.push_back(IndexSet(requestedRows->front().offset(), end - requestedRows->front().offset()));
+  }
+  std::vector<IndexSet> head;
+  if (nonZeroRows != NULL)
+    head.push_back(IndexSet(nonZeroRows->front().offset(), end - nonZeroRows->front().offset()));
+  const Diag diag = algo == Factorization::LLT ? Diag::NONUNIT : Diag::UNIT;
+  this->solveLowerTriangularLeft(b, algo, diag, Uplo::LOWER, nonZeroRows, requestedRows ? &tail : NULL);
+  if (algo == Factorization::LDLT)
+    this->solveDiagonal(b);
+  this->solveUpperTriangularLeft(b, algo, algo == Factorization::LU ? Diag::NONUNIT : diag,
+                                 algo == Factorization::LU ? Uplo::UPPER : Uplo::LOWER,
+                                 nonZeroRows ? &head : NULL, requestedRows);
+}
+
 template<typename T>
 void HMatrix<T>::checkStructure() const {
 #if 0
@@ -42,6 +42,7 @@ namespace hmat {
 #include <fstream>
 #include <iostream>
 #include <deque>
+#include <vector>
 
 
 namespace hmat {
@@ -122,6 +123,7 @@ template<typename T> unsigned char * compatibilityGridForGEMM(const HMatrix<T>*
  */
 template<typename T> class HMatrix : public Tree<HMatrix<T> >, public RecursionMatrix<T, HMatrix<T> > {
   friend class RkMatrix<T>;
+  template<typename U> friend HMatrix<U>* fromDoubleHMatrix(const HMatrix<typename Types<U>::dp>* h);
 
   /// Rows of this HMatrix block
   const ClusterTree * rows_;
@@ -137,12 +139,16 @@ template<typename T> class HMatrix : public Tree<HMatrix<T> >, public RecursionM
   int rank_;
   /// approximate rank of the block, or: UNINITIALIZED_BLOCK=-3 for an uninitialized matrix
   int approximateRank_;
+  /// Low-rank updates queued on this Rk leaf (see deferUpdates()), or NULL
+  std::vector<RkMatrix<T>*> * pendingUpdates_;
+  /// Queue an update of this Rk leaf, which is merged by flushUpdates()
+  void pushUpdate(RkMatrix<T>* update);
   void uncompatibleGemm(char transA, char transB, T alpha, const HMatrix<T>* a, const HMatrix<T>*b);
   void recursiveGemm(char transA, char transB, T alpha, const HMatrix<T>* a, const HMatrix<T>*b);
   void leafGemm(char transA, char transB, T alpha, const HMatrix<T>* a, const HMatrix<T>*b);
   HMatrix<T> * fullRkSubset(const IndexSet* subset, bool col) const;
 
-  /** Only used by internalCopy */
+  /** Only used by internalCopy and fromDoubleHMatrix */
   HMatrix(const MatrixSettings * settings);
   /** This <- This + alpha * b
 
@@ -361,6 +367,18 @@ public:
   /** Set a matrix to 0.
    */
   void clear();
+  /** Enable or disable the deferred updates of the Rk leaves of this block.
+
+      When enabled, the low-rank contributions of gemm and axpy that land on an
+      Rk leaf are queued on the leaf instead of being added and recompressed
+      one by one. They are merged by a single recompression when the leaf is
+      read by a triangular solve, or by flushUpdates(). Disabling flushes all
+      the queued updates.
+   */
+  void deferUpdates(bool enable);
+  /** Merge the queued updates of the Rk leaves of this block.
+   */
+  void flushUpdates();
   /** Inverse an HMatrix in place.
 
       \param tmp temporary HMatrix used in the inversion. If set, it must have
@@ -475,6 +493,21 @@ public:
    */
   void solveLowerTriangularLeft(ScalarArray<T>* b, Factorization algo, Diag diag, Uplo uplo) const;
   void solveLowerTriangularLeft(FullMatrix<T>* b, Factorization algo, Diag diag, Uplo uplo) const;
+  /*! Forward substitution restricted to a sparse right-hand side and to
+    the requested entries of the solution.
+
+    The diagonal blocks whose right-hand side remains zero, and those which
+    neither contain requested entries nor contribute to them, are skipped.
+    Ranges are sorted, disjoint and in the numbering of the cluster tree,
+    NULL meaning all the rows.
+
+    \param nonZeroRows the rows outside of which b is zero
+    \param requestedRows the rows of x to compute, the other rows of b are
+    unspecified on output
+   */
+  void solveLowerTriangularLeft(ScalarArray<T>* b, Factorization algo, Diag diag, Uplo uplo,
+                                const std::vector<IndexSet>* nonZeroRows,
+                                const std::vector<IndexSet>* requestedRows) const;
   /*! Resolution de X U = B, avec U = this, et X = B.
 
     \param b la matrice B en entree, X en sortie
@@ -503,6 +536,13 @@ public:
   */
   void solveUpperTriangularLeft(ScalarArray<T>* b, Factorization algo, Diag diag, Uplo uplo) const;
   void solveUpperTriangularLeft(FullMatrix<T>* b, Factorization algo, Diag diag, Uplo uplo) const;
+  /*! Backward substitution restricted to a sparse right-hand side and to
+    the requested entries of the solution, see the pruned
+    solveLowerTriangularLeft().
+   */
+  void solveUpperTriangularLeft(ScalarArray<T>* b, Factorization algo, Diag diag, Uplo uplo,
+                                const std::vector<IndexSet>* nonZeroRows,
+                                const std::vector<IndexSet>* requestedRows) const;
   /*! Solve D x = b, in place with D a diagonal matrix.
 
      \param b Input: B, Output: X
@@ -538,6 +578,24 @@ public:
    */
   void solveLlt(ScalarArray<T>* b) const ;
   void solveLlt(FullMatrix<T>* b) const ;
+  /*! Solve This * x = b, with b zero outside of nonZeroRows and
+    only the rows requestedRows of x being computed.
+
+    The forward substitution starts at the first nonzero row and the
+    backward substitution stops at the first requested row, which saves
+    most of the work when both are localized. The blocks which are not
+    coupled to the nonzero rows, as the separated subdomains of a nested
+    dissection ordering, are skipped too.
+
+    \param algo the factorization of This
+    \param nonZeroRows sorted and disjoint ranges in the numbering of the
+    cluster tree, or NULL if b is dense
+    \param requestedRows sorted and disjoint ranges, or NULL for the whole
+    solution. The other rows of b are unspecified on output.
+   */
+  void solveSparse(ScalarArray<T>* b, Factorization algo,
+                   const std::vector<IndexSet>* nonZeroRows,
+                   const std::vector<IndexSet>* requestedRows) const;
   /*! Triggers an assertion if the HMatrix contains any NaN.
    */
   void checkNan() const;
@@ -636,7 +694,8 @@ public:
   short isUpper:1, isLower:1,       /// symmetric, upper or lower stored
        isTriUpper:1, isTriLower:1, /// upper/lower triangular
        keepSameRows:1, keepSameCols:1,
-       temporary_:1, ownRowsClusterTree_:1, ownColsClusterTree_:1;
+       temporary_:1, ownRowsClusterTree_:1, ownColsClusterTree_:1,
+       deferUpdates_:1;
   LocalSettings localSettings;
 
   int rank() const {
@@ -28,6 +28,7 @@
 #include "disable_threading.hpp"
 #include "json.hpp"
 #include "iengine.hpp"
+#include "serialization.hpp"
 
 #include <cstring>
 #include <fstream>
@@ -38,7 +39,7 @@ namespace hmat {
 template<typename T>
 HMatInterface<T>::HMatInterface(IEngine<T>* engine, const ClusterTree* _rows, const ClusterTree* _cols,
                                 SymmetryFlag sym, AdmissibilityCondition * admissibilityCondition) :
-  engine_(engine),factorizationType(Factorization::NONE)
+  engine_(engine),factorizationType(Factorization::NONE), gemvPlan_(NULL), h2_(NULL), mappedFile_(NULL)
 {
   DECLARE_CONTEXT;
   admissibilityCondition->prepare(*_rows, *_cols);
@@ -48,14 +49,19 @@ HMatInterface<T>::HMatInterface(IEngine<T>* engine, const ClusterTree* _rows, co
 
 template<typename T>
 HMatInterface<T>::~HMatInterface() {
+  if(gemvPlan_)
+    gemvPlan_->forgetLeaves();
+  delete gemvPlan_;
+  delete h2_;
   engine_->destroy();
   delete engine_->hmat;
   delete engine_;
+  delete mappedFile_;
 }
 
 template<typename T>
 HMatInterface<T>::HMatInterface(IEngine<T>* engine, HMatrix<T>* h, Factorization factorization):
-  engine_(engine)
+  engine_(engine), gemvPlan_(NULL), h2_(NULL), mappedFile_(NULL)
 {
   engine_->setHMatrix(h);
       factorizationType = factorization;
@@ -64,6 +70,7 @@ HMatInterface<T>::HMatInterface(IEngine<T>* engine, HMatrix<T>* h, Factorization
 template<typename T>
 void HMatInterface<T>::assemble(Assembly<T>& f, SymmetryFlag sym, bool,
                                    hmat_progress_t * progress, bool ownAssembly) {
+  invalidateGemvPlan();
   DISABLE_THREADING_IN_BLOCK;
   DECLARE_CONTEXT;
   engine_->progress(progress);
@@ -72,18 +79,25 @@ void HMatInterface<T>::assemble(Assembly<T>& f, SymmetryFlag sym, bool,
 
 template<typename T>
 void HMatInterface<T>::factorize(Factorization t, hmat_progress_t * progress) {
+  invalidateGemvPlan();
   DISABLE_THREADING_IN_BLOCK;
   DECLARE_CONTEXT;
   engine_->progress(progress);
   if(progress != NULL)
     progress->max = engine_->hmat->rows()->size();
+  const bool deferred = HMatSettings::getInstance().deferredUpdates;
+  if(deferred)
+    engine_->hmat->deferUpdates(true);
   engine_->factorization(t);
+  if(deferred)
+    engine_->hmat->deferUpdates(false);
   factorizationType = t;
   engine_->hmat->checkStructure();
 }
 
 template<typename T>
 void HMatInterface<T>::inverse(hmat_progress_t * progress) {
+  invalidateGemvPlan();
   DISABLE_THREADING_IN_BLOCK;
   DECLARE_CONTEXT;
   engine_->progress(progress);
@@ -95,21 +109,67 @@ void HMatInterface<T>::gemv(char trans, T alpha, ScalarArray<T>& x, T beta,
                             ScalarArray<T>& y) const {
   DISABLE_THREADING_IN_BLOCK;
   DECLARE_CONTEXT;
-  engine_->gemv(trans, alpha, x, beta, y);
+  if(h2_ && (trans == 'N' || trans == 'T'))
+    h2_->gemv(trans, alpha, x, beta, y);
+  else if(gemvPlan_ && (trans == 'N' || trans == 'T'))
+    gemvPlan_->gemv(trans, alpha, x, beta, y);
+  else {
+    restoreLeaves();
+    engine_->gemv(trans, alpha, x, beta, y);
+  }
 }
 
 template<typename T>
 void HMatInterface<T>::gemm_scalar(char trans, T alpha, ScalarArray<T>& x,
 				      T beta, ScalarArray<T>& y) const {
-  DISABLE_THREADING_IN_BLOCK;
+  gemv(trans, alpha, x, beta, y);
+}
+
+template<typename T>
+void HMatInterface<T>::prepareGemv() {
+  DECLARE_CONTEXT;
+  HMAT_ASSERT_MSG(factorizationType == Factorization::NONE,
+                  "prepareGemv is not supported on factorized matrices");
+  invalidateGemvPlan();
+  gemvPlan_ = new MatvecPlan<T>(engine_->hmat, HMatSettings::getInstance().mixedPrecisionGemv);
+}
+
+template<typename T>
+void HMatInterface<T>::convertToH2(double epsilon) {
   DECLARE_CONTEXT;
-  engine_->gemv( trans, alpha, x, beta, y );
+  HMAT_ASSERT_MSG(factorizationType == Factorization::NONE,
+                  "convertToH2 is not supported on factorized matrices");
+  invalidateGemvPlan();
+  h2_ = new H2Matrix<T>(engine_->hmat, epsilon);
+}
+
+template<typename T>
+void HMatInterface<T>::invalidateGemvPlan() const {
+  delete gemvPlan_;
+  gemvPlan_ = NULL;
+  if(h2_)
+    h2_->restoreLeaves();
+  delete h2_;
+  h2_ = NULL;
+}
+
+template<typename T>
+void HMatInterface<T>::restoreLeaves() const {
+  if(h2_)
+    invalidateGemvPlan();
+}
+
+template<typename T>
+void HMatInterface<T>::mappedFile(MappedFile * file) {
+  delete mappedFile_;
+  mappedFile_ = file;
 }
 
 template<typename T>
 void HMatInterface<T>::gemm(char transA, char transB, T alpha,
                             const HMatInterface<T>* a,
                             const HMatInterface<T>* b, T beta) {
+  invalidateGemvPlan();
     DISABLE_THREADING_IN_BLOCK;
     DECLARE_CONTEXT;
     engine_->gemm(transA, transB, alpha, *a->engine_, *b->engine_, beta);
@@ -119,6 +179,7 @@ void HMatInterface<T>::gemm(char transA, char transB, T alpha,
 template<typename T>
 void HMatInterface<T>::trsm( char side, char uplo, char transa, char diag,
 				T alpha, HMatInterface<T>* B ) {
+    B->invalidateGemvPlan();
     DISABLE_THREADING_IN_BLOCK;
     DECLARE_CONTEXT;
     engine_->trsm( side, uplo, transa, diag, alpha, *B->engine_ );
@@ -178,6 +239,7 @@ void HMatInterface<T>::solve(ScalarArray<T>& b) const {
 
 template<typename T>
 void HMatInterface<T>::solve(HMatInterface<T>& b) const {
+  b.invalidateGemvPlan();
   DISABLE_THREADING_IN_BLOCK;
   DECLARE_CONTEXT;
   engine_->solve(*b.engine_, factorizationType);
@@ -190,8 +252,32 @@ void HMatInterface<T>::solveLower(ScalarArray<T>& b, bool transpose) const {
   engine_->solveLower(b, factorizationType, transpose);
 }
 
+template<typename T>
+void HMatInterface<T>::solveSparse(ScalarArray<T>& b, const std::vector<IndexSet>* nonZeroRows,
+                                   const std::vector<IndexSet>* requestedRows) const {
+  DISABLE_THREADING_IN_BLOCK;
+  DECLARE_CONTEXT;
+  engine_->solveSparse(b, factorizationType, nonZeroRows, requestedRows);
+}
+
+template<typename T>
+void HMatInterface<T>::inverseDiagonal(ScalarArray<T>& d) const {
+  DISABLE_THREADING_IN_BLOCK;
+  DECLARE_CONTEXT;
+  engine_->inverseDiagonal(d, factorizationType);
+}
+
+template<typename T>
+void HMatInterface<T>::inverseBlocks(const std::vector<std::vector<int> >& indices,
+                                     std::vector<ScalarArray<T>*>& blocks) const {
+  DISABLE_THREADING_IN_BLOCK;
+  DECLARE_CONTEXT;
+  engine_->inverseBlocks(indices, blocks, factorizationType);
+}
+
 template<typename T>
 HMatInterface<T>* HMatInterface<T>::copy(bool structOnly) const {
+  restoreLeaves();
   DECLARE_CONTEXT;
   HMatInterface<T>* result = new HMatInterface<T>(engine_->clone(), NULL);
   engine_->copy(*(result->engine_), structOnly);
@@ -202,6 +288,7 @@ HMatInterface<T>* HMatInterface<T>::copy(bool structOnly) const {
 
 template<typename T>
 void HMatInterface<T>::transpose() {
+  invalidateGemvPlan();
   DECLARE_CONTEXT;
   engine_->transpose();
   engine_->hmat->checkStructure();
@@ -209,6 +296,7 @@ void HMatInterface<T>::transpose() {
 
 template<typename T>
 void HMatInterface<T>::scale(T alpha) {
+  invalidateGemvPlan();
   DISABLE_THREADING_IN_BLOCK;
   DECLARE_CONTEXT;
   engine_->scale(alpha);
@@ -216,6 +304,7 @@ void HMatInterface<T>::scale(T alpha) {
 
 template<typename T>
 void HMatInterface<T>::truncate() {
+  invalidateGemvPlan();
   DISABLE_THREADING_IN_BLOCK;
   DECLARE_CONTEXT;
   engine_->hmat->truncate();
@@ -223,12 +312,14 @@ void HMatInterface<T>::truncate() {
 
 template<typename T>
 void HMatInterface<T>::addIdentity(T alpha) {
+  invalidateGemvPlan();
   DECLARE_CONTEXT;
   engine_->addIdentity(alpha);
 }
 
 template<typename T>
 void HMatInterface<T>::addRand(double epsilon) {
+  invalidateGemvPlan();
   DECLARE_CONTEXT;
   engine_->addRand(epsilon);
 }
@@ -236,6 +327,8 @@ void HMatInterface<T>::addRand(double epsilon) {
 template<typename T>
 void HMatInterface<T>::info(hmat_info_t & result) const {
   DECLARE_CONTEXT;
+  // The Rk blocks held by the H2Matrix have no panels
+  restoreLeaves();
     memset(&result, 0, sizeof(hmat_info_t));
     engine_->info(result);
 }
@@ -243,6 +336,7 @@ void HMatInterface<T>::info(hmat_info_t & result) const {
 template<typename T>
 void HMatInterface<T>::dumpTreeToFile(const std::string& filename) const {
   DECLARE_CONTEXT;
+  restoreLeaves();
   std::ofstream out(filename.c_str());
   HMatrixJSONDumper<T>(engine_->hmat, out).dump();
 }
@@ -256,6 +350,7 @@ int HMatInterface<T>::nodesCount() const {
 
 template<typename T>
 void HMatInterface<T>::walk(TreeProcedure<HMatrix<T> > *proc){
+  invalidateGemvPlan();
   DISABLE_THREADING_IN_BLOCK;
   DECLARE_CONTEXT;
   return engine_->hmat->walk(proc);
@@ -263,6 +358,7 @@ void HMatInterface<T>::walk(TreeProcedure<HMatrix<T> > *proc){
 
 template<typename T>
 void HMatInterface<T>::apply_on_leaf(const LeafProcedure<HMatrix<T> >& proc){
+  invalidateGemvPlan();
   DISABLE_THREADING_IN_BLOCK;
   DECLARE_CONTEXT;
   engine_->applyOnLeaf(proc);
@@ -272,6 +368,7 @@ template<typename T>
 HMatrix<T>* HMatInterface<T>::get( int i, int j ) const {
     DISABLE_THREADING_IN_BLOCK;
     DECLARE_CONTEXT;
+    restoreLeaves();
     return engine_->hmat->get(i, j);
 }
 
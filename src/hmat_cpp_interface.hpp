@@ -46,6 +46,8 @@
 #include "compression.hpp"
 #include "h_matrix.hpp"
 #include "iengine.hpp"
+#include "matvec_plan.hpp"
+#include "h2_matrix.hpp"
 #include "common/my_assert.h"
 
 namespace hmat {
@@ -55,6 +57,7 @@ class AdmissibilityCondition;
 
 class DofCoordinates;
 class ClusteringAlgorithm;
+class MappedFile;
 
 /** Settings for the HMatrix library.
 
@@ -81,6 +84,9 @@ public:
   bool dumpTrace; ///< Dump trace at the end of the algorithms (depends on the runtime)
   bool validationDump; ///< For blocks above error threshold, dump the faulty block to disk
   double validationErrorThreshold; ///< Error threshold for the compression validation
+  size_t assemblyMemory; ///< Memory budget of the blocks assembled in parallel, in bytes (0 for no limit)
+  bool mixedPrecisionGemv; ///< Store the Rk blocks of the gemv plan in single precision when accurate enough
+  bool deferredUpdates; ///< Queue the low-rank updates of the Rk blocks during factorization and merge them once
 private:
   /** This constructor sets the default values.
    */
@@ -89,7 +95,8 @@ private:
                    maxLeafSize(200),
                    coarsening(false),
                    validateNullRowCol(false), validateCompression(false),
-                   validationReRun(false), dumpTrace(false), validationDump(false), validationErrorThreshold(0.) {
+                   validationReRun(false), dumpTrace(false), validationDump(false), validationErrorThreshold(0.),
+                   assemblyMemory(0), mixedPrecisionGemv(false), deferredUpdates(false) {
     setParameters();
   }
   // Disable the copy.
@@ -134,6 +141,12 @@ class HMatInterface {
 private:
   IEngine<T>* engine_;
   Factorization factorizationType;
+  /// Flattened copy of the matrix used by gemv, see prepareGemv()
+  mutable MatvecPlan<T>* gemvPlan_;
+  /// Nested bases representation of the matrix used by gemv, see convertToH2()
+  mutable H2Matrix<T>* h2_;
+  /// File the blocks point to when the matrix was loaded with MappedMatrixReader
+  MappedFile* mappedFile_;
 
 public:
   /** Build a new HMatrix from two cluster sets.
@@ -198,9 +211,34 @@ public:
       @param x
       @param beta
       @param y
+      @note When prepareGemv() or convertToH2() has been called, the product
+      is computed with a flattened or H2 copy of the matrix.
    */
   void gemv(char trans, T alpha, ScalarArray<T>& x, T beta, ScalarArray<T>& y) const;
   void gemm_scalar(char trans, T alpha, ScalarArray<T>& x, T beta, ScalarArray<T>& y) const;
+  /** Prepare the matrix for repeated gemv.
+
+      The leaves are moved to a \a MatvecPlan which is used by the next
+      calls to gemv with trans == 'N' or 'T'. The plan is dropped by any
+      method modifying the matrix, and gemv falls back to the recursive
+      product until prepareGemv() is called again.
+   */
+  void prepareGemv();
+  /** Recompress the matrix with nested cluster bases for repeated gemv.
+
+      The \a H2Matrix replaces the plan of prepareGemv() and is used and
+      dropped in the same way. It frees the panels of the Rk blocks, which
+      are rebuilt when it is dropped. Its bases are computed with the
+      relative accuracy epsilon, or the low-rank epsilon of the matrix if
+      epsilon is 0.
+   */
+  void convertToH2(double epsilon = 0);
+  /** Drop the copies built by prepareGemv() and convertToH2(). This must be
+      called when the HMatrix is modified without using this interface. */
+  void invalidateGemvPlan() const;
+  /** Drop the H2Matrix of convertToH2(), whose Rk blocks are only stored in
+      it. This must be called before the HMatrix is read without using gemv. */
+  void restoreLeaves() const;
   /** Matrix-Matrix product.
 
       This computes \f$ C \gets \alpha . op(A) \times op(B) + \beta C\f$ with A,
@@ -277,6 +315,29 @@ public:
       @warning A has to be factored first with \a HMatInterface<T>::factorize().
    */
   void solveLower(ScalarArray<T>& b, bool transpose=false) const;
+  /** Solve the system \f$A x = b\f$ in place, with b zero outside of nonZeroRows and
+      only the rows requestedRows of x being computed, see HMatrix::solveSparse().
+
+      Ranges are sorted, disjoint, in the internal numbering, and NULL means all
+      the rows. The rows of b which are not requested are unspecified on output.
+
+      @warning A has to be factored first with \a HMatInterface<T>::factorize().
+   */
+  void solveSparse(ScalarArray<T>& b, const std::vector<IndexSet>* nonZeroRows,
+                   const std::vector<IndexSet>* requestedRows) const;
+  /** Compute the diagonal of the inverse, in the internal numbering.
+
+      @warning A has to be factored first with the LLT, LDLT, HODLR or
+      HODLRSYM factorization.
+   */
+  void inverseDiagonal(ScalarArray<T>& d) const;
+  /** Compute diagonal blocks of the inverse, blocks[i] = A^-1(indices[i], indices[i]),
+      in the internal numbering.
+
+      @warning A has to be factored first with the LLT, LDLT, HODLR or
+      HODLRSYM factorization.
+   */
+  void inverseBlocks(const std::vector<std::vector<int> >& indices, std::vector<ScalarArray<T>*>& blocks) const;
   /** this <- alpha * this
    */
   void scale(T alpha);
@@ -338,6 +399,7 @@ public:
   }
 
   const IEngine<T> & engine() const {
+      restoreLeaves();
       return *engine_;
   }
 
@@ -352,12 +414,17 @@ public:
   HMatrix<T>* get( int i, int j) const;
 
   void setHMatrix( HMatrix<T> *hmat = NULL) const {
+      invalidateGemvPlan();
       engine_->setHMatrix( hmat );
   }
 
   void progress(hmat_progress_t * progress) {
       engine_->progress(progress);
   }
+
+  /** Take the ownership of the file mapping the blocks of the matrix point
+      to. It is unmapped after the matrix is destroyed. */
+  void mappedFile(MappedFile * file);
 private:
   /// Disallow the copy
   HMatInterface(const HMatInterface<T>& o);
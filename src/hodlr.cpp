@@ -21,6 +21,7 @@
 */
 #include "hodlr.hpp"
 #include "h_matrix.hpp"
+#include "common/task_pool.hpp"
 
 namespace {
 using namespace hmat;
@@ -34,6 +35,19 @@ struct EnvVar {
 };
 static const EnvVar env;
 
+/** Call f0 and f1, which must be independent, concurrently if parallel is true */
+template<typename F0, typename F1> void forkJoin(bool parallel, const F0 & f0, const F1 & f1) {
+  if(parallel) {
+    TaskGraph g;
+    g.submit(f0);
+    f1();
+    g.wait();
+  } else {
+    f0();
+    f1();
+  }
+}
+
 template<typename T> void desymmetrize(HMatrix<T> * m) {
   auto m10 = m->get(1,0);
   auto m01 = m->internalCopy(m10->colsTree(), m10->rowsTree());
@@ -43,14 +57,16 @@ template<typename T> void desymmetrize(HMatrix<T> * m) {
 }
 
 template<typename T>
-void solve(HMatrix<T> * const m, ScalarArray<T> *x, int xOffset, const HODLRNode<T> * node) {
+void solve(HMatrix<T> * const m, ScalarArray<T> *x, int xOffset, const HODLRNode<T> * node, bool parallel) {
   if(m->isLeaf()) {
     ScalarArray<T> xc(*x, m->cols()->offset() - xOffset, m->cols()->size(), 0, x->cols);
     m->solveLlt(&xc);
     return;
   }
-  solve(m->get(0, 0), x, xOffset, node->child0);
-  solve(m->get(1, 1), x, xOffset, node->child1);
+  // The 2 diagonal blocks work on distinct rows of x
+  forkJoin(parallel,
+    [&]{ solve(m->get(0, 0), x, xOffset, node->child0, parallel); },
+    [&]{ solve(m->get(1, 1), x, xOffset, node->child1, parallel); });
   // Compute (I-U.KK.tV).X that is X = X - U.KK.tV.X where
   // U and V are so that tU.V is equal to the 2 anti-diagonal blocks of m which
   // are by (HODLR) definition Rk. U and V are not explicitly created to avoid useless copy.
@@ -74,12 +90,12 @@ void solve(HMatrix<T> * const m, ScalarArray<T> *x, int xOffset, const HODLRNode
 }
 
 template<typename T>
-void solve(HMatrix<T> * const m, HMatrix<T> *x, const HODLRNode<T> * node) {
-  solve(m, x->rk()->a, x->rows()->offset(), node);
+void solve(HMatrix<T> * const m, HMatrix<T> *x, const HODLRNode<T> * node, bool parallel) {
+  solve(m, x->rk()->a, x->rows()->offset(), node, parallel);
 }
 
 template<typename T>
-void factorize(HMatrix<T> * m, HODLRNode<T> * node) {
+void factorize(HMatrix<T> * m, HODLRNode<T> * node, bool parallel) {
   HMAT_ASSERT_MSG(!m->isLeaf(), "Not HODLR matrix");
   // | m00     |   | m00^-1        |   | I    Rk1 |
   // | m01 m11 | = |        m11^-1 | * | Rk0  I   |
@@ -90,20 +106,26 @@ void factorize(HMatrix<T> * m, HODLRNode<T> * node) {
   auto m10 = m->get(1,0);
   HMAT_ASSERT_MSG(m10->isRkMatrix(), "Not HODLR matrix");
   HMAT_ASSERT_MSG(m->get(0,1) == nullptr, "Not lowered stored matrix");
-  if(m00->isLeaf()) {
-    m00->lltDecomposition(nullptr);
-  } else {
-    factorize(m00, node->child0);
-  }
-  if(m11->isLeaf()) {
-    m11->lltDecomposition(nullptr);
-  } else {
-    factorize(m11, node->child1);
-  }
+  forkJoin(parallel,
+    [&]{
+      if(m00->isLeaf()) {
+        m00->lltDecomposition(nullptr);
+      } else {
+        factorize(m00, node->child0, parallel);
+      }
+    },
+    [&]{
+      if(m11->isLeaf()) {
+        m11->lltDecomposition(nullptr);
+      } else {
+        factorize(m11, node->child1, parallel);
+      }
+    });
   desymmetrize(m);
   auto m01 = m->get(0,1);
-  solve(m00, m01, node->child0);
-  solve(m11, m10, node->child1);
+  forkJoin(parallel,
+    [&]{ solve(m00, m01, node->child0, parallel); },
+    [&]{ solve(m11, m10, node->child1, parallel); });
   int r0 = m10->rk()->rank();
   int r1 = m01->rk()->rank();
   // Compute kk=(I+V^t.U)^-1
@@ -116,7 +138,8 @@ void factorize(HMatrix<T> * m, HODLRNode<T> * node) {
 }
 
 template<typename T>
-void solveUpperTriangularLeft(HMatrix<T> * const m, ScalarArray<T> *x, int xOffset, const HODLRNode<T> * node) {
+void solveUpperTriangularLeft(HMatrix<T> * const m, ScalarArray<T> *x, int xOffset, const HODLRNode<T> * node,
+                              bool parallel) {
   if(m->isLeaf()) {
     ScalarArray<T> xc(*x, m->cols()->offset() - xOffset, m->cols()->size(), 0, x->cols);
     m->solveUpperTriangularLeft(&xc, Factorization::LLT, Diag::NONUNIT, Uplo::LOWER);
@@ -131,19 +154,22 @@ void solveUpperTriangularLeft(HMatrix<T> * const m, ScalarArray<T> *x, int xOffs
   tkktax1.gemm('T', 'N', 1, &node->kk, &tax1, 0);
   x1.gemm('N', 'N', -1, m10->rk()->a, &tkktax1, 1);
   m10->gemv('T', -1, &x1, 1, &x0);
-  solveUpperTriangularLeft(m->get(0, 0), x, xOffset, node->child0);
-  solveUpperTriangularLeft(m->get(1, 1), x, xOffset, node->child1);
+  forkJoin(parallel,
+    [&]{ solveUpperTriangularLeft(m->get(0, 0), x, xOffset, node->child0, parallel); },
+    [&]{ solveUpperTriangularLeft(m->get(1, 1), x, xOffset, node->child1, parallel); });
 }
 
 template<typename T>
-void solveLowerTriangularLeft(HMatrix<T> * const m, ScalarArray<T> *x, int xOffset, const HODLRNode<T> * node) {
+void solveLowerTriangularLeft(HMatrix<T> * const m, ScalarArray<T> *x, int xOffset, const HODLRNode<T> * node,
+                              bool parallel) {
   if(m->isLeaf()) {
     ScalarArray<T> xc(*x, m->cols()->offset() - xOffset, m->cols()->size(), 0, x->cols);
     m->solveLowerTriangularLeft(&xc, Factorization::LLT, Diag::NONUNIT, Uplo::LOWER);
     return;
   }
-  solveLowerTriangularLeft(m->get(0, 0), x, xOffset, node->child0);
-  solveLowerTriangularLeft(m->get(1, 1), x, xOffset, node->child1);
+  forkJoin(parallel,
+    [&]{ solveLowerTriangularLeft(m->get(0, 0), x, xOffset, node->child0, parallel); },
+    [&]{ solveLowerTriangularLeft(m->get(1, 1), x, xOffset, node->child1, parallel); });
   auto m10 = m->get(1,0);
   ScalarArray<T> x0(*x, m10->cols()->offset() - xOffset, m10->cols()->size(), 0, x->cols);
   ScalarArray<T> x1(*x, m10->rows()->offset() - xOffset, m10->rows()->size(), 0, x->cols);
@@ -285,7 +311,7 @@ void computeQRSymKK(ScalarArray<T> & ra, HODLRNode<T> * node, ScalarArray<T> & t
 }
 
 template<typename T>
-void factorizeSym(HMatrix<T> * a, HODLRNode<T> * node) {
+void factorizeSym(HMatrix<T> * a, HODLRNode<T> * node, bool parallel) {
   HMAT_ASSERT_MSG(!a->isLeaf(), "Not HODLR matrix");
   // |a00    |   |P00   |   |I   Rk1|   |P00^t     |
   // |a01 a11| = |   P11| * |Rk0 I  | * |     P11^t|
@@ -297,18 +323,24 @@ void factorizeSym(HMatrix<T> * a, HODLRNode<T> * node) {
   HMAT_ASSERT_MSG(a10->isRkMatrix(), "Not HODLR matrix");
   HMAT_ASSERT_MSG(a->get(0,1) == nullptr, "Not lowered stored matrix");
   int r = a10->rank();
-  if(a00->isLeaf()) {
-    a00->lltDecomposition(nullptr);
-  } else {
-    factorizeSym(a00, node->child0);
-  }
-  if(a11->isLeaf()) {
-    a11->lltDecomposition(nullptr);
-  } else {
-    factorizeSym(a11, node->child1);
-  }
-  solveLowerTriangularLeft(a00, a10->rk()->b, a10->cols()->offset(), node->child0);
-  solveLowerTriangularLeft(a11, a10->rk()->a, a10->rows()->offset(), node->child1);
+  forkJoin(parallel,
+    [&]{
+      if(a00->isLeaf()) {
+        a00->lltDecomposition(nullptr);
+      } else {
+        factorizeSym(a00, node->child0, parallel);
+      }
+    },
+    [&]{
+      if(a11->isLeaf()) {
+        a11->lltDecomposition(nullptr);
+      } else {
+        factorizeSym(a11, node->child1, parallel);
+      }
+    });
+  forkJoin(parallel,
+    [&]{ solveLowerTriangularLeft(a00, a10->rk()->b, a10->cols()->offset(), node->child0, parallel); },
+    [&]{ solveLowerTriangularLeft(a11, a10->rk()->a, a10->rows()->offset(), node->child1, parallel); });
   ScalarArray<T> tmp(r, r, false);
   if(env.noQrSym) {
     ScalarArray<T> ata(r, r, false);
@@ -323,7 +355,7 @@ void factorizeSym(HMatrix<T> * a, HODLRNode<T> * node) {
 }
 
 template<typename T> void gemv(char trans, T alpha, HMatrix<T> * const ma, const ScalarArray<T> & x,
-                               T beta, ScalarArray<T> & y, HODLRNode<T> * node, int offset) {
+                               T beta, ScalarArray<T> & y, HODLRNode<T> * node, int offset, bool parallel) {
   if(ma->isLeaf()) {
     ma->gemv(trans, alpha, &x, beta, &y);
     return;
@@ -354,15 +386,17 @@ template<typename T> void gemv(char trans, T alpha, HMatrix<T> * const ma, const
     x1bis.copyMatrixAtOffset(&x1, 0, 0);
     // x1bis = x1 + a.(bT.x0 + X11.aT.x1)
     x1bis.gemm('N', 'N', 1, &a, &x11atx1, 1);
-    gemv(trans, alpha, ma->get(1,1), x1bis, beta, y1, node->child1, offset1);
-    gemv(trans, alpha, ma->get(0,0), x0, beta, y0, node->child0, offset0);
+    forkJoin(parallel,
+      [&]{ gemv(trans, alpha, ma->get(1,1), x1bis, beta, y1, node->child1, offset1, parallel); },
+      [&]{ gemv(trans, alpha, ma->get(0,0), x0, beta, y0, node->child0, offset0, parallel); });
   } else {
     // |y0|    |I b.a^T|   |L0^T    |   |x0|
     // |y1| += |  W11^T| x |    L1^T| x |x1|
     ScalarArray<T> l1tx1(x1.rows, x1.cols, false);
     // y0 <- beta*y0 + alpha*L0^T*x0
-    gemv(trans, alpha, ma->get(0,0), x0, beta, y0, node->child0, offset0);
-    gemv<T>(trans, alpha, ma->get(1,1), x1, 0, l1tx1, node->child1, offset1);
+    forkJoin(parallel,
+      [&]{ gemv(trans, alpha, ma->get(0,0), x0, beta, y0, node->child0, offset0, parallel); },
+      [&]{ gemv<T>(trans, alpha, ma->get(1,1), x1, 0, l1tx1, node->child1, offset1, parallel); });
     ScalarArray<T> atl1tx1(r, x1.cols, false);
     ScalarArray<T> x11atl1tx1(r, x1.cols, false);
     atl1tx1.gemm('T', 'N', 1, &a, &l1tx1, 0);
@@ -376,6 +410,161 @@ template<typename T> void gemv(char trans, T alpha, HMatrix<T> * const ma, const
   }
 }
 
+
+/**
+ * @brief Compute the low-rank part of the inverse of a HODLR node
+ *
+ * The inverse of m is diag(m00^-1, m11^-1) - p.q, where p and q are n x r
+ * and r x n with r the size of the Woodbury system of the node.
+ */
+template<typename T>
+void inverseCorrection(HMatrix<T> * const m, const HODLRNode<T> * node, ScalarArray<T> & p, ScalarArray<T> & q,
+                       bool parallel) {
+  auto m10 = m->get(1,0);
+  const int offset0 = m10->cols()->offset();
+  const int offset1 = m10->rows()->offset();
+  const int n0 = m10->cols()->size();
+  const int n1 = m10->rows()->size();
+  if(node->isSymmetric()) {
+    // m = W.(I+U.K.U^t).W^t where W = diag(W0, W1) are the factors of the
+    // children, U = diag(b, a) the panels of m10 already multiplied by W0^-1
+    // and W1^-1, and K = [0 I; I 0]. With Woodbury:
+    // m^-1 = diag(m00^-1, m11^-1) - W^-t.U.(K+U^t.U)^-1.U^t.W^-1
+    const int r = m10->rank();
+    ScalarArray<T> p0(p, 0, n0, 0, r);
+    ScalarArray<T> p1(p, n0, n1, r, r);
+    p0.copyMatrixAtOffset(m10->rk()->b, 0, 0);
+    p1.copyMatrixAtOffset(m10->rk()->a, 0, 0);
+    forkJoin(parallel,
+      [&]{ solveUpperTriangularLeft(m->get(0, 0), &p0, offset0, node->child0, parallel); },
+      [&]{ solveUpperTriangularLeft(m->get(1, 1), &p1, offset1, node->child1, parallel); });
+    ScalarArray<T> kutu(2 * r, 2 * r);
+    ScalarArray<T> btb(kutu, 0, r, 0, r);
+    ScalarArray<T> ata(kutu, r, r, r, r);
+    ScalarArray<T> k01(kutu, 0, r, r, r);
+    ScalarArray<T> k10(kutu, r, r, 0, r);
+    btb.gemm('T', 'N', 1, m10->rk()->b, m10->rk()->b, 0);
+    ata.gemm('T', 'N', 1, m10->rk()->a, m10->rk()->a, 0);
+    k01.addIdentity(1);
+    k10.addIdentity(1);
+    p.copyAndTranspose(&q);
+    int * pivots = new int[kutu.rows];
+    kutu.luDecomposition(pivots);
+    FactorizationData<T> fd = { Factorization::LU, { pivots }};
+    kutu.solve(&q, fd);
+    delete[] pivots;
+  } else {
+    // m = diag(m00, m11).(I+U.V^t) where U = diag(a01, a10), the panels of
+    // the off-diagonal blocks already multiplied by m00^-1 and m11^-1, and
+    // V^t.x = (b01^t.x1, b10^t.x0). As m00 and m11 are symmetric:
+    // m^-1 = diag(m00^-1, m11^-1) - U.kk.(diag(m00^-1, m11^-1).V)^t
+    auto m01 = m->get(0,1);
+    const int r1 = m01->rank();
+    const int r0 = m10->rank();
+    ScalarArray<T> p0(p, 0, n0, 0, r1);
+    ScalarArray<T> p1(p, n0, n1, r1, r0);
+    p0.copyMatrixAtOffset(m01->rk()->a, 0, 0);
+    p1.copyMatrixAtOffset(m10->rk()->a, 0, 0);
+    ScalarArray<T> z0(n0, r0, false);
+    ScalarArray<T> z1(n1, r1, false);
+    z0.copyMatrixAtOffset(m10->rk()->b, 0, 0);
+    z1.copyMatrixAtOffset(m01->rk()->b, 0, 0);
+    forkJoin(parallel,
+      [&]{ solve(m->get(0, 0), &z0, offset0, node->child0, parallel); },
+      [&]{ solve(m->get(1, 1), &z1, offset1, node->child1, parallel); });
+    ScalarArray<T> q01(q, 0, r1, n0, n1);
+    ScalarArray<T> q10(q, r1, r0, 0, n0);
+    z1.copyAndTranspose(&q01);
+    z0.copyAndTranspose(&q10);
+    FactorizationData<T> fd = { Factorization::LU, { node->pivot }};
+    node->kk.solve(&q, fd);
+  }
+}
+
+template<typename T> int inverseCorrectionRank(HMatrix<T> * const m, const HODLRNode<T> * node) {
+  return node->isSymmetric() ? 2 * m->get(1,0)->rank() : node->kk.rows;
+}
+
+/** Inverse of a LLt factorized leaf */
+template<typename T> void leafInverse(HMatrix<T> * const m, ScalarArray<T> & inv) {
+  inv.addIdentity(1);
+  m->solveLlt(&inv);
+}
+
+template<typename T>
+void inverseDiagonal(HMatrix<T> * const m, ScalarArray<T> & d, int dOffset, const HODLRNode<T> * node,
+                     bool parallel) {
+  const int n = m->rows()->size();
+  ScalarArray<T> dm(d, m->rows()->offset() - dOffset, n, 0, 1);
+  if(m->isLeaf()) {
+    ScalarArray<T> inv(n, n);
+    leafInverse(m, inv);
+    for(int i = 0; i < n; i++)
+      dm.get(i) = inv.get(i, i);
+    return;
+  }
+  forkJoin(parallel,
+    [&]{ inverseDiagonal(m->get(0, 0), d, dOffset, node->child0, parallel); },
+    [&]{ inverseDiagonal(m->get(1, 1), d, dOffset, node->child1, parallel); });
+  const int r = inverseCorrectionRank(m, node);
+  ScalarArray<T> p(n, r);
+  ScalarArray<T> q(r, n);
+  inverseCorrection(m, node, p, q, parallel);
+  for(int k = 0; k < r; k++)
+    for(int i = 0; i < n; i++)
+      dm.get(i) -= p.get(i, k) * q.get(k, i);
+}
+
+/**
+ * @param indices the rows of each block, relative to the root
+ * @param members for each block, the positions in indices which are in m
+ */
+template<typename T>
+void inverseBlocks(HMatrix<T> * const m, const HODLRNode<T> * node, int rootOffset,
+                   const std::vector<std::vector<int> > & indices,
+                   const std::vector<std::vector<int> > & members,
+                   std::vector<ScalarArray<T>*> & blocks, bool parallel) {
+  bool empty = true;
+  for(size_t s = 0; s < members.size(); s++)
+    empty = empty && members[s].empty();
+  if(empty)
+    return;
+  const int n = m->rows()->size();
+  const int offset = m->rows()->offset() - rootOffset;
+  if(m->isLeaf()) {
+    ScalarArray<T> inv(n, n);
+    leafInverse(m, inv);
+    for(size_t s = 0; s < members.size(); s++)
+      for(int k : members[s])
+        for(int l : members[s])
+          blocks[s]->get(k, l) += inv.get(indices[s][k] - offset, indices[s][l] - offset);
+    return;
+  }
+  const int r = inverseCorrectionRank(m, node);
+  ScalarArray<T> p(n, r);
+  ScalarArray<T> q(r, n);
+  inverseCorrection(m, node, p, q, parallel);
+  const int n0 = m->get(0, 0)->rows()->size();
+  std::vector<std::vector<int> > members0(members.size()), members1(members.size());
+  for(size_t s = 0; s < members.size(); s++) {
+    for(int k : members[s]) {
+      const int i = indices[s][k] - offset;
+      (i < n0 ? members0 : members1)[s].push_back(k);
+      for(int l : members[s]) {
+        const int j = indices[s][l] - offset;
+        T pq = 0;
+        for(int c = 0; c < r; c++)
+          pq += p.get(i, c) * q.get(c, j);
+        blocks[s]->get(k, l) -= pq;
+      }
+    }
+  }
+  // The 2 halves update distinct entries of the blocks
+  forkJoin(parallel,
+    [&]{ inverseBlocks(m->get(0, 0), node->child0, rootOffset, indices, members0, blocks, parallel); },
+    [&]{ inverseBlocks(m->get(1, 1), node->child1, rootOffset, indices, members1, blocks, parallel); });
+}
+
 }
 namespace hmat {
 
@@ -400,15 +589,23 @@ template<typename T> struct HODLRNode {
   T detm11_;
 
   HODLRNode(int n, int x11n): x11(x11n, x11n),
-    kk(n, n), pivot(x11n == 0 ? new int[n] : nullptr), detm11_(0) {}
+    kk(n, n), pivot(x11n == 0 ? new int[n] : nullptr), detm11_(0) {
+    // The factors of the Rk blocks are accounted with them
+    x11.memoryCategory(MemoryCounters::RK);
+    kk.memoryCategory(MemoryCounters::RK);
+    if(pivot)
+      MemoryCounters::add(MemoryCounters::PIVOTS, n * sizeof(int));
+  }
 
   ~HODLRNode() {
+    if(pivot)
+      MemoryCounters::add(MemoryCounters::PIVOTS, -(ptrdiff_t)(kk.rows * sizeof(int)));
     delete[] pivot;
     delete child0;
     delete child1;
   }
 
-  bool isSymmetric() {
+  bool isSymmetric() const {
     assert((x11.rows > 0) == (pivot == nullptr));
     return x11.rows > 0;
   }
@@ -427,48 +624,71 @@ template<typename T> struct HODLRNode {
 };
 
 template<typename T>
-void HODLR<T>::solve(HMatrix<T> * const m, HMatrix<T> *x) const {
-  ::solve(m, x, root);
+void HODLR<T>::solve(HMatrix<T> * const m, HMatrix<T> *x, bool parallel) const {
+  ::solve(m, x, root, parallel);
 }
 
 template<typename T>
-void HODLR<T>::solve(HMatrix<T> * const m, ScalarArray<T> &x) const {
-  ::solve(m, &x, 0, root);
+void HODLR<T>::solve(HMatrix<T> * const m, ScalarArray<T> &x, bool parallel) const {
+  ::solve(m, &x, 0, root, parallel);
 }
 
 template<typename T>
-void HODLR<T>::factorize(HMatrix<T> * m, hmat_progress_t* p) {
+void HODLR<T>::factorize(HMatrix<T> * m, hmat_progress_t* p, bool parallel) {
   root = HODLRNode<T>::create(m, false);
-  ::factorize(m, root);
+  ::factorize(m, root, parallel);
 }
 
 template<typename T>
-void HODLR<T>::factorizeSym(HMatrix<T> * m, hmat_progress_t* p) {
+void HODLR<T>::factorizeSym(HMatrix<T> * m, hmat_progress_t* p, bool parallel) {
   HMAT_ASSERT_MSG(hmat::Types<T>::IS_REAL::value, "Complex HODLR symmetric factorization is not supported.");
   root = HODLRNode<T>::create(m, true);
-  ::factorizeSym(m, root);
+  ::factorizeSym(m, root, parallel);
 }
 
 template<typename T>
-void HODLR<T>::solveSymUpper(HMatrix<T> * const m, ScalarArray<T> &x) const {
+void HODLR<T>::solveSymUpper(HMatrix<T> * const m, ScalarArray<T> &x, bool parallel) const {
   assert(x.rows == m->rows()->size());
   assert(m->cols()->size() == m->rows()->size());
-  ::solveUpperTriangularLeft(m, &x, 0, root);
+  ::solveUpperTriangularLeft(m, &x, 0, root, parallel);
 }
 
 template<typename T>
-void HODLR<T>::solveSymLower(HMatrix<T> * const m, ScalarArray<T> &x) const {
+void HODLR<T>::solveSymLower(HMatrix<T> * const m, ScalarArray<T> &x, bool parallel) const {
   assert(x.rows == m->rows()->size());
   assert(m->cols()->size() == m->rows()->size());
-  ::solveLowerTriangularLeft(m, &x, 0, root);
+  ::solveLowerTriangularLeft(m, &x, 0, root, parallel);
 }
 
-template<typename T> void HODLR<T>::gemv(char trans, T alpha, HMatrix<T> * const a, ScalarArray<T> & x, T beta, ScalarArray<T> & y) const {
+template<typename T> void HODLR<T>::gemv(char trans, T alpha, HMatrix<T> * const a, ScalarArray<T> & x, T beta, ScalarArray<T> & y,
+                                         bool parallel) const {
   HMAT_ASSERT_MSG(root != nullptr && root->isSymmetric(), "gemv is only supported for symmetrically factorized HODLR matrices");
   HMAT_ASSERT(trans == 'N' || trans == 'T');
   HMAT_ASSERT(x.cols == y.cols);
   HMAT_ASSERT(x.rows == y.rows);
-  ::gemv(trans, alpha, a, x, beta, y, root, 0);
+  ::gemv(trans, alpha, a, x, beta, y, root, 0, parallel);
+}
+
+template<typename T>
+void HODLR<T>::inverseDiagonal(HMatrix<T> * const m, ScalarArray<T> & d, bool parallel) const {
+  HMAT_ASSERT_MSG(root != nullptr, "The matrix is not HODLR factorized");
+  HMAT_ASSERT(d.rows == m->rows()->size() && d.cols == 1);
+  ::inverseDiagonal(m, d, m->rows()->offset(), root, parallel);
+}
+
+template<typename T>
+void HODLR<T>::inverseBlocks(HMatrix<T> * const m, const std::vector<std::vector<int> > & indices,
+                             std::vector<ScalarArray<T>*> & blocks, bool parallel) const {
+  HMAT_ASSERT_MSG(root != nullptr, "The matrix is not HODLR factorized");
+  HMAT_ASSERT(indices.size() == blocks.size());
+  std::vector<std::vector<int> > members(indices.size());
+  for(size_t s = 0; s < indices.size(); s++) {
+    HMAT_ASSERT(blocks[s]->rows == (int)indices[s].size() && blocks[s]->cols == (int)indices[s].size());
+    blocks[s]->clear();
+    for(size_t k = 0; k < indices[s].size(); k++)
+      members[s].push_back(k);
+  }
+  ::inverseBlocks(m, root, m->rows()->offset(), indices, members, blocks, parallel);
 }
 
 template<typename T> bool HODLR<T>::isFactorized() const {
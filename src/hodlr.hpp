@@ -21,6 +21,7 @@
 */
 #include "hmat/hmat.h"
 #include "data_types.hpp"
+#include <vector>
 namespace hmat {
 template<typename T> class HMatrix;
 template<typename T> class ScalarArray;
@@ -39,16 +40,38 @@ template<typename T> struct HODLRNode;
 template<typename T> class HODLR {
   HODLRNode<T> * root = nullptr;
 public:
-  void factorize(HMatrix<T> *, hmat_progress_t*);
-  void factorizeSym(HMatrix<T> *, hmat_progress_t*);
+  /**
+   * In all the following methods, if parallel is true the 2 halves of each
+   * node are processed by concurrent tasks.
+   */
+  void factorize(HMatrix<T> *, hmat_progress_t*, bool parallel = false);
+  void factorizeSym(HMatrix<T> *, hmat_progress_t*, bool parallel = false);
   /** @brief solve with a Rk RHS */
-  void solve(HMatrix<T> * const a, HMatrix<T> *b) const;
-  void solve(HMatrix<T> * const a, ScalarArray<T> & b) const;
-  void solveSymLower(HMatrix<T> * const a, ScalarArray<T> & b) const;
-  void solveSymUpper(HMatrix<T> * const a, ScalarArray<T> & b) const;
+  void solve(HMatrix<T> * const a, HMatrix<T> *b, bool parallel = false) const;
+  void solve(HMatrix<T> * const a, ScalarArray<T> & b, bool parallel = false) const;
+  void solveSymLower(HMatrix<T> * const a, ScalarArray<T> & b, bool parallel = false) const;
+  void solveSymUpper(HMatrix<T> * const a, ScalarArray<T> & b, bool parallel = false) const;
   bool isFactorized() const;
-  void gemv(char trans, T alpha, HMatrix<T> * const a, ScalarArray<T> & x, T beta, ScalarArray<T> & y) const;
+  void gemv(char trans, T alpha, HMatrix<T> * const a, ScalarArray<T> & x, T beta, ScalarArray<T> & y,
+            bool parallel = false) const;
   typename Types<T>::dp logdet(HMatrix<T> * const a) const;
+  /**
+   * @brief Diagonal of the inverse of the factorized matrix
+   *
+   * Each node of the HODLR tree adds a low-rank correction to the inverses of
+   * its 2 halves (Woodbury identity), which only requires solves with the
+   * halves on as many columns as the rank of the node.
+   * @param d the n x 1 result, in the internal numbering
+   */
+  void inverseDiagonal(HMatrix<T> * const a, ScalarArray<T> & d, bool parallel = false) const;
+  /**
+   * @brief Diagonal blocks of the inverse of the factorized matrix
+   *
+   * @param indices the rows (and columns) of each block, in the internal numbering
+   * @param blocks the results, of size indices[i].size() x indices[i].size()
+   */
+  void inverseBlocks(HMatrix<T> * const a, const std::vector<std::vector<int> > & indices,
+                     std::vector<ScalarArray<T>*> & blocks, bool parallel = false) const;
   ~HODLR();
 };
 }
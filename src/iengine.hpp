@@ -60,6 +60,10 @@ namespace hmat {
 
     virtual void solveLower(ScalarArray<T> &b, Factorization t, bool transpose) const = 0;
 
+    /** solve() with b zero outside of nonZeroRows and only requestedRows of x computed, see HMatrix::solveSparse() */
+    virtual void solveSparse(ScalarArray<T> &b, Factorization, const std::vector<IndexSet> *nonZeroRows,
+                             const std::vector<IndexSet> *requestedRows) const = 0;
+
     virtual void transpose() = 0;
 
     virtual void applyOnLeaf(const hmat::LeafProcedure<hmat::HMatrix<T> > &f) = 0;
@@ -78,6 +82,11 @@ namespace hmat {
 
     virtual void scale(T alpha) = 0;
     virtual typename hmat::Types<T>::dp logdet() const = 0;
+    /** d <- diag(A^-1) of the factorized matrix, in the internal numbering */
+    virtual void inverseDiagonal(ScalarArray<T> &d, Factorization) const = 0;
+    /** blocks[i] <- A^-1(indices[i], indices[i]) of the factorized matrix, in the internal numbering */
+    virtual void inverseBlocks(const std::vector<std::vector<int> > &indices,
+                               std::vector<ScalarArray<T>*> &blocks, Factorization) const = 0;
     virtual double norm() const = 0;
   protected:
     hmat_progress_t *progress_;
@@ -0,0 +1,409 @@
+/*
+  HMat-OSS (HMatrix library, open source software)
+
+  Copyright (C) 2014-2015 Airbus Group SAS
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+  http://github.com/jeromerobert/hmat-oss
+*/
+
+#include "iterative_solver.hpp"
+#include "hmat_cpp_interface.hpp"
+#include "fromdouble.hpp"
+#include "common/context.hpp"
+#include "common/my_assert.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace {
+
+using hmat::ScalarArray;
+
+/** Return x^H.y */
+template<typename T>
+T dotc(const ScalarArray<T> & x, const ScalarArray<T> & y) {
+  const hmat::Vector<T> vx(x, 0);
+  const hmat::Vector<T> vy(y, 0);
+  return hmat::Vector<T>::dot(&vx, &vy);
+}
+
+/** Return x^T.y, the bilinear form of COCG */
+template<typename T>
+T dotu(const ScalarArray<T> & x, const ScalarArray<T> & y) {
+  T result = 0;
+  for (int i = 0; i < x.rows; i++)
+    result += x.get(i, 0) * y.get(i, 0);
+  return result;
+}
+
+/** Apply the Givens rotation (c, s) to (a, b) */
+template<typename T>
+void rotate(typename hmat::Types<T>::real c, T s, T & a, T & b) {
+  const T t = c * a + s * b;
+  b = c * b - hmat::conj(s) * a;
+  a = t;
+}
+
+/** Compute the Givens rotation which cancels b in (a, b) */
+template<typename T>
+void givens(T a, T b, typename hmat::Types<T>::real & c, T & s) {
+  typedef typename hmat::Types<T>::real real_t;
+  const real_t absA = std::abs(a);
+  if (absA == 0) {
+    c = 0;
+    s = 1;
+    return;
+  }
+  const real_t norm = std::sqrt(absA * absA + std::abs(b) * std::abs(b));
+  c = absA / norm;
+  s = (a / absA) * hmat::conj(b) / norm;
+}
+
+/** Return a single precision copy of h */
+hmat::HMatrix<hmat::S_t> * singlePrecisionCopy(const hmat::HMatrix<hmat::S_t> * h) {
+  return h->copy();
+}
+hmat::HMatrix<hmat::S_t> * singlePrecisionCopy(const hmat::HMatrix<hmat::D_t> * h) {
+  return hmat::fromDoubleHMatrix<hmat::S_t>(h);
+}
+hmat::HMatrix<hmat::C_t> * singlePrecisionCopy(const hmat::HMatrix<hmat::C_t> * h) {
+  return h->copy();
+}
+hmat::HMatrix<hmat::C_t> * singlePrecisionCopy(const hmat::HMatrix<hmat::Z_t> * h) {
+  return hmat::fromDoubleHMatrix<hmat::C_t>(h);
+}
+
+}
+
+namespace hmat {
+
+template<typename T>
+IterativeSolver<T>::IterativeSolver(const HMatInterface<T> & a, const HMatInterface<T> * preconditioner)
+  : method(IterativeMethod::GMRES), tolerance(1e-6), maxIterations(1000), restart(30),
+    a_(a), preconditioner_(preconditioner), lowPreconditioner_(NULL), iterations_(0), residual_(0) {
+  HMAT_ASSERT_MSG(a.rows()->size() == a.cols()->size(), "The matrix of an iterative solve must be square");
+  HMAT_ASSERT_MSG(preconditioner == NULL || (preconditioner->rows()->size() == a.rows()->size() &&
+                                            preconditioner->cols()->size() == a.cols()->size()),
+                  "The preconditioner and the matrix have different sizes");
+}
+
+template<typename T>
+void IterativeSolver<T>::lowPrecisionPreconditioner(const HMatInterface<sp_t> * preconditioner) {
+  HMAT_ASSERT_MSG(preconditioner == NULL || (preconditioner->rows()->size() == a_.rows()->size() &&
+                                            preconditioner->cols()->size() == a_.cols()->size()),
+                  "The preconditioner and the matrix have different sizes");
+  preconditioner_ = NULL;
+  lowPreconditioner_ = preconditioner;
+}
+
+template<typename T>
+HMatInterface<typename Types<T>::sp> *
+IterativeSolver<T>::createLowPrecisionPreconditioner(const HMatInterface<T> & a,
+                                                     std::unique_ptr<IEngine<sp_t> > engine,
+                                                     Factorization factorization,
+                                                     hmat_progress_t * progress) {
+  DECLARE_CONTEXT;
+  HMatInterface<sp_t> * result = new HMatInterface<sp_t>(engine.get(), singlePrecisionCopy(a.engine().hmat));
+  // The engine is owned by result from now on
+  engine.release();
+  try {
+    // Truncations below the rounding error would only keep noise
+    const double minEpsilon = 10 * std::numeric_limits<typename Types<sp_t>::real>::epsilon();
+    if (a.engine().hmat->lowRankEpsilon() < minEpsilon)
+      result->engine().hmat->lowRankEpsilon(minEpsilon);
+    result->factorize(factorization, progress);
+  } catch (...) {
+    delete result;
+    throw;
+  }
+  return result;
+}
+
+template<typename T>
+HMatInterface<T> * IterativeSolver<T>::createPreconditioner(const HMatInterface<T> & a, double epsilon,
+                                                            Factorization factorization,
+                                                            hmat_progress_t * progress) {
+  DECLARE_CONTEXT;
+  HMatInterface<T> * result = a.copy();
+  try {
+    result->engine().hmat->lowRankEpsilon(epsilon);
+    result->truncate();
+    result->factorize(factorization, progress);
+  } catch (...) {
+    delete result;
+    throw;
+  }
+  return result;
+}
+
+template<typename T>
+void IterativeSolver<T>::apply(const ScalarArray<T> & x, ScalarArray<T> & y) const {
+  a_.gemv('N', 1, const_cast<ScalarArray<T> &>(x), 0, y);
+}
+
+template<typename T>
+void IterativeSolver<T>::precondition(const ScalarArray<T> & v, ScalarArray<T> & z) const {
+  if (lowPreconditioner_) {
+    ScalarArray<sp_t> low(v.rows, v.cols, false);
+    for (int j = 0; j < v.cols; j++)
+      for (int i = 0; i < v.rows; i++)
+        low.get(i, j) = sp_t(v.get(i, j));
+    lowPreconditioner_->solve(low);
+    for (int j = 0; j < v.cols; j++)
+      for (int i = 0; i < v.rows; i++)
+        z.get(i, j) = T(low.get(i, j));
+    return;
+  }
+  z.copyMatrixAtOffset(&v, 0, 0);
+  if (preconditioner_)
+    preconditioner_->solve(z);
+}
+
+template<typename T>
+void IterativeSolver<T>::residualVector(const ScalarArray<T> & b, const ScalarArray<T> & x,
+                                        ScalarArray<T> & r) const {
+  r.copyMatrixAtOffset(&b, 0, 0);
+  a_.gemv('N', -1, const_cast<ScalarArray<T> &>(x), 1, r);
+}
+
+template<typename T>
+int IterativeSolver<T>::gmres(const ScalarArray<T> & b, ScalarArray<T> & x, bool flexible,
+                              double & residual) const {
+  typedef typename Types<T>::real real_t;
+  const int n = b.rows;
+  const int m = std::max(1, std::min(restart, n));
+  const double bNorm = b.norm();
+  // Krylov basis, and the preconditioned basis of flexible GMRES
+  ScalarArray<T> v(n, m + 1);
+  ScalarArray<T> z(n, flexible ? m : 1);
+  // Hessenberg matrix, reduced to upper triangular by Givens rotations
+  ScalarArray<T> h(m + 1, m);
+  std::vector<real_t> c(m);
+  std::vector<T> s(m);
+  std::vector<T> g(m + 1);
+  ScalarArray<T> r(n, 1);
+  ScalarArray<T> tmp(n, 1);
+
+  residualVector(b, x, r);
+  double beta = r.norm();
+  int iterations = 0;
+  while (true) {
+    residual = beta / bNorm;
+    if (residual <= tolerance || iterations >= maxIterations)
+      break;
+    ScalarArray<T> v0(v, 0, n, 0, 1);
+    v0.copyMatrixAtOffset(&r, 0, 0);
+    v0.scale(T(1 / beta));
+    std::fill(g.begin(), g.end(), T(0));
+    g[0] = beta;
+
+    int k = 0;
+    while (k < m && iterations < maxIterations) {
+      const ScalarArray<T> vk(v, 0, n, k, 1);
+      ScalarArray<T> zk(z, 0, n, flexible ? k : 0, 1);
+      precondition(vk, zk);
+      ScalarArray<T> w(v, 0, n, k + 1, 1);
+      apply(zk, w);
+      // Modified Gram-Schmidt
+      for (int i = 0; i <= k; i++) {
+        const ScalarArray<T> vi(v, 0, n, i, 1);
+        h.get(i, k) = dotc(vi, w);
+        w.axpy(-h.get(i, k), &vi);
+      }
+      const double wNorm = w.norm();
+      h.get(k + 1, k) = wNorm;
+      if (wNorm > 0)
+        w.scale(T(1 / wNorm));
+      for (int i = 0; i < k; i++)
+        rotate(c[i], s[i], h.get(i, k), h.get(i + 1, k));
+      givens(h.get(k, k), h.get(k + 1, k), c[k], s[k]);
+      rotate(c[k], s[k], h.get(k, k), h.get(k + 1, k));
+      rotate(c[k], s[k], g[k], g[k + 1]);
+      k++;
+      iterations++;
+      // wNorm == 0 is a lucky breakdown: x is in the Krylov space
+      if (std::abs(g[k]) <= tolerance * bNorm || wNorm == 0)
+        break;
+    }
+
+    // y <- H^-1.g, stored in g
+    for (int i = k - 1; i >= 0; i--) {
+      for (int j = i + 1; j < k; j++)
+        g[i] -= h.get(i, j) * g[j];
+      g[i] /= h.get(i, i);
+    }
+    ScalarArray<T> y(g.data(), k, 1);
+    if (flexible) {
+      const ScalarArray<T> zs(z, 0, n, 0, k);
+      x.gemm('N', 'N', 1, &zs, &y, 1);
+    } else {
+      const ScalarArray<T> vs(v, 0, n, 0, k);
+      r.gemm('N', 'N', 1, &vs, &y, 0);
+      precondition(r, tmp);
+      x.axpy(1, &tmp);
+    }
+    residualVector(b, x, r);
+    beta = r.norm();
+  }
+  return iterations;
+}
+
+template<typename T>
+int IterativeSolver<T>::cg(const ScalarArray<T> & b, ScalarArray<T> & x, double & residual) const {
+  const int n = b.rows;
+  const double bNorm = b.norm();
+  ScalarArray<T> r(n, 1);
+  ScalarArray<T> z(n, 1);
+  ScalarArray<T> p(n, 1);
+  ScalarArray<T> q(n, 1);
+  residualVector(b, x, r);
+  residual = r.norm() / bNorm;
+  precondition(r, z);
+  p.copyMatrixAtOffset(&z, 0, 0);
+  T rho = dotu(r, z);
+  int iterations = 0;
+  while (residual > tolerance && iterations < maxIterations) {
+    apply(p, q);
+    const T alpha = rho / dotu(p, q);
+    x.axpy(alpha, &p);
+    r.axpy(-alpha, &q);
+    iterations++;
+    residual = r.norm() / bNorm;
+    if (residual <= tolerance)
+      break;
+    precondition(r, z);
+    const T rhoNew = dotu(r, z);
+    // p <- z + (rhoNew / rho).p
+    p.scale(rhoNew / rho);
+    p.axpy(1, &z);
+    rho = rhoNew;
+  }
+  return iterations;
+}
+
+template<typename T>
+int IterativeSolver<T>::bicgstab(const ScalarArray<T> & b, ScalarArray<T> & x, double & residual) const {
+  const int n = b.rows;
+  const double bNorm = b.norm();
+  ScalarArray<T> r(n, 1);
+  ScalarArray<T> r0(n, 1);
+  ScalarArray<T> p(n, 1);
+  ScalarArray<T> v(n, 1);
+  ScalarArray<T> pHat(n, 1);
+  ScalarArray<T> sHat(n, 1);
+  ScalarArray<T> t(n, 1);
+  residualVector(b, x, r);
+  r0.copyMatrixAtOffset(&r, 0, 0);
+  residual = r.norm() / bNorm;
+  T rho = 1, alpha = 1, omega = 1;
+  int iterations = 0;
+  while (residual > tolerance && iterations < maxIterations) {
+    const T rhoNew = dotc(r0, r);
+    if (rhoNew == T(0))
+      break;
+    // p <- r + beta.(p - omega.v)
+    const T beta = (rhoNew / rho) * (alpha / omega);
+    p.axpy(-omega, &v);
+    p.scale(beta);
+    p.axpy(1, &r);
+    precondition(p, pHat);
+    apply(pHat, v);
+    alpha = rhoNew / dotc(r0, v);
+    // r becomes s = r - alpha.v
+    r.axpy(-alpha, &v);
+    x.axpy(alpha, &pHat);
+    iterations++;
+    residual = r.norm() / bNorm;
+    if (residual <= tolerance)
+      break;
+    precondition(r, sHat);
+    apply(sHat, t);
+    const double tNorm = t.norm();
+    if (tNorm == 0)
+      break;
+    omega = dotc(t, r) / T(tNorm * tNorm);
+    x.axpy(omega, &sHat);
+    r.axpy(-omega, &t);
+    residual = r.norm() / bNorm;
+    rho = rhoNew;
+  }
+  return iterations;
+}
+
+template<typename T>
+int IterativeSolver<T>::refinement(const ScalarArray<T> & b, ScalarArray<T> & x, double & residual) const {
+  const int n = b.rows;
+  const double bNorm = b.norm();
+  ScalarArray<T> r(n, 1);
+  ScalarArray<T> d(n, 1);
+  residualVector(b, x, r);
+  residual = r.norm() / bNorm;
+  int iterations = 0;
+  while (residual > tolerance && iterations < maxIterations) {
+    precondition(r, d);
+    x.axpy(1, &d);
+    residualVector(b, x, r);
+    iterations++;
+    const double newResidual = r.norm() / bNorm;
+    if (newResidual >= residual) {
+      // Stagnation or divergence, M is not accurate enough
+      x.axpy(-1, &d);
+      break;
+    }
+    residual = newResidual;
+  }
+  return iterations;
+}
+
+template<typename T>
+bool IterativeSolver<T>::solve(const ScalarArray<T> & b, ScalarArray<T> & x) {
+  DECLARE_CONTEXT;
+  HMAT_ASSERT(b.rows == a_.rows()->size() && x.rows == b.rows && x.cols == b.cols);
+  iterations_ = 0;
+  residual_ = 0;
+  for (int col = 0; col < b.cols; col++) {
+    const ScalarArray<T> bc(b, 0, b.rows, col, 1);
+    ScalarArray<T> xc(x, 0, x.rows, col, 1);
+    if (bc.norm() == 0) {
+      xc.clear();
+      continue;
+    }
+    double residual = 0;
+    int iterations = 0;
+    switch (method) {
+    case IterativeMethod::GMRES: iterations = gmres(bc, xc, false, residual); break;
+    case IterativeMethod::FGMRES: iterations = gmres(bc, xc, true, residual); break;
+    case IterativeMethod::CG: iterations = cg(bc, xc, residual); break;
+    case IterativeMethod::BICGSTAB: iterations = bicgstab(bc, xc, residual); break;
+    case IterativeMethod::REFINEMENT: iterations = refinement(bc, xc, residual); break;
+    default: HMAT_ASSERT_MSG(false, "Unknown iterative method %d", (int)method);
+    }
+    iterations_ = std::max(iterations_, iterations);
+    residual_ = std::max(residual_, residual);
+  }
+  return residual_ <= tolerance;
+}
+
+// Explicit template instantiation
+template class IterativeSolver<S_t>;
+template class IterativeSolver<D_t>;
+template class IterativeSolver<C_t>;
+template class IterativeSolver<Z_t>;
+
+}  // end namespace hmat
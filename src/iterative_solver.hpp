@@ -0,0 +1,143 @@
+/*
+  HMat-OSS (HMatrix library, open source software)
+
+  Copyright (C) 2014-2015 Airbus Group SAS
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+  http://github.com/jeromerobert/hmat-oss
+*/
+
+/*! \file
+  \ingroup HMatrix
+  \brief Krylov solvers preconditioned by a factorized HMatrix.
+*/
+#ifndef _HMAT_ITERATIVE_SOLVER_HPP
+#define _HMAT_ITERATIVE_SOLVER_HPP
+
+#include "hmat/hmat.h"
+#include "scalar_array.hpp"
+#include <memory>
+
+namespace hmat {
+
+template<typename T> class HMatInterface;
+template<typename T> class IEngine;
+
+enum class IterativeMethod {
+    GMRES = hmat_iterative_gmres,
+    FGMRES = hmat_iterative_fgmres,
+    CG = hmat_iterative_cg,
+    BICGSTAB = hmat_iterative_bicgstab,
+    REFINEMENT = hmat_iterative_refinement
+};
+
+/*! \brief Krylov solver for A.x = b.
+
+  The products by A use HMatInterface::gemv, so they benefit from
+  HMatInterface::prepareGemv() or HMatInterface::convertToH2(). The
+  preconditioner is an optional factorized matrix M approximating A, which
+  is applied with HMatInterface::solve(). It is typically a copy of A
+  recompressed at a large epsilon, see createPreconditioner().
+
+  GMRES, flexible GMRES and BiCGStab are right preconditioned, so the
+  residual they monitor is the one of the original system. CG requires a
+  symmetric positive definite A and M (LLT or LDLT factorization). For
+  complex matrices, CG is the conjugate orthogonal variant (COCG) which
+  applies to complex symmetric matrices, as the symmetric HMatrix.
+  Iterative refinement repeats x <- x + M^-1.(b - A.x) and stops when the
+  residual no longer decreases.
+
+  The preconditioner may be factorized in single precision, see
+  createLowPrecisionPreconditioner(). Iterative refinement then recovers
+  the double precision accuracy when M is accurate enough, and GMRES
+  (GMRES-IR) is the robust alternative.
+
+  Vectors are in the internal numbering of the matrix. Each column of b is
+  solved independently.
+ */
+template<typename T> class IterativeSolver {
+public:
+  /**
+   * @param a the matrix of the system, square with the same rows and cols
+   * @param preconditioner a factorized approximation of a, or NULL
+   */
+  IterativeSolver(const HMatInterface<T> & a, const HMatInterface<T> * preconditioner = NULL);
+  typedef typename Types<T>::sp sp_t;
+  /** Use a single precision preconditioner instead of the one given to the constructor */
+  void lowPrecisionPreconditioner(const HMatInterface<sp_t> * preconditioner);
+
+  /** Krylov method, the default is GMRES */
+  IterativeMethod method;
+  /** Stop when ||b - A.x|| <= tolerance.||b|| */
+  double tolerance;
+  /** Maximum number of iterations for each column of b */
+  int maxIterations;
+  /** Dimension of the Krylov space before GMRES restarts */
+  int restart;
+
+  /**
+   * Solve A.x = b.
+   * @param b the right-hand sides
+   * @param x the initial guess, replaced by the solution
+   * @return true if all the columns converged
+   */
+  bool solve(const ScalarArray<T> & b, ScalarArray<T> & x);
+  /** Largest number of iterations of the columns in the last solve() */
+  int iterations() const { return iterations_; }
+  /** Largest relative residual of the columns in the last solve() */
+  double residual() const { return residual_; }
+
+  /**
+   * Return a factorized copy of a, recompressed with a low-rank epsilon
+   * larger than the one of a, to be used as preconditioner.
+   */
+  static HMatInterface<T> * createPreconditioner(const HMatInterface<T> & a, double epsilon,
+                                                 Factorization factorization,
+                                                 hmat_progress_t * progress = NULL);
+  /**
+   * Return a factorized single precision copy of a, to be used with
+   * lowPrecisionPreconditioner(). The copy shares the cluster trees of a,
+   * and its low-rank epsilon is bounded by the single precision accuracy.
+   * @param engine the engine of the copy, owned by the result, deleted on error
+   */
+  static HMatInterface<sp_t> * createLowPrecisionPreconditioner(const HMatInterface<T> & a,
+                                                                std::unique_ptr<IEngine<sp_t> > engine,
+                                                                Factorization factorization,
+                                                                hmat_progress_t * progress = NULL);
+
+private:
+  const HMatInterface<T> & a_;
+  const HMatInterface<T> * preconditioner_;
+  const HMatInterface<sp_t> * lowPreconditioner_;
+  int iterations_;
+  double residual_;
+
+  /** y <- A.x */
+  void apply(const ScalarArray<T> & x, ScalarArray<T> & y) const;
+  /** z <- M^-1.v */
+  void precondition(const ScalarArray<T> & v, ScalarArray<T> & z) const;
+  /** r <- b - A.x */
+  void residualVector(const ScalarArray<T> & b, const ScalarArray<T> & x, ScalarArray<T> & r) const;
+  /** Solve a single right-hand side, return the number of iterations and set residual */
+  int gmres(const ScalarArray<T> & b, ScalarArray<T> & x, bool flexible, double & residual) const;
+  int cg(const ScalarArray<T> & b, ScalarArray<T> & x, double & residual) const;
+  int bicgstab(const ScalarArray<T> & b, ScalarArray<T> & x, double & residual) const;
+  int refinement(const ScalarArray<T> & b, ScalarArray<T> & x, double & residual) const;
+};
+
+}  // end namespace hmat
+
+#endif
@@ -0,0 +1,271 @@
+/*
+  HMat-OSS (HMatrix library, open source software)
+
+  Copyright (C) 2014-2015 Airbus Group SAS
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+  http://github.com/jeromerobert/hmat-oss
+*/
+
+#include "matvec_plan.hpp"
+#include "h_matrix.hpp"
+#include "rk_matrix.hpp"
+#include "full_matrix.hpp"
+#include "common/context.hpp"
+#include "common/my_assert.h"
+#include "common/memory_instrumentation.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <type_traits>
+
+namespace {
+/// Elements of T promoted at once by the mixed precision gemv, so that they stay in cache
+const size_t promotionChunk = 16384;
+
+template<typename T, typename S> void promote(const S * from, size_t n, T * to) {
+  for (size_t i = 0; i < n; i++)
+    to[i] = T(from[i]);
+}
+}
+
+namespace hmat {
+
+template<typename T>
+void MatvecPlan<T>::collect(const HMatrix<T> * h, char trans, const HMatrix<T> * root,
+                            std::vector<const HMatrix<T> *> & blocks) {
+  if (h->isVoid())
+    return;
+  if (h->isLeaf()) {
+    if (h->isNull() || (h->isRkMatrix() && h->rk() == NULL))
+      return;
+    Leaf l;
+    l.rowsOffset = h->rows()->offset() - root->rows()->offset();
+    l.rowsSize = h->rows()->size();
+    l.colsOffset = h->cols()->offset() - root->cols()->offset();
+    l.colsSize = h->cols()->size();
+    l.mirror = trans != 'N';
+    l.rank = h->isRkMatrix() ? h->rank() : -1;
+    l.offset = 0;
+    l.low = false;
+    leaves_.push_back(l);
+    blocks.push_back(h);
+    return;
+  }
+  // Same traversal as HMatrix::gemv
+  for (int i = 0, iend = (trans == 'N' ? h->nrChildRow() : h->nrChildCol()); i < iend; i++) {
+    for (int j = 0, jend = (trans == 'N' ? h->nrChildCol() : h->nrChildRow()); j < jend; j++) {
+      char t = trans;
+      const HMatrix<T> * child = h->getChildForGEMM(t, i, j);
+      if (child)
+        collect(child, t, root, blocks);
+    }
+  }
+}
+
+template<typename T>
+bool MatvecPlan<T>::isLowPrecisionAccurate(const HMatrix<T> * h) {
+  // Rounding a and b perturbs a.b^T by about 2.u.|a|.|b|
+  const RkMatrix<T> * rk = h->rk();
+  const double u = 2 * std::numeric_limits<typename Types<sp_t>::real>::epsilon();
+  const double eps = h->lowRankEpsilon();
+  return u * u * rk->a->normSqr() * rk->b->normSqr() <= eps * eps * rk->normSqr();
+}
+
+template<typename T>
+MatvecPlan<T>::MatvecPlan(HMatrix<T> * h, bool mixedPrecision)
+  : fullBytes_(0), rkBytes_(0), rows_(h->rows()->size()), cols_(h->cols()->size()), maxRank_(0) {
+  DECLARE_CONTEXT;
+  std::vector<const HMatrix<T> *> blocks;
+  collect(h, 'N', h, blocks);
+
+  // Sort by the first row of y updated by y <- h.x
+  std::vector<size_t> order(leaves_.size());
+  for (size_t i = 0; i < order.size(); i++)
+    order[i] = i;
+  std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+    const Leaf & la = leaves_[a];
+    const Leaf & lb = leaves_[b];
+    return (la.mirror ? la.colsOffset : la.rowsOffset) < (lb.mirror ? lb.colsOffset : lb.rowsOffset);
+  });
+
+  std::vector<Leaf> sorted(leaves_.size());
+  std::vector<const HMatrix<T> *> sortedBlocks(leaves_.size());
+  for (size_t i = 0; i < order.size(); i++) {
+    sorted[i] = leaves_[order[i]];
+    sortedBlocks[i] = blocks[order[i]];
+  }
+  leaves_.swap(sorted);
+
+  mixedPrecision = mixedPrecision && !std::is_same<sp_t, T>::value;
+  // Blocks of a symmetric matrix may appear twice but are stored once
+  std::map<const HMatrix<T> *, const Leaf *> stored;
+  size_t total = 0;
+  size_t lowTotal = 0;
+  for (size_t i = 0; i < leaves_.size(); i++) {
+    Leaf & l = leaves_[i];
+    maxRank_ = std::max(maxRank_, l.rank);
+    typename std::map<const HMatrix<T> *, const Leaf *>::iterator it = stored.find(sortedBlocks[i]);
+    if (it != stored.end()) {
+      l.offset = it->second->offset;
+      l.low = it->second->low;
+      sortedBlocks[i] = NULL;
+      continue;
+    }
+    stored[sortedBlocks[i]] = &l;
+    if (l.rank < 0) {
+      l.offset = total;
+      total += (size_t)l.rowsSize * l.colsSize;
+      fullBytes_ += (size_t)l.rowsSize * l.colsSize * sizeof(T);
+    } else if (mixedPrecision && l.rank > 0 && isLowPrecisionAccurate(sortedBlocks[i])) {
+      l.low = true;
+      l.offset = lowTotal;
+      lowTotal += (size_t)(l.rowsSize + l.colsSize) * l.rank;
+      rkBytes_ += (size_t)(l.rowsSize + l.colsSize) * l.rank * sizeof(sp_t);
+    } else {
+      l.offset = total;
+      total += (size_t)(l.rowsSize + l.colsSize) * l.rank;
+      rkBytes_ += (size_t)(l.rowsSize + l.colsSize) * l.rank * sizeof(T);
+    }
+  }
+
+  arena_.resize(total);
+  lowArena_.resize(lowTotal);
+  MemoryCounters::add(MemoryCounters::FULL, fullBytes_);
+  MemoryCounters::add(MemoryCounters::RK, rkBytes_);
+  for (size_t i = 0; i < leaves_.size(); i++) {
+    const Leaf & l = leaves_[i];
+    const HMatrix<T> * b = sortedBlocks[i];
+    if (b == NULL)
+      continue;
+    if (l.low) {
+      // A rounded copy, the double precision panels are left in the matrix
+      sp_t * data = lowArena_.data() + l.offset;
+      const ScalarArray<T> * panels[2] = { b->rk()->a, b->rk()->b };
+      for (int p = 0; p < 2; p++)
+        for (int k = 0; k < l.rank; k++)
+          for (int r = 0; r < panels[p]->rows; r++)
+            *data++ = sp_t(panels[p]->get(r, k));
+      continue;
+    }
+    // The leaf arrays now use the arena instead of their own memory
+    T * data = arena_.data() + l.offset;
+    if (l.rank < 0) {
+      ScalarArray<T> * f = &b->full()->data;
+      Moved m = { f, f->moveData(data) };
+      moved_.push_back(m);
+    } else if (l.rank > 0) {
+      ScalarArray<T> * panels[2] = { b->rk()->a, b->rk()->b };
+      Moved ma = { panels[0], panels[0]->moveData(data) };
+      Moved mb = { panels[1], panels[1]->moveData(data + (size_t)l.rowsSize * l.rank) };
+      moved_.push_back(ma);
+      moved_.push_back(mb);
+    }
+  }
+}
+
+template<typename T>
+MatvecPlan<T>::~MatvecPlan() {
+  for (size_t i = 0; i < moved_.size(); i++)
+    moved_[i].array->restoreData(moved_[i].previous);
+  MemoryCounters::add(MemoryCounters::FULL, -(ptrdiff_t)fullBytes_);
+  MemoryCounters::add(MemoryCounters::RK, -(ptrdiff_t)rkBytes_);
+}
+
+template<typename T>
+size_t MatvecPlan<T>::memorySize() const {
+  return arena_.size() * sizeof(T) + lowArena_.size() * sizeof(sp_t);
+}
+
+template<typename T>
+void MatvecPlan<T>::lowPrecisionGemv(const Leaf & l, bool transposed, T alpha, const ScalarArray<T> & x,
+                                     ScalarArray<T> & y, ScalarArray<T> & z, T * scratch) const {
+  // y <- y + alpha.a.b^T.x, or y <- y + alpha.b.a^T.x when transposed. The
+  // panels are promoted by chunks of columns into scratch, then applied with gemm.
+  const sp_t * a = lowArena_.data() + l.offset;
+  const sp_t * b = a + (size_t)l.rowsSize * l.rank;
+  const sp_t * in = transposed ? a : b;
+  const sp_t * out = transposed ? b : a;
+  assert(x.rows == (transposed ? l.rowsSize : l.colsSize));
+  assert(y.rows == (transposed ? l.colsSize : l.rowsSize));
+  const int inStep = std::max(1, (int)(promotionChunk / x.rows));
+  for (int k = 0; k < l.rank; k += inStep) {
+    const int n = std::min(inStep, l.rank - k);
+    promote(in + (size_t)k * x.rows, (size_t)x.rows * n, scratch);
+    const ScalarArray<T> chunk(scratch, x.rows, n);
+    ScalarArray<T> subZ(z, k, n, 0, x.cols);
+    subZ.gemm('T', 'N', 1, &chunk, &x, 0);
+  }
+  const int outStep = std::max(1, (int)(promotionChunk / y.rows));
+  for (int k = 0; k < l.rank; k += outStep) {
+    const int n = std::min(outStep, l.rank - k);
+    promote(out + (size_t)k * y.rows, (size_t)y.rows * n, scratch);
+    const ScalarArray<T> chunk(scratch, y.rows, n);
+    const ScalarArray<T> subZ(z, k, n, 0, x.cols);
+    y.gemm('N', 'N', alpha, &chunk, &subZ, 1);
+  }
+}
+
+template<typename T>
+void MatvecPlan<T>::gemv(char trans, T alpha, const ScalarArray<T> & x, T beta, ScalarArray<T> & y) const {
+  DECLARE_CONTEXT;
+  HMAT_ASSERT(trans == 'N' || trans == 'T');
+  assert(x.cols == y.cols);
+  assert((trans == 'N' ? rows_ : cols_) == y.rows);
+  assert((trans == 'N' ? cols_ : rows_) == x.rows);
+  if (rows_ == 0 || cols_ == 0)
+    return;
+  if (beta != T(1))
+    y.scale(beta);
+  ScalarArray<T> z(std::max(maxRank_, 1), x.cols, false);
+  // Promoted chunk of a single precision panel, of at least one column
+  std::vector<T> scratch(lowArena_.empty() ? 0 : std::max(promotionChunk, (size_t)std::max(rows_, cols_)));
+  for (size_t i = 0; i < leaves_.size(); i++) {
+    const Leaf & l = leaves_[i];
+    // The block is applied transposed in op(h) when trans and mirror differ
+    const char t = (trans == 'N') == l.mirror ? 'T' : 'N';
+    const bool transposed = t == 'T';
+    const ScalarArray<T> subX(x, transposed ? l.rowsOffset : l.colsOffset,
+                              transposed ? l.rowsSize : l.colsSize, 0, x.cols);
+    ScalarArray<T> subY(y, transposed ? l.colsOffset : l.rowsOffset,
+                        transposed ? l.colsSize : l.rowsSize, 0, y.cols);
+    if (l.low) {
+      lowPrecisionGemv(l, transposed, alpha, subX, subY, z, scratch.data());
+      continue;
+    }
+    T * data = const_cast<T*>(arena_.data()) + l.offset;
+    if (l.rank < 0) {
+      const ScalarArray<T> f(data, l.rowsSize, l.colsSize);
+      subY.gemm(t, 'N', alpha, &f, &subX, 1);
+    } else if (l.rank > 0) {
+      const ScalarArray<T> a(data, l.rowsSize, l.rank);
+      const ScalarArray<T> b(data + (size_t)l.rowsSize * l.rank, l.colsSize, l.rank);
+      ScalarArray<T> subZ(z, 0, l.rank, 0, x.cols);
+      // Y <- Y + alpha * A * B^T * X or Y <- Y + alpha * B * A^T * X
+      subZ.gemm('T', 'N', 1, transposed ? &a : &b, &subX, 0);
+      subY.gemm('N', 'N', alpha, transposed ? &b : &a, &subZ, 1);
+    }
+  }
+}
+
+// Explicit template instantiation
+template class MatvecPlan<S_t>;
+template class MatvecPlan<D_t>;
+template class MatvecPlan<C_t>;
+template class MatvecPlan<Z_t>;
+
+}  // end namespace hmat
@@ -0,0 +1,119 @@
+/*
+  HMat-OSS (HMatrix library, open source software)
+
+  Copyright (C) 2014-2015 Airbus Group SAS
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+  http://github.com/jeromerobert/hmat-oss
+*/
+
+/*! \file
+  \ingroup HMatrix
+  \brief Flattened representation of an HMatrix for repeated matrix-vector products.
+*/
+#ifndef _MATVEC_PLAN_HPP
+#define _MATVEC_PLAN_HPP
+
+#include "scalar_array.hpp"
+#include <vector>
+
+namespace hmat {
+
+template<typename T> class HMatrix;
+
+/*! \brief Flat list of the leaves of an HMatrix, for fast repeated gemv.
+
+  The leaves are sorted by the offset of the rows of y they update, and
+  their full or Rk data are moved to a single contiguous arena. A product
+  is then a linear sweep over the leaves, without tree traversal.
+
+  The arrays of the leaves point to the arena while the plan is alive, so
+  that the matrix is not stored twice, and the plan gives them their data
+  back when it is deleted. It must be deleted before the HMatrix is
+  modified, and rebuilt afterwards.
+  Lower or upper stored symmetric matrices are supported, the stored
+  off-diagonal blocks being applied a second time, transposed, as in
+  HMatrix::gemv.
+
+  In mixed precision mode, the Rk blocks of double precision matrices are
+  stored in single precision when the rounding error is below their
+  low-rank epsilon, and promoted on the fly in gemv. This halves the
+  bandwidth used by these blocks. They are rounded copies: the double
+  precision panels are left in the HMatrix, which is unchanged when the
+  plan is deleted.
+ */
+template<typename T> class MatvecPlan {
+  struct Leaf {
+    /// Offsets of the block rows and cols relative to the matrix rows and cols
+    int rowsOffset, rowsSize, colsOffset, colsSize;
+    /// True for the transposed copy of a block of a symmetric matrix
+    bool mirror;
+    /// Rank of a Rk block, -1 for a full block
+    int rank;
+    /// Offset of the full data or of the Rk a panel (followed by b) in the arena
+    size_t offset;
+    /// True if the Rk panels are stored in lowArena_
+    bool low;
+  };
+  typedef typename Types<T>::sp sp_t;
+  std::vector<Leaf> leaves_;
+  std::vector<T> arena_;
+  std::vector<sp_t> lowArena_;
+  /// A leaf array whose data is in the plan
+  struct Moved {
+    ScalarArray<T> * array;
+    /// Value returned by ScalarArray::moveData()
+    T * previous;
+  };
+  std::vector<Moved> moved_;
+  /// Bytes of arena_ accounted as MemoryCounters::FULL and MemoryCounters::RK
+  size_t fullBytes_, rkBytes_;
+  int rows_, cols_;
+  int maxRank_;
+
+  void collect(const HMatrix<T> * h, char trans, const HMatrix<T> * root,
+               std::vector<const HMatrix<T> *> & blocks);
+  /** Return true if the Rk block h can be stored in sp_t */
+  static bool isLowPrecisionAccurate(const HMatrix<T> * h);
+  void lowPrecisionGemv(const Leaf & l, bool transposed, T alpha, const ScalarArray<T> & x,
+                        ScalarArray<T> & y, ScalarArray<T> & z, T * scratch) const;
+  MatvecPlan(const MatvecPlan&);
+  void operator=(const MatvecPlan&);
+public:
+  /**
+   * @param mixedPrecision store the Rk blocks in single precision when
+   * accurate enough. Ignored for single precision matrices.
+   */
+  MatvecPlan(HMatrix<T> * h, bool mixedPrecision = false);
+  /** Give their data back to the leaves, see forgetLeaves() */
+  ~MatvecPlan();
+  /** Do not touch the leaves in the destructor, because the HMatrix is deleted */
+  void forgetLeaves() {
+    moved_.clear();
+  }
+  /**
+   * y <- alpha.op(h).x + beta.y, with the same meaning as
+   * HMatrix::gemv(trans, alpha, &x, beta, &y, Side::LEFT).
+   * @param trans 'N' or 'T'
+   */
+  void gemv(char trans, T alpha, const ScalarArray<T> & x, T beta, ScalarArray<T> & y) const;
+  /** Size of the arenas in bytes */
+  size_t memorySize() const;
+};
+
+}  // end namespace hmat
+
+#endif
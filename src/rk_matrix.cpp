@@ -32,12 +32,19 @@
 #include "common/context.hpp"
 #include "common/my_assert.h"
 #include "common/timeline.hpp"
+#include "common/memory_instrumentation.hpp"
 #include "lapack_exception.hpp"
 
 #include <algorithm>
 
 namespace hmat {
 
+/** Account for the memory of a panel which now belongs to a RkMatrix */
+template<typename T> static void rkPanel(ScalarArray<T>* panel) {
+  if (panel)
+    panel->memoryCategory(MemoryCounters::RK);
+}
+
 /** RkApproximationControl */
 template<typename T> RkApproximationControl RkMatrix<T>::approx;
 
@@ -49,7 +56,8 @@ template<typename T> RkMatrix<T>::RkMatrix(ScalarArray<T>* _a, const IndexSet* _
     a(_a),
     b(_b)
 {
-
+  rkPanel(a);
+  rkPanel(b);
   // We make a special case for empty matrices.
   if ((!a) && (!b)) {
     return;
@@ -332,9 +340,11 @@ template<typename T> void RkMatrix<T>::truncate(double epsilon, int initialPivot
   ScalarArray<T>* newA = truncatedAB(a, rows, newK, u, useInitPivot, initialPivotA);
   delete a;
   a = newA;
+  rkPanel(a);
   ScalarArray<T>* newB = truncatedAB(b, cols, newK, v, useInitPivot, initialPivotB);
   delete b;
   b = newB;
+  rkPanel(b);
 }
 
 template<typename T> void RkMatrix<T>::mGSTruncate(double epsilon, int initialPivotA, int initialPivotB) {
@@ -402,8 +412,10 @@ template<typename T> void RkMatrix<T>::mGSTruncate(double epsilon, int initialPi
 
   delete a;
   a = newA;
+  rkPanel(a);
   delete b;
   b = newB;
+  rkPanel(b);
 }
 
 // Swap members with members from another instance.
@@ -604,6 +616,7 @@ void RkMatrix<T>::formattedAddParts(double epsilon, const T* alpha, const RkMatr
   if(!useRealloc && a != NULL)
     delete a;
   a = resultA;
+  rkPanel(a);
 
   if(useRealloc) {
     resultB = b;
@@ -626,6 +639,7 @@ void RkMatrix<T>::formattedAddParts(double epsilon, const T* alpha, const RkMatr
   if(!useRealloc && b != NULL)
     delete b;
   b = resultB;
+  rkPanel(b);
 
   assert(rankOffset==rankTotal);
   // If only one of the parts is non-zero, then the recompression is not necessary
@@ -1076,6 +1090,8 @@ template<typename T> void RkMatrix<T>::copy(const RkMatrix<T>* o) {
   cols = o->cols;
   a = (o->a ? o->a->copy() : NULL);
   b = (o->b ? o->b->copy() : NULL);
+  rkPanel(a);
+  rkPanel(b);
 }
 
 template<typename T> RkMatrix<T>* RkMatrix<T>::copy() const {
@@ -32,6 +32,7 @@
 #include "blas_overloads.hpp"
 #include "lapack_exception.hpp"
 #include "common/memory_instrumentation.hpp"
+#include "common/buffer_pool.hpp"
 #include "system_types.h"
 #include "common/my_assert.h"
 #include "common/context.hpp"
@@ -57,11 +58,6 @@
 
 #include <stdlib.h>
 
-#ifdef HAVE_JEMALLOC
-#define JEMALLOC_NO_DEMANGLE
-#include <jemalloc/jemalloc.h>
-#endif
-
 namespace {
 struct EnvVar {
   bool sumCriterion;
@@ -174,7 +170,7 @@ int convert_factorization_to_int(Factorization f) {
 /** ScalarArray */
 template<typename T>
 ScalarArray<T>::ScalarArray(T* _m, int _rows, int _cols, int _lda)
-  : ownsMemory(false), m(_m), rows(_rows), cols(_cols), lda(_lda) {
+  : ownsMemory(false), memoryCategory_(MemoryCounters::TEMPORARY), memoryBytes_(0), m(_m), rows(_rows), cols(_cols), lda(_lda) {
   if (lda == -1) {
     lda = rows;
   }
@@ -187,36 +183,29 @@ ScalarArray<T>::ScalarArray(T* _m, int _rows, int _cols, int _lda)
 
 template<typename T>
 ScalarArray<T>::ScalarArray(int _rows, int _cols, bool initzero)
-  : ownsMemory(true), ownsFlag(true), rows(_rows), cols(_cols), lda(_rows) {
+  : ownsMemory(true), memoryCategory_(MemoryCounters::TEMPORARY), memoryBytes_(0), ownsFlag(true), rows(_rows), cols(_cols), lda(_rows) {
   size_t size = sizeof(T) * rows * cols;
   if(size == 0) {
     m = nullptr;
     return;
   }
-  void * p;
-#ifdef HAVE_JEMALLOC
-  p = initzero ? je_calloc(size, 1) : je_malloc(size);
-#else
-  p = initzero ? calloc(size, 1) : malloc(size);
-#endif
-  m = static_cast<T*>(p);
+  m = static_cast<T*>(BufferPool::allocate(size, initzero));
 #ifdef HMAT_SCALAR_ARRAY_ORTHO
   is_ortho = (int*)calloc(1, sizeof(int));
   setOrtho(initzero ? 1 : 0); // buffer filled with 0 is orthogonal
 #endif
   HMAT_ASSERT_MSG(m, "Trying to allocate %ldb of memory failed (rows=%d cols=%d sizeof(T)=%d)", size, rows, cols, sizeof(T));
   MemoryInstrumenter::instance().alloc(size, MemoryInstrumenter::FULL_MATRIX);
+  memoryBytes_ = size;
+  MemoryCounters::add(MemoryCounters::TEMPORARY, size);
 }
 
 template<typename T> ScalarArray<T>::~ScalarArray() {
   if (ownsMemory) {
     size_t size = ((size_t) rows) * cols * sizeof(T);
     MemoryInstrumenter::instance().free(size, MemoryInstrumenter::FULL_MATRIX);
-#ifdef HAVE_JEMALLOC
-    je_free(m);
-#else
-    free(m);
-#endif
+    MemoryCounters::add(MemoryCounters::Category(memoryCategory_), -(ptrdiff_t)memoryBytes_);
+    BufferPool::release(m);
     m = NULL;
   }
 #ifdef HMAT_SCALAR_ARRAY_ORTHO
@@ -231,6 +220,21 @@ template<typename T> void ScalarArray<T>::resize(int col_num) {
   assert(ownsFlag);
   if(col_num > cols)
     setOrtho(0);
+  if(!ownsMemory) {
+    // The data is not ours (for example a mapped file), take a copy
+    size_t size = sizeof(T) * rows * col_num;
+    T* r = static_cast<T*>(BufferPool::allocate(size, false));
+    for(int j = 0; j < std::min(cols, col_num); j++)
+      memcpy(r + (size_t)rows * j, m + (size_t)lda * j, sizeof(T) * rows);
+    MemoryInstrumenter::instance().alloc(size, MemoryInstrumenter::FULL_MATRIX);
+    memoryBytes_ = size;
+    MemoryCounters::add(MemoryCounters::Category(memoryCategory_), size);
+    m = r;
+    lda = rows;
+    cols = col_num;
+    ownsMemory = true;
+    return;
+  }
   int diffcol = col_num - cols;
   if(diffcol > 0)
     MemoryInstrumenter::instance().alloc(sizeof(T) * rows * diffcol,
@@ -239,12 +243,48 @@ template<typename T> void ScalarArray<T>::resize(int col_num) {
     MemoryInstrumenter::instance().free(sizeof(T) * rows * -diffcol,
                                         MemoryInstrumenter::FULL_MATRIX);
   cols = col_num;
-#ifdef HAVE_JEMALLOC
-  void * p = je_realloc(m, sizeof(T) * rows * cols);
-#else
-  void * p = realloc(m, sizeof(T) * rows * cols);
-#endif
-  m = static_cast<T*>(p);
+  const size_t size = sizeof(T) * rows * cols;
+  MemoryCounters::add(MemoryCounters::Category(memoryCategory_), (ptrdiff_t)size - (ptrdiff_t)memoryBytes_);
+  memoryBytes_ = size;
+  m = static_cast<T*>(BufferPool::reallocate(m, sizeof(T) * rows * cols));
+}
+
+template<typename T> T* ScalarArray<T>::moveData(T* ptr) {
+  for(int j = 0; j < cols; j++)
+    memcpy(ptr + (size_t)rows * j, m + (size_t)lda * j, sizeof(T) * rows);
+  T* previous = NULL;
+  if(ownsMemory) {
+    MemoryInstrumenter::instance().free(sizeof(T) * rows * cols, MemoryInstrumenter::FULL_MATRIX);
+    MemoryCounters::add(MemoryCounters::Category(memoryCategory_), -(ptrdiff_t)memoryBytes_);
+    memoryBytes_ = 0;
+    BufferPool::release(m);
+    ownsMemory = false;
+  } else {
+    assert(lda == rows);
+    previous = m;
+  }
+  m = ptr;
+  lda = rows;
+  return previous;
+}
+
+template<typename T> void ScalarArray<T>::restoreData(T* previous) {
+  assert(!ownsMemory && lda == rows);
+  if(previous != NULL) {
+    // Do not dirty the pages of a private mapping if nothing changed
+    const size_t size = sizeof(T) * rows * cols;
+    if(memcmp(previous, m, size) != 0)
+      memcpy(previous, m, size);
+    m = previous;
+  } else {
+    // Same as resize() on memory which is not ours
+    resize(cols);
+  }
+}
+
+template<typename T> void ScalarArray<T>::memoryCategory(int category) {
+  MemoryCounters::move(MemoryCounters::Category(memoryCategory_), MemoryCounters::Category(category), memoryBytes_);
+  memoryCategory_ = category;
 }
 
 template<typename T> void ScalarArray<T>::clear() {
@@ -559,10 +599,17 @@ template<typename T> void ScalarArray<T>::fromFile(const char * filename) {
   HMAT_ASSERT(r == 1);
   r = fseek(f, 2 * sizeof(int), SEEK_CUR);
   HMAT_ASSERT(r == 0);
-  if(m)
-      free(m);
+  if(ownsMemory) {
+    MemoryInstrumenter::instance().free(memoryBytes_, MemoryInstrumenter::FULL_MATRIX);
+    BufferPool::release(m);
+  }
+  // A view (for example of a mapped file) now owns the buffer it reads
   size_t size = ((size_t) rows) * cols * sizeof(T);
-  m = (T*) calloc(size, 1);
+  m = (T*) BufferPool::allocate(size, true);
+  MemoryInstrumenter::instance().alloc(size, MemoryInstrumenter::FULL_MATRIX);
+  MemoryCounters::add(MemoryCounters::Category(memoryCategory_), (ptrdiff_t)size - (ptrdiff_t)memoryBytes_);
+  memoryBytes_ = size;
+  ownsMemory = true;
   r = fread(ptr(), size, 1, f);
   fclose(f);
   HMAT_ASSERT(r == 1);
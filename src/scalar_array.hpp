@@ -31,6 +31,7 @@
 #include "assert.h"
 #include "data_types.hpp"
 #include "hmat/hmat.h"
+#include "common/memory_instrumentation.hpp"
 
 namespace hmat {
 
@@ -90,6 +91,10 @@ template<typename T> class ScalarArray {
 private:
   /*! True if the matrix owns its memory, ie has to free it upon destruction */
   char ownsMemory:1;
+  /*! MemoryCounters::Category of the memory owned by the array */
+  unsigned char memoryCategory_;
+  /*! Bytes accounted in MemoryCounters, rows and cols may be reduced without reallocation */
+  size_t memoryBytes_;
 protected:
   /// Fortran style pointer (columnwise)
   T* m;
@@ -114,7 +119,7 @@ public:
 
       \param d a ScalarArray
    */
-  ScalarArray(const ScalarArray& d) : ownsMemory(false), m(d.m),
+  ScalarArray(const ScalarArray& d) : ownsMemory(false), memoryCategory_(MemoryCounters::TEMPORARY), memoryBytes_(0), m(d.m),
 #ifdef HMAT_SCALAR_ARRAY_ORTHO
     is_ortho(d.is_ortho),
 #endif
@@ -143,7 +148,7 @@ public:
    */
   ScalarArray(const ScalarArray &d, const int rowsOffset, const int rowsSize,
               const int colsOffset, const int colsSize)
-      : ownsMemory(false), m(d.m + rowsOffset + (size_t)colsOffset * d.lda),
+      : ownsMemory(false), memoryCategory_(MemoryCounters::TEMPORARY), memoryBytes_(0), m(d.m + rowsOffset + (size_t)colsOffset * d.lda),
 #ifdef HMAT_SCALAR_ARRAY_ORTHO
         is_ortho(d.is_ortho),
 #endif
@@ -212,6 +217,26 @@ public:
    * \param col_num the new number of columns
    */
   void resize(int col_num);
+  /*! \brief Move the data to memory owned by somebody else.
+
+    The data is copied to ptr, which must hold rows * cols elements, and the
+    array uses it from now on. The memory owned by the array is released.
+    \return the previous data if the array did not own it (for example a
+    mapped file), NULL otherwise. It must be given to restoreData().
+   */
+  T* moveData(T* ptr);
+  /*! \brief Undo moveData() before the memory given to it is freed.
+
+    \param previous the value returned by moveData(). If NULL, the data is
+    copied to new memory owned by the array.
+   */
+  void restoreData(T* previous);
+  /*! \brief Set the MemoryCounters::Category of the memory owned by the array.
+
+    The arrays are accounted as temporaries when they are allocated, their
+    owner tags them with the category of their content.
+   */
+  void memoryCategory(int category);
   /*! \brief add term by term a random value
 
     \param epsilon  x *= (1 + a),  a = epsilon*(1.0-2.0*rand()/(double)RAND_MAX)
@@ -0,0 +1,235 @@
+/*
+  HMat-OSS (HMatrix library, open source software)
+
+  Copyright (C) 2014-2015 Airbus Group SAS
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+  http://github.com/jeromerobert/hmat-oss
+*/
+
+#include "selected_inversion.hpp"
+#include "h_matrix.hpp"
+#include "rk_matrix.hpp"
+#include "full_matrix.hpp"
+#include "cluster_tree.hpp"
+#include "common/context.hpp"
+#include "common/my_assert.h"
+
+#include <algorithm>
+
+namespace {
+
+/** Clear the symmetry flags, the copy of a factor being a plain lower triangular matrix */
+template<typename T> void clearFlags(hmat::HMatrix<T> * h) {
+  h->isUpper = false;
+  h->isLower = false;
+  h->isTriUpper = false;
+  h->isTriLower = false;
+  for (int i = 0; i < h->nrChild(); i++)
+    if (h->getChild(i))
+      clearFlags(h->getChild(i));
+}
+
+}
+
+namespace hmat {
+
+template<typename T>
+SelectedInversion<T>::SelectedInversion(const HMatrix<T> * factor, Factorization algo)
+  : factor_(factor), algo_(algo), diag_(algo == Factorization::LLT ? Diag::NONUNIT : Diag::UNIT),
+    inverse_(NULL), weights_(factor->rows()->size(), 1, false), offset_(factor->rows()->offset()) {
+  HMAT_ASSERT_MSG(algo == Factorization::LLT || algo == Factorization::LDLT,
+                  "Selected inversion requires a LLt or LDLt factorization");
+  HMAT_ASSERT_MSG(factor->isTriLower, "The matrix is not factorized");
+  if (algo == Factorization::LDLT) {
+    factor->extractDiagonal(weights_.ptr());
+    for (int i = 0; i < weights_.rows; i++)
+      weights_.get(i) = T(1) / weights_.get(i);
+  } else {
+    for (int i = 0; i < weights_.rows; i++)
+      weights_.get(i) = 1;
+  }
+}
+
+template<typename T>
+SelectedInversion<T>::~SelectedInversion() {
+  delete inverse_;
+}
+
+template<typename T>
+const HMatrix<T> * SelectedInversion<T>::inverse() const {
+  if (inverse_ == NULL) {
+    DECLARE_CONTEXT;
+    // L^-1 is the solution of L.X = I, it is lower triangular so the upper
+    // blocks of the copy of L are kept NULL
+    inverse_ = HMatrix<T>::Zero(factor_);
+    clearFlags(inverse_);
+    inverse_->addIdentity(1);
+    factor_->solveLowerTriangularLeft(inverse_, algo_, diag_, Uplo::LOWER);
+  }
+  return inverse_;
+}
+
+template<typename T>
+void SelectedInversion<T>::addDiagonal(const HMatrix<T> * h, ScalarArray<T> & d) const {
+  if (!h->isLeaf()) {
+    for (int i = 0; i < h->nrChild(); i++)
+      if (h->getChild(i))
+        addDiagonal(h->getChild(i), d);
+    return;
+  }
+  const int rowsOffset = h->rows()->offset() - offset_;
+  const int colsOffset = h->cols()->offset() - offset_;
+  const ScalarArray<T> w(weights_, rowsOffset, h->rows()->size(), 0, 1);
+  if (h->isFullMatrix()) {
+    const ScalarArray<T> & f = h->full()->data;
+    for (int j = 0; j < f.cols; j++) {
+      T s = 0;
+      for (int i = 0; i < f.rows; i++)
+        s += f.get(i, j) * f.get(i, j) * w.get(i);
+      d.get(colsOffset + j) += s;
+    }
+  } else if (h->isRkMatrix() && h->rk() && h->rank() > 0) {
+    // The column j of a.b^T is a.b_j, its weighted norm is b_j^T.(a^T.W.a).b_j
+    const RkMatrix<T> * rk = h->rk();
+    const int r = rk->rank();
+    ScalarArray<T> wa(rk->a->rows, r, false);
+    wa.copyMatrixAtOffset(rk->a, 0, 0);
+    wa.multiplyWithDiagOrDiagInv(&w, false, Side::LEFT);
+    ScalarArray<T> ata(r, r, false);
+    ata.gemm('T', 'N', 1, rk->a, &wa, 0);
+    ScalarArray<T> bata(rk->b->rows, r, false);
+    bata.gemm('N', 'N', 1, rk->b, &ata, 0);
+    for (int k = 0; k < r; k++)
+      for (int j = 0; j < bata.rows; j++)
+        d.get(colsOffset + j) += bata.get(j, k) * rk->b->get(j, k);
+  }
+}
+
+template<typename T>
+void SelectedInversion<T>::addInverseDiagonal(const HMatrix<T> * l, ScalarArray<T> & d) const {
+  if (l->isLeaf()) {
+    if (!l->isFullMatrix())
+      return;
+    // Dense diagonal leaf, its inverse is computed with the dense solve
+    const int n = l->rows()->size();
+    ScalarArray<T> x(n, n);
+    for (int i = 0; i < n; i++)
+      x.get(i, i) = 1;
+    l->solveLowerTriangularLeft(&x, algo_, diag_, Uplo::LOWER);
+    const int offset = l->rows()->offset() - offset_;
+    for (int j = 0; j < n; j++) {
+      T s = 0;
+      for (int i = j; i < n; i++)
+        s += x.get(i, j) * x.get(i, j) * weights_.get(offset + i);
+      d.get(offset + j) += s;
+    }
+    return;
+  }
+  const int k = l->nrChildRow();
+  for (int c = 0; c < k; c++) {
+    addInverseDiagonal(l->get(c, c), d);
+    // Blocks of L^-1 below the diagonal block c, which are
+    // -L_ii^-1.(L_ic - sum(L_im.Y_m, c < m < i)).L_cc^-1. Only the blocks of
+    // L in l are used, and each block of L^-1 is freed once its columns are
+    // added to d.
+    std::vector<HMatrix<T>*> y(k, (HMatrix<T>*) NULL);
+    for (int i = c + 1; i < k; i++) {
+      y[i] = l->get(i, c)->copy();
+      clearFlags(y[i]);
+      for (int m = c + 1; m < i; m++)
+        y[i]->gemm('N', 'N', -1, l->get(i, m), y[m], 1);
+      l->get(i, i)->solveLowerTriangularLeft(y[i], algo_, diag_, Uplo::LOWER);
+    }
+    for (int i = c + 1; i < k; i++) {
+      // Y_i.L_cc^-1 = (L_cc^-T.Y_i^T)^T
+      y[i]->transpose();
+      l->get(c, c)->solveUpperTriangularLeft(y[i], algo_, diag_, Uplo::LOWER);
+      y[i]->transpose();
+      addDiagonal(y[i], d);
+      delete y[i];
+    }
+  }
+}
+
+template<typename T>
+void SelectedInversion<T>::diagonal(ScalarArray<T> & d) const {
+  DECLARE_CONTEXT;
+  HMAT_ASSERT(d.rows == weights_.rows && d.cols == 1);
+  d.clear();
+  addInverseDiagonal(factor_, d);
+}
+
+template<typename T>
+void SelectedInversion<T>::addColumns(const HMatrix<T> * h, const std::vector<std::pair<int, int> > & columns,
+                                      ScalarArray<T> & y) const {
+  const int colsOffset = h->cols()->offset() - offset_;
+  std::vector<std::pair<int, int> >::const_iterator begin = std::lower_bound(
+      columns.begin(), columns.end(), std::make_pair(colsOffset, -1));
+  std::vector<std::pair<int, int> >::const_iterator end = std::lower_bound(
+      begin, columns.end(), std::make_pair(colsOffset + h->cols()->size(), -1));
+  if (begin == end)
+    return;
+  if (!h->isLeaf()) {
+    for (int i = 0; i < h->nrChild(); i++)
+      if (h->getChild(i))
+        addColumns(h->getChild(i), columns, y);
+    return;
+  }
+  const int rowsOffset = h->rows()->offset() - offset_;
+  for (std::vector<std::pair<int, int> >::const_iterator it = begin; it != end; ++it) {
+    ScalarArray<T> yj(y, rowsOffset, h->rows()->size(), it->second, 1);
+    const int j = it->first - colsOffset;
+    if (h->isFullMatrix()) {
+      const ScalarArray<T> fj(h->full()->data, 0, h->rows()->size(), j, 1);
+      yj.copyMatrixAtOffset(&fj, 0, 0);
+    } else if (h->isRkMatrix() && h->rk() && h->rank() > 0) {
+      const ScalarArray<T> bj(*h->rk()->b, j, 1, 0, h->rank());
+      yj.gemm('N', 'T', 1, h->rk()->a, &bj, 0);
+    }
+  }
+}
+
+template<typename T>
+void SelectedInversion<T>::block(const std::vector<int> & indices, ScalarArray<T> & x) const {
+  DECLARE_CONTEXT;
+  const int m = indices.size();
+  HMAT_ASSERT(x.rows == m && x.cols == m);
+  std::vector<std::pair<int, int> > columns(m);
+  for (int k = 0; k < m; k++) {
+    HMAT_ASSERT(indices[k] >= 0 && indices[k] < weights_.rows);
+    columns[k] = std::make_pair(indices[k], k);
+  }
+  std::sort(columns.begin(), columns.end());
+  // L^-1 is lower triangular, the rows above the first index are 0
+  const int first = m == 0 ? 0 : columns.front().first;
+  ScalarArray<T> y(weights_.rows, m);
+  addColumns(inverse(), columns, y);
+  ScalarArray<T> ly(y, first, y.rows - first, 0, m);
+  ScalarArray<T> wy(ly.rows, m, false);
+  wy.copyMatrixAtOffset(&ly, 0, 0);
+  const ScalarArray<T> w(weights_, first, ly.rows, 0, 1);
+  wy.multiplyWithDiagOrDiagInv(&w, false, Side::LEFT);
+  x.gemm('T', 'N', 1, &ly, &wy, 0);
+}
+
+// Explicit template instantiation
+template class SelectedInversion<S_t>;
+template class SelectedInversion<D_t>;
+template class SelectedInversion<C_t>;
+template class SelectedInversion<Z_t>;
+
+}  // end namespace hmat
@@ -0,0 +1,95 @@
+/*
+  HMat-OSS (HMatrix library, open source software)
+
+  Copyright (C) 2014-2015 Airbus Group SAS
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+  http://github.com/jeromerobert/hmat-oss
+*/
+
+/*! \file
+  \ingroup HMatrix
+  \brief Selected entries of the inverse of a LLt or LDLt factorized HMatrix.
+*/
+#ifndef _HMAT_SELECTED_INVERSION_HPP
+#define _HMAT_SELECTED_INVERSION_HPP
+
+#include "scalar_array.hpp"
+#include <vector>
+
+namespace hmat {
+
+template<typename T> class HMatrix;
+
+/*! \brief Diagonal and diagonal blocks of A^-1, with A = L.D.L^T.
+
+  As A^-1 = L^-T.D^-1.L^-1, the entry (i, j) of A^-1 is the sum over k of
+  (L^-1)_ki.(L^-1)_kj / d_k, with D = I for the LLt factorization.
+
+  The diagonal of A^-1 only requires the weighted squared norms of the
+  columns of L^-1. They are computed along the recursion on the diagonal
+  blocks of L: below the diagonal block c of a block l, the blocks of L^-1
+  are -L_ii^-1.(L_ic - sum(L_im.Y_m, c < m < i)).L_cc^-1, computed with the
+  blocks of l only, then added to the diagonal and freed. The whole L^-1 is
+  never stored, only the blocks below one diagonal block at a time.
+
+  A diagonal block of A^-1 is computed from the columns of L^-1 it selects,
+  in O(n.m) for a block of size m. L^-1 is then computed on the first call,
+  with the HMatrix triangular solve of the identity, and kept.
+
+  For the HODLR factorizations, see HODLR::inverseDiagonal().
+ */
+template<typename T> class SelectedInversion {
+public:
+  /**
+   * @param factor a LLt or LDLt factorized HMatrix, which is not modified and
+   * must outlive this object
+   * @param algo Factorization::LLT or Factorization::LDLT
+   */
+  SelectedInversion(const HMatrix<T> * factor, Factorization algo);
+  ~SelectedInversion();
+  /** d <- diag(A^-1), d being a n x 1 array in the internal numbering */
+  void diagonal(ScalarArray<T> & d) const;
+  /**
+   * x <- A^-1(indices, indices)
+   * @param indices the rows (and columns) of the block in the internal numbering
+   * @param x the result, of size indices.size() x indices.size()
+   */
+  void block(const std::vector<int> & indices, ScalarArray<T> & x) const;
+
+private:
+  const HMatrix<T> * factor_;
+  Factorization algo_;
+  Diag diag_;
+  /// L^-1, computed by the first call to block()
+  mutable HMatrix<T> * inverse_;
+  /// D^-1, or 1 for LLt
+  ScalarArray<T> weights_;
+  int offset_;
+
+  const HMatrix<T> * inverse() const;
+  /// d <- d + the weighted squared norms of the columns of l^-1, l being a diagonal block of L
+  void addInverseDiagonal(const HMatrix<T> * l, ScalarArray<T> & d) const;
+  void addDiagonal(const HMatrix<T> * h, ScalarArray<T> & d) const;
+  void addColumns(const HMatrix<T> * h, const std::vector<std::pair<int, int> > & columns,
+                  ScalarArray<T> & y) const;
+  SelectedInversion(const SelectedInversion&);
+  void operator=(const SelectedInversion&);
+};
+
+}  // end namespace hmat
+
+#endif
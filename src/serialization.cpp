@@ -22,9 +22,24 @@
 
 #include "serialization.hpp"
 #include <vector>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <stddef.h>
+#include <stdint.h>
 #include "compression.hpp"
 #include "rk_matrix.hpp"
+#include "common/codec.hpp"
 #include "common/my_assert.h"
+#include "common/memory_instrumentation.hpp"
+#include "common/task_pool.hpp"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 namespace hmat {
 
@@ -329,10 +344,12 @@ void MatrixDataUnmarshaller<T>::readLeaf(HMatrix<T> * matrix) {
 	matrix->full( fmat );
         if(pivot) {
             matrix->full()->pivots = (int*) calloc(r->size(), sizeof(int));
+            MemoryCounters::add(MemoryCounters::PIVOTS, r->size() * sizeof(int));
             readFunc_(matrix->full()->pivots, r->size() * sizeof(int), userData_);
         }
         if(diagonal) {
             matrix->full()->diagonal = new Vector<T>(r->size());
+            matrix->full()->diagonal->memoryCategory(MemoryCounters::PIVOTS);
             matrix->full()->diagonal->readArray(readFunc_, userData_);
         }
     }
@@ -365,6 +382,504 @@ void MatrixDataUnmarshaller<T>::read(HMatrix<T> * matrix){
     readFunc_(&stack, 0, userData_);
 }
 
+namespace {
+const char MAPPED_MAGIC[8] = {'H', 'M', 'A', 'T', 'M', 'A', 'P', '\0'};
+const int MAPPED_VERSION = 1;
+const size_t MAPPED_ALIGNMENT = 64;
+
+struct MappedHeader {
+    char magic[8];
+    int version;
+    int type;
+    int factorization;
+    int reserved;
+    /// Size of the structure, which is stored right after the header
+    uint64_t structSize;
+    uint64_t leafCount;
+    uint64_t indexOffset;
+    uint64_t fileSize;
+};
+
+/**
+ * Index entry of a leaf. header has the same meaning as in
+ * MatrixDataMarshaller::writeLeaf. Offsets are from the beginning of the
+ * file, 0 when there is no array.
+ */
+struct MappedLeaf {
+    int header;
+    int orthoA;
+    int orthoB;
+    int reserved;
+    /// Rk: A panel, full: data
+    uint64_t a;
+    /// Rk: B panel, full: pivots
+    uint64_t b;
+    /// full: diagonal
+    uint64_t diagonal;
+};
+
+size_t alignMapped(size_t offset) {
+    return (offset + MAPPED_ALIGNMENT - 1) / MAPPED_ALIGNMENT * MAPPED_ALIGNMENT;
+}
+
+/** Leaves in the order of MatrixDataMarshaller::write */
+template<typename M> void collectLeaves(M * matrix, std::vector<M *> & leaves) {
+    std::vector<M *> stack;
+    stack.push_back(matrix);
+    while(!stack.empty()) {
+        M * m = stack.back();
+        stack.pop_back();
+        if(m->isLeaf()) {
+            leaves.push_back(m);
+        } else {
+            for(int i = m->nrChild() - 1; i >= 0; --i) {
+                if(m->getChild(i) != NULL && !m->getChild(i)->isVoid())
+                    stack.push_back(m->getChild(i));
+            }
+        }
+    }
+}
+
+void appendToBuffer(void * data, size_t n, void * user_data) {
+    std::vector<char> * buffer = static_cast<std::vector<char> *>(user_data);
+    buffer->insert(buffer->end(), static_cast<char *>(data), static_cast<char *>(data) + n);
+}
+
+struct MemoryReader {
+    const char * current;
+    const char * end;
+};
+
+void readFromMemory(void * data, size_t n, void * user_data) {
+    MemoryReader * reader = static_cast<MemoryReader *>(user_data);
+    HMAT_ASSERT_MSG(n <= (size_t)(reader->end - reader->current), "Truncated matrix structure");
+    memcpy(data, reader->current, n);
+    reader->current += n;
+}
+
+/** Sequential writer which keeps track of the offset in the file */
+class PaddedFileWriter {
+    FILE * file_;
+    size_t offset_;
+public:
+    PaddedFileWriter(FILE * file): file_(file), offset_(0) {}
+    void write(const void * data, size_t n) {
+        HMAT_ASSERT_MSG(n == 0 || fwrite(data, n, 1, file_) == 1, "Cannot write matrix file");
+        offset_ += n;
+    }
+    void padTo(size_t offset) {
+        static const char zeros[MAPPED_ALIGNMENT] = {0};
+        assert(offset >= offset_ && offset - offset_ < MAPPED_ALIGNMENT);
+        write(zeros, offset - offset_);
+    }
+    template<typename T> void writeArray(const ScalarArray<T> * a) {
+        for(int j = 0; j < a->cols; j++)
+            write(a->const_ptr(0, j), sizeof(T) * a->rows);
+    }
+};
+
+const char CHUNKED_MAGIC[8] = {'H', 'M', 'A', 'T', 'C', 'H', 'K', '\0'};
+const int CHUNKED_VERSION = 2;
+enum ChunkCodec {CHUNK_RAW = 0, CHUNK_COMPRESSED = 1};
+
+struct ChunkedHeader {
+    char magic[8];
+    int version;
+    int type;
+    uint64_t leafCount;
+    uint64_t chunkCount;
+    /// Largest rawSize of the chunks
+    uint64_t maxChunkSize;
+};
+
+struct ChunkHeader {
+    int codec;
+    int reserved;
+    uint64_t leafCount;
+    uint64_t rawSize;
+    uint64_t storedSize;
+    /// Hash of the stored bytes, seeded with the hash of the fields above
+    uint64_t checksum;
+};
+
+uint64_t chunkChecksum(const ChunkHeader & h, const std::vector<char> & data) {
+    return checksum64(data.data(), data.size(), checksum64(&h, offsetof(ChunkHeader, checksum)));
+}
+
+/** A chunk being encoded or decoded */
+struct Chunk {
+    size_t firstLeaf;
+    ChunkHeader header;
+    std::vector<char> data;
+};
+
+/** Size written by MatrixDataMarshaller::writeLeaf, used to balance the chunks */
+template<typename T> size_t leafDataSize(const HMatrix<T> * m) {
+    const size_t r = m->rows()->size();
+    const size_t c = m->cols()->size();
+    if(!m->isAssembled() || m->isNull())
+        return sizeof(int);
+    if(m->isRkMatrix())
+        return 3 * sizeof(int) + (r + c) * m->rank() * sizeof(T);
+    return sizeof(int) + r * c * sizeof(T) + r * (sizeof(int) + sizeof(T));
+}
+
+/** Largest number of bytes written by MatrixDataMarshaller::writeLeaf for a leaf of this structure */
+template<typename T> size_t leafDataBound(const HMatrix<T> * m) {
+    const size_t r = m->rows()->size();
+    const size_t c = m->cols()->size();
+    const size_t rk = 3 * sizeof(int) + (r + c) * std::min(r, c) * sizeof(T);
+    const size_t full = sizeof(int) + r * c * sizeof(T) + r * (sizeof(int) + sizeof(T));
+    return std::max(rk, full);
+}
+}
+
+#ifndef _WIN32
+MappedFile::MappedFile(const char * filename): data_(NULL), size_(0) {
+    int fd = open(filename, O_RDONLY);
+    HMAT_ASSERT_MSG(fd != -1, "Cannot open %s", filename);
+    struct stat st;
+    int ierr = fstat(fd, &st);
+    if(ierr == 0 && st.st_size > 0) {
+        size_ = st.st_size;
+        // Private writable pages so that the matrix may still be modified
+        void * p = mmap(NULL, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if(p != MAP_FAILED)
+            data_ = static_cast<char *>(p);
+    }
+    close(fd);
+    HMAT_ASSERT_MSG(data_ != NULL, "Cannot map %s", filename);
+}
+
+MappedFile::~MappedFile() {
+    munmap(data_, size_);
+}
+#else
+MappedFile::MappedFile(const char *): data_(NULL), size_(0) {
+    HMAT_ASSERT_MSG(false, "mmap not available on this platform");
+}
+
+MappedFile::~MappedFile() {}
+#endif
+
+template<typename T>
+void MappedMatrixWriter<T>::write(const HMatrix<T> * matrix, Factorization factorization) {
+    std::vector<char> structure;
+    MatrixStructMarshaller<T>(appendToBuffer, &structure).write(matrix, factorization);
+    std::vector<const HMatrix<T> *> leaves;
+    collectLeaves(matrix, leaves);
+
+    MappedHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MAPPED_MAGIC, sizeof(MAPPED_MAGIC));
+    header.version = MAPPED_VERSION;
+    header.type = Types<T>::TYPE;
+    header.factorization = convert_factorization_to_int(factorization);
+    header.structSize = structure.size();
+    header.leafCount = leaves.size();
+    header.indexOffset = alignMapped(sizeof(header) + structure.size());
+
+    // Compute the offsets of all arrays before writing anything
+    std::vector<MappedLeaf> index(leaves.size());
+    size_t offset = alignMapped(header.indexOffset + sizeof(MappedLeaf) * leaves.size());
+    for(size_t i = 0; i < leaves.size(); i++) {
+        const HMatrix<T> * m = leaves[i];
+        MappedLeaf & e = index[i];
+        memset(&e, 0, sizeof(e));
+        const size_t r = m->rows()->size();
+        const size_t c = m->cols()->size();
+        if(!m->isAssembled()) {
+            e.header = UNINITIALIZED_BLOCK;
+        } else if(m->isRkMatrix()) {
+            e.header = m->rank();
+            if(!m->isNull()) {
+                e.orthoA = m->rk()->a->getOrtho();
+                e.orthoB = m->rk()->b->getOrtho();
+                e.a = offset;
+                offset = alignMapped(offset + sizeof(T) * r * e.header);
+                e.b = offset;
+                offset = alignMapped(offset + sizeof(T) * c * e.header);
+            }
+        } else if(m->isNull()) {
+            e.header = 1;
+        } else {
+            e.a = offset;
+            offset = alignMapped(offset + sizeof(T) * r * c);
+            if(m->full()->pivots != NULL) {
+                e.header |= 2;
+                e.b = offset;
+                offset = alignMapped(offset + sizeof(int) * r);
+            }
+            if(m->full()->diagonal != NULL) {
+                e.header |= 4;
+                e.diagonal = offset;
+                offset = alignMapped(offset + sizeof(T) * r);
+            }
+        }
+    }
+    header.fileSize = offset;
+
+    FILE * f = fopen(filename_.c_str(), "wb");
+    HMAT_ASSERT_MSG(f != NULL, "Cannot open %s", filename_.c_str());
+    PaddedFileWriter w(f);
+    w.write(&header, sizeof(header));
+    w.write(structure.data(), structure.size());
+    w.padTo(header.indexOffset);
+    w.write(index.data(), sizeof(MappedLeaf) * index.size());
+    for(size_t i = 0; i < leaves.size(); i++) {
+        const HMatrix<T> * m = leaves[i];
+        const MappedLeaf & e = index[i];
+        if(e.a == 0)
+            continue;
+        w.padTo(e.a);
+        if(m->isRkMatrix()) {
+            w.writeArray(m->rk()->a);
+            w.padTo(e.b);
+            w.writeArray(m->rk()->b);
+        } else {
+            w.writeArray(&m->full()->data);
+            if(e.b != 0) {
+                w.padTo(e.b);
+                w.write(m->full()->pivots, sizeof(int) * m->rows()->size());
+            }
+            if(e.diagonal != 0) {
+                w.padTo(e.diagonal);
+                w.writeArray(m->full()->diagonal);
+            }
+        }
+    }
+    w.padTo(header.fileSize);
+    HMAT_ASSERT_MSG(fclose(f) == 0, "Cannot write %s", filename_.c_str());
+}
+
+template<typename T>
+MappedMatrixReader<T>::MappedMatrixReader(MatrixSettings * settings, const char * filename):
+    file_(new MappedFile(filename)), settings_(settings), factorization_(Factorization::NONE) {}
+
+template<typename T>
+MappedMatrixReader<T>::~MappedMatrixReader() {
+    delete file_;
+}
+
+template<typename T>
+T * MappedMatrixReader<T>::array(size_t offset, size_t n) const {
+    HMAT_ASSERT_MSG(offset % MAPPED_ALIGNMENT == 0 && offset <= file_->size() &&
+                    n * sizeof(T) <= file_->size() - offset, "Invalid array offset %lu", (unsigned long)offset);
+    return reinterpret_cast<T *>(file_->data() + offset);
+}
+
+template<typename T>
+void MappedMatrixReader<T>::readLeaf(HMatrix<T> * matrix, const void * entry) {
+    const MappedLeaf & e = *static_cast<const MappedLeaf *>(entry);
+    const IndexSet * r = matrix->rows();
+    const IndexSet * c = matrix->cols();
+    if(matrix->isRkMatrix()) {
+        if(matrix->rk() != NULL)
+            delete matrix->rk();
+        int rank = e.header;
+        if(rank > 0) {
+            ScalarArray<T> * a = new ScalarArray<T>(array(e.a, (size_t)r->size() * rank), r->size(), rank);
+            ScalarArray<T> * b = new ScalarArray<T>(array(e.b, (size_t)c->size() * rank), c->size(), rank);
+            matrix->rk(new RkMatrix<T>(a, r, b, c));
+            matrix->rk()->a->setOrtho(e.orthoA);
+            matrix->rk()->b->setOrtho(e.orthoB);
+        } else {
+            matrix->rk(NULL);
+        }
+    } else if(!(e.header & 1)) {
+        assert(!matrix->isAssembled() || matrix->full() == NULL);
+        FullMatrix<T> * fmat = new FullMatrix<T>(array(e.a, (size_t)r->size() * c->size()), r, c, r->size());
+        matrix->full(fmat);
+        if(e.header & 2) {
+            // FullMatrix frees its pivots, so they are copied
+            HMAT_ASSERT(e.b % MAPPED_ALIGNMENT == 0 && e.b + sizeof(int) * r->size() <= file_->size());
+            fmat->pivots = (int*) calloc(r->size(), sizeof(int));
+            MemoryCounters::add(MemoryCounters::PIVOTS, r->size() * sizeof(int));
+            memcpy(fmat->pivots, file_->data() + e.b, sizeof(int) * r->size());
+        }
+        if(e.header & 4)
+            fmat->diagonal = new Vector<T>(array(e.diagonal, r->size()), r->size());
+    }
+}
+
+template<typename T>
+HMatrix<T> * MappedMatrixReader<T>::read() {
+    MappedHeader header;
+    HMAT_ASSERT_MSG(file_->size() >= sizeof(header), "Not a mapped matrix file");
+    memcpy(&header, file_->data(), sizeof(header));
+    HMAT_ASSERT_MSG(memcmp(header.magic, MAPPED_MAGIC, sizeof(MAPPED_MAGIC)) == 0, "Not a mapped matrix file");
+    HMAT_ASSERT_MSG(header.version == MAPPED_VERSION, "Unsupported mapped matrix version %d", header.version);
+    HMAT_ASSERT_MSG(header.type == Types<T>::TYPE,
+                    "Type mismatch. Reader type is %d while data type is %d",
+                    Types<T>::TYPE, header.type);
+    HMAT_ASSERT_MSG(header.fileSize == file_->size() &&
+                    header.indexOffset >= sizeof(header) + header.structSize &&
+                    header.indexOffset + sizeof(MappedLeaf) * header.leafCount <= header.fileSize,
+                    "Truncated or corrupted mapped matrix file");
+
+    MemoryReader reader;
+    reader.current = file_->data() + sizeof(header);
+    reader.end = reader.current + header.structSize;
+    MatrixStructUnmarshaller<T> unmarshaller(settings_, readFromMemory, &reader);
+    HMatrix<T> * matrix = unmarshaller.read();
+    factorization_ = unmarshaller.factorization();
+
+    std::vector<HMatrix<T> *> leaves;
+    collectLeaves(matrix, leaves);
+    HMAT_ASSERT_MSG(leaves.size() == header.leafCount, "Leaf count mismatch: %lu in index, %lu in structure",
+                    (unsigned long)header.leafCount, (unsigned long)leaves.size());
+    const MappedLeaf * index = reinterpret_cast<const MappedLeaf *>(file_->data() + header.indexOffset);
+    for(size_t i = 0; i < leaves.size(); i++)
+        readLeaf(leaves[i], index + i);
+    return matrix;
+}
+
+template<typename T>
+void ChunkedDataMarshaller<T>::write(const HMatrix<T> * matrix) {
+    std::vector<const HMatrix<T> *> leaves;
+    collectLeaves(matrix, leaves);
+    // Boundaries of the chunks in leaves
+    std::vector<size_t> bounds(1, 0);
+    size_t size = 0, maxSize = 0;
+    for(size_t i = 0; i < leaves.size(); i++) {
+        size += leafDataSize(leaves[i]);
+        if(size >= chunkSize_ || i + 1 == leaves.size()) {
+            bounds.push_back(i + 1);
+            maxSize = std::max(maxSize, size);
+            size = 0;
+        }
+    }
+    ChunkedHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CHUNKED_MAGIC, sizeof(CHUNKED_MAGIC));
+    header.version = CHUNKED_VERSION;
+    header.type = Types<T>::TYPE;
+    header.leafCount = leaves.size();
+    header.chunkCount = bounds.size() - 1;
+    header.maxChunkSize = maxSize;
+    writeFunc_(&header, sizeof(header), userData_);
+
+    // Encode a few chunks per thread in parallel, then write them in order
+    const size_t batchSize = 2 * TaskPool::instance().size();
+    for(size_t first = 0; first < header.chunkCount; first += batchSize) {
+        const size_t n = std::min(batchSize, (size_t)header.chunkCount - first);
+        std::vector<Chunk> chunks(n);
+        TaskGraph g;
+        for(size_t k = 0; k < n; k++) {
+            Chunk * chunk = &chunks[k];
+            const size_t begin = bounds[first + k], end = bounds[first + k + 1];
+            g.submit([this, chunk, &leaves, begin, end] {
+                std::vector<char> raw;
+                size_t rawSize = 0;
+                for(size_t i = begin; i < end; i++)
+                    rawSize += leafDataSize(leaves[i]);
+                raw.reserve(rawSize);
+                MatrixDataMarshaller<T> marshaller(appendToBuffer, &raw);
+                for(size_t i = begin; i < end; i++)
+                    marshaller.writeLeaf(leaves[i]);
+                ChunkHeader & h = chunk->header;
+                memset(&h, 0, sizeof(h));
+                h.codec = CHUNK_RAW;
+                h.leafCount = end - begin;
+                h.rawSize = raw.size();
+                if(compress_ && !raw.empty()) {
+                    chunk->data.resize(compressBound(raw.size()));
+                    size_t s = compressBlock(raw.data(), raw.size(), chunk->data.data(),
+                                             sizeof(typename Types<T>::real));
+                    if(s > 0) {
+                        h.codec = CHUNK_COMPRESSED;
+                        chunk->data.resize(s);
+                    }
+                }
+                if(h.codec == CHUNK_RAW)
+                    chunk->data.swap(raw);
+                h.storedSize = chunk->data.size();
+                h.checksum = chunkChecksum(h, chunk->data);
+            });
+        }
+        g.wait();
+        for(size_t k = 0; k < n; k++) {
+            writeFunc_(&chunks[k].header, sizeof(ChunkHeader), userData_);
+            writeFunc_(chunks[k].data.data(), chunks[k].data.size(), userData_);
+        }
+    }
+}
+
+template<typename T>
+void ChunkedDataUnmarshaller<T>::read(HMatrix<T> * matrix) {
+    std::vector<HMatrix<T> *> leaves;
+    collectLeaves(matrix, leaves);
+    ChunkedHeader header;
+    readFunc_(&header, sizeof(header), userData_);
+    HMAT_ASSERT_MSG(memcmp(header.magic, CHUNKED_MAGIC, sizeof(CHUNKED_MAGIC)) == 0, "Not a chunked matrix stream");
+    HMAT_ASSERT_MSG(header.version == CHUNKED_VERSION, "Unsupported chunked stream version %d", header.version);
+    HMAT_ASSERT_MSG(header.type == Types<T>::TYPE,
+                    "Type mismatch. Unmarshaller type is %d while data type is %d",
+                    Types<T>::TYPE, header.type);
+    HMAT_ASSERT_MSG(header.leafCount == leaves.size(), "Leaf count mismatch: %lu in stream, %lu in structure",
+                    (unsigned long)header.leafCount, (unsigned long)leaves.size());
+    // Nothing is allocated from the stream before its sizes are checked against the structure
+    size_t dataBound = 0;
+    for(size_t i = 0; i < leaves.size(); i++)
+        dataBound += leafDataBound(leaves[i]);
+    HMAT_ASSERT_MSG(header.chunkCount <= leaves.size() && header.maxChunkSize <= dataBound,
+                    "Corrupted chunked stream header");
+
+    const size_t batchSize = 2 * TaskPool::instance().size();
+    size_t nextLeaf = 0;
+    for(size_t first = 0; first < header.chunkCount; first += batchSize) {
+        const size_t n = std::min(batchSize, (size_t)header.chunkCount - first);
+        std::vector<Chunk> chunks(n);
+        // Read sequentially, decode in parallel
+        for(size_t k = 0; k < n; k++) {
+            Chunk & chunk = chunks[k];
+            readFunc_(&chunk.header, sizeof(ChunkHeader), userData_);
+            const ChunkHeader & h = chunk.header;
+            HMAT_ASSERT_MSG(h.leafCount <= leaves.size() - nextLeaf && h.rawSize <= header.maxChunkSize &&
+                            h.storedSize <= h.rawSize &&
+                            (h.codec == CHUNK_RAW ? h.storedSize == h.rawSize : h.codec == CHUNK_COMPRESSED),
+                            "Corrupted header in chunk %lu", (unsigned long)(first + k));
+            chunk.firstLeaf = nextLeaf;
+            nextLeaf += h.leafCount;
+            chunk.data.resize(h.storedSize);
+            readFunc_(chunk.data.data(), h.storedSize, userData_);
+        }
+        TaskGraph g;
+        for(size_t k = 0; k < n; k++) {
+            Chunk * chunk = &chunks[k];
+            const size_t index = first + k;
+            g.submit([chunk, &leaves, index] {
+                const ChunkHeader & h = chunk->header;
+                HMAT_ASSERT_MSG(chunkChecksum(h, chunk->data) == h.checksum,
+                                "Checksum mismatch in chunk %lu, the stream is truncated or corrupted",
+                                (unsigned long)index);
+                std::vector<char> raw;
+                if(h.codec == CHUNK_COMPRESSED) {
+                    raw.resize(h.rawSize);
+                    HMAT_ASSERT_MSG(uncompressBlock(chunk->data.data(), chunk->data.size(), raw.data(),
+                                                    raw.size(), sizeof(typename Types<T>::real)),
+                                    "Cannot uncompress chunk %lu", (unsigned long)index);
+                    std::vector<char>().swap(chunk->data);
+                } else {
+                    raw.swap(chunk->data);
+                }
+                MemoryReader reader;
+                reader.current = raw.data();
+                reader.end = raw.data() + raw.size();
+                MatrixDataUnmarshaller<T> unmarshaller(readFromMemory, &reader);
+                for(size_t i = 0; i < h.leafCount; i++)
+                    unmarshaller.readLeaf(leaves[chunk->firstLeaf + i]);
+                HMAT_ASSERT_MSG(reader.current == reader.end, "Chunk %lu does not match the matrix structure",
+                                (unsigned long)index);
+            });
+        }
+        g.wait();
+    }
+    HMAT_ASSERT_MSG(nextLeaf == leaves.size(), "Missing leaves in chunked stream");
+    // Comment in MatrixStructUnmarshaller<T>::read explains why readFunc_ is called there
+    readFunc_(&header, 0, userData_);
+}
+
 // Templates declaration
 template class MatrixStructMarshaller<S_t>;
 template class MatrixStructMarshaller<D_t>;
@@ -382,4 +897,20 @@ template class MatrixDataUnmarshaller<S_t>;
 template class MatrixDataUnmarshaller<D_t>;
 template class MatrixDataUnmarshaller<C_t>;
 template class MatrixDataUnmarshaller<Z_t>;
+template class MappedMatrixWriter<S_t>;
+template class MappedMatrixWriter<D_t>;
+template class MappedMatrixWriter<C_t>;
+template class MappedMatrixWriter<Z_t>;
+template class MappedMatrixReader<S_t>;
+template class MappedMatrixReader<D_t>;
+template class MappedMatrixReader<C_t>;
+template class MappedMatrixReader<Z_t>;
+template class ChunkedDataMarshaller<S_t>;
+template class ChunkedDataMarshaller<D_t>;
+template class ChunkedDataMarshaller<C_t>;
+template class ChunkedDataMarshaller<Z_t>;
+template class ChunkedDataUnmarshaller<S_t>;
+template class ChunkedDataUnmarshaller<D_t>;
+template class ChunkedDataUnmarshaller<C_t>;
+template class ChunkedDataUnmarshaller<Z_t>;
 }
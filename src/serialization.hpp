@@ -22,6 +22,7 @@
 #pragma once
 
 #include <h_matrix.hpp>
+#include <string>
 
 namespace hmat {
 
@@ -69,7 +70,6 @@ public:
 
 /** Save matrix blocks to a stream */
 template<typename T> class MatrixDataMarshaller {
-    void writeLeaf(const HMatrix<T> * matrix);
     void writeScalarArray(ScalarArray<T> * a);
     void writeInt(int v);
     hmat_iostream writeFunc_;
@@ -80,6 +80,8 @@ public:
         writeFunc_(writefunc), userData_(user_data){}
 
     void write(const HMatrix<T> * matrix);
+    /** Write the data of a single leaf */
+    void writeLeaf(const HMatrix<T> * matrix);
 };
 
 /**
@@ -87,7 +89,6 @@ public:
  * structure.
  */
 template<typename T> class MatrixDataUnmarshaller {
-    void readLeaf(HMatrix<T> * matrix);
     ScalarArray<T> * readScalarArray(int rows, int cols);
     hmat_iostream readFunc_;
     void * userData_;
@@ -96,5 +97,108 @@ public:
         readFunc_(readfunc), userData_(user_data){}
 
     void read(HMatrix<T> * matrix);
+    /** Read the data of a single leaf */
+    void readLeaf(HMatrix<T> * matrix);
+};
+
+/**
+ * Save matrix blocks to a stream in independent chunks.
+ *
+ * Leaves are grouped in chunks of about chunkSize bytes, in the order of
+ * MatrixDataMarshaller::write. Chunks are encoded in parallel, optionally
+ * compressed, and written with a checksum which is verified by
+ * ChunkedDataUnmarshaller.
+ */
+template<typename T> class ChunkedDataMarshaller {
+    hmat_iostream writeFunc_;
+    void * userData_;
+    bool compress_;
+    size_t chunkSize_;
+public:
+    ChunkedDataMarshaller(hmat_iostream writefunc, void * user_data, bool compress,
+                          size_t chunkSize = 4 << 20):
+        writeFunc_(writefunc), userData_(user_data), compress_(compress), chunkSize_(chunkSize) {}
+
+    void write(const HMatrix<T> * matrix);
+};
+
+/**
+ * Read matrix blocks written by ChunkedDataMarshaller to an existing
+ * matrix structure. Chunks are decoded in parallel. An exception is thrown
+ * if the stream is truncated or corrupted, or does not match the structure.
+ * The sizes read from the stream are checked against the structure before
+ * anything is allocated.
+ */
+template<typename T> class ChunkedDataUnmarshaller {
+    hmat_iostream readFunc_;
+    void * userData_;
+public:
+    ChunkedDataUnmarshaller(hmat_iostream readfunc, void * user_data):
+        readFunc_(readfunc), userData_(user_data){}
+
+    void read(HMatrix<T> * matrix);
+};
+
+/**
+ * A file mapped in memory.
+ * Pages are loaded on first access. Modified pages are private to the
+ * process and are never written back to the file.
+ */
+class MappedFile {
+    char * data_;
+    size_t size_;
+    MappedFile(const MappedFile &);
+    void operator=(const MappedFile &);
+public:
+    explicit MappedFile(const char * filename);
+    ~MappedFile();
+    char * data() const {
+        return data_;
+    }
+    size_t size() const {
+        return size_;
+    }
+};
+
+/**
+ * Save a matrix, structure and blocks, in a file which can be loaded
+ * with MappedMatrixReader.
+ *
+ * The file contains a header, the structure as written by
+ * MatrixStructMarshaller, an index with one entry per leaf and the leaf
+ * arrays, each one aligned on 64 bytes.
+ */
+template<typename T> class MappedMatrixWriter {
+    std::string filename_;
+public:
+    explicit MappedMatrixWriter(const char * filename): filename_(filename) {}
+    void write(const HMatrix<T> * matrix, Factorization factorization = Factorization::NONE);
+};
+
+/**
+ * Load a matrix written by MappedMatrixWriter without copying its blocks.
+ *
+ * The arrays of the leaves point to the mapped file, which must outlive
+ * the matrix returned by read().
+ */
+template<typename T> class MappedMatrixReader {
+    void readLeaf(HMatrix<T> * matrix, const void * entry);
+    T * array(size_t offset, size_t n) const;
+    MappedFile * file_;
+    MatrixSettings * settings_;
+    Factorization factorization_;
+public:
+    MappedMatrixReader(MatrixSettings * settings, const char * filename);
+    ~MappedMatrixReader();
+    HMatrix<T> * read();
+    Factorization factorization() {
+        return factorization_;
+    }
+    /** Transfer the ownership of the mapped file to the caller */
+    MappedFile * releaseFile() {
+        MappedFile * r = file_;
+        file_ = NULL;
+        return r;
+    }
 };
 }
@@ -0,0 +1,685 @@
+/*
+  HMat-OSS (HMatrix library, open source software)
+
+  Copyright (C) 2014-2015 Airbus Group SAS
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+  http://github.com/jeromerobert/hmat-oss
+*/
+
+#include "config.h"
+#include "task_engine.hpp"
+#include "hmat_cpp_interface.hpp"
+#include "common/context.hpp"
+#include "common/my_assert.h"
+#include "common/task_pool.hpp"
+#include "common/timeline.hpp"
+#include "disable_threading.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <memory>
+
+namespace {
+using namespace hmat;
+
+struct EnvVar {
+  /// Blocks with less elements than this are processed by a single task
+  size_t grain;
+  EnvVar() {
+    const char * grainStr = getenv("HMAT_TASK_GRAIN");
+    grain = grainStr == nullptr ? 128 * 128 : atol(grainStr);
+  }
+};
+static const EnvVar env;
+
+/**
+ * Last task writing each child of a HMatrix node. As the blocks read by a
+ * task are never modified afterwards in the algorithms below, tracking the
+ * last writer is enough to get all the dependencies.
+ */
+class Writers {
+  std::vector<TaskGraph::Task*> tasks_;
+  int rows_;
+public:
+  Writers(int rows, int cols): tasks_(rows * cols, nullptr), rows_(rows) {}
+  TaskGraph::Task *& operator()(int i, int j) { return tasks_[i + j * rows_]; }
+};
+
+/**
+ * Task based versions of the algorithms in recursion.cpp. Each method builds
+ * a graph over the children of its arguments, where the tasks call the same
+ * methods on the children, and waits for it.
+ */
+template<typename T> class TaskAlgorithms {
+  hmat_progress_t * progress_;
+  std::mutex progressMutex_;
+
+  bool sequential(const HMatrix<T> * m) const {
+    return m->isLeaf() || (size_t)m->rows()->size() * m->cols()->size() < env.grain;
+  }
+
+  void progress(const HMatrix<T> * m) {
+    if(progress_ == nullptr)
+      return;
+    std::lock_guard<std::mutex> lock(progressMutex_);
+    progress_->current = std::max(progress_->current, m->rows()->offset() + m->rows()->size());
+    progress_->update(progress_);
+  }
+
+public:
+  explicit TaskAlgorithms(hmat_progress_t * p): progress_(p) {}
+  void lu(HMatrix<T> * h);
+  void ldlt(HMatrix<T> * h);
+  void llt(HMatrix<T> * h);
+  void solveLowerTriangularLeft(const HMatrix<T> * l, HMatrix<T> * b, Factorization algo, Diag diag, Uplo uplo);
+  void solveUpperTriangularRight(const HMatrix<T> * u, HMatrix<T> * b, Factorization algo, Diag diag, Uplo uplo);
+  /**
+   * y <- y + alpha.op(h).x. Each task computes the contributions of a row of
+   * blocks of op(h), so tasks write to disjoint parts of y, even for
+   * transposed products.
+   */
+  void gemv(const HMatrix<T> * h, char matTrans, T alpha, const ScalarArray<T> * x, ScalarArray<T> * y);
+  /** c <- c + alpha.op(a).op(b) */
+  void gemm(HMatrix<T> * c, char transA, char transB, T alpha, const HMatrix<T> * a, const HMatrix<T> * b);
+};
+
+template<typename T> void TaskAlgorithms<T>::lu(HMatrix<T> * h) {
+  if(h->isVoid())
+    return;
+  if(sequential(h)) {
+    h->luDecomposition(nullptr);
+    progress(h);
+    return;
+  }
+  const int n = h->nrChildRow();
+  HMAT_ASSERT_MSG(n == h->nrChildCol(),
+                  "TaskAlgorithms::lu: case not allowed Nr Child A[%d, %d] Dimensions A=%s ",
+                  n, h->nrChildCol(), h->description().c_str());
+  TaskGraph g;
+  Writers w(n, n);
+  for (int k = 0; k < n; k++) {
+    HMatrix<T> * hkk = h->get(k, k);
+    if(hkk == nullptr)
+      // inert diagonal block. The associated row & column are considered as also inert.
+      continue;
+    TaskGraph::Task * f = g.submit([this, hkk]{ lu(hkk); }, {w(k, k)});
+    w(k, k) = f;
+    // Solve the rest of line k: solve Lkk Uki = Hki and get Uki
+    for (int i = k + 1; i < n; i++) {
+      HMatrix<T> * hki = h->get(k, i);
+      if(hki)
+        w(k, i) = g.submit([this, hkk, hki]{
+          solveLowerTriangularLeft(hkk, hki, Factorization::LU, Diag::UNIT, Uplo::LOWER);
+        }, {f, w(k, i)});
+    }
+    // Solve the rest of column k: solve Lik Ukk = Hik and get Lik
+    for (int i = k + 1; i < n; i++) {
+      HMatrix<T> * hik = h->get(i, k);
+      if(hik)
+        w(i, k) = g.submit([this, hkk, hik]{
+          solveUpperTriangularRight(hkk, hik, Factorization::LU, Diag::NONUNIT, Uplo::UPPER);
+        }, {f, w(i, k)});
+    }
+    // Hij <- Hij - Lik Ukj
+    for (int i = k + 1; i < n; i++) {
+      HMatrix<T> * hik = h->get(i, k);
+      if(!hik)
+        continue;
+      for (int j = k + 1; j < n; j++) {
+        HMatrix<T> * hij = h->get(i, j);
+        HMatrix<T> * hkj = h->get(k, j);
+        if(hij && hkj)
+          w(i, j) = g.submit([this, hij, hik, hkj]{
+            gemm(hij, 'N', 'N', -1, hik, hkj);
+          }, {w(i, k), w(k, j), w(i, j)});
+      }
+    }
+  }
+  g.wait();
+}
+
+template<typename T> void TaskAlgorithms<T>::ldlt(HMatrix<T> * h) {
+  if(h->isVoid()) {
+    // nothing to do
+  } else if(sequential(h)) {
+    h->ldltDecomposition(nullptr);
+    progress(h);
+    return;
+  } else {
+    const int n = h->nrChildRow();
+    HMAT_ASSERT_MSG(n == h->nrChildCol(),
+                    "TaskAlgorithms::ldlt: case not allowed Nr Child A[%d, %d] Dimensions A=%s ",
+                    n, h->nrChildCol(), h->description().c_str());
+    TaskGraph g;
+    Writers w(n, n);
+    for (int k = 0; k < n; k++) {
+      HMatrix<T> * hkk = h->get(k, k);
+      TaskGraph::Task * f = g.submit([this, hkk]{ ldlt(hkk); }, {w(k, k)});
+      w(k, k) = f;
+      // Solve the rest of column k: solve Lik Dk tLkk = Hik and get Lik
+      for (int i = k + 1; i < n; i++) {
+        HMatrix<T> * hik = h->get(i, k);
+        if(hik)
+          w(i, k) = g.submit([this, hkk, hik]{
+            solveUpperTriangularRight(hkk, hik, Factorization::LDLT, Diag::NONUNIT, Uplo::LOWER);
+            hik->multiplyWithDiag(hkk, Side::RIGHT, true);
+          }, {f, w(i, k)});
+      }
+      // Hij <- Hij - Lik Dk tLjk below the diagonal
+      for (int i = k + 1; i < n; i++) {
+        HMatrix<T> * hik = h->get(i, k);
+        if(!hik)
+          continue;
+        for (int j = k + 1; j < i; j++) {
+          HMatrix<T> * hij = h->get(i, j);
+          HMatrix<T> * hjk = h->get(j, k);
+          if(hij && hjk)
+            w(i, j) = g.submit([hij, hik, hkk, hjk]{
+              hij->mdntProduct(hik, hkk, hjk);
+            }, {w(i, k), w(j, k), w(i, j)});
+        }
+        HMatrix<T> * hii = h->get(i, i);
+        w(i, i) = g.submit([hii, hik, hkk]{ hii->mdmtProduct(hik, hkk); }, {w(i, k), w(i, i)});
+      }
+    }
+    g.wait();
+  }
+  h->isTriLower = true;
+  h->isLower = false;
+}
+
+template<typename T> void TaskAlgorithms<T>::llt(HMatrix<T> * h) {
+  if(h->isVoid()) {
+    // nothing to do
+  } else if(sequential(h)) {
+    h->lltDecomposition(nullptr);
+    progress(h);
+    return;
+  } else {
+    HMAT_ASSERT(h->isLower);
+    const int n = h->nrChildRow();
+    HMAT_ASSERT_MSG(n == h->nrChildCol(),
+                    "TaskAlgorithms::llt: case not allowed Nr Child A[%d, %d] Dimensions A=%s ",
+                    n, h->nrChildCol(), h->description().c_str());
+    TaskGraph g;
+    Writers w(n, n);
+    for (int k = 0; k < n; k++) {
+      HMatrix<T> * hkk = h->get(k, k);
+      TaskGraph::Task * f = g.submit([this, hkk]{ llt(hkk); }, {w(k, k)});
+      w(k, k) = f;
+      // Solve the rest of column k: solve Lik tLkk = Hik and get Lik
+      for (int i = k + 1; i < n; i++) {
+        HMatrix<T> * hik = h->get(i, k);
+        if(hik)
+          w(i, k) = g.submit([this, hkk, hik]{
+            solveUpperTriangularRight(hkk, hik, Factorization::LLT, Diag::NONUNIT, Uplo::LOWER);
+          }, {f, w(i, k)});
+      }
+      // Hij <- Hij - Lik tLjk below the diagonal
+      for (int i = k + 1; i < n; i++) {
+        HMatrix<T> * hik = h->get(i, k);
+        if(!hik)
+          continue;
+        for (int j = k + 1; j <= i; j++) {
+          HMatrix<T> * hij = h->get(i, j);
+          HMatrix<T> * hjk = h->get(j, k);
+          if(hij && hjk)
+            w(i, j) = g.submit([this, hij, hik, hjk]{
+              gemm(hij, 'N', 'T', -1, hik, hjk);
+            }, {w(i, k), w(j, k), w(i, j)});
+        }
+      }
+    }
+    g.wait();
+  }
+  h->isTriLower = true;
+  h->isLower = false;
+}
+
+template<typename T> void TaskAlgorithms<T>::solveLowerTriangularLeft(
+    const HMatrix<T> * l, HMatrix<T> * b, Factorization algo, Diag diag, Uplo uplo) {
+  if(l->isVoid())
+    return;
+  if(l->isLeaf() || sequential(b) || l->nrChildCol() != b->nrChildRow()) {
+    l->solveLowerTriangularLeft(b, algo, diag, uplo);
+    return;
+  }
+  // Columns of b are independent, rows are solved by forward substitution
+  TaskGraph g;
+  Writers w(b->nrChildRow(), b->nrChildCol());
+  for (int k = 0; k < b->nrChildCol(); k++) {
+    for (int i = 0; i < l->nrChildRow(); i++) {
+      HMatrix<T> * bik = b->get(i, k);
+      if(!bik)
+        continue;
+      for (int j = 0; j < i; j++) {
+        const HMatrix<T> * lij = l->get(i, j);
+        const HMatrix<T> * bjk = b->get(j, k);
+        if(lij && bjk)
+          w(i, k) = g.submit([this, bik, lij, bjk]{
+            gemm(bik, 'N', 'N', -1, lij, bjk);
+          }, {w(j, k), w(i, k)});
+      }
+      const HMatrix<T> * lii = l->get(i, i);
+      w(i, k) = g.submit([this, lii, bik, algo, diag, uplo]{
+        solveLowerTriangularLeft(lii, bik, algo, diag, uplo);
+      }, {w(i, k)});
+    }
+  }
+  g.wait();
+}
+
+template<typename T> void TaskAlgorithms<T>::solveUpperTriangularRight(
+    const HMatrix<T> * u, HMatrix<T> * b, Factorization algo, Diag diag, Uplo uplo) {
+  if(u->isVoid())
+    return;
+  if(u->isLeaf() || sequential(b) || u->nrChildRow() != b->nrChildCol()) {
+    u->solveUpperTriangularRight(b, algo, diag, uplo);
+    return;
+  }
+  // Rows of b are independent, columns are solved by forward substitution
+  TaskGraph g;
+  Writers w(b->nrChildRow(), b->nrChildCol());
+  const char transU = uplo == Uplo::LOWER ? 'T' : 'N';
+  for (int k = 0; k < b->nrChildRow(); k++) {
+    for (int i = 0; i < u->nrChildRow(); i++) {
+      HMatrix<T> * bki = b->get(k, i);
+      if(!bki)
+        continue;
+      for (int j = 0; j < i; j++) {
+        const HMatrix<T> * uji = uplo == Uplo::LOWER ? u->get(i, j) : u->get(j, i);
+        const HMatrix<T> * bkj = b->get(k, j);
+        if(uji && bkj)
+          w(k, i) = g.submit([this, bki, bkj, uji, transU]{
+            gemm(bki, 'N', transU, -1, bkj, uji);
+          }, {w(k, j), w(k, i)});
+      }
+      const HMatrix<T> * uii = u->get(i, i);
+      w(k, i) = g.submit([this, uii, bki, algo, diag, uplo]{
+        solveUpperTriangularRight(uii, bki, algo, diag, uplo);
+      }, {w(k, i)});
+    }
+  }
+  g.wait();
+}
+
+template<typename T> void TaskAlgorithms<T>::gemm(HMatrix<T> * c, char transA, char transB, T alpha,
+                                                  const HMatrix<T> * a, const HMatrix<T> * b) {
+  if(c->isVoid() || a->isVoid())
+    return;
+  if(sequential(c) || a->isLeaf() || b->isLeaf()) {
+    c->gemm(transA, transB, alpha, a, b, 1);
+    return;
+  }
+  // Same loops as HMatrix::recursiveGemm with one task per block of c
+  const int row_a = transA == 'N' ? a->nrChildRow() : a->nrChildCol();
+  const int col_a = transA == 'N' ? a->nrChildCol() : a->nrChildRow();
+  const int row_b = transB == 'N' ? b->nrChildRow() : b->nrChildCol();
+  const int col_b = transB == 'N' ? b->nrChildCol() : b->nrChildRow();
+  const int row_c = c->nrChildRow();
+  const int col_c = c->nrChildCol();
+  std::unique_ptr<unsigned char[]> is_compatible_a_b(compatibilityGridForGEMM(a, Axis::COL, transA, b, Axis::ROW, transB));
+  std::unique_ptr<unsigned char[]> is_compatible_a_c(compatibilityGridForGEMM(a, Axis::ROW, transA, c, Axis::ROW, 'N'));
+  std::unique_ptr<unsigned char[]> is_compatible_b_c(compatibilityGridForGEMM(b, Axis::COL, transB, c, Axis::COL, 'N'));
+  const unsigned char * ab = is_compatible_a_b.get();
+  const unsigned char * ac = is_compatible_a_c.get();
+  const unsigned char * bc = is_compatible_b_c.get();
+  TaskGraph g;
+  for (int i = 0; i < row_c; i++) {
+    for (int j = 0; j < col_c; j++) {
+      HMatrix<T> * child = c->get(i, j);
+      if (!child)
+        continue;
+      g.submit([=]{
+        for (int iA = 0; iA < row_a; iA++) {
+          if (!ac[iA * row_c + i])
+            continue;
+          for (int jB = 0; jB < col_b; jB++) {
+            if (!bc[jB * col_c + j])
+              continue;
+            for (int k = 0; k < col_a; k++) {
+              char tA = transA;
+              const HMatrix<T> * childA = a->getChildForGEMM(tA, iA, k);
+              if(!childA)
+                continue;
+              for (int l = 0; l < row_b; l++) {
+                if (!ab[k * row_b + l])
+                  continue;
+                char tB = transB;
+                const HMatrix<T> * childB = b->getChildForGEMM(tB, l, jB);
+                if(childB)
+                  gemm(child, tA, tB, alpha, childA, childB);
+              }
+            }
+          }
+        }
+      });
+    }
+  }
+  g.wait();
+}
+
+template<typename T> void TaskAlgorithms<T>::gemv(const HMatrix<T> * h, char matTrans, T alpha,
+                                                  const ScalarArray<T> * x, ScalarArray<T> * y) {
+  if(h->isVoid())
+    return;
+  if(sequential(h)) {
+    h->gemv(matTrans, alpha, x, 1, y);
+    return;
+  }
+  const int nrRow = matTrans == 'N' ? h->nrChildRow() : h->nrChildCol();
+  const int nrCol = matTrans == 'N' ? h->nrChildCol() : h->nrChildRow();
+  TaskGraph g;
+  for (int i = 0; i < nrRow; i++) {
+    g.submit([=]{
+      // Same order as HMatrix::gemv so the result does not depend on the engine
+      for (int j = 0; j < nrCol; j++) {
+        char trans = matTrans;
+        const HMatrix<T> * child = h->getChildForGEMM(trans, i, j);
+        if (!child)
+          continue;
+        int colsOffset = child->cols()->offset() - h->cols()->offset();
+        int colsSize   = child->cols()->size();
+        int rowsOffset = child->rows()->offset() - h->rows()->offset();
+        int rowsSize   = child->rows()->size();
+        if (trans != 'N') {
+          std::swap(colsOffset, rowsOffset);
+          std::swap(colsSize,   rowsSize);
+        }
+        const ScalarArray<T> subX(*x, colsOffset, colsSize, 0, x->cols);
+        ScalarArray<T> subY(*y, rowsOffset, rowsSize, 0, y->cols);
+        gemv(child, trans, alpha, &subX, &subY);
+      }
+    });
+  }
+  g.wait();
+}
+
+/**
+ * Delay the preparation of blocks while the memory requested by the blocks
+ * being assembled (see hmat_block_info_t.needed_memory) exceeds a budget.
+ * A block is always accepted when no other block holds memory, so a block
+ * larger than the budget is assembled alone instead of dead locking.
+ * A delayed thread runs the other pending tasks, which are the blocks
+ * asking for less memory, and only sleeps when there is none.
+ */
+class MemoryBudget: public AllocationObserver {
+  const size_t budget_;
+  mutable size_t used_;
+  mutable std::mutex mutex_;
+  mutable std::condition_variable released_;
+  bool fits(size_t size) const { return used_ == 0 || used_ + size <= budget_; }
+public:
+  /** @param budget the budget in bytes, 0 for no limit */
+  explicit MemoryBudget(size_t budget): budget_(budget), used_(0) {}
+  void allocate(size_t size) const override {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while(budget_ > 0 && !fits(size)) {
+      lock.unlock();
+      const bool helped = TaskPool::instance().runPending();
+      lock.lock();
+      if(!helped)
+        released_.wait(lock, [this, size]{ return fits(size); });
+    }
+    used_ += size;
+  }
+  void free(size_t size) const override {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      used_ -= size;
+    }
+    released_.notify_all();
+  }
+};
+
+/**
+ * Parallel version of HMatrix::assemble and HMatrix::assembleSymmetric.
+ * The leaves are assembled and compressed by independent tasks, then the
+ * non-leaf blocks are tagged as assembled and coarsened sequentially, in the
+ * same order as in the recursive algorithms.
+ */
+template<typename T> class ParallelAssembly {
+  struct Leaf {
+    HMatrix<T> * block;
+    /// upper argument of HMatrix::assembleSymmetric
+    HMatrix<T> * upper;
+    bool onlyLower;
+    /// Estimated cost, used to start the most expensive blocks first
+    double cost;
+    bool operator<(const Leaf & o) const { return cost > o.cost; }
+  };
+  Assembly<T> & f_;
+  const bool symmetric_;
+  std::vector<Leaf> leaves_;
+
+  static double cost(const HMatrix<T> * h) {
+    const double r = h->rows()->size();
+    const double c = h->cols()->size();
+    if(!h->isRkMatrix())
+      return r * c;
+    // Compressions compute about as many rows and columns as the rank
+    const int k = h->approximateRank() > 0 ? h->approximateRank() : 1;
+    return (r + c) * std::min((double)k, std::min(r, c));
+  }
+
+  void addLeaf(HMatrix<T> * h, HMatrix<T> * upper, bool onlyLower) {
+    Leaf l = { h, upper, onlyLower, cost(h) };
+    leaves_.push_back(l);
+  }
+
+  /** Walk the blocks like HMatrix::assemble, leaves are collected if finish is false */
+  void walk(HMatrix<T> * h, bool finish) {
+    if(h->isLeaf()) {
+      if(!finish)
+        addLeaf(h, nullptr, false);
+      return;
+    }
+    for (int i = 0; i < h->nrChild(); i++) {
+      if (h->getChild(i))
+        walk(h->getChild(i), finish);
+    }
+    if(finish) {
+      h->assembledRecurse();
+      if (HMatrix<T>::coarsening)
+        h->coarsen(RkMatrix<T>::approx.coarseningEpsilon);
+    }
+  }
+
+  /** Walk the blocks like HMatrix::assembleSymmetric */
+  void walkSymmetric(HMatrix<T> * h, HMatrix<T> * upper, bool onlyLower, bool finish) {
+    if(h->isLeaf()) {
+      if(!finish)
+        addLeaf(h, upper, onlyLower);
+      return;
+    }
+    if (!onlyLower && !upper)
+      upper = h;
+    if (onlyLower) {
+      for (int i = 0; i < h->nrChildRow(); i++) {
+        for (int j = 0; j < h->nrChildCol(); j++) {
+          if ((*h->rows() == *h->cols()) && (j > i))
+            continue;
+          if (h->get(i, j))
+            walkSymmetric(h->get(i, j), nullptr, true, finish);
+        }
+      }
+    } else if (h == upper) {
+      for (int i = 0; i < h->nrChildRow(); i++) {
+        for (int j = 0; j <= i; j++) {
+          if (h->get(i, j))
+            walkSymmetric(h->get(i, j), h->get(j, i), false, finish);
+        }
+      }
+    } else {
+      for (int i = 0; i < h->nrChildRow(); i++) {
+        for (int j = 0; j < h->nrChildCol(); j++) {
+          if (h->get(i, j))
+            walkSymmetric(h->get(i, j), upper->get(j, i), false, finish);
+        }
+      }
+      if(finish) {
+        upper->assembledRecurse();
+        if (HMatrix<T>::coarsening)
+          h->coarsen(RkMatrix<T>::approx.coarseningEpsilon, upper);
+      }
+    }
+    if(finish)
+      h->assembledRecurse();
+  }
+
+public:
+  ParallelAssembly(Assembly<T> & f, bool symmetric): f_(f), symmetric_(symmetric) {}
+
+  /**
+   * @param onlyLower see HMatrix::assembleSymmetric
+   * @param budget memory budget of the prepare callbacks in bytes, 0 for no limit
+   */
+  void run(HMatrix<T> * h, bool onlyLower, size_t budget) {
+    if(symmetric_)
+      walkSymmetric(h, nullptr, onlyLower, false);
+    else
+      walk(h, false);
+    // Tasks are stolen from the front of the queue: submit the largest blocks first
+    std::stable_sort(leaves_.begin(), leaves_.end());
+    MemoryBudget ao(budget);
+    TaskGraph g;
+    for(size_t i = 0; i < leaves_.size(); i++) {
+      const Leaf & l = leaves_[i];
+      if(symmetric_)
+        g.submit([this, &l, &ao]{ l.block->assembleSymmetric(f_, l.upper, l.onlyLower, ao); });
+      else
+        g.submit([this, &l, &ao]{ l.block->assemble(f_, ao); });
+    }
+    g.wait();
+    if(symmetric_)
+      walkSymmetric(h, nullptr, onlyLower, true);
+    else
+      walk(h, true);
+  }
+};
+
+}  // end anonymous namespace
+
+namespace hmat {
+
+static int taskWorkerIndex() {
+  return TaskPool::workerIndex();
+}
+
+template<typename T>
+int TaskEngine<T>::init() {
+  TaskPool & pool = TaskPool::instance();
+  tracing_set_worker_index_func(taskWorkerIndex);
+  Timeline::instance().init(pool.size() - 1);
+  return 0;
+}
+
+template<typename T>
+void TaskEngine<T>::assembly(Assembly<T>& f, SymmetryFlag sym, bool ownAssembly) {
+  DISABLE_THREADING_IN_BLOCK;
+  HMatrix<T> * h = this->hmat;
+  const bool onlyLower = h->isLower || h->isUpper;
+  ParallelAssembly<T> assembly(f, sym == kLowerSymmetric || onlyLower);
+  assembly.run(h, onlyLower, HMatSettings::getInstance().assemblyMemory);
+  if(ownAssembly)
+      delete &f;
+}
+
+template<typename T>
+void TaskEngine<T>::gemv(char trans, T alpha, ScalarArray<T>& x, T beta, ScalarArray<T>& y) const {
+  if(this->hodlr.isFactorized()) {
+    this->hodlr.gemv(trans, alpha, this->hmat, x, beta, y, true);
+  } else if(!this->hmat->isVoid()) {
+    if (beta != T(1))
+      y.scale(beta);
+    TaskAlgorithms<T> algorithms(nullptr);
+    algorithms.gemv(this->hmat, trans, alpha, &x, &y);
+  }
+}
+
+template<typename T>
+void TaskEngine<T>::factorization(Factorization algo) {
+  DISABLE_THREADING_IN_BLOCK;
+  TaskAlgorithms<T> algorithms(this->progress_);
+  switch(algo)
+  {
+  case Factorization::LU:
+      algorithms.lu(this->hmat);
+      break;
+  case Factorization::LDLT:
+      algorithms.ldlt(this->hmat);
+      break;
+  case Factorization::LLT:
+      algorithms.llt(this->hmat);
+      break;
+  case Factorization::HODLR:
+      this->hodlr.factorize(this->hmat, this->progress_, true);
+      break;
+  case Factorization::HODLRSYM:
+      this->hodlr.factorizeSym(this->hmat, this->progress_, true);
+      break;
+  default:
+      DefaultEngine<T>::factorization(algo);
+  }
+}
+
+template<typename T>
+void TaskEngine<T>::solve(ScalarArray<T>& b, Factorization algo) const {
+  switch(algo) {
+  case Factorization::HODLR:
+      this->hodlr.solve(this->hmat, b, true);
+      break;
+  case Factorization::HODLRSYM:
+      this->hodlr.solveSymLower(this->hmat, b, true);
+      this->hodlr.solveSymUpper(this->hmat, b, true);
+      break;
+  default:
+      DefaultEngine<T>::solve(b, algo);
+  }
+}
+
+template<typename T>
+void TaskEngine<T>::solve(IEngine<T>& b, Factorization algo) const {
+  if(algo == Factorization::HODLR)
+    this->hodlr.solve(this->hmat, b.hmat, true);
+  else
+    DefaultEngine<T>::solve(b, algo);
+}
+
+template<typename T>
+void TaskEngine<T>::solveLower(ScalarArray<T>& b, Factorization algo, bool transpose) const {
+  if(algo == Factorization::HODLRSYM) {
+    if(transpose)
+      this->hodlr.solveSymUpper(this->hmat, b, true);
+    else
+      this->hodlr.solveSymLower(this->hmat, b, true);
+  } else
+    DefaultEngine<T>::solveLower(b, algo, transpose);
+}
+
+}  // end namespace hmat
+
+namespace hmat {
+
+// Explicit template instantiation
+template class TaskEngine<S_t>;
+template class TaskEngine<D_t>;
+template class TaskEngine<C_t>;
+template class TaskEngine<Z_t>;
+
+}  // end namespace hmat
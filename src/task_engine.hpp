@@ -0,0 +1,66 @@
+/*
+  HMat-OSS (HMatrix library, open source software)
+
+  Copyright (C) 2014-2015 Airbus Group SAS
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; either version 2
+  of the License, or (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+
+  http://github.com/jeromerobert/hmat-oss
+*/
+
+#ifndef _TASK_ENGINE_HPP
+#define _TASK_ENGINE_HPP
+#include "default_engine.hpp"
+
+namespace hmat {
+
+/*! \brief Multithreaded engine.
+
+  The recursive LU, LDLT and LLT factorizations are unrolled into a graph of
+  tasks over the children of each HMatrix node (factorization of diagonal
+  blocks, triangular solves and updates) and executed on the
+  \a TaskPool. Each task is itself unrolled into a nested graph when its block
+  is large enough. Updates of a given block are applied in the same order as
+  in \a DefaultEngine, so both engines give the same factors.
+
+  The assembly and compression of the leaves are also run in parallel, the
+  most expensive blocks being started first. The memory requested by the
+  prepare callbacks of the blocks assembled at the same time is kept under
+  HMatSettings::assemblyMemory.
+
+  Matrix-vector products are split by row of blocks, so that concurrent
+  tasks never update the same part of the result.
+
+  The HODLR factorizations and solves process the 2 diagonal halves of each
+  node with concurrent tasks.
+
+  Other operations are inherited from \a DefaultEngine.
+ */
+template<typename T> class TaskEngine : public DefaultEngine<T>
+{
+public:
+  static int init();
+  void assembly(Assembly<T>& f, SymmetryFlag sym, bool ownAssembly) override;
+  void factorization(Factorization) override;
+  void gemv(char trans, T alpha, ScalarArray<T>& x, T beta, ScalarArray<T>& y) const override;
+  void solve(ScalarArray<T>& b, Factorization) const override;
+  void solve(IEngine<T>& b, Factorization) const override;
+  void solveLower(ScalarArray<T>& b, Factorization t, bool transpose=false) const override;
+  IEngine<T>* clone() const override { return new TaskEngine();}
+};
+
+}  // end namespace hmat
+
+#endif